@@ -0,0 +1,979 @@
+/*
+Performance benchmarks of str_view, using Google Benchmark:
+https://github.com/google/benchmark
+
+Every operation is measured for str_view and for std::string_view as a baseline,
+under the same name with the type in angle brackets, e.g.:
+
+BM_FindChar<str_view>/4096
+BM_FindChar<std::string_view>/4096
+
+Operations that std::string_view doesn't have are compared with what would be
+written instead: c_str() with constructing std::string, case-insensitive compare()
+with a loop over tolower().
+
+Run with --benchmark_filter=<regex> to select some of them, e.g. --benchmark_filter=Find.
+*/
+#include "str_view.hpp"
+#include <benchmark/benchmark.h>
+#include <string_view>
+#include <cctype>
+#include <thread>
+#include <map>
+#include <vector>
+#include <clocale>
+#include <cstdlib>
+#include <cstdio>
+
+using std::string;
+using std::wstring;
+
+/*
+Returns string of given length made of pseudo-random lowercase letters,
+except the last character, which is '#'. Searching for '#' or for a needle
+taken from the end of the haystack scans the whole string.
+*/
+static string MakeHaystack(size_t length)
+{
+    string result(length, 'a');
+    uint32_t seed = 0x12345678u;
+    for(size_t i = 0; i < length; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        result[i] = (char)('a' + (seed >> 24) % 26);
+    }
+    if(length)
+        result[length - 1] = '#';
+    return result;
+}
+
+static bool EqualNocaseNaive(std::string_view lhs, std::string_view rhs)
+{
+    if(lhs.length() != rhs.length())
+        return false;
+    for(size_t i = 0; i < lhs.length(); ++i)
+    {
+        if(tolower((unsigned char)lhs[i]) != tolower((unsigned char)rhs[i]))
+            return false;
+    }
+    return true;
+}
+
+static void HaystackArgs(benchmark::internal::Benchmark* b)
+{
+    for(int64_t length : { 16, 256, 4096, 65536 })
+        b->Arg(length);
+}
+
+static void HaystackNeedleArgs(benchmark::internal::Benchmark* b)
+{
+    for(int64_t length : { 256, 4096, 65536 })
+        for(int64_t needleLength : { 2, 8, 32, 64 })
+            b->Args({ length, needleLength });
+}
+
+static void SetBytesProcessed(benchmark::State& state, size_t length)
+{
+    state.SetBytesProcessed((int64_t)(state.iterations() * length));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Construction and length
+
+template<typename ViewT>
+static void BM_ConstructFromPointerAndLength(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0));
+    for(auto _ : state)
+    {
+        ViewT v(s.data(), s.length());
+        benchmark::DoNotOptimize(v);
+    }
+}
+BENCHMARK_TEMPLATE(BM_ConstructFromPointerAndLength, str_view)->Arg(16);
+BENCHMARK_TEMPLATE(BM_ConstructFromPointerAndLength, std::string_view)->Arg(16);
+
+// str_view doesn't calculate the length. std::string_view calls strlen.
+template<typename ViewT>
+static void BM_ConstructFromNullTerminated(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0));
+    for(auto _ : state)
+    {
+        ViewT v(s.c_str());
+        benchmark::DoNotOptimize(v);
+    }
+}
+BENCHMARK_TEMPLATE(BM_ConstructFromNullTerminated, str_view)->Apply(HaystackArgs);
+BENCHMARK_TEMPLATE(BM_ConstructFromNullTerminated, std::string_view)->Apply(HaystackArgs);
+
+template<typename ViewT>
+static void BM_ConstructFromString(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0));
+    for(auto _ : state)
+    {
+        ViewT v(s);
+        benchmark::DoNotOptimize(v);
+    }
+}
+BENCHMARK_TEMPLATE(BM_ConstructFromString, str_view)->Arg(16);
+BENCHMARK_TEMPLATE(BM_ConstructFromString, std::string_view)->Arg(16);
+
+// Construction from null-terminated string followed by length(), so the length is calculated.
+template<typename ViewT>
+static void BM_LengthLazy(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0));
+    for(auto _ : state)
+    {
+        ViewT v(s.c_str());
+        benchmark::DoNotOptimize(v.length());
+    }
+    SetBytesProcessed(state, s.length());
+}
+BENCHMARK_TEMPLATE(BM_LengthLazy, str_view)->Apply(HaystackArgs);
+BENCHMARK_TEMPLATE(BM_LengthLazy, std::string_view)->Apply(HaystackArgs);
+
+template<typename ViewT>
+static void BM_LengthKnown(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0));
+    const ViewT v(s.data(), s.length());
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(&v);
+        benchmark::DoNotOptimize(v.length());
+    }
+}
+BENCHMARK_TEMPLATE(BM_LengthKnown, str_view)->Arg(16);
+BENCHMARK_TEMPLATE(BM_LengthKnown, std::string_view)->Arg(16);
+
+////////////////////////////////////////////////////////////////////////////////
+// c_str()
+
+// View of null-terminated string returns the original pointer.
+static void BM_CStrNullTerminated(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0));
+    for(auto _ : state)
+    {
+        const str_view v(s);
+        benchmark::DoNotOptimize(v.c_str());
+    }
+}
+BENCHMARK(BM_CStrNullTerminated)->Name("BM_CStrNullTerminated<str_view>")->Apply(HaystackArgs);
+
+// Substring that is not null-terminated needs a copy.
+static void BM_CStrCopy(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0) + 1);
+    for(auto _ : state)
+    {
+        const str_view v(s.data(), s.length() - 1);
+        benchmark::DoNotOptimize(v.c_str());
+    }
+    SetBytesProcessed(state, s.length() - 1);
+}
+BENCHMARK(BM_CStrCopy)->Name("BM_CStrCopy<str_view>")->Apply(HaystackArgs);
+
+static void BM_CStrCopyInline(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0) + 1);
+    for(auto _ : state)
+    {
+        const str_view_sso v(s.data(), s.length() - 1);
+        benchmark::DoNotOptimize(v.c_str());
+    }
+}
+BENCHMARK(BM_CStrCopyInline)->Name("BM_CStrCopy<str_view_sso>")->Arg(16);
+
+static void BM_CStrCopyBaseline(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0) + 1);
+    for(auto _ : state)
+    {
+        const std::string_view v(s.data(), s.length() - 1);
+        const string copy(v);
+        benchmark::DoNotOptimize(copy.c_str());
+    }
+    SetBytesProcessed(state, s.length() - 1);
+}
+BENCHMARK(BM_CStrCopyBaseline)->Name("BM_CStrCopy<std::string_view>")->Apply(HaystackArgs);
+
+/*
+All threads call c_str() and length() of one shared view, which was created from
+a string that is not null-terminated. The copy is made once by the first thread.
+*/
+static const str_view* g_SharedView = nullptr;
+static string g_SharedString;
+
+static void BM_CStrShared(benchmark::State& state)
+{
+    if(state.thread_index() == 0)
+    {
+        g_SharedString = MakeHaystack(257);
+        g_SharedView = new str_view(g_SharedString.data(), 256);
+    }
+    // Google Benchmark starts measuring in all threads at the same time, after this setup.
+    for(auto _ : state)
+    {
+        const str_view& v = *g_SharedView;
+        benchmark::DoNotOptimize(v.c_str());
+        benchmark::DoNotOptimize(v.length());
+    }
+    if(state.thread_index() == 0)
+    {
+        delete g_SharedView;
+        g_SharedView = nullptr;
+    }
+}
+BENCHMARK(BM_CStrShared)->Name("BM_CStrShared<str_view>")->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_CStrSharedBaseline(benchmark::State& state)
+{
+    // Without a view that caches the copy, every thread has to make its own.
+    if(state.thread_index() == 0)
+        g_SharedString = MakeHaystack(257);
+    for(auto _ : state)
+    {
+        const std::string_view v(g_SharedString.data(), 256);
+        const string copy(v);
+        benchmark::DoNotOptimize(copy.c_str());
+        benchmark::DoNotOptimize(v.length());
+    }
+}
+BENCHMARK(BM_CStrSharedBaseline)->Name("BM_CStrShared<std::string_view>")->ThreadRange(1, 16)->UseRealTime();
+
+////////////////////////////////////////////////////////////////////////////////
+// Comparison
+
+// Strings equal except the last character.
+template<typename ViewT>
+static void BM_Compare(benchmark::State& state)
+{
+    const string lhs = MakeHaystack((size_t)state.range(0));
+    string rhs = lhs;
+    rhs.back() = '$';
+    const ViewT lhsView(lhs.data(), lhs.length());
+    const ViewT rhsView(rhs.data(), rhs.length());
+    for(auto _ : state)
+        benchmark::DoNotOptimize(lhsView.compare(rhsView));
+    SetBytesProcessed(state, lhs.length());
+}
+BENCHMARK_TEMPLATE(BM_Compare, str_view)->Apply(HaystackArgs);
+BENCHMARK_TEMPLATE(BM_Compare, std::string_view)->Apply(HaystackArgs);
+
+// Equal strings differing in case of letters.
+static void BM_CompareNocase(benchmark::State& state)
+{
+    const string lhs = MakeHaystack((size_t)state.range(0));
+    string rhs = lhs;
+    for(char& ch : rhs)
+        ch = (char)toupper((unsigned char)ch);
+    const str_view lhsView(lhs.data(), lhs.length());
+    const str_view rhsView(rhs.data(), rhs.length());
+    for(auto _ : state)
+        benchmark::DoNotOptimize(lhsView.compare(rhsView, false));
+    SetBytesProcessed(state, lhs.length());
+}
+BENCHMARK(BM_CompareNocase)->Name("BM_CompareNocase<str_view>")->Apply(HaystackArgs);
+
+static void BM_CompareNocaseBaseline(benchmark::State& state)
+{
+    const string lhs = MakeHaystack((size_t)state.range(0));
+    string rhs = lhs;
+    for(char& ch : rhs)
+        ch = (char)toupper((unsigned char)ch);
+    const std::string_view lhsView(lhs.data(), lhs.length());
+    const std::string_view rhsView(rhs.data(), rhs.length());
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(&lhsView);
+        benchmark::DoNotOptimize(EqualNocaseNaive(lhsView, rhsView));
+    }
+    SetBytesProcessed(state, lhs.length());
+}
+BENCHMARK(BM_CompareNocaseBaseline)->Name("BM_CompareNocase<std::string_view>")->Apply(HaystackArgs);
+
+////////////////////////////////////////////////////////////////////////////////
+// Searching
+
+template<typename ViewT>
+static void BM_FindChar(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0));
+    const ViewT v(s.data(), s.length());
+    for(auto _ : state)
+        benchmark::DoNotOptimize(v.find('#'));
+    SetBytesProcessed(state, s.length());
+}
+BENCHMARK_TEMPLATE(BM_FindChar, str_view)->Apply(HaystackArgs);
+BENCHMARK_TEMPLATE(BM_FindChar, std::string_view)->Apply(HaystackArgs);
+
+// Character placed only at the beginning.
+template<typename ViewT>
+static void BM_RFindChar(benchmark::State& state)
+{
+    string s = MakeHaystack((size_t)state.range(0));
+    s.back() = 'a';
+    s.front() = '#';
+    const ViewT v(s.data(), s.length());
+    for(auto _ : state)
+        benchmark::DoNotOptimize(v.rfind('#'));
+    SetBytesProcessed(state, s.length());
+}
+BENCHMARK_TEMPLATE(BM_RFindChar, str_view)->Apply(HaystackArgs);
+BENCHMARK_TEMPLATE(BM_RFindChar, std::string_view)->Apply(HaystackArgs);
+
+// View of unknown length. str_view calculates it in the same pass as the search, std::string_view calls strlen first.
+template<typename ViewT>
+static void BM_RFindCharNullTerminated(benchmark::State& state)
+{
+    string s = MakeHaystack((size_t)state.range(0));
+    s.back() = 'a';
+    s.front() = '#';
+    for(auto _ : state)
+    {
+        const ViewT v(s.c_str());
+        benchmark::DoNotOptimize(v.rfind('#'));
+    }
+    SetBytesProcessed(state, s.length());
+}
+BENCHMARK_TEMPLATE(BM_RFindCharNullTerminated, str_view)->Apply(HaystackArgs);
+BENCHMARK_TEMPLATE(BM_RFindCharNullTerminated, std::string_view)->Apply(HaystackArgs);
+
+// Needle taken from the end of the haystack.
+template<typename ViewT>
+static void BM_FindSubstring(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0));
+    const size_t needleLength = (size_t)state.range(1);
+    const ViewT v(s.data(), s.length());
+    const ViewT needle(s.data() + s.length() - needleLength, needleLength);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(v.find(needle));
+    SetBytesProcessed(state, s.length());
+}
+BENCHMARK_TEMPLATE(BM_FindSubstring, str_view)->Apply(HaystackNeedleArgs);
+BENCHMARK_TEMPLATE(BM_FindSubstring, std::string_view)->Apply(HaystackNeedleArgs);
+
+// Needle made of repeated 'a', in haystack of 'a' - worst case of naive algorithms.
+template<typename ViewT>
+static void BM_FindSubstringRepetitive(benchmark::State& state)
+{
+    string s((size_t)state.range(0), 'a');
+    s.back() = 'b';
+    const string needleString = string((size_t)state.range(1) - 1, 'a') + 'b';
+    const ViewT v(s.data(), s.length());
+    const ViewT needle(needleString.data(), needleString.length());
+    for(auto _ : state)
+        benchmark::DoNotOptimize(v.find(needle));
+    SetBytesProcessed(state, s.length());
+}
+BENCHMARK_TEMPLATE(BM_FindSubstringRepetitive, str_view)->Apply(HaystackNeedleArgs);
+BENCHMARK_TEMPLATE(BM_FindSubstringRepetitive, std::string_view)->Apply(HaystackNeedleArgs);
+
+// Needle taken from the beginning of the haystack.
+template<typename ViewT>
+static void BM_RFindSubstring(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0));
+    const size_t needleLength = (size_t)state.range(1);
+    string reversed(s.rbegin(), s.rend());
+    const ViewT v(reversed.data(), reversed.length());
+    const ViewT needle(reversed.data(), needleLength);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(v.rfind(needle));
+    SetBytesProcessed(state, s.length());
+}
+BENCHMARK_TEMPLATE(BM_RFindSubstring, str_view)->Apply(HaystackNeedleArgs);
+BENCHMARK_TEMPLATE(BM_RFindSubstring, std::string_view)->Apply(HaystackNeedleArgs);
+
+// Set of characters not present in the haystack except '#' at the end.
+// Second argument is number of characters in the set.
+static const char* const SET_CHARACTERS = "#0123456789ABCDEFGHIJKLMNOPQRSTU";
+
+static void SetArgs(benchmark::internal::Benchmark* b)
+{
+    for(int64_t length : { 256, 65536 })
+        for(int64_t setSize : { 1, 3, 8, 32 })
+            b->Args({ length, setSize });
+}
+
+template<typename ViewT>
+static void BM_FindFirstOf(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0));
+    const ViewT v(s.data(), s.length());
+    const ViewT chars(SET_CHARACTERS, (size_t)state.range(1));
+    for(auto _ : state)
+        benchmark::DoNotOptimize(v.find_first_of(chars));
+    SetBytesProcessed(state, s.length());
+}
+BENCHMARK_TEMPLATE(BM_FindFirstOf, str_view)->Apply(SetArgs);
+BENCHMARK_TEMPLATE(BM_FindFirstOf, std::string_view)->Apply(SetArgs);
+
+// The same with prebuilt char_set, so the lookup table is not rebuilt on every call.
+static void BM_FindFirstOfCharSet(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0));
+    const str_view v(s.data(), s.length());
+    const char_set chars(str_view(SET_CHARACTERS, (size_t)state.range(1)));
+    for(auto _ : state)
+        benchmark::DoNotOptimize(v.find_first_of(chars));
+    SetBytesProcessed(state, s.length());
+}
+BENCHMARK(BM_FindFirstOfCharSet)->Name("BM_FindFirstOf<char_set>")->Apply(SetArgs);
+
+// '#' moved to the beginning.
+template<typename ViewT>
+static void BM_FindLastOf(benchmark::State& state)
+{
+    string s = MakeHaystack((size_t)state.range(0));
+    s.back() = 'a';
+    s.front() = '#';
+    const ViewT v(s.data(), s.length());
+    const ViewT chars(SET_CHARACTERS, (size_t)state.range(1));
+    for(auto _ : state)
+        benchmark::DoNotOptimize(v.find_last_of(chars));
+    SetBytesProcessed(state, s.length());
+}
+BENCHMARK_TEMPLATE(BM_FindLastOf, str_view)->Apply(SetArgs);
+BENCHMARK_TEMPLATE(BM_FindLastOf, std::string_view)->Apply(SetArgs);
+
+// All characters are lowercase letters except '#' at the end.
+template<typename ViewT>
+static void BM_FindFirstNotOf(benchmark::State& state)
+{
+    const string s = MakeHaystack((size_t)state.range(0));
+    const ViewT v(s.data(), s.length());
+    const ViewT letters("abcdefghijklmnopqrstuvwxyz", 26);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(v.find_first_not_of(letters));
+    SetBytesProcessed(state, s.length());
+}
+BENCHMARK_TEMPLATE(BM_FindFirstNotOf, str_view)->Apply(HaystackArgs);
+BENCHMARK_TEMPLATE(BM_FindFirstNotOf, std::string_view)->Apply(HaystackArgs);
+
+template<typename ViewT>
+static void BM_FindLastNotOf(benchmark::State& state)
+{
+    string s = MakeHaystack((size_t)state.range(0));
+    s.back() = 'a';
+    s.front() = '#';
+    const ViewT v(s.data(), s.length());
+    const ViewT letters("abcdefghijklmnopqrstuvwxyz", 26);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(v.find_last_not_of(letters));
+    SetBytesProcessed(state, s.length());
+}
+BENCHMARK_TEMPLATE(BM_FindLastNotOf, str_view)->Apply(HaystackArgs);
+BENCHMARK_TEMPLATE(BM_FindLastNotOf, std::string_view)->Apply(HaystackArgs);
+
+////////////////////////////////////////////////////////////////////////////////
+// Keyword matching
+
+// 500 distinct keywords of 2-12 characters, and strings to look up: half of them keywords.
+static void MakeKeywords(std::vector<string>& keywords, std::vector<string>& queries)
+{
+    uint32_t seed = 0x9E3779B9u;
+    const auto random = [&seed](uint32_t range) {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 16) % range;
+    };
+    std::map<string, size_t> unique;
+    while(unique.size() < 500)
+    {
+        string keyword;
+        const uint32_t len = 2 + random(11);
+        for(uint32_t i = 0; i < len; ++i)
+            keyword.push_back((char)('a' + random(26)));
+        unique.insert(std::make_pair(keyword, unique.size()));
+    }
+    keywords.clear();
+    for(const auto& item : unique)
+        keywords.push_back(item.first);
+    queries.clear();
+    for(size_t i = 0; i < 1024; ++i)
+    {
+        string query = keywords[random(500)];
+        if(i % 2)
+            query.back() = '#';
+        queries.push_back(query);
+    }
+}
+
+static void BM_KeywordFind(benchmark::State& state)
+{
+    std::vector<string> keywords, queries;
+    MakeKeywords(keywords, queries);
+    std::vector<str_view_lite> keys(keywords.begin(), keywords.end());
+    const keyword_matcher matcher(keys.data(), keys.size());
+    size_t i = 0;
+    for(auto _ : state)
+        benchmark::DoNotOptimize(matcher.find(queries[i++ % queries.size()]));
+}
+BENCHMARK(BM_KeywordFind)->Name("BM_KeywordFind<keyword_matcher>");
+
+static void BM_KeywordFindBaseline(benchmark::State& state)
+{
+    std::vector<string> keywords, queries;
+    MakeKeywords(keywords, queries);
+    std::map<string, size_t, std::less<>> map;
+    for(size_t i = 0; i < keywords.size(); ++i)
+        map.insert(std::make_pair(keywords[i], i));
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        const auto it = map.find(std::string_view(queries[i++ % queries.size()]));
+        benchmark::DoNotOptimize(it == map.end() ? SIZE_MAX : it->second);
+    }
+}
+BENCHMARK(BM_KeywordFindBaseline)->Name("BM_KeywordFind<std::map>");
+
+// Log lines of about 100 characters and tokens to find in them. Every line contains some of the tokens.
+static void MakeLogLines(size_t tokenCount, std::vector<string>& tokens, std::vector<string>& lines)
+{
+    uint32_t seed = 0x85EBCA6Bu;
+    const auto random = [&seed](uint32_t range) {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 16) % range;
+    };
+    tokens.clear();
+    for(size_t i = 0; i < tokenCount; ++i)
+        tokens.push_back("E" + std::to_string(1000 + i * 37) + ":");
+    lines.clear();
+    for(size_t i = 0; i < 256; ++i)
+    {
+        string line = "2024-01-01 12:00:" + std::to_string(10 + i % 50) + " [worker-" + std::to_string(i % 8) + "]";
+        while(line.length() < 100)
+        {
+            line += ' ';
+            if(random(8) == 0)
+                line += tokens[random((uint32_t)tokenCount)];
+            else
+            {
+                const uint32_t len = 2 + random(8);
+                for(uint32_t j = 0; j < len; ++j)
+                    line.push_back((char)('a' + random(26)));
+            }
+        }
+        lines.push_back(line);
+    }
+}
+
+static void BM_MultiFind(benchmark::State& state)
+{
+    std::vector<string> tokens, lines;
+    MakeLogLines((size_t)state.range(0), tokens, lines);
+    std::vector<str_view_lite> patterns(tokens.begin(), tokens.end());
+    const str_view_multi_searcher searcher(patterns.data(), patterns.size());
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        size_t sum = 0;
+        searcher.find_all(lines[i++ % lines.size()], [&sum](size_t pos, size_t patternIndex) { sum += pos + patternIndex; });
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_MultiFind)->Name("BM_MultiFind<str_view_multi_searcher>")->Arg(4)->Arg(200);
+
+static void BM_MultiFindBaseline(benchmark::State& state)
+{
+    std::vector<string> tokens, lines;
+    MakeLogLines((size_t)state.range(0), tokens, lines);
+    std::vector<str_view_searcher> searchers;
+    for(const string& token : tokens)
+        searchers.push_back(str_view_searcher(token));
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        const str_view line = lines[i++ % lines.size()];
+        size_t sum = 0;
+        for(size_t patternIndex = 0; patternIndex < searchers.size(); ++patternIndex)
+            searchers[patternIndex].find_all(line, [&sum, patternIndex](size_t pos) { sum += pos + patternIndex; });
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_MultiFindBaseline)->Name("BM_MultiFind<str_view_searcher>")->Arg(4)->Arg(200);
+
+// Text in UTF-8, mostly ASCII with some 2- and 3-byte characters, like Polish text or JSON with names.
+static string MakeUtf8Text(size_t length)
+{
+    const char* const words[] = { "Ala", "ma", "kota", "za\xC5\xBC\xC3\xB3\xC5\x82\xC4\x87", "g\xC4\x99\xC5\x9Bl\xC4\x85", "\xE2\x82\xAC", "value", "\"name\":" };
+    string result;
+    for(size_t i = 0; result.length() < length; ++i)
+    {
+        result += words[(i * 7) % 8];
+        result += ' ';
+    }
+    result.resize(length);
+    while(!str_view(result).is_valid_utf8())
+        result.pop_back();
+    return result;
+}
+
+static void BM_Utf8Validate(benchmark::State& state)
+{
+    const string text = MakeUtf8Text((size_t)state.range(0));
+    const str_view view = str_view(text);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(view.is_valid_utf8());
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)text.length());
+}
+BENCHMARK(BM_Utf8Validate)->Name("BM_Utf8Validate<str_view>")->Arg(64)->Arg(4096);
+
+static void BM_Utf8ToWide(benchmark::State& state)
+{
+    const string text = MakeUtf8Text((size_t)state.range(0));
+    std::vector<wchar_t> buf(text.length() + 1);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(str_view_utf8_to_wide(text, buf.data()));
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)text.length());
+}
+BENCHMARK(BM_Utf8ToWide)->Name("BM_Utf8ToWide<str_view>")->Arg(64)->Arg(4096);
+
+// Conversion by the C library, in UTF-8 locale.
+static void BM_Utf8ToWideBaseline(benchmark::State& state)
+{
+    if(!setlocale(LC_CTYPE, ".UTF8") && !setlocale(LC_CTYPE, "C.UTF-8"))
+    {
+        state.SkipWithError("UTF-8 locale not available");
+        return;
+    }
+    const string text = MakeUtf8Text((size_t)state.range(0));
+    std::vector<wchar_t> buf(text.length() + 1);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(mbstowcs(buf.data(), text.c_str(), buf.size()));
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)text.length());
+    setlocale(LC_CTYPE, "C");
+}
+BENCHMARK(BM_Utf8ToWideBaseline)->Name("BM_Utf8ToWide<mbstowcs>")->Arg(64)->Arg(4096);
+
+static void BM_WideToUtf8(benchmark::State& state)
+{
+    wstring wide;
+    str_view_utf8_to_wide(MakeUtf8Text((size_t)state.range(0)), wide);
+    std::vector<char> buf(str_view_wide_to_utf8_max_length(wide.length()) + 1);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(str_view_wide_to_utf8(wide, buf.data()));
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)wide.length() * (int64_t)sizeof(wchar_t));
+}
+BENCHMARK(BM_WideToUtf8)->Name("BM_WideToUtf8<str_view>")->Arg(64)->Arg(4096);
+
+static void BM_WideToUtf8Baseline(benchmark::State& state)
+{
+    if(!setlocale(LC_CTYPE, ".UTF8") && !setlocale(LC_CTYPE, "C.UTF-8"))
+    {
+        state.SkipWithError("UTF-8 locale not available");
+        return;
+    }
+    wstring wide;
+    str_view_utf8_to_wide(MakeUtf8Text((size_t)state.range(0)), wide);
+    std::vector<char> buf(str_view_wide_to_utf8_max_length(wide.length()) + 1);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(wcstombs(buf.data(), wide.c_str(), buf.size()));
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)wide.length() * (int64_t)sizeof(wchar_t));
+    setlocale(LC_CTYPE, "C");
+}
+BENCHMARK(BM_WideToUtf8Baseline)->Name("BM_WideToUtf8<wcstombs>")->Arg(64)->Arg(4096);
+
+// Numbers like in CSV fields: integers with given number of digits, or decimals with 2 to 6 fraction digits.
+static std::vector<string> MakeNumbers(size_t digitCount, bool decimal)
+{
+    std::vector<string> result;
+    uint32_t seed = 1;
+    for(size_t i = 0; i < 1000; ++i)
+    {
+        string number = i % 4 == 0 ? "-" : "";
+        for(size_t j = 0; j < digitCount; ++j)
+        {
+            seed = seed * 1103515245u + 12345u;
+            number += (char)('0' + (j == 0 ? 1 + (seed >> 16) % 9 : (seed >> 16) % 10));
+        }
+        if(decimal)
+            number.insert(number.length() - 2 - i % 5, 1, '.');
+        result.push_back(number);
+    }
+    return result;
+}
+
+static void BM_ParseInt(benchmark::State& state)
+{
+    const std::vector<string> numbers = MakeNumbers((size_t)state.range(0), false);
+    for(auto _ : state)
+    {
+        int64_t sum = 0;
+        for(const string& number : numbers)
+            sum += str_view(number).to_int();
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)numbers.size());
+}
+BENCHMARK(BM_ParseInt)->Name("BM_ParseInt<str_view>")->Arg(4)->Arg(16);
+
+// strtoll needs null-terminated strings, which are given here for free.
+static void BM_ParseIntBaseline(benchmark::State& state)
+{
+    const std::vector<string> numbers = MakeNumbers((size_t)state.range(0), false);
+    for(auto _ : state)
+    {
+        int64_t sum = 0;
+        for(const string& number : numbers)
+            sum += strtoll(number.c_str(), nullptr, 10);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)numbers.size());
+}
+BENCHMARK(BM_ParseIntBaseline)->Name("BM_ParseInt<strtoll>")->Arg(4)->Arg(16);
+
+static void BM_ParseDouble(benchmark::State& state)
+{
+    const std::vector<string> numbers = MakeNumbers((size_t)state.range(0), true);
+    for(auto _ : state)
+    {
+        double sum = 0;
+        for(const string& number : numbers)
+            sum += str_view(number).to_double();
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)numbers.size());
+}
+BENCHMARK(BM_ParseDouble)->Name("BM_ParseDouble<str_view>")->Arg(8)->Arg(16);
+
+static void BM_ParseDoubleBaseline(benchmark::State& state)
+{
+    const std::vector<string> numbers = MakeNumbers((size_t)state.range(0), true);
+    for(auto _ : state)
+    {
+        double sum = 0;
+        for(const string& number : numbers)
+            sum += strtod(number.c_str(), nullptr);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)numbers.size());
+}
+BENCHMARK(BM_ParseDoubleBaseline)->Name("BM_ParseDouble<strtod>")->Arg(8)->Arg(16);
+
+// Random doubles of any magnitude with 17 significant digits, too precise for the exact fast path.
+static std::vector<string> MakePreciseDoubles()
+{
+    std::vector<string> result;
+    uint64_t seed = 1;
+    char buf[64];
+    while(result.size() < 1000)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        double number;
+        memcpy(&number, &seed, sizeof(number));
+        if(number == number && number - number == 0)
+        {
+            snprintf(buf, sizeof(buf), "%.17g", number);
+            result.push_back(buf);
+        }
+    }
+    return result;
+}
+
+static void BM_ParsePreciseDouble(benchmark::State& state)
+{
+    const std::vector<string> numbers = MakePreciseDoubles();
+    for(auto _ : state)
+    {
+        double sum = 0;
+        for(const string& number : numbers)
+            sum += str_view(number).to_double();
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)numbers.size());
+}
+BENCHMARK(BM_ParsePreciseDouble)->Name("BM_ParsePreciseDouble<str_view>");
+
+static void BM_ParsePreciseDoubleBaseline(benchmark::State& state)
+{
+    const std::vector<string> numbers = MakePreciseDoubles();
+    for(auto _ : state)
+    {
+        double sum = 0;
+        for(const string& number : numbers)
+            sum += strtod(number.c_str(), nullptr);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)numbers.size());
+}
+BENCHMARK(BM_ParsePreciseDoubleBaseline)->Name("BM_ParsePreciseDouble<strtod>");
+
+// CSV with given number of columns of short numbers and a quoted text column.
+static string MakeCsv(size_t columnCount)
+{
+    string result;
+    uint32_t seed = 1;
+    for(size_t row = 0; row < 500; ++row)
+    {
+        for(size_t col = 0; col < columnCount; ++col)
+        {
+            seed = seed * 1103515245u + 12345u;
+            result += col == 0 ? "\"name, with comma\"" : std::to_string((seed >> 16) % 100000);
+            result += col + 1 < columnCount ? ',' : '\n';
+        }
+    }
+    return result;
+}
+
+static void BM_CsvFields(benchmark::State& state)
+{
+    const string csv = MakeCsv((size_t)state.range(0));
+    str_view_structural_index index;
+    for(auto _ : state)
+    {
+        index.build(csv);
+        size_t sum = 0;
+        for(size_t i = 0; i < index.field_count(); ++i)
+            sum += index.field(i).length();
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)csv.length());
+}
+BENCHMARK(BM_CsvFields)->Name("BM_CsvFields<str_view_structural_index>")->Arg(4)->Arg(40);
+
+// Fields found by find() of the delimiter and of the closing quote, one at a time.
+static void BM_CsvFieldsBaseline(benchmark::State& state)
+{
+    const string csv = MakeCsv((size_t)state.range(0));
+    const std::string_view view = csv;
+    for(auto _ : state)
+    {
+        size_t sum = 0;
+        for(size_t pos = 0; pos < view.length(); )
+        {
+            size_t end = pos;
+            if(view[pos] == '"')
+                end = view.find('"', pos + 1) + 1;
+            end = std::min(view.find_first_of(",\n", end), view.length());
+            sum += end - pos;
+            pos = end + 1;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)csv.length());
+}
+BENCHMARK(BM_CsvFieldsBaseline)->Name("BM_CsvFields<std::string_view>")->Arg(4)->Arg(40);
+
+// Keys like in a dedup job: common prefixes, about 4 copies of every key.
+static std::vector<string> MakeSortKeys(size_t count)
+{
+    std::vector<string> result;
+    char buf[64];
+    uint32_t seed = 1;
+    for(size_t i = 0; i < count; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const uint32_t id = (seed >> 4) % (uint32_t)(count / 4 + 1);
+        snprintf(buf, sizeof(buf), "%s/item/%u", (seed & 3) ? "host.example.com" : "cdn.example.org", id);
+        result.push_back(buf);
+    }
+    return result;
+}
+
+// Every iteration also copies the unsorted views, like the baselines.
+static void BM_Sort(benchmark::State& state)
+{
+    const std::vector<string> keys = MakeSortKeys((size_t)state.range(0));
+    const std::vector<str_view_lite> unsorted(keys.begin(), keys.end());
+    for(auto _ : state)
+    {
+        std::vector<str_view_lite> views = unsorted;
+        str_view_sort(views);
+        benchmark::DoNotOptimize(views.data());
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)keys.size());
+}
+BENCHMARK(BM_Sort)->Name("BM_Sort<str_view_sort>")->Arg(1 << 12)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+static void BM_SortParallel(benchmark::State& state)
+{
+    const std::vector<string> keys = MakeSortKeys((size_t)state.range(0));
+    const std::vector<str_view_lite> unsorted(keys.begin(), keys.end());
+    str_view_thread_executor executor;
+    for(auto _ : state)
+    {
+        std::vector<str_view_lite> views = unsorted;
+        str_view_sort(views, str_view_parallel_options(&executor, 1 << 16));
+        benchmark::DoNotOptimize(views.data());
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)keys.size());
+}
+BENCHMARK(BM_SortParallel)->Name("BM_Sort<str_view_sort parallel>")->Arg(1 << 20)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_SortStrView(benchmark::State& state)
+{
+    const std::vector<string> keys = MakeSortKeys((size_t)state.range(0));
+    const std::vector<str_view> unsorted(keys.begin(), keys.end());
+    for(auto _ : state)
+    {
+        std::vector<str_view> views = unsorted;
+        std::sort(views.begin(), views.end());
+        benchmark::DoNotOptimize(views.data());
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)keys.size());
+}
+BENCHMARK(BM_SortStrView)->Name("BM_Sort<std::sort str_view>")->Arg(1 << 12)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+static void BM_SortBaseline(benchmark::State& state)
+{
+    const std::vector<string> keys = MakeSortKeys((size_t)state.range(0));
+    const std::vector<std::string_view> unsorted(keys.begin(), keys.end());
+    for(auto _ : state)
+    {
+        std::vector<std::string_view> views = unsorted;
+        std::sort(views.begin(), views.end());
+        benchmark::DoNotOptimize(views.data());
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)keys.size());
+}
+BENCHMARK(BM_SortBaseline)->Name("BM_Sort<std::sort std::string_view>")->Arg(1 << 12)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+static void BM_Unique(benchmark::State& state)
+{
+    const std::vector<string> keys = MakeSortKeys((size_t)state.range(0));
+    std::vector<str_view_lite> sorted(keys.begin(), keys.end());
+    str_view_sort(sorted);
+    for(auto _ : state)
+    {
+        std::vector<str_view_lite> views = sorted;
+        str_view_unique(views);
+        benchmark::DoNotOptimize(views.data());
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)keys.size());
+}
+BENCHMARK(BM_Unique)->Name("BM_Unique<str_view_unique>")->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+static void BM_UniqueBaseline(benchmark::State& state)
+{
+    const std::vector<string> keys = MakeSortKeys((size_t)state.range(0));
+    std::vector<std::string_view> sorted(keys.begin(), keys.end());
+    std::sort(sorted.begin(), sorted.end());
+    for(auto _ : state)
+    {
+        std::vector<std::string_view> views = sorted;
+        views.erase(std::unique(views.begin(), views.end()), views.end());
+        benchmark::DoNotOptimize(views.data());
+    }
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)keys.size());
+}
+BENCHMARK(BM_UniqueBaseline)->Name("BM_Unique<std::unique std::string_view>")->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+    if(!str_view_cpu_supports_build())
+    {
+        fprintf(stderr, "This CPU doesn't support %s.\n", str_view_simd_name());
+        return 77;
+    }
+    benchmark::Initialize(&argc, argv);
+    if(benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -1,5 +1,17 @@
 #include "str_view.hpp"
 #include <thread>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <cfloat>
+#ifdef __cpp_lib_ranges
+    #include <ranges>
+#endif
 
 #define TEST(expr)   do { \
     if(!(expr)) { \
@@ -372,6 +384,3085 @@ static void TestOtherMethods()
     }
 }
 
+template<typename CharT>
+static void TestFindCharKernel()
+{
+    // Lengths cover scalar path, whole SIMD blocks and partial last blocks.
+    std::basic_string<CharT> buf(200, (CharT)'.');
+    for(size_t len = 0; len < buf.length(); ++len)
+    {
+        const str_view_template<CharT> v(buf.data(), len);
+        TEST(v.find((CharT)'|') == SIZE_MAX);
+        TEST(v.rfind((CharT)'|') == SIZE_MAX);
+        for(size_t at = 0; at < len; ++at)
+        {
+            buf[at] = (CharT)'|';
+            TEST(v.find((CharT)'|') == at);
+            TEST(v.rfind((CharT)'|') == at);
+            TEST(v.find((CharT)'|', at) == at);
+            TEST(v.find((CharT)'|', at + 1) == SIZE_MAX);
+            TEST(v.rfind((CharT)'|', at) == at);
+            TEST(at == 0 || v.rfind((CharT)'|', at - 1) == SIZE_MAX);
+            buf[at] = (CharT)'.';
+        }
+    }
+
+    // Multiple occurrences - first and last one must be found.
+    buf.assign(100, (CharT)'.');
+    buf[17] = buf[40] = buf[41] = buf[90] = (CharT)'=';
+    const str_view_template<CharT> v(buf);
+    TEST(v.find((CharT)'=') == 17);
+    TEST(v.find((CharT)'=', 18) == 40);
+    TEST(v.find((CharT)'=', 42) == 90);
+    TEST(v.rfind((CharT)'=') == 90);
+    TEST(v.rfind((CharT)'=', 89) == 41);
+    TEST(v.rfind((CharT)'=', 39) == 17);
+    TEST(v.find((CharT)'=', 1000) == SIZE_MAX);
+
+    // Characters with high bits set must not match sign-extended or partial lanes.
+    buf.assign(64, (CharT)0x7F);
+    buf[50] = (CharT)0xFF;
+    const str_view_template<CharT> high(buf);
+    TEST(high.find((CharT)0xFF) == 50);
+    TEST(high.rfind((CharT)0xFF) == 50);
+}
+
+static void TestFindChar()
+{
+    TestFindCharKernel<char>();
+    TestFindCharKernel<wchar_t>();
+
+    // Unknown length, null-terminated.
+    const char* sz = "key=value|key2=value2|key3=value3|key4=value4";
+    TEST(str_view(sz).find('|') == 9);
+    TEST(str_view(sz).rfind('|') == 33);
+    TEST(str_view(sz).find('\n') == SIZE_MAX);
+    TEST(wstr_view(L"key=value|key2=value2|key3=value3").find(L'=', 4) == 14);
+}
+
+template<typename CharT>
+static size_t NaiveFind(const std::basic_string<CharT>& haystack, const std::basic_string<CharT>& needle, size_t pos)
+{
+    for(size_t i = pos; i + needle.length() <= haystack.length(); ++i)
+    {
+        if(haystack.compare(i, needle.length(), needle) == 0)
+            return i;
+    }
+    return SIZE_MAX;
+}
+
+template<typename CharT>
+static size_t NaiveRFind(const std::basic_string<CharT>& haystack, const std::basic_string<CharT>& needle, size_t pos)
+{
+    if(haystack.length() < needle.length())
+        return SIZE_MAX;
+    for(size_t i = std::min(pos, haystack.length() - needle.length()) + 1; i--; )
+    {
+        if(haystack.compare(i, needle.length(), needle) == 0)
+            return i;
+    }
+    return SIZE_MAX;
+}
+
+template<typename CharT>
+static void TestFindSubstringKernel()
+{
+    typedef std::basic_string<CharT> StringT;
+    typedef str_view_template<CharT> ViewT;
+
+    // Pseudo-random strings over small alphabet produce many partial matches and periodic needles.
+    uint32_t seed = 12345;
+    auto random = [&seed](uint32_t max) -> uint32_t {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % max;
+    };
+    for(size_t iter = 0; iter < 2000; ++iter)
+    {
+        const uint32_t alphabet = 2 + random(3);
+        StringT haystack(random(300), (CharT)'a');
+        for(CharT& ch : haystack)
+            ch = (CharT)('a' + random(alphabet));
+        StringT needle;
+        if(!haystack.empty() && random(2))
+        {
+            // Needle taken from haystack so it's found at least once.
+            const size_t offset = random((uint32_t)haystack.length());
+            needle = haystack.substr(offset, 1 + random(80));
+        }
+        else
+        {
+            needle.resize(1 + random(80));
+            for(CharT& ch : needle)
+                ch = (CharT)('a' + random(alphabet));
+        }
+        const size_t pos = random(2) ? 0 : random((uint32_t)haystack.length() + 2);
+        const ViewT haystackView(haystack);
+        const ViewT needleView(needle);
+        TEST(haystackView.find(needleView, pos) == NaiveFind(haystack, needle, pos));
+        TEST(haystackView.find(needleView) == NaiveFind(haystack, needle, 0));
+        TEST(haystackView.rfind(needleView, pos) == NaiveRFind(haystack, needle, pos));
+        TEST(haystackView.rfind(needleView) == NaiveRFind(haystack, needle, SIZE_MAX));
+    }
+
+    // Pathological case for naive search: long needle almost matching everywhere.
+    {
+        StringT haystack(100000, (CharT)'a');
+        StringT needle(1000, (CharT)'a');
+        needle[500] = (CharT)'b';
+        const ViewT haystackView(haystack);
+        TEST(haystackView.find(ViewT(needle)) == SIZE_MAX);
+        TEST(haystackView.rfind(ViewT(needle)) == SIZE_MAX);
+        haystack[70000] = (CharT)'b';
+        const ViewT haystackView2(haystack);
+        TEST(haystackView2.find(ViewT(needle)) == 69500);
+        TEST(haystackView2.rfind(ViewT(needle)) == 69500);
+    }
+}
+
+static void TestFindSubstring()
+{
+    TestFindSubstringKernel<char>();
+    TestFindSubstringKernel<wchar_t>();
+
+    const char* sz = "GET /index.html HTTP/1.1\r\nHost: example.com\r\nContent-Type: text/html\r\n\r\n";
+    TEST(str_view(sz).find("\r\n\r\n") == 68);
+    TEST(str_view(sz).find("Content-Type") == 45);
+    TEST(str_view(sz).rfind("\r\n") == 70);
+    TEST(str_view(sz).rfind("\r\n", 69) == 68);
+    TEST(str_view(sz).find("Content-Type: text/html\r\n\r\nXYZ") == SIZE_MAX);
+}
+
+static void TestSearcher()
+{
+    // Short needle
+    {
+        const str_view_searcher searcher = str_view_searcher("ma");
+        TEST(searcher.length() == 2);
+        TEST(searcher.find_in("Ala ma kota") == 4);
+        TEST(searcher.find_in("Ala ma kota", 5) == SIZE_MAX);
+        TEST(searcher.find_in("Mateusz ma psy") == 8);
+        TEST(searcher.find_in("") == SIZE_MAX);
+        TEST(searcher.rfind_in("mama") == 2);
+        TEST(searcher.rfind_in("mama", 1) == 0);
+
+        std::vector<size_t> found;
+        TEST(searcher.find_all("mamama", [&found](size_t pos) { found.push_back(pos); }) == 3);
+        TEST(found == std::vector<size_t>({ 0, 2, 4 }));
+    }
+
+    // Overlapping occurrences and single character
+    {
+        std::vector<size_t> found;
+        TEST(str_view_searcher("aa").find_all("aaaa", [&found](size_t pos) { found.push_back(pos); }) == 3);
+        TEST(found == std::vector<size_t>({ 0, 1, 2 }));
+        TEST(str_view_searcher("|").find_all("a|b||c", [](size_t) { }) == 3);
+        TEST(str_view_searcher("|").rfind_in("a|b||c") == 4);
+    }
+
+    // Empty needle
+    {
+        const str_view_searcher searcher = str_view_searcher(str_view());
+        TEST(searcher.find_in("ABC", 2) == 2);
+        TEST(searcher.find_all("ABC", [](size_t) { }) == 4);
+    }
+
+    // Long needle - must give the same results as find() and rfind().
+    {
+        string haystack;
+        for(size_t i = 0; i < 50; ++i)
+            haystack += "abcabcabdabcabcabcabdabcabcabcabdabcabc-";
+        const string needle = "abcabcabdabcabcabcabdabcabcabcabdabcabc-abcabcabd";
+        const str_view_searcher searcher = str_view_searcher(needle);
+        const str_view haystackView = str_view(haystack);
+        TEST(searcher.find_in(haystackView) == haystackView.find(needle));
+        TEST(searcher.find_in(haystackView, 7) == haystackView.find(needle, 7));
+        TEST(searcher.rfind_in(haystackView) == haystackView.rfind(needle));
+        TEST(searcher.rfind_in(haystackView, 1000) == haystackView.rfind(needle, 1000));
+        size_t expectedPos = 0;
+        TEST(searcher.find_all(haystackView, [&](size_t pos) {
+            expectedPos = haystackView.find(needle, expectedPos);
+            TEST(pos == expectedPos);
+            ++expectedPos;
+        }) == 49);
+    }
+
+    // Overlapping occurrences of long needles, periodic and not, compared with find().
+    {
+        uint32_t seed = 7;
+        const auto random = [&seed](uint32_t range) {
+            seed = seed * 1664525u + 1013904223u;
+            return (seed >> 8) % range;
+        };
+        for(size_t test = 0; test < 300; ++test)
+        {
+            string unit(1 + random(test % 2 ? 5 : 40), 'a');
+            for(char& ch : unit)
+                ch = (char)('a' + random(2));
+            string needle;
+            while(needle.length() < 33 + random(60))
+                needle += unit;
+            string haystack;
+            while(haystack.length() < 2000)
+                haystack += random(8) ? unit : string(1, (char)('a' + random(3)));
+            std::vector<size_t> expected, found;
+            for(size_t pos = haystack.find(needle); pos != string::npos; pos = haystack.find(needle, pos + 1))
+                expected.push_back(pos);
+            TEST(str_view_searcher(needle).find_all(haystack, [&found](size_t pos) { found.push_back(pos); }) == expected.size());
+            TEST(found == expected);
+        }
+        // Linear time: a periodic needle matching at every position.
+        const string haystack(1 << 20, 'a'), needle(2000, 'a');
+        size_t last = 0;
+        TEST(str_view_searcher(needle).find_all(haystack, [&last](size_t pos) { last = pos; }) == haystack.length() - needle.length() + 1);
+        TEST(last == haystack.length() - needle.length());
+    }
+
+    // Unicode
+    {
+        const wstr_view_searcher searcher = wstr_view_searcher(L"kot");
+        TEST(searcher.find_in(L"Ala ma kota") == 7);
+        TEST(searcher.rfind_in(L"kot kot kot") == 8);
+    }
+
+#if __cplusplus >= 201703L || _MSVC_LANG >= 201703L
+    // std::search
+    {
+        const string haystack = "Content-Type: text/html";
+        const str_view_searcher searcher = str_view_searcher("text");
+        auto it = std::search(haystack.begin(), haystack.end(), searcher);
+        TEST(it - haystack.begin() == 14);
+        const str_view haystackView = str_view(haystack);
+        TEST(std::search(haystackView.begin(), haystackView.end(), str_view_searcher("xml")) == haystackView.end());
+    }
+#endif
+}
+
+template<typename CharT>
+static void TestFindOfKernel(const CharT* alphabet, size_t alphabetLen)
+{
+    typedef std::basic_string<CharT> StringT;
+    typedef str_view_template<CharT> ViewT;
+
+    uint32_t seed = 777;
+    auto random = [&seed](uint32_t max) -> uint32_t {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % max;
+    };
+    for(size_t iter = 0; iter < 2000; ++iter)
+    {
+        StringT str(random(150), (CharT)0);
+        for(CharT& ch : str)
+            ch = alphabet[random((uint32_t)alphabetLen)];
+        StringT chars(1 + random(8), (CharT)0);
+        for(CharT& ch : chars)
+            ch = alphabet[random((uint32_t)alphabetLen)];
+        const size_t pos = random(3) ? random((uint32_t)str.length() + 2) : (random(2) ? 0 : SIZE_MAX);
+
+        const ViewT view(str);
+        const ViewT charsView(chars);
+        const char_set_template<CharT> set(charsView);
+        const size_t firstPos = pos == SIZE_MAX ? 0 : pos;
+
+        const size_t expectedFirstOf = str.find_first_of(chars, firstPos);
+        const size_t expectedLastOf = str.find_last_of(chars, pos);
+        const size_t expectedFirstNotOf = str.find_first_not_of(chars, firstPos);
+        const size_t expectedLastNotOf = str.find_last_not_of(chars, pos);
+        TEST(view.find_first_of(charsView, firstPos) == expectedFirstOf);
+        TEST(view.find_first_of(set, firstPos) == expectedFirstOf);
+        TEST(view.find_last_of(charsView, pos) == expectedLastOf);
+        TEST(view.find_last_of(set, pos) == expectedLastOf);
+        TEST(view.find_first_not_of(charsView, firstPos) == expectedFirstNotOf);
+        TEST(view.find_first_not_of(set, firstPos) == expectedFirstNotOf);
+        TEST(view.find_last_not_of(charsView, pos) == expectedLastNotOf);
+        TEST(view.find_last_not_of(set, pos) == expectedLastNotOf);
+
+        for(size_t i = 0; i < alphabetLen; ++i)
+            TEST(set.contains(alphabet[i]) == (chars.find(alphabet[i]) != StringT::npos));
+    }
+}
+
+static void TestFindOf()
+{
+    const char alphabet[] = { 'a', 'b', 'c', 'd', ' ', '\t', ',', ';', (char)0xE9, (char)0x80, (char)0x7F };
+    TestFindOfKernel(alphabet, sizeof(alphabet) / sizeof(alphabet[0]));
+    // Wide characters that share hash with each other and with characters below 256.
+    const wchar_t walphabet[] = { L'a', L'b', L' ', L',', (wchar_t)0xE9, (wchar_t)0x104, (wchar_t)0x105, (wchar_t)0x401, (wchar_t)0x1E9, (wchar_t)0x2000 };
+    TestFindOfKernel(walphabet, sizeof(walphabet) / sizeof(walphabet[0]));
+
+    // Prebuilt set reused for many calls.
+    const char_set delimiters = char_set(str_view(" \t\r\n,;"));
+    TEST(delimiters.length() == 6);
+    TEST(delimiters.contains(';'));
+    TEST(!delimiters.contains('a'));
+    const str_view line = "key1 = value1, key2\t=\tvalue2;";
+    TEST(line.find_first_of(delimiters) == 4);
+    TEST(line.find_first_of(delimiters, 5) == 6);
+    TEST(line.find_last_of(delimiters) == 28);
+    TEST(line.find_first_not_of(delimiters, 4) == 5);
+    TEST(line.find_last_not_of(delimiters) == 27);
+    TEST(line.find_first_of(char_set(str_view())) == SIZE_MAX);
+}
+
+static void TestLite()
+{
+    static_assert(std::is_trivially_copyable<str_view_lite>::value, "str_view_lite must be trivially copyable.");
+    static_assert(sizeof(str_view_lite) == sizeof(const char*) + sizeof(size_t), "str_view_lite must be pointer + length.");
+
+    // Construction
+    {
+        str_view_lite empty;
+        TEST(empty.empty() && empty.length() == 0 && empty.begin() == empty.end());
+        TEST(str_view_lite(nullptr).empty());
+
+        const char* sz = "Ala ma kota";
+        str_view_lite fromSz = sz;
+        TEST(fromSz.data() == sz && fromSz.length() == 11);
+
+        const string str = "Ala ma kota";
+        str_view_lite fromStr(str, 4, 2);
+        TEST(fromStr.data() == str.data() + 4 && fromStr.length() == 2);
+        TEST(str_view_lite(str, 7).length() == 4);
+    }
+
+    // Conversion in both directions
+    {
+        const char* sz = "Ala ma kota";
+        str_view full = str_view(sz);
+        str_view_lite lite = full;
+        TEST(lite.data() == sz && lite.length() == 11);
+        TEST(full.to_lite().data() == sz);
+
+        str_view fromLite = lite.substr(4, 2);
+        TEST(fromLite.length() == 2);
+        TEST(strcmp(fromLite.c_str(), "ma") == 0);
+        TEST(fromLite.c_str() != sz + 4); // Not null-terminated, so copy is made.
+        TEST(fromLite == lite.substr(4, 2));
+    }
+
+    // Same API as str_view
+    {
+        const str_view_lite v = "Ala ma kota";
+        TEST(v[0] == 'A' && v.at(4) == 'm' && v.front() == 'A' && v.back() == 'a');
+        TEST(v.substr(7) == "kota");
+        TEST(v.compare("Ala") > 0);
+        TEST(v.compare("ala ma kota", false) == 0);
+        TEST(v < "Ala mb" && v > "Ala" && v != "Ala" && v == "Ala ma kota");
+        TEST(v.starts_with('A') && v.starts_with("ALA", false) && !v.starts_with("kot"));
+        TEST(v.ends_with('a') && v.ends_with("KOTA", false) && !v.ends_with("Ala"));
+        TEST(v.find('a') == 2 && v.find("ma") == 4 && v.find("psy") == SIZE_MAX);
+        TEST(v.rfind('a') == 10 && v.rfind("a", 4) == 2);
+        TEST(v.find_first_of("mk") == 4 && v.find_last_of("mk") == 7);
+        TEST(v.find_first_not_of("Al") == 2 && v.find_last_not_of("ta") == 8);
+        TEST(v.find_first_of(char_set(str_view(" \t"))) == 3);
+
+        char dst[4];
+        TEST(v.copy_to(dst, 7) == 4 && memcmp(dst, "kota", 4) == 0);
+        string s;
+        v.to_string(s, 4, 2);
+        TEST(s == "ma");
+
+        str_view_lite a = "A", b = "B";
+        a.swap(b);
+        TEST(a == "B" && b == "A");
+    }
+
+    // Unicode
+    {
+        const wstr_view_lite v = L"Ala ma kota";
+        TEST(v.length() == 11);
+        TEST(v.find(L"kota") == 7);
+        TEST(wstr_view(v) == wstr_view(L"Ala ma kota"));
+    }
+}
+
+static void TestConversionToString()
+{
+    // to_string reuses capacity and append_to appends.
+    {
+        const str_view v = "Ala ma kota";
+        string s;
+        s.reserve(64);
+        const char* const buffer = s.data();
+        v.to_string(s);
+        TEST(s == "Ala ma kota" && s.data() == buffer);
+        v.to_string(s, 4, 2);
+        TEST(s == "ma" && s.data() == buffer);
+        v.append_to(s, 6);
+        v.to_lite().append_to(s, 0, 3);
+        TEST(s == "ma kotaAla" && s.data() == buffer);
+
+        const str_view_rope rope = { v.substr(0, 4), v.substr(4) };
+        rope.append_to(s, 2, 6);
+        TEST(s == "ma kotaAlaa ma k");
+    }
+
+    // str_view_append
+    {
+        string s = "x";
+        str_view_append(s, str_view("Host"), ": ", string("example.com"), str_view_lite("\r\n"));
+        TEST(s == "xHost: example.com\r\n");
+        str_view_append(s);
+        TEST(s.length() == 20);
+        wstring ws;
+        str_view_append(ws, L"a", wstr_view(L"bc"));
+        TEST(ws == L"abc");
+
+        string out;
+        size_t reallocations = 0;
+        for(size_t i = 0; i < 1000; ++i)
+        {
+            const size_t capacity = out.capacity();
+            str_view_append(out, "key", "=", "value", ";");
+            if(out.capacity() != capacity)
+                ++reallocations;
+        }
+        TEST(out.length() == 10000 && reallocations < 20);
+    }
+
+#if STR_VIEW_HAS_STD_STRING_VIEW
+    // Conversions from and to std::string_view.
+    {
+        const std::string_view sv = "Ala ma kota";
+        const str_view v = sv;
+        TEST(v.data() == sv.data() && v.length() == 11);
+        TEST(v.c_str() != sv.data()); // Not known to be null-terminated.
+        const str_view_lite lite = sv;
+        TEST(lite.data() == sv.data() && lite.length() == 11);
+
+        const std::string_view back = v;
+        TEST(back.data() == sv.data() && back.length() == 11);
+        const std::string_view lazy = str_view("Ala");
+        TEST(lazy.length() == 3);
+        const std::string_view fromLite = lite.substr(4, 2);
+        TEST(fromLite == "ma");
+        TEST(std::string_view(str_view()).empty() && str_view(std::string_view()).empty());
+
+        TEST(v == sv && sv == v && !(v != sv) && !(sv != v));
+        TEST(lite == sv && sv == lite && lite != std::string_view("Ala"));
+        TEST(v == "Ala ma kota" && v != std::string("Ala"));
+
+        // Standard functions accept str_view through the conversion.
+        std::string s(v);
+        TEST(s == "Ala ma kota");
+        s += str_view(" i psa");
+        TEST(s == "Ala ma kota i psa");
+        TEST(std::string_view(s).find(str_view("psa")) == 14);
+
+        static_assert(std::is_convertible<str_view, std::string_view>::value, "");
+        static_assert(std::is_convertible<std::string_view, str_view>::value, "");
+        static_assert(std::is_convertible<wstr_view_lite, std::wstring_view>::value, "");
+    }
+#endif
+}
+
+class CountingAllocator : public str_view_allocator
+{
+public:
+    std::atomic<size_t> m_AllocCount{0};
+    std::atomic<size_t> m_FreeCount{0};
+
+    virtual void* allocate(size_t bytes) { ++m_AllocCount; return ::operator new(bytes); }
+    virtual void deallocate(void* ptr, size_t) { ++m_FreeCount; ::operator delete(ptr); }
+};
+
+static void TestAllocator()
+{
+    TEST(str_view_get_thread_allocator() == nullptr);
+
+    // Custom allocator installed for a scope.
+    {
+        CountingAllocator allocator;
+        {
+            str_view_allocator_scope scope(&allocator);
+            TEST(str_view_get_thread_allocator() == &allocator);
+
+            str_view v = str_view("ABCDEF", 3);
+            TEST(strcmp(v.c_str(), "ABC") == 0);
+            TEST(allocator.m_AllocCount == 1);
+            // Null-terminated string needs no copy.
+            TEST(str_view("ABC").c_str() != nullptr);
+            TEST(allocator.m_AllocCount == 1);
+
+            str_view moved = std::move(v);
+            TEST(strcmp(moved.c_str(), "ABC") == 0);
+            TEST(allocator.m_AllocCount == 1);
+        }
+        TEST(str_view_get_thread_allocator() == nullptr);
+        TEST(allocator.m_FreeCount == 1);
+
+        // Copy allocated from custom allocator is returned to it even when it's no longer installed.
+        str_view* const v = new str_view("ABCDEF", 2);
+        {
+            str_view_allocator_scope scope(&allocator);
+            TEST(strcmp(v->c_str(), "AB") == 0);
+        }
+        delete v;
+        TEST(allocator.m_AllocCount == 2 && allocator.m_FreeCount == 2);
+    }
+
+    // Monotonic arena
+    {
+        str_view_monotonic_arena arena(128);
+        str_view_allocator_scope scope(&arena);
+        for(size_t round = 0; round < 3; ++round)
+        {
+            {
+                string longStr(1000, 'x');
+                str_view big = str_view(longStr.data(), 500); // Larger than block.
+                TEST(strlen(big.c_str()) == 500);
+                for(size_t i = 0; i < 50; ++i)
+                {
+                    const char* sz = "Ala ma kota" + (i & 7);
+                    str_view piece = str_view(sz, 3);
+                    TEST(memcmp(piece.c_str(), sz, 3) == 0 && piece.c_str()[3] == '\0');
+                }
+            }
+            arena.reset();
+        }
+    }
+
+    // Threads racing in c_str(), each with own allocator. Losers free their copies.
+    {
+        CountingAllocator allocators[8];
+        {
+            str_view substr = str_view("ABCDEF", 4);
+            std::thread threads[8];
+            for(size_t i = 0; i < 8; ++i)
+            {
+                threads[i] = std::thread([i, &substr, &allocators]() {
+                    str_view_allocator_scope scope(&allocators[i]);
+                    TEST(strcmp(substr.c_str(), "ABCD") == 0);
+                });
+            }
+            for(size_t i = 0; i < 8; ++i)
+                threads[i].join();
+        }
+        size_t allocCount = 0, freeCount = 0;
+        for(size_t i = 0; i < 8; ++i)
+        {
+            allocCount += allocators[i].m_AllocCount;
+            freeCount += allocators[i].m_FreeCount;
+        }
+        TEST(allocCount >= 1 && allocCount == freeCount);
+    }
+}
+
+static void TestInlineCopy()
+{
+    CountingAllocator allocator;
+    str_view_allocator_scope scope(&allocator);
+
+    // Short string - copy is stored inside the object.
+    {
+        const char* sz = "Ala ma kota";
+        str_view_sso v = str_view_sso(sz + 4, 2);
+        const char* cstr = v.c_str();
+        TEST(strcmp(cstr, "ma") == 0);
+        TEST((const void*)cstr >= (const void*)&v && (const void*)cstr < (const void*)(&v + 1));
+        TEST(v.c_str() == cstr);
+        // Called through base class, returns the same inline copy.
+        const str_view& base = v;
+        TEST(base.c_str() == cstr);
+        TEST(allocator.m_AllocCount == 0);
+
+        // Copy and move create their own copies.
+        str_view_sso copy = v;
+        TEST(strcmp(copy.c_str(), "ma") == 0 && copy.c_str() != cstr);
+        str_view_sso moved = std::move(copy);
+        TEST(strcmp(moved.c_str(), "ma") == 0);
+        str_view plain = std::move(moved);
+        TEST(strcmp(plain.c_str(), "ma") == 0);
+        TEST(allocator.m_AllocCount == 1); // Only plain str_view needed allocation.
+    }
+    TEST(allocator.m_FreeCount == 1);
+
+    // Null-terminated string doesn't need a copy.
+    {
+        const char* sz = "Ala ma kota";
+        str_view_sso v = str_view_sso(sz);
+        TEST(v.c_str() == sz);
+        TEST(str_view_sso(str_view(sz), 4).c_str() == sz + 4);
+    }
+
+    // Long string - copy is allocated.
+    {
+        const string longStr(100, 'x');
+        str_view_sso v = str_view_sso(longStr.data(), 50);
+        TEST(strlen(v.c_str()) == 50);
+        TEST(allocator.m_AllocCount == 2);
+        str_view_sso_template<char, 100> bigger = str_view_sso_template<char, 100>(longStr.data(), 50);
+        TEST(strlen(bigger.c_str()) == 50);
+        TEST(allocator.m_AllocCount == 2);
+    }
+
+    // Swapped views drop their inline copies.
+    {
+        str_view_sso a = str_view_sso("ABCD", 2);
+        str_view_sso b = str_view_sso("EFGH", 3);
+        a.c_str();
+        b.c_str();
+        a.swap(b);
+        TEST(strcmp(a.c_str(), "EFG") == 0 && strcmp(b.c_str(), "AB") == 0);
+        // Each one has copy inside itself, not inside the other one.
+        TEST((const void*)b.c_str() >= (const void*)&b && (const void*)b.c_str() < (const void*)(&b + 1));
+    }
+
+    // Many threads calling c_str() at once must get the same pointer.
+    for(size_t round = 0; round < 20; ++round)
+    {
+        const wchar_t* original = L"ABCDEF";
+        wstr_view_sso substr = wstr_view_sso(original, 4);
+        constexpr size_t THREAD_COUNT = 16;
+        std::thread threads[THREAD_COUNT];
+        const wchar_t* ptrs[THREAD_COUNT];
+        for(size_t i = 0; i < THREAD_COUNT; ++i)
+        {
+            threads[i] = std::thread([i, &substr, &ptrs]() {
+                // Half of the threads go through base class.
+                const wchar_t* cstr = (i & 1) ? substr.c_str() : static_cast<const wstr_view&>(substr).c_str();
+                TEST(wcscmp(cstr, L"ABCD") == 0);
+                ptrs[i] = cstr;
+            });
+        }
+        for(size_t i = 0; i < THREAD_COUNT; ++i)
+            threads[i].join();
+        for(size_t i = 0; i < THREAD_COUNT; ++i)
+            TEST(ptrs[i] == substr.c_str());
+    }
+    TEST(allocator.m_AllocCount == allocator.m_FreeCount);
+}
+
+static void TestConstexpr()
+{
+    using namespace str_view_literals;
+
+#if STR_VIEW_HAS_CONSTEXPR
+    static_assert("Ala ma kota"_svl.length() == 11, "");
+    static_assert(str_view_lite("Ala ma kota").length() == 11, "");
+    static_assert(L"Ala"_svl.length() == 3, "");
+    static_assert(str_view_lite().empty(), "");
+
+    static_assert("abc"_svl == "abc"_svl, "");
+    static_assert("abc"_svl < "abd"_svl, "");
+    static_assert("abc"_svl < "abcd"_svl, "");
+    static_assert("ABC"_svl.compare("abc"_svl, false) == 0, "");
+    static_assert("\xFF"_svl > "a"_svl, ""); // Compared as unsigned char, like strncmp.
+    static_assert(L"ABC"_svl.compare(L"abd"_svl, false) < 0, "");
+
+    static_assert("Ala ma kota"_svl.starts_with("Ala"_svl), "");
+    static_assert("Ala ma kota"_svl.starts_with('a', false), "");
+    static_assert("Ala ma kota"_svl.ends_with("KOTA"_svl, false), "");
+    static_assert(!"Ala ma kota"_svl.ends_with("kot"_svl), "");
+    static_assert("Ala ma kota"_svl.substr(4, 2) == "ma"_svl, "");
+
+    static_assert("Ala ma kota"_svl.find('a') == 2, "");
+    static_assert("Ala ma kota"_svl.rfind('a') == 10, "");
+    static_assert("Ala ma kota"_svl.find('x') == SIZE_MAX, "");
+    static_assert("Ala ma kota"_svl.find("ma"_svl) == 4, "");
+    static_assert("Ala ma kota"_svl.find("a"_svl, 3) == 5, "");
+    static_assert("Ala ma kota"_svl.rfind("a "_svl) == 5, "");
+    static_assert("Ala ma kota"_svl.rfind("Ala"_svl, 0) == 0, "");
+    static_assert(L"Ala ma kota"_svl.find(L"kot"_svl) == 7, "");
+
+    static_assert("Ala"_svl.hash() == str_view_lite("Ala").hash(), "");
+    static_assert("Ala"_svl.hash() != "Ale"_svl.hash(), "");
+
+    // Dispatch table built at compile time.
+    struct Keyword { str_view_lite name; size_t hash; };
+    static constexpr Keyword keywords[] = {
+        { "if"_svl, "if"_svl.hash() },
+        { "while"_svl, "while"_svl.hash() },
+    };
+    static_assert(keywords[1].name.length() == 5, "");
+
+    // Compile-time and run-time results must be the same.
+    {
+        const string whileStr = "while";
+        TEST(str_view_lite(whileStr).hash() == keywords[1].hash);
+        TEST(str_view_lite(whileStr) == keywords[1].name);
+        constexpr size_t found = "Ala ma kota"_svl.find("kota"_svl);
+        TEST(str_view_lite(string("Ala ma kota")).find("kota") == found);
+        constexpr int cmpResult = "abc"_svl.compare("abd"_svl);
+        TEST((cmpResult < 0) == (str_view_lite(string("abc")).compare("abd") < 0));
+    }
+#endif
+
+    // Null-terminated view with known length.
+    {
+        str_view sv = "Ala ma kota"_sv;
+        TEST(sv.length() == 11);
+        TEST(sv == "Ala ma kota");
+        const char* const data = sv.data();
+        TEST(sv.c_str() == data); // No copy needed.
+
+        wstr_view wsv = L"Ala"_sv;
+        TEST(wsv.length() == 3 && wsv.c_str() == wsv.data());
+
+        TEST(""_sv.empty());
+        TEST(""_sv.c_str()[0] == '\0');
+    }
+
+    // Constant initialization of full views.
+    {
+        static const str_view staticView("Ala ma kota", 11, str_view::StillNullTerminated());
+        TEST(staticView.length() == 11);
+        TEST(staticView.starts_with("Ala"));
+    }
+}
+
+template<typename CharT>
+static void TestHashKernel()
+{
+    typedef std::basic_string<CharT> StringT;
+    // Lengths around all thresholds: short, 16, 48, HASH_LONG_MIN and blocks of 16 stripes.
+    const size_t maxLen = 1200;
+    StringT str(maxLen, (CharT)0);
+    for(size_t i = 0; i < maxLen; ++i)
+        str[i] = (CharT)('a' + (i * 7) % 26);
+
+    for(size_t len = 0; len < maxLen; len += (len < 300 ? 1 : 61))
+    {
+        const str_view_lite_template<CharT> v(str.data(), len);
+        const size_t hash = v.hash();
+
+        // Same content at different address and alignment.
+        const StringT copy = StringT(1, (CharT)'x') + str.substr(0, len);
+        TEST(str_view_lite_template<CharT>(copy.data() + 1, len).hash() == hash);
+        TEST(str_view_template<CharT>(copy, 1).hash() == hash);
+
+        // Different length.
+        if(len > 0)
+            TEST(str_view_lite_template<CharT>(str.data(), len - 1).hash() != hash);
+
+        // Change of any single character.
+        for(size_t pos = 0; pos < len; pos += (len < 64 ? 1 : 13))
+        {
+            StringT changed = str.substr(0, len);
+            changed[pos] = (CharT)(changed[pos] ^ 1);
+            TEST(str_view_lite_template<CharT>(changed).hash() != hash);
+        }
+
+        // Case-insensitive.
+        StringT upper = str.substr(0, len);
+        for(size_t i = 0; i < len; i += 2)
+            upper[i] = (CharT)(upper[i] - 'a' + 'A');
+        const str_view_lite_template<CharT> upperView(upper);
+        TEST(upperView.compare(v, false) == 0);
+        TEST(upperView.hash(false) == v.hash(false));
+        TEST(v.hash(false) == hash); // v is lowercase.
+        if(len > 0)
+            TEST(upperView.hash() != hash);
+    }
+
+    // Characters that are not ASCII letters are not folded.
+    {
+        const CharT punct[] = { (CharT)'@', (CharT)'[', (CharT)'`', (CharT)'{', (CharT)0xC0, (CharT)0xE0, 0 };
+        const CharT punct2[] = { (CharT)'`', (CharT)'{', (CharT)'@', (CharT)'[', (CharT)0xE0, (CharT)0xC0, 0 };
+        for(size_t i = 0; i < 6; ++i)
+        {
+            if(punct[i] != punct2[i])
+                TEST(str_view_lite_template<CharT>(punct + i, 1).hash(false) != str_view_lite_template<CharT>(punct2 + i, 1).hash(false));
+        }
+    }
+}
+
+static void TestHash()
+{
+    TestHashKernel<char>();
+    TestHashKernel<wchar_t>();
+
+    // Full view, lite view and std::hash agree.
+    {
+        const str_view full = "Ala ma kota";
+        TEST(full.hash() == full.to_lite().hash());
+        TEST(std::hash<str_view>()(full) == full.hash());
+        TEST(std::hash<str_view_lite>()(full.to_lite()) == full.hash());
+        TEST(std::hash<wstr_view>()(wstr_view(L"Ala")) == wstr_view_lite(L"Ala").hash());
+        TEST(str_view_hash<str_view_binary_compare>()(full) == full.hash());
+    }
+
+    // Hash function objects hash only characters compared by their traits.
+    {
+        const str_view a("A\0B", 3), b("A\0C", 3), c("a\0c", 3);
+        TEST(a == b && std::hash<str_view>()(a) == std::hash<str_view>()(b));
+        TEST(std::hash<str_view_lite>()(a.to_lite()) == str_view("A").hash());
+        TEST(str_view_hash<>()(b.to_lite()) == std::hash<str_view>()(b));
+        TEST(str_view_hash<str_view_binary_compare>()(a) != str_view_hash<str_view_binary_compare>()(b));
+        TEST(str_view_hash<str_view_binary_compare>()(a) == a.hash());
+        TEST(str_view_hash_nocase()(a) == str_view_hash_nocase()(c) && str_view_equal_nocase()(a, c));
+        std::unordered_set<str_view> set;
+        set.insert(a);
+        set.insert(b);
+        TEST(set.size() == 1);
+        TEST(std::hash<wstr_view_lite>()(wstr_view_lite(L"x\0y", 3)) == std::hash<wstr_view_lite>()(wstr_view_lite(L"x\0z", 3)));
+    }
+
+    // Hash containers.
+    {
+        std::unordered_map<str_view, int> map;
+        map["if"] = 1;
+        map["while"] = 2;
+        const string key = "while";
+        TEST(map.find(str_view(key)) != map.end() && map.find(str_view(key))->second == 2);
+        TEST(map.find(str_view("While")) == map.end());
+
+        std::unordered_map<str_view, int, str_view_hash_nocase, str_view_equal_nocase> mapNocase;
+        mapNocase["Content-Length"] = 1;
+        TEST(mapNocase.find(str_view("content-length")) != mapNocase.end());
+        TEST(mapNocase.find(str_view("content-type")) == mapNocase.end());
+    }
+
+#if STR_VIEW_HAS_CONSTEXPR
+    // Compile-time value equals run-time value, also for inputs long enough to use SIMD.
+    {
+        using namespace str_view_literals;
+        constexpr size_t shortHash = "Ala ma kota"_svl.hash();
+        TEST(str_view_lite(string("Ala ma kota")).hash() == shortHash);
+        #define LONG_TEXT "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor " \
+            "incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation " \
+            "ullamco laboris nisi ut aliquip ex ea commodo consequat. Duis aute irure dolor in reprehenderit " \
+            "in voluptate velit esse cillum dolore eu fugiat nulla pariatur."
+        constexpr size_t longHash = LONG_TEXT ""_svl.hash();
+        constexpr size_t longHashNocase = LONG_TEXT ""_svl.hash(false);
+        constexpr size_t wideLongHash = L"" LONG_TEXT ""_svl.hash();
+        const string longStr = LONG_TEXT;
+        const wstring wideLongStr = L"" LONG_TEXT;
+        #undef LONG_TEXT
+        TEST(longStr.length() >= 256);
+        TEST(str_view_lite(longStr).hash() == longHash);
+        TEST(str_view_lite(longStr).hash(false) == longHashNocase);
+        TEST(wstr_view_lite(wideLongStr).hash() == wideLongHash);
+    }
+#endif
+}
+
+// Index of the first key equal to str, or of the longest key that is its prefix, found by comparing with all keys.
+template<typename CharT>
+static size_t NaiveFindKeyword(const std::vector<str_view_lite_template<CharT>>& keys, const str_view_lite_template<CharT>& str,
+    bool prefix, bool caseSensitive)
+{
+    size_t result = SIZE_MAX;
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+        const bool match = prefix ? str.starts_with(keys[i], caseSensitive) : str.compare(keys[i], caseSensitive) == 0;
+        if(match && (result == SIZE_MAX || keys[i].length() > keys[result].length()))
+            result = i;
+    }
+    return result;
+}
+
+template<typename CharT>
+static void TestKeywordMatcherKernel()
+{
+    typedef str_view_lite_template<CharT> LiteT;
+    typedef std::basic_string<CharT> StringT;
+    const auto make = [](const char* sz) {
+        StringT result;
+        for(; *sz; ++sz)
+            result.push_back((CharT)*sz);
+        return result;
+    };
+
+    // Keys with common prefixes, duplicates and empty key.
+    {
+        const StringT strings[] = { make("GET"), make("POST"), make("PUT"), make("PATCH"), make("P"), make("POST"), make("") };
+        std::vector<LiteT> keys;
+        for(const StringT& str : strings)
+            keys.push_back(LiteT(str.data(), str.length()));
+        const keyword_matcher_template<CharT> matcher(keys.data(), keys.size());
+        TEST(matcher.size() == 7 && !matcher.empty() && matcher.case_sensitive());
+        TEST(matcher.find(make("GET")) == 0);
+        TEST(matcher.find(make("POST")) == 1); // First of duplicates.
+        TEST(matcher.find(make("PUT")) == 2);
+        TEST(matcher.find(make("P")) == 4);
+        TEST(matcher.find(make("")) == 6);
+        TEST(matcher.find(make("PO")) == SIZE_MAX);
+        TEST(matcher.find(make("POSTS")) == SIZE_MAX);
+        TEST(matcher.find(make("get")) == SIZE_MAX);
+        TEST(matcher.find_longest_prefix(make("POSTS")) == 1);
+        TEST(matcher.find_longest_prefix(make("PATCHES")) == 3 && matcher.key_length(3) == 5);
+        TEST(matcher.find_longest_prefix(make("PO")) == 4);
+        TEST(matcher.find_longest_prefix(make("XYZ")) == 6);
+        // Characters after the keys' characters are not confused with end of key.
+        const StringT withNull = make("GET") + (CharT)0;
+        TEST(matcher.find(LiteT(withNull.data(), withNull.length())) == SIZE_MAX);
+        TEST(matcher.find_longest_prefix(LiteT(withNull.data(), withNull.length())) == 0);
+    }
+
+    // Case-insensitive, with non-ASCII characters compared by value.
+    {
+        const StringT strings[] = { make("Select"), make("SELECTED"), make("from"), make("\xC4\x85"), make("\xE4") };
+        std::vector<LiteT> keys;
+        for(const StringT& str : strings)
+            keys.push_back(LiteT(str.data(), str.length()));
+        const keyword_matcher_template<CharT> matcher(keys.data(), keys.size(), false);
+        TEST(!matcher.case_sensitive());
+        TEST(matcher.find(make("SELECT")) == 0 && matcher.find(make("select")) == 0);
+        TEST(matcher.find(make("selected")) == 1);
+        TEST(matcher.find(make("FROM")) == 2);
+        TEST(matcher.find_longest_prefix(make("SeLeCtEdX")) == 1);
+        TEST(matcher.find(make("\xC4\x85")) == 3);
+        TEST(matcher.find(make("\xC4\xA5")) == SIZE_MAX);
+        TEST(matcher.find(make("\xC4")) == SIZE_MAX && matcher.find(make("\xE4")) == 4);
+        TEST(matcher.find(make("")) == SIZE_MAX && matcher.find_longest_prefix(make("fro")) == SIZE_MAX);
+    }
+
+    // Many keys, compared with naive search. Small alphabet makes long common prefixes
+    // and nodes with many children.
+    for(int caseSensitive = 0; caseSensitive < 2; ++caseSensitive)
+    {
+        uint32_t seed = 0x2468ACE1u + (uint32_t)caseSensitive;
+        const auto random = [&seed](uint32_t range) {
+            seed = seed * 1664525u + 1013904223u;
+            return (seed >> 16) % range;
+        };
+        const char* const alphabet = "abcABCxyz0123456789_-.";
+        std::vector<StringT> strings;
+        for(size_t i = 0; i < 500; ++i)
+        {
+            StringT str;
+            const uint32_t len = 1 + random(10);
+            for(uint32_t j = 0; j < len; ++j)
+                str.push_back((CharT)alphabet[random(i < 250 ? 6 : 22)]);
+            strings.push_back(str);
+        }
+        std::vector<LiteT> keys;
+        for(const StringT& str : strings)
+            keys.push_back(LiteT(str.data(), str.length()));
+        const keyword_matcher_template<CharT> matcher(keys.data(), keys.size(), caseSensitive != 0);
+        for(size_t i = 0; i < 2000; ++i)
+        {
+            StringT str = i < 500 ? strings[i] : StringT();
+            if(i >= 500 || i % 3 == 0)
+            {
+                const uint32_t len = random(14);
+                for(uint32_t j = 0; j < len; ++j)
+                    str.push_back((CharT)alphabet[random(i % 2 ? 6 : 22)]);
+            }
+            const LiteT v(str.data(), str.length());
+            const size_t expectedExact = NaiveFindKeyword(keys, v, false, caseSensitive != 0);
+            // Naive search returns the longest. For exact match all candidates are equal, so take the first.
+            size_t firstExact = SIZE_MAX;
+            for(size_t k = 0; k < keys.size() && expectedExact != SIZE_MAX; ++k)
+            {
+                if(v.compare(keys[k], caseSensitive != 0) == 0)
+                {
+                    firstExact = k;
+                    break;
+                }
+            }
+            TEST(matcher.find(v) == firstExact);
+            const size_t found = matcher.find_longest_prefix(v);
+            const size_t expectedPrefix = NaiveFindKeyword(keys, v, true, caseSensitive != 0);
+            TEST((found == SIZE_MAX) == (expectedPrefix == SIZE_MAX));
+            if(found != SIZE_MAX && expectedPrefix != SIZE_MAX)
+                TEST(keys[found].length() == keys[expectedPrefix].length() && v.starts_with(keys[found], caseSensitive != 0));
+        }
+    }
+}
+
+static void TestKeywordMatcher()
+{
+    TestKeywordMatcherKernel<char>();
+    TestKeywordMatcherKernel<wchar_t>();
+
+    {
+        const keyword_matcher empty;
+        TEST(empty.empty() && empty.size() == 0);
+        TEST(empty.find("") == SIZE_MAX && empty.find_longest_prefix("abc") == SIZE_MAX);
+
+        const keyword_matcher fromList = { "if", "else", "while", str_view("for") };
+        TEST(fromList.find("while") == 2 && fromList.find(str_view("for")) == 3);
+        TEST(fromList.find(string("else")) == 1 && fromList.find("el") == SIZE_MAX);
+    }
+
+#if STR_VIEW_HAS_CONSTEXPR
+    {
+        using namespace str_view_literals;
+        static constexpr str_view_lite KEYWORDS[] = { "if"_svl, "else"_svl, "elif"_svl, "while"_svl, "e"_svl };
+        static constexpr auto MATCHER = make_static_keyword_matcher<keyword_matcher_capacity(KEYWORDS)>(KEYWORDS);
+        static_assert(MATCHER.size() == 5, "");
+        static_assert(MATCHER.find("else"_svl) == 1, "");
+        static_assert(MATCHER.find("elif"_svl) == 2, "");
+        static_assert(MATCHER.find("el"_svl) == SIZE_MAX, "");
+        static_assert(MATCHER.find_longest_prefix("elsewhere"_svl) == 1, "");
+        static_assert(MATCHER.find_longest_prefix("eq"_svl) == 4, "");
+        static_assert(MATCHER.find_longest_prefix("x"_svl) == SIZE_MAX, "");
+        // Root, "i", "e", "w", "if", "el", "wh", "els", "eli", "whi", "else", "elif", "whil", "while".
+        static_assert(MATCHER.node_count() == 14, "");
+        TEST(MATCHER.find(str_view("while")) == 3);
+
+        static constexpr auto NOCASE = make_static_keyword_matcher<keyword_matcher_capacity(KEYWORDS)>(KEYWORDS, false);
+        static_assert(NOCASE.find("ELSE"_svl) == 1 && !NOCASE.case_sensitive(), "");
+        static_assert(NOCASE.find_longest_prefix("While(1)"_svl) == 3 && NOCASE.key_length(3) == 5, "");
+
+        static constexpr wstr_view_lite WIDE_KEYWORDS[] = { L"abc"_svl, L"abd"_svl };
+        static constexpr auto WIDE = make_static_keyword_matcher<keyword_matcher_capacity(WIDE_KEYWORDS)>(WIDE_KEYWORDS);
+        static_assert(WIDE.find(L"abd"_svl) == 1 && WIDE.find(L"ab"_svl) == SIZE_MAX, "");
+    }
+#endif
+}
+
+template<typename CharT>
+static void TestMultiSearcherKernel()
+{
+    typedef str_view_lite_template<CharT> LiteT;
+    typedef std::basic_string<CharT> StringT;
+    const auto make = [](const char* sz) {
+        StringT result;
+        for(; *sz; ++sz)
+            result.push_back((CharT)*sz);
+        return result;
+    };
+    typedef std::vector<std::pair<size_t, size_t>> MatchVector;
+    const auto findAll = [](const str_view_multi_searcher_template<CharT>& searcher, const StringT& haystack, MatchVector& outMatches) {
+        outMatches.clear();
+        return searcher.find_all(str_view_template<CharT>(haystack), [&outMatches](size_t pos, size_t patternIndex) {
+            outMatches.push_back(std::make_pair(pos, patternIndex));
+        });
+    };
+
+    // Few patterns, overlapping, one a prefix of another, duplicated.
+    {
+        const StringT strings[] = { make("ERROR"), make("error"), make("or"), make("timeout"), make("ERR"), make("or") };
+        std::vector<LiteT> patterns;
+        for(const StringT& str : strings)
+            patterns.push_back(LiteT(str.data(), str.length()));
+        const str_view_multi_searcher_template<CharT> searcher(patterns.data(), patterns.size());
+        TEST(searcher.size() == 6 && !searcher.empty() && searcher.pattern_length(3) == 7);
+        const StringT haystack = make("12:00 ERROR: connection timeout, error code 7");
+        const str_view_template<CharT> haystackView = str_view_template<CharT>(haystack);
+        size_t patternIndex = SIZE_MAX;
+        TEST(searcher.find_in(haystackView, 0, patternIndex) == 6 && patternIndex == 0);
+        TEST(searcher.find_in(haystackView, 7, patternIndex) == 24 && patternIndex == 3);
+        TEST(searcher.find_in(haystackView, 25, patternIndex) == 33 && patternIndex == 1);
+        TEST(searcher.find_in(haystackView, 34) == 36);
+        TEST(searcher.find_in(haystackView, 37) == SIZE_MAX);
+        TEST(searcher.find_in(haystackView, 1000) == SIZE_MAX);
+        MatchVector matches;
+        TEST(findAll(searcher, haystack, matches) == 6);
+        TEST(matches == MatchVector({ { 6, 0 }, { 6, 4 }, { 24, 3 }, { 33, 1 }, { 36, 2 }, { 36, 5 } }));
+        TEST(findAll(searcher, make("ERRO"), matches) == 1 && matches == MatchVector({ { 0, 4 } }));
+        TEST(findAll(searcher, StringT(), matches) == 0);
+
+        const std::pair<const CharT*, const CharT*> range = searcher(haystack.data(), haystack.data() + haystack.length());
+        TEST(range.first == haystack.data() + 6 && range.second == haystack.data() + 11);
+        const StringT other = make("none");
+        TEST(searcher(other.begin(), other.end()) == std::make_pair(other.end(), other.end()));
+    }
+
+    // Set of patterns, large enough for the automaton, compared with naive search.
+    // Small alphabet makes many overlapping matches and long chains of failure links.
+    for(size_t patternCount = 1; patternCount <= 40; patternCount += patternCount < 12 ? 1 : 7)
+    {
+        uint32_t seed = 0x13579BDFu + (uint32_t)patternCount;
+        const auto random = [&seed](uint32_t range) {
+            seed = seed * 1664525u + 1013904223u;
+            return (seed >> 16) % range;
+        };
+        std::vector<CharT> alphabet = { (CharT)'a', (CharT)'b', (CharT)'c', (CharT)'-' };
+        if(sizeof(CharT) > 1)
+            alphabet.push_back((CharT)0x105);
+        std::vector<StringT> strings;
+        for(size_t i = 0; i < patternCount; ++i)
+        {
+            StringT str;
+            const uint32_t len = 1 + random(i % 5 == 4 ? 40 : 6);
+            for(uint32_t j = 0; j < len; ++j)
+                str.push_back(alphabet[random((uint32_t)alphabet.size())]);
+            strings.push_back(str);
+        }
+        std::vector<LiteT> patterns;
+        for(const StringT& str : strings)
+            patterns.push_back(LiteT(str.data(), str.length()));
+        const str_view_multi_searcher_template<CharT> searcher(patterns.data(), patterns.size());
+        for(size_t i = 0; i < 30; ++i)
+        {
+            StringT haystack;
+            const uint32_t len = random(300);
+            for(uint32_t j = 0; j < len; ++j)
+                haystack.push_back(alphabet[random((uint32_t)alphabet.size() - (i % 2))]);
+            MatchVector expected;
+            for(size_t pos = 0; pos < haystack.length(); ++pos)
+            {
+                for(size_t p = 0; p < patterns.size(); ++p)
+                {
+                    if(haystack.compare(pos, patterns[p].length(), strings[p]) == 0)
+                        expected.push_back(std::make_pair(pos, p));
+                }
+            }
+            MatchVector matches;
+            TEST(findAll(searcher, haystack, matches) == expected.size());
+            TEST(matches == expected);
+            const size_t startPos = random(len + 2);
+            const auto expectedFirst = std::lower_bound(expected.begin(), expected.end(), std::make_pair(startPos, (size_t)0));
+            size_t patternIndex = SIZE_MAX;
+            const size_t found = searcher.find_in(str_view_template<CharT>(haystack), startPos, patternIndex);
+            if(expectedFirst == expected.end())
+                TEST(found == SIZE_MAX);
+            else
+                TEST(found == expectedFirst->first && patternIndex == expectedFirst->second);
+        }
+    }
+}
+
+static void TestMultiSearcher()
+{
+    TestMultiSearcherKernel<char>();
+    TestMultiSearcherKernel<wchar_t>();
+
+    {
+        const str_view_multi_searcher empty;
+        TEST(empty.empty() && empty.size() == 0);
+        TEST(empty.find_in("abc") == SIZE_MAX && empty.find_all("abc", [](size_t, size_t) { }) == 0);
+    }
+
+    // Typical use - classifying log lines by many tokens.
+    {
+        std::vector<string> tokens;
+        for(size_t i = 0; i < 200; ++i)
+            tokens.push_back("token" + std::to_string(i * 7) + ";");
+        std::vector<str_view_lite> patterns(tokens.begin(), tokens.end());
+        const str_view_multi_searcher searcher(patterns.data(), patterns.size());
+        const str_view line = "2024-01-01 12:00:00 [worker] token700; token13; token1393;token14;";
+        size_t patternIndex = SIZE_MAX;
+        TEST(searcher.find_in(line, 0, patternIndex) == 29 && patternIndex == 100);
+        std::vector<size_t> found;
+        TEST(searcher.find_all(line, [&found](size_t, size_t index) { found.push_back(index); }) == 3);
+        TEST(found == std::vector<size_t>({ 100, 199, 2 }));
+    }
+
+#if __cplusplus >= 201703L || _MSVC_LANG >= 201703L
+    {
+        const string haystack = "GET /index.html HTTP/1.1";
+        const str_view_multi_searcher searcher = { "HTTP", ".html", ".htm" };
+        auto it = std::search(haystack.begin(), haystack.end(), searcher);
+        TEST(it - haystack.begin() == 10);
+    }
+#endif
+}
+
+template<typename CharT>
+static void TestRopeKernel()
+{
+    typedef str_view_template<CharT> ViewT;
+    typedef std::basic_string<CharT> StringT;
+    const auto make = [](const char* sz) {
+        StringT result;
+        for(; *sz; ++sz)
+            result.push_back((CharT)*sz);
+        return result;
+    };
+
+    // Token split between pieces.
+    {
+        const StringT a = make("GET /index.html HT"), b = make("TP/1.1\r"), c = make("\n"), d = make("Host: x\r\n");
+        const str_view_rope_template<CharT> rope = { ViewT(a), ViewT(), ViewT(b), ViewT(c), ViewT(d) };
+        TEST(rope.piece_count() == 4 && rope.length() == 35 && rope.piece_offset(2) == 25);
+        TEST(rope.find_piece(25) == 2 && rope[16] == (CharT)'H' && rope[25] == (CharT)'\n');
+        TEST(rope.find(ViewT(make("HTTP/1.1"))) == 16);
+        TEST(rope.find(ViewT(make("\r\n"))) == 24);
+        TEST(rope.find(ViewT(make("\r\n")), 25) == 33);
+        TEST(rope.find(ViewT(make("1\r\nHost"))) == 23);
+        TEST(rope.find(ViewT(make("HTTX"))) == SIZE_MAX);
+        TEST(rope.find((CharT)'\n') == 25 && rope.find((CharT)'/', 5) == 20);
+        TEST(rope.find_first_of(ViewT(make(":\n"))) == 25);
+        TEST(rope.starts_with(ViewT(make("GET /index.html HTTP"))));
+        TEST(rope.starts_with(ViewT(make("get")), false) && !rope.starts_with(ViewT(make("get"))));
+        TEST(rope.ends_with(ViewT(make("1.1\r\nHost: x\r\n"))));
+        const StringT flat = a + b + c + d;
+        TEST(rope.compare(ViewT(flat)) == 0);
+        TEST(rope.compare(ViewT(make("GET /index.html HTTP/1.0\r\n"))) > 0);
+        TEST(rope.compare(ViewT(make("GET /index.html HTTP/1.1\r\nHost: x\r\n "))) < 0);
+        StringT str;
+        rope.to_string(str);
+        TEST(str == flat);
+        rope.to_string(str, 16, 8);
+        TEST(str == make("HTTP/1.1"));
+        const str_view_rope_template<CharT> sub = rope.substr(16, 10);
+        TEST(sub.piece_count() == 3 && sub.compare(ViewT(make("HTTP/1.1\r\n"))) == 0);
+
+        std::vector<StringT> lines;
+        TEST(rope.split(ViewT(make("\r\n")), [&lines](const str_view_rope_template<CharT>& part) {
+            StringT line;
+            part.to_string(line);
+            lines.push_back(line);
+        }) == 3);
+        TEST(lines == std::vector<StringT>({ make("GET /index.html HTTP/1.1"), make("Host: x"), StringT() }));
+        std::vector<size_t> words;
+        TEST(rope.split((CharT)' ', [&words](const str_view_rope_template<CharT>& part) { words.push_back(part.length()); }) == 4);
+        TEST(words == std::vector<size_t>({ 3, 11, 15, 3 }));
+    }
+
+    // Random strings cut into pieces, compared with results on one string.
+    uint32_t seed = 0x51ED270Bu;
+    const auto random = [&seed](uint32_t range) {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 16) % range;
+    };
+    for(size_t test = 0; test < 200; ++test)
+    {
+        StringT flat;
+        const uint32_t len = random(120);
+        for(uint32_t i = 0; i < len; ++i)
+            flat.push_back((CharT)"ab\0c"[random(test % 2 ? 2 : 4)]);
+        std::vector<ViewT> pieces;
+        for(size_t pos = 0; pos < flat.length(); )
+        {
+            const size_t pieceLen = std::min((size_t)random(test % 3 ? 5 : 40), flat.length() - pos);
+            pieces.push_back(ViewT(flat.data() + pos, pieceLen));
+            pos += pieceLen;
+        }
+        const str_view_rope_template<CharT> rope(pieces.data(), pieces.size());
+        const ViewT flatView = ViewT(flat);
+        TEST(rope.length() == flat.length());
+        for(size_t i = 0; i < 10; ++i)
+        {
+            const size_t pos = random(len + 2);
+            StringT needle = flat.substr(std::min((size_t)random(len + 1), flat.length()), random(12));
+            if(i % 3 == 0)
+                needle.push_back((CharT)'a');
+            TEST(rope.find(ViewT(needle), pos) == flatView.find(ViewT(needle), pos));
+            TEST(rope.find((CharT)'c', pos) == flatView.find((CharT)'c', pos));
+            TEST(rope.find_first_of(ViewT(make("cx")), pos) == flatView.find_first_of(ViewT(make("cx")), pos));
+            const int expectedCompare = flatView.template compare<str_view_binary_compare>(ViewT(needle));
+            const int compareResult = rope.compare(ViewT(needle));
+            TEST((compareResult < 0) == (expectedCompare < 0) && (compareResult > 0) == (expectedCompare > 0));
+            TEST(rope.starts_with(ViewT(needle)) == (flat.compare(0, needle.length(), needle) == 0 && needle.length() <= len));
+        }
+        size_t partCount = 0;
+        size_t partPos = 0;
+        const StringT separator = make("ab");
+        TEST(rope.split(ViewT(separator), [&](const str_view_rope_template<CharT>& part) {
+            const size_t partEnd = std::min(flat.find(separator, partPos), flat.length());
+            TEST(part.compare(ViewT(flat.data() + partPos, partEnd - partPos)) == 0);
+            partPos = partEnd + 2;
+            ++partCount;
+        }) == partCount);
+
+        // The same string fed as a stream of the pieces.
+        str_view_stream_searcher_template<CharT> streamSearcher = str_view_stream_searcher_template<CharT>(ViewT(make("aba")));
+        std::vector<size_t> expected, found;
+        str_view_searcher_template<CharT>(ViewT(make("aba"))).find_all(flatView, [&expected](size_t pos) { expected.push_back(pos); });
+        size_t count = 0;
+        for(const ViewT& piece : pieces)
+            count += streamSearcher.feed(piece, [&found](size_t pos) { found.push_back(pos); });
+        TEST(found == expected && count == expected.size() && streamSearcher.position() == len);
+    }
+}
+
+static void TestRope()
+{
+    TestRopeKernel<char>();
+    TestRopeKernel<wchar_t>();
+
+    {
+        const str_view_rope empty;
+        TEST(empty.empty() && empty.piece_count() == 0);
+        TEST(empty.find('a') == SIZE_MAX && empty.find("") == 0 && empty.find("a") == SIZE_MAX);
+        TEST(empty.compare("") == 0 && empty.compare("a") < 0 && empty.starts_with(""));
+        TEST(empty.split(',', [](const str_view_rope& part) { TEST(part.empty()); }) == 1);
+    }
+
+    // Stream of single characters and chunks shorter than the needle.
+    {
+        str_view_stream_searcher searcher = str_view_stream_searcher("<!--");
+        std::vector<size_t> found;
+        const auto onFound = [&found](size_t pos) { found.push_back(pos); };
+        const char* const chunks[] = { "a<", "!", "-", "-b<!-", "", "-<!--", "<!" };
+        for(const char* chunk : chunks)
+            searcher.feed(chunk, onFound);
+        TEST(found == std::vector<size_t>({ 1, 6, 10 }));
+        TEST(searcher.position() == 16 && searcher.length() == 4);
+
+        str_view_stream_searcher copy = searcher;
+        found.clear();
+        TEST(copy.feed("--", onFound) == 1 && found == std::vector<size_t>({ 14 }));
+        searcher.reset();
+        found.clear();
+        TEST(searcher.feed("--", onFound) == 0 && searcher.position() == 2);
+    }
+}
+
+static void TestUtf8()
+{
+    // Validation, with table 3-7 of the Unicode Standard.
+    {
+        TEST(str_view().is_valid_utf8());
+        TEST(str_view("Ala ma kota").is_valid_utf8());
+        TEST(str_view("Za\xC5\xBC\xC3\xB3\xC5\x82\xC4\x87 g\xC4\x99\xC5\x9Bl\xC4\x85 ja\xC5\xBA\xC5\x84").is_valid_utf8());
+        TEST(str_view("\xE2\x82\xAC \xF0\x9F\x98\x80 \xEF\xBF\xBF \xF4\x8F\xBF\xBF").is_valid_utf8());
+        TEST(str_view("a\0b", 3).is_valid_utf8());
+        const char* const invalid[] = {
+            "\x80", "\xBF", "\xC0\x80", "\xC1\xBF", "\xC2", "\xC2\x41", "\xE0\x9F\xBF", "\xE0\xA0",
+            "\xED\xA0\x80", "\xED\xBF\xBF", "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80",
+            "\xFF", "\xF0\x9F\x98", "\xE2\x82\xAC\x80" };
+        for(const char* sz : invalid)
+            TEST(!str_view(sz).is_valid_utf8());
+        TEST(str_view_lite("\xED\x9F\xBF").is_valid_utf8() && !str_view_lite("\xED\xA0\x80").is_valid_utf8());
+
+        // Invalid byte at every position of a long ASCII string, to cross SIMD blocks.
+        string str(200, 'x');
+        for(size_t i = 0; i < str.length(); ++i)
+        {
+            str[i] = '\x80';
+            TEST(!str_view(str).is_valid_utf8());
+            str[i] = '\xC4';
+            TEST(!str_view(str).is_valid_utf8() || i + 1 < str.length()); // Followed by 'x'.
+            str[i] = 'x';
+        }
+        TEST(str_view(str).is_valid_utf8());
+
+        // All sequences of 4 bytes from boundaries of the ranges in table 3-7, across SIMD blocks
+        // and at the end. Validation must agree with conversion, which decodes one sequence at a time.
+        const char bytes[] = { 'x', '\x80', '\x8F', '\x90', '\x9F', '\xA0', '\xBF', '\xC1',
+            '\xC2', '\xDF', '\xE0', '\xED', '\xEF', '\xF0', '\xF4', '\xF5' };
+        const size_t offsets[] = { 0, 13, 29, 30, 31, 61, 62, 63, 92 };
+        wstring converted;
+        for(uint32_t code = 0; code < 0x10000; ++code)
+        {
+            str.assign(96, 'x');
+            for(size_t offset : offsets)
+            {
+                for(size_t i = 0; i < 4; ++i)
+                    str[offset + i] = bytes[(code >> (i * 4)) & 0xF];
+                str_view_utf8_to_wide(str, converted);
+                TEST(str_view(str).is_valid_utf8() == (converted.find(L'\xFFFD') == wstring::npos));
+                str.replace(offset, 4, 4, 'x');
+            }
+        }
+    }
+
+    // Replacement of invalid sequences by maximal subparts.
+    {
+        wchar_t buf[16];
+        TEST(str_view_utf8_to_wide("a\xE0\x80" "b", buf) == 4);
+        TEST(wstr_view(buf) == L"a\xFFFD\xFFFD" L"b");
+        TEST(str_view_utf8_to_wide("\xF0\x9F\x98!", buf) == 2 && wstr_view(buf) == L"\xFFFD!");
+        TEST(str_view_utf8_to_wide(str_view(), buf) == 0 && buf[0] == L'\0');
+
+        const wchar_t unpaired[] = { L'a', (wchar_t)0xD800, L'b', 0 };
+        char utf8[16];
+        TEST(str_view_wide_to_utf8(unpaired, utf8) == 5 && str_view(utf8) == "a\xEF\xBF\xBD" "b");
+        TEST(str_view_wide_to_utf8_length(unpaired) == 5);
+    }
+
+    // Random text: mostly ASCII, with characters of every length of UTF-8 and control characters.
+    uint32_t seed = 0x3C6EF372u;
+    const auto random = [&seed](uint32_t range) {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) % range;
+    };
+    for(size_t test = 0; test < 300; ++test)
+    {
+        std::vector<uint32_t> codePoints;
+        const uint32_t count = random(test % 10 == 0 ? 1000 : 80);
+        for(uint32_t i = 0; i < count; ++i)
+        {
+            const uint32_t kind = random(test % 3 == 0 ? 4 : 20);
+            uint32_t codePoint = kind == 0 ? 0x80 + random(0x780) : kind == 1 ? 0x800 + random(0xF800) :
+                kind == 2 ? 0x10000 + random(0x100000) : random(0x80);
+            if(codePoint >= 0xD800 && codePoint <= 0xDFFF)
+                codePoint = 0xE000;
+            codePoints.push_back(codePoint);
+        }
+        // Reference encoding.
+        string utf8;
+        wstring wide;
+        for(uint32_t cp : codePoints)
+        {
+            if(cp < 0x80)
+                utf8 += (char)cp;
+            else if(cp < 0x800)
+                utf8 += { (char)(0xC0 | (cp >> 6)), (char)(0x80 | (cp & 0x3F)) };
+            else if(cp < 0x10000)
+                utf8 += { (char)(0xE0 | (cp >> 12)), (char)(0x80 | ((cp >> 6) & 0x3F)), (char)(0x80 | (cp & 0x3F)) };
+            else
+                utf8 += { (char)(0xF0 | (cp >> 18)), (char)(0x80 | ((cp >> 12) & 0x3F)), (char)(0x80 | ((cp >> 6) & 0x3F)), (char)(0x80 | (cp & 0x3F)) };
+            if(sizeof(wchar_t) == 2 && cp >= 0x10000)
+                wide += { (wchar_t)(0xD800 + ((cp - 0x10000) >> 10)), (wchar_t)(0xDC00 + ((cp - 0x10000) & 0x3FF)) };
+            else
+                wide += (wchar_t)cp;
+        }
+        const str_view utf8View = str_view(utf8);
+        TEST(utf8View.is_valid_utf8());
+        TEST(str_view_utf8_to_wide_length(utf8View) == wide.length());
+        std::vector<wchar_t> wideBuf(utf8.length() + 1);
+        TEST(str_view_utf8_to_wide(utf8View, wideBuf.data()) == wide.length());
+        TEST(wstr_view(wideBuf.data(), wide.length()) == wstr_view(wide) && wideBuf[wide.length()] == L'\0');
+        TEST(str_view_wide_to_utf8_length(wide) == utf8.length());
+        std::vector<char> utf8Buf(str_view_wide_to_utf8_max_length(wide.length()) + 1);
+        TEST(str_view_wide_to_utf8(wide, utf8Buf.data()) == utf8.length());
+        TEST(memcmp(utf8Buf.data(), utf8.data(), utf8.length() + 1) == 0);
+
+        // Damaged text is rejected and converted with replacements.
+        if(!utf8.empty())
+        {
+            string damaged = utf8;
+            const size_t pos = random((uint32_t)damaged.length());
+            damaged[pos] = (char)(0x80 + random(0x80));
+            const bool valid = str_view(damaged).is_valid_utf8();
+            wstring converted;
+            str_view_utf8_to_wide(damaged, converted);
+            TEST(converted.length() == str_view_utf8_to_wide_length(damaged));
+            TEST(valid == (converted.find(L'\xFFFD') == wstring::npos));
+        }
+    }
+
+    // Results in strings and in arena.
+    {
+        const str_view utf8 = "Za\xC5\xBC\xC3\xB3\xC5\x82\xC4\x87 \xF0\x9F\x98\x80";
+        wstring wide = L"previous content";
+        str_view_utf8_to_wide(utf8, wide);
+        TEST(wide.length() == (sizeof(wchar_t) == 2 ? 9u : 8u) && wide[2] == (wchar_t)0x17C);
+        string back = "previous content";
+        str_view_wide_to_utf8(wide, back);
+        TEST(utf8 == back);
+
+        str_view_monotonic_arena arena;
+        const wstr_view arenaWide = str_view_utf8_to_wide(utf8, arena);
+        TEST(arenaWide == wstr_view(wide) && arenaWide.c_str() == arenaWide.data());
+        const str_view arenaUtf8 = str_view_wide_to_utf8(arenaWide, arena);
+        TEST(arenaUtf8 == utf8 && arenaUtf8.c_str() == arenaUtf8.data());
+        TEST(str_view_utf8_to_wide(str_view(), arena).empty());
+    }
+}
+
+template<typename CharT>
+static void TestParseNumberKernel()
+{
+    typedef std::basic_string<CharT> StringT;
+    typedef str_view_template<CharT> ViewT;
+    const auto make = [](const char* sz) { return StringT(sz, sz + strlen(sz)); };
+
+    {
+        int value = 7;
+        TEST(ViewT(make("0")).parse(value) && value == 0);
+        TEST(ViewT(make("-2147483648")).parse(value) && value == INT32_MIN);
+        TEST(ViewT(make("+2147483647")).parse(value) && value == INT32_MAX);
+        value = 7;
+        TEST(!ViewT(make("2147483648")).parse(value) && value == 7);
+        TEST(!ViewT(make("")).parse(value) && !ViewT(make("-")).parse(value) && !ViewT(make("12a")).parse(value));
+        TEST(!ViewT(make(" 12")).parse(value) && !ViewT(make("1.5")).parse(value) && value == 7);
+
+        uint64_t u64 = 0;
+        TEST(ViewT(make("18446744073709551615")).parse(u64) && u64 == UINT64_MAX);
+        TEST(ViewT(make("000000000000000000000018446744073709551615")).parse(u64) && u64 == UINT64_MAX);
+        TEST(!ViewT(make("18446744073709551616")).parse(u64) && !ViewT(make("123456789012345678901234")).parse(u64));
+        TEST(!ViewT(make("-1")).parse(u64) && ViewT(make("-0")).parse(u64) && u64 == 0);
+        int8_t i8 = 0;
+        TEST(ViewT(make("-128")).parse(i8) && i8 == -128 && !ViewT(make("128")).parse(i8));
+        uint16_t u16 = 0;
+        TEST(ViewT(make("65535")).parse(u16) && u16 == 65535 && !ViewT(make("65536")).parse(u16));
+
+        long long ll = 0;
+        const StringT field = make("id=12345678901234567,x");
+        TEST(ViewT(field).parse_prefix(ll, 3) == 17 && ll == 12345678901234567ll);
+        TEST(ViewT(field).parse_prefix(ll) == 0 && ViewT(field).parse_prefix(ll, 100) == 0);
+        TEST(ViewT(make("-42")).to_int() == -42 && ViewT(make("x")).to_int(-1) == -1);
+        TEST(str_view_lite_template<CharT>(field.data() + 3, 17).to_int() == 12345678901234567ll);
+    }
+
+    {
+        double value = 7;
+        TEST(ViewT(make("0")).parse(value) && value == 0);
+        TEST(ViewT(make("-0.0")).parse(value) && value == 0 && std::signbit(value));
+        TEST(ViewT(make("1.5")).parse(value) && value == 1.5);
+        TEST(ViewT(make("-.25")).parse(value) && value == -0.25);
+        TEST(ViewT(make("+3.")).parse(value) && value == 3);
+        TEST(ViewT(make("1e3")).parse(value) && value == 1000);
+        TEST(ViewT(make("2.5E-3")).parse(value) && value == 0.0025);
+        TEST(ViewT(make("0.1")).parse(value) && value == 0.1);
+        TEST(ViewT(make("123456789012345678901234567890")).parse(value) && value == 123456789012345678901234567890.0);
+        TEST(ViewT(make("0.000000000000000000000000000001")).parse(value) && value == 1e-30);
+        TEST(ViewT(make("1.7976931348623157e308")).parse(value) && value == DBL_MAX);
+        TEST(ViewT(make("4.9406564584124654e-324")).parse(value) && value == 4.9406564584124654e-324);
+        TEST(ViewT(make("9007199254740993")).parse(value) && value == 9007199254740992.0);
+        TEST(ViewT(make("INF")).parse(value) && value == std::numeric_limits<double>::infinity());
+        TEST(ViewT(make("-Infinity")).parse(value) && value == -std::numeric_limits<double>::infinity());
+        TEST(ViewT(make("nan")).parse(value) && value != value);
+        value = 7;
+        TEST(!ViewT(make("1e400")).parse(value) && !ViewT(make("1e-400")).parse(value) && value == 7);
+        TEST(!ViewT(make(".")).parse(value) && !ViewT(make("e5")).parse(value) && !ViewT(make("1e")).parse(value));
+        TEST(!ViewT(make("0x10")).parse(value) && !ViewT(make("in")).parse(value) && value == 7);
+        TEST(ViewT(make("1e+")).parse_prefix(value) == 1 && value == 1);
+        TEST(ViewT(make("-2.5e1;")).parse_prefix(value) == 6 && value == -25);
+        TEST(ViewT(make("1.5")).to_double() == 1.5 && ViewT(make("")).to_double(-1) == -1);
+
+        float f = 0;
+        TEST(ViewT(make("0.1")).parse(f) && f == 0.1f);
+        TEST(ViewT(make("16777217")).parse(f) && f == 16777216.0f);
+        TEST(ViewT(make("3.4028235e38")).parse(f) && f == FLT_MAX && !ViewT(make("1e39")).parse(f));
+    }
+
+    // Random numbers formatted by printf, compared with the C library.
+    uint32_t seed = 0x9E3779B9u;
+    const auto random = [&seed](uint32_t range) {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) % range;
+    };
+    char buf[64];
+    for(size_t test = 0; test < 3000; ++test)
+    {
+        const uint64_t bits = ((uint64_t)random(1u << 24) << 40) ^ ((uint64_t)random(1u << 24) << 16) ^ random(1u << 16);
+        const int64_t i64 = (int64_t)(bits >> random(64));
+        snprintf(buf, sizeof(buf), "%lld", (long long)(test % 2 ? -i64 : i64));
+        int64_t parsedInt = 0;
+        TEST(ViewT(make(buf)).parse(parsedInt) && parsedInt == strtoll(buf, nullptr, 10));
+        int32_t parsedInt32 = 0;
+        const long long asLongLong = strtoll(buf, nullptr, 10);
+        TEST(ViewT(make(buf)).parse(parsedInt32) == (asLongLong >= INT32_MIN && asLongLong <= INT32_MAX));
+
+        // Decimal numbers of up to 25 digits, with the point anywhere and exponent.
+        string number = test % 3 ? "" : "-";
+        const uint32_t digitCount = 1 + random(test % 4 ? 17 : 25);
+        const uint32_t pointPos = random(digitCount + 1);
+        for(uint32_t i = 0; i < digitCount; ++i)
+        {
+            if(i == pointPos)
+                number += '.';
+            number += (char)('0' + random(10));
+        }
+        if(test % 2)
+        {
+            snprintf(buf, sizeof(buf), "e%d", (int)random(test % 5 ? 60 : 560) - (test % 5 ? 30 : 280));
+            number += buf;
+        }
+        double parsedDouble = 0;
+        TEST(ViewT(make(number.c_str())).parse(parsedDouble) && parsedDouble == strtod(number.c_str(), nullptr));
+        float parsedFloat = 0;
+        const float expectedFloat = strtof(number.c_str(), nullptr);
+        if(expectedFloat != 0 && expectedFloat <= FLT_MAX && expectedFloat >= -FLT_MAX && std::fabs(expectedFloat) >= FLT_MIN)
+            TEST(ViewT(make(number.c_str())).parse(parsedFloat) && parsedFloat == expectedFloat);
+    }
+}
+
+static void TestParseNumber()
+{
+    TestParseNumberKernel<char>();
+    TestParseNumberKernel<wchar_t>();
+
+    // Fields of a CSV line, which is not null-terminated between them.
+    const str_view line = "17,-3.25,abc,1e2";
+    double sum = 0;
+    for(const str_view_lite& field : line.split(','))
+        sum += field.to_double();
+    TEST(sum == 17 - 3.25 + 100);
+
+    // Cases hard to round: halfway between doubles, smallest and largest numbers, many digits.
+    {
+        const char* const numbers[] = {
+            "9007199254740993", "9007199254740993.0000000000000000001", "9007199254740995",
+            "2.2250738585072011e-308", "4.9406564584124654e-324", "2.4703282292062328e-324",
+            "1.7976931348623157e308", "1.7976931348623158e308", "7.2057594037927933e16",
+            "0.1000000000000000055511151231257827021181583404541015625", "123456789012345678901234567890e-10",
+            "3.4028235e38", "1.17549435e-38", "1.4e-45", "16777217", "0.000000000000000000000000000000000000000000000000001" };
+        for(const char* number : numbers)
+        {
+            double value = 0;
+            float floatValue = 0;
+            TEST(str_view(number).parse(value) && value == strtod(number, nullptr));
+            TEST(str_view(number).parse(floatValue) == (strtof(number, nullptr) != 0 && std::isfinite(strtof(number, nullptr))));
+            TEST(floatValue == 0 || floatValue == strtof(number, nullptr));
+        }
+        double value = 0;
+        TEST(!str_view("2.4703282292062327e-324").parse(value) && !str_view("1.7976931348623159e308").parse(value));
+        TEST(!str_view("1e-400").parse(value) && !str_view("1e400").parse(value) && value == 0);
+    }
+
+    // Random doubles printed with different precision and numbers halfway between them.
+    {
+        uint64_t seed = 0x2545F4914F6CDD1Dull;
+        char buf[128];
+        for(size_t test = 0; test < 20000; ++test)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            const uint64_t bits = seed >> (test % 2);
+            double number;
+            memcpy(&number, &bits, sizeof(number));
+            if(!std::isfinite(number) || number == 0)
+                continue;
+            if(test % 4 == 0)
+            {
+                const double next = std::nextafter(number, INFINITY);
+                snprintf(buf, sizeof(buf), "%.*Le", (int)(16 + test % 25), ((long double)number + next) / 2);
+            }
+            else
+                snprintf(buf, sizeof(buf), "%.*e", (int)(test % 20), number);
+            const double expected = strtod(buf, nullptr);
+            double value = 0;
+            const bool parsed = str_view(buf).parse(value);
+            TEST(parsed ? value == expected : expected == 0 || !std::isfinite(expected));
+            const float expectedFloat = strtof(buf, nullptr);
+            float floatValue = 0;
+            if(str_view(buf).parse(floatValue))
+                TEST(floatValue == expectedFloat);
+            else
+                TEST(expectedFloat == 0 || !std::isfinite(expectedFloat));
+        }
+    }
+}
+
+template<typename CharT>
+static void TestStructuralIndexKernel()
+{
+    typedef std::basic_string<CharT> StringT;
+    typedef str_view_lite_template<CharT> LiteT;
+    const auto make = [](const char* sz) { return StringT(sz, sz + strlen(sz)); };
+
+    {
+        const StringT text = make("id,name,note\r\n1,\"Smith, John\",\"say \"\"hi\"\"\"\r\n2,,\"multi\nline\"\r\n\n3");
+        const str_view_structural_index_template<CharT> index = str_view_structural_index_template<CharT>(LiteT(text));
+        TEST(index.row_count() == 5 && index.field_count() == 11);
+        TEST(index.row_field_count(0) == 3 && index.row_field_count(3) == 1 && index.row_field_count(4) == 1);
+        TEST(index.field(0, 2) == LiteT(make("note")));
+        TEST(index.field(1, 1) == LiteT(make("Smith, John")) && index.is_quoted(index.row_first_field(1) + 1));
+        TEST(index.field(2, 1).empty() && index.field(2, 2) == LiteT(make("multi\nline")));
+        TEST(index.field(3, 0).empty() && index.field(4, 0) == LiteT(make("3")));
+        TEST(index.row(1) == LiteT(make("1,\"Smith, John\",\"say \"\"hi\"\"\"")));
+        TEST(index.row(3).empty() && index.row(4) == LiteT(make("3")));
+        StringT unescaped = make("previous");
+        index.field_to_string(index.row_first_field(1) + 2, unescaped);
+        TEST(unescaped == make("say \"hi\""));
+        index.field_to_string(0, unescaped);
+        TEST(unescaped == make("id"));
+    }
+
+    // Trailing newline, empty text and disabled quoting.
+    {
+        str_view_structural_index_template<CharT> index;
+        TEST(index.row_count() == 0 && index.field_count() == 0);
+        const StringT text = make("a\tb\"\tc\n");
+        index.build(LiteT(text), (CharT)'\t', (CharT)'\t');
+        TEST(index.row_count() == 1 && index.row_field_count(0) == 3 && index.field(1) == LiteT(make("b\"")));
+        index.build(LiteT(text), (CharT)'\t');
+        TEST(index.row_count() == 1 && index.row_field_count(0) == 2 && index.field(1) == LiteT(make("b\"\tc\n")));
+        index.build(LiteT());
+        TEST(index.row_count() == 0 && index.field_count() == 0);
+        const StringT newline = make("\n");
+        index.build(LiteT(newline));
+        TEST(index.row_count() == 1 && index.field(0, 0).empty());
+    }
+
+    // Random rows compared with scalar splitting, with fields long enough to cross SIMD registers.
+    uint32_t seed = 0x243F6A88u;
+    const auto random = [&seed](uint32_t range) {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) % range;
+    };
+    for(size_t test = 0; test < 200; ++test)
+    {
+        std::vector<std::vector<StringT>> rows(random(8));
+        StringT text;
+        for(std::vector<StringT>& row : rows)
+        {
+            row.resize(1 + random(6));
+            for(size_t col = 0; col < row.size(); ++col)
+            {
+                row[col].assign(random(test % 2 ? 40 : 5), (CharT)'x');
+                for(CharT& ch : row[col])
+                    ch = (CharT)("ab;\n"[random(4)]);
+                const bool quoted = row[col].find_first_of(make(";\n")) != StringT::npos;
+                if(col > 0)
+                    text += (CharT)';';
+                if(quoted)
+                    text += (CharT)'\'';
+                text += row[col];
+                if(quoted)
+                    text += (CharT)'\'';
+            }
+            text += (CharT)'\n';
+        }
+        const str_view_structural_index_template<CharT> index(LiteT(text), (CharT)';', (CharT)'\'');
+        TEST(index.row_count() == rows.size());
+        size_t fieldCount = 0;
+        for(size_t r = 0; r < rows.size() && r < index.row_count(); ++r)
+        {
+            TEST(index.row_field_count(r) == rows[r].size());
+            for(size_t c = 0; c < rows[r].size() && c < index.row_field_count(r); ++c)
+                TEST(index.field(r, c) == LiteT(rows[r][c]));
+            fieldCount += rows[r].size();
+        }
+        TEST(index.field_count() == fieldCount);
+    }
+}
+
+static void TestStructuralIndex()
+{
+    TestStructuralIndexKernel<char>();
+    TestStructuralIndexKernel<wchar_t>();
+}
+
+static void TestStringPool()
+{
+    // Basic interning
+    {
+        string_pool pool;
+        const string a = "hostname";
+        const string b = "hostname";
+        const str_view internedA = pool.intern(a);
+        const str_view internedB = pool.intern(str_view(b));
+        TEST(internedA == "hostname");
+        TEST(internedA.data() == internedB.data());
+        TEST(internedA.data() != a.data());
+        TEST(internedA.c_str() == internedA.data()); // Null-terminated, no copy.
+        TEST(internedA.length() == 8);
+
+        const str_view other = pool.intern("host");
+        TEST(other == "host" && other.data() != internedA.data());
+        TEST(pool.size() == 2);
+
+        TEST(pool.intern("").empty());
+        TEST(pool.size() == 2);
+    }
+
+    // Lookup
+    {
+        string_pool pool(1);
+        const str_view interned = pool.intern("Content-Length");
+        const string key = "Content-Length: 123";
+        TEST(pool.find(str_view(key).substr(0, 14)).data() == interned.data());
+        TEST(pool.find("Content-Type").data() == nullptr);
+        TEST(pool.contains("Content-Length"));
+        TEST(!pool.contains("content-length"));
+        TEST(pool.contains(""));
+        TEST(pool.size() == 1);
+    }
+
+    // Many strings, views stay valid while the pool grows.
+    {
+        string_pool pool(4, 256);
+        std::vector<str_view> views;
+        for(int i = 0; i < 5000; ++i)
+            views.push_back(pool.intern(std::to_string(i)));
+        std::string longStr(1000, 'x');
+        const str_view longView = pool.intern(longStr);
+        TEST(pool.size() == 5001);
+        for(int i = 0; i < 5000; ++i)
+        {
+            TEST(views[i] == std::to_string(i).c_str());
+            TEST(pool.intern(std::to_string(i)).data() == views[i].data());
+        }
+        TEST(longView.length() == 1000 && pool.find(longStr).data() == longView.data());
+
+        const string_pool::Stats stats = pool.get_stats();
+        TEST(stats.stringCount == 5001);
+        size_t expectedBytes = 1001;
+        for(int i = 0; i < 5000; ++i)
+            expectedBytes += std::to_string(i).length() + 1;
+        TEST(stats.stringBytes == expectedBytes);
+        TEST(stats.blockBytes >= stats.stringBytes);
+        TEST(stats.tableBytes > 0);
+
+        pool.clear();
+        TEST(pool.size() == 0 && !pool.contains("1"));
+        TEST(pool.intern("1") == "1");
+    }
+
+    // Interning strings already in the pool doesn't grow the table, even when it's full.
+    {
+        string_pool pool(1);
+        std::vector<string> strings;
+        for(int i = 0; i < 48; ++i)
+            strings.push_back(std::to_string(i));
+        for(const string& str : strings)
+            pool.intern(str);
+        const size_t tableBytes = pool.get_stats().tableBytes;
+        for(const string& str : strings)
+            TEST(pool.intern(str) == str_view(str));
+        TEST(pool.get_stats().tableBytes == tableBytes);
+        pool.intern("new");
+        TEST(pool.get_stats().tableBytes > tableBytes && pool.size() == 49);
+    }
+
+    // Wide strings
+    {
+        wstring_pool pool;
+        const wstr_view interned = pool.intern(L"Ala");
+        TEST(interned == L"Ala" && pool.intern(wstring(L"Ala")).data() == interned.data());
+    }
+
+    // Concurrent inserts of overlapping strings
+    {
+        string_pool pool;
+        const int threadCount = 8, stringCount = 2000;
+        std::vector<std::vector<const char*>> results(threadCount);
+        std::vector<std::thread> threads;
+        for(int t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([&pool, &results, t]() {
+                for(int i = 0; i < stringCount; ++i)
+                {
+                    const int value = (i * (t + 1)) % stringCount;
+                    results[t].push_back(pool.intern(std::to_string(value)).data());
+                }
+            });
+        }
+        for(std::thread& thread : threads)
+            thread.join();
+        TEST(pool.size() == stringCount);
+        for(int t = 0; t < threadCount; ++t)
+        {
+            for(int i = 0; i < stringCount; ++i)
+            {
+                const int value = (i * (t + 1)) % stringCount;
+                TEST(pool.find(std::to_string(value)).data() == results[t][i]);
+            }
+        }
+    }
+}
+
+template<typename CharT>
+static int NaiveCompareNocase(const CharT* lhs, const CharT* rhs, size_t count)
+{
+    typedef typename std::conditional<sizeof(CharT) == 1, unsigned char, CharT>::type CompareT;
+    for(size_t i = 0; i < count; ++i)
+    {
+        CompareT lhsCh = (CompareT)lhs[i], rhsCh = (CompareT)rhs[i];
+        if(lhsCh >= 'A' && lhsCh <= 'Z')
+            lhsCh = (CompareT)(lhsCh + 32);
+        if(rhsCh >= 'A' && rhsCh <= 'Z')
+            rhsCh = (CompareT)(rhsCh + 32);
+        if(lhsCh != rhsCh)
+            return lhsCh < rhsCh ? -1 : 1;
+        if(lhsCh == 0)
+            return 0;
+    }
+    return 0;
+}
+
+static int Sign(int value) { return (value > 0) - (value < 0); }
+
+template<typename CharT>
+static void TestCompareNocaseKernel()
+{
+    typedef std::basic_string<CharT> StringT;
+    typedef str_view_lite_template<CharT> ViewT;
+    // Characters around letter boundaries and outside ASCII.
+    const CharT special[] = { (CharT)'@', (CharT)'[', (CharT)'`', (CharT)'{', (CharT)0x7F, (CharT)0x80, (CharT)0xC1, (CharT)0xE1, (CharT)0xFF };
+    const size_t specialCount = sizeof(special) / sizeof(special[0]);
+
+    for(size_t len = 0; len < 80; ++len)
+    {
+        StringT lower(len, (CharT)0), mixed(len, (CharT)0);
+        for(size_t i = 0; i < len; ++i)
+        {
+            lower[i] = (CharT)('a' + (i * 5) % 26);
+            mixed[i] = (i % 3 == 0) ? (CharT)(lower[i] - 'a' + 'A') : lower[i];
+        }
+        TEST(ViewT(lower).compare(ViewT(mixed), false) == 0);
+        TEST(ViewT(mixed).compare(ViewT(lower), false) == 0);
+        TEST(ViewT(mixed).starts_with(ViewT(lower).substr(0, len / 2), false));
+        TEST(ViewT(mixed).ends_with(ViewT(lower).substr(len / 2), false));
+
+        for(size_t pos = 0; pos < len; ++pos)
+        {
+            // Difference at pos.
+            for(size_t k = 0; k < specialCount; ++k)
+            {
+                StringT changed = mixed;
+                changed[pos] = special[k];
+                const int expected = NaiveCompareNocase(lower.data(), changed.data(), len);
+                TEST(Sign(ViewT(lower).compare(ViewT(changed), false)) == expected);
+                TEST(Sign(ViewT(changed).compare(ViewT(lower), false)) == -expected);
+            }
+            // Null character at pos ends comparison, like in _strnicmp.
+            StringT lhs = lower, rhs = mixed;
+            lhs[pos] = rhs[pos] = (CharT)0;
+            if(pos + 1 < len)
+                rhs[pos + 1] = (CharT)'#';
+            TEST(ViewT(lhs).compare(ViewT(rhs), false) == 0);
+            // Unless comparison is binary.
+            if(pos + 1 < len)
+                TEST(ViewT(lhs).template compare<str_view_binary_compare>(ViewT(rhs), false) > 0);
+        }
+    }
+
+    // Wide characters that become ASCII letters when truncated are not letters.
+    if(sizeof(CharT) > 1)
+    {
+        StringT lhs(40, (CharT)'a'), rhs(40, (CharT)'a');
+        rhs[33] = (CharT)(0x100 + 'A');
+        TEST(ViewT(lhs).compare(ViewT(rhs), false) < 0);
+        rhs[33] = (CharT)(0x8000 + 'a');
+        TEST(ViewT(lhs).compare(ViewT(rhs), false) < 0);
+    }
+}
+
+static void TestCompareNocase()
+{
+    TestCompareNocaseKernel<char>();
+    TestCompareNocaseKernel<wchar_t>();
+
+    TEST(tstrnicmp("Content-Length", "content-length", 14) == 0);
+    TEST(tstrnicmp(L"Content-Length", L"CONTENT-LENGTH", 14) == 0);
+    TEST(tstrnicmp("abc", "ABD", 3) < 0);
+}
+
+static void TestBinaryCompare()
+{
+    // Embedded null characters
+    {
+        const char a[] = "ABC\0DEF", b[] = "ABC\0XYZ";
+        const str_view va(a, 7), vb(b, 7);
+        // Default: like strncmp.
+        TEST(va == vb && va.compare(vb) == 0 && va.equals(vb));
+        TEST(va.starts_with(str_view(b, 5)));
+        // Binary: like memcmp.
+        TEST(!va.equals<str_view_binary_compare>(vb));
+        TEST(va.compare<str_view_binary_compare>(vb) < 0);
+        TEST(vb.compare<str_view_binary_compare>(va) > 0);
+        TEST(!va.starts_with<str_view_binary_compare>(str_view(b, 5)));
+        TEST(va.starts_with<str_view_binary_compare>(str_view(b, 4)));
+        TEST(!va.ends_with<str_view_binary_compare>(str_view(b + 3, 4)));
+        TEST(va.ends_with<str_view_binary_compare>(str_view(a + 3, 4)));
+        TEST(va.equals<str_view_binary_compare>(str_view(string(a, 7))));
+
+        const str_view_lite la(a, 7), lb(b, 7);
+        TEST(la == lb && !la.equals<str_view_binary_compare>(lb));
+        TEST(str_view_lite("abc\0Def", 7).equals<str_view_binary_compare>(str_view_lite("ABC\0dEF", 7), false));
+        TEST(!str_view_lite("abc\0Def", 7).equals<str_view_binary_compare>(str_view_lite("ABC\0dEx", 7), false));
+        TEST(str_view_lite("abc\0Def", 7).compare<str_view_binary_compare>(str_view_lite("ABC\0dEx", 7), false) < 0);
+
+        const wchar_t wa[] = L"AB\0C", wb[] = L"AB\0D";
+        TEST(wstr_view(wa, 4) == wstr_view(wb, 4));
+        TEST(wstr_view(wa, 4).compare<str_view_binary_compare>(wstr_view(wb, 4)) < 0);
+    }
+
+    // Bytes above 0x7F are ordered as unsigned in both modes.
+    {
+        const char hi[] = "\x80", lo[] = "\x7F";
+        TEST(str_view(hi).compare(lo) > 0);
+        TEST(str_view(hi).compare<str_view_binary_compare>(lo) > 0);
+        TEST(tmemcmp("a\0b", "a\0c", 3) < 0);
+        TEST(tmemicmp("A\0b", "a\0B", 3) == 0);
+    }
+
+    // equals() is consistent with compare().
+    {
+        const char* const strings[] = { "", "a", "A", "ab", "abc", "abd", "ABC", "b" };
+        for(const char* lhs : strings)
+        {
+            for(const char* rhs : strings)
+            {
+                for(int cs = 0; cs < 2; ++cs)
+                {
+                    TEST(str_view(lhs).equals(rhs, cs != 0) == (str_view(lhs).compare(rhs, cs != 0) == 0));
+                    TEST(str_view(lhs).equals<str_view_binary_compare>(rhs, cs != 0) ==
+                        (str_view(lhs).compare<str_view_binary_compare>(rhs, cs != 0) == 0));
+                }
+            }
+        }
+    }
+
+    // Containers
+    {
+        const char k1[] = { 1, 0, 2 }, k2[] = { 1, 0, 3 };
+        std::map<str_view_lite, int, str_view_less<str_view_binary_compare>> map;
+        map[str_view_lite(k1, 3)] = 1;
+        map[str_view_lite(k2, 3)] = 2;
+        TEST(map.size() == 2);
+        TEST(map[str_view_lite(k2, 3)] == 2);
+
+        std::unordered_map<str_view_lite, int, str_view_hash<str_view_binary_compare>, str_view_equal_to<str_view_binary_compare>> hashMap;
+        hashMap[str_view_lite(k1, 3)] = 1;
+        hashMap[str_view_lite(k2, 3)] = 2;
+        TEST(hashMap.size() == 2 && hashMap[str_view_lite(k1, 3)] == 1);
+    }
+
+#if STR_VIEW_HAS_CONSTEXPR
+    {
+        using namespace str_view_literals;
+        static_assert("ABC\0DEF"_svl.equals("ABC\0XYZ"_svl), "");
+        static_assert(!"ABC\0DEF"_svl.equals<str_view_binary_compare>("ABC\0XYZ"_svl), "");
+        static_assert("ABC\0DEF"_svl.compare<str_view_binary_compare>("ABC\0XYZ"_svl) < 0, "");
+        static_assert(!"abc"_svl.equals("abcd"_svl), "");
+    }
+#endif
+}
+
+template<typename RangeT>
+static std::vector<string> SplitToVector(const RangeT& range)
+{
+    std::vector<string> result;
+    for(str_view_lite part : range)
+        result.push_back(string(part.data(), part.length()));
+    return result;
+}
+
+// Reference implementation: separator is found with std::basic_string::find or find_first_of.
+template<typename CharT, typename FindT>
+static std::vector<std::basic_string<CharT>> NaiveSplit(const std::basic_string<CharT>& str, size_t separatorLen, FindT find)
+{
+    std::vector<std::basic_string<CharT>> result;
+    size_t pos = 0;
+    for(;;)
+    {
+        const size_t found = find(str, pos);
+        if(found == std::basic_string<CharT>::npos)
+            break;
+        result.push_back(str.substr(pos, found - pos));
+        pos = found + separatorLen;
+    }
+    result.push_back(str.substr(pos));
+    return result;
+}
+
+template<typename CharT>
+static void TestSplitKernel()
+{
+    typedef std::basic_string<CharT> StringT;
+    typedef str_view_template<CharT> ViewT;
+
+    uint32_t seed = 4321;
+    auto random = [&seed](uint32_t max) -> uint32_t {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % max;
+    };
+    auto collect = [](const str_view_split_range_template<CharT, str_view_detail::split_by_char<CharT>>& range) {
+        std::vector<StringT> result;
+        for(str_view_lite_template<CharT> part : range)
+            result.push_back(StringT(part.data(), part.length()));
+        return result;
+    };
+    for(size_t iter = 0; iter < 500; ++iter)
+    {
+        // Long strings with rare separators cross vector boundaries between parts.
+        const uint32_t alphabet = 2 + random(20);
+        StringT str(random(200), (CharT)'a');
+        for(CharT& ch : str)
+            ch = (CharT)('a' + random(alphabet));
+        const ViewT view(str);
+
+        const CharT ch = (CharT)('a' + random(alphabet));
+        TEST(collect(view.split(ch)) == NaiveSplit(str, 1, [ch](const StringT& s, size_t pos) { return s.find(ch, pos); }));
+
+        const StringT separator(1 + random(3), (CharT)('a' + random(2)));
+        std::vector<StringT> parts;
+        for(str_view_lite_template<CharT> part : view.split(ViewT(separator)))
+            parts.push_back(StringT(part.data(), part.length()));
+        TEST(parts == NaiveSplit(str, separator.length(), [&separator](const StringT& s, size_t pos) { return s.find(separator, pos); }));
+
+        StringT separators(random(5), (CharT)'a');
+        for(CharT& sep : separators)
+            sep = (CharT)('a' + random(alphabet));
+        parts.clear();
+        for(str_view_lite_template<CharT> part : view.split_any(ViewT(separators)))
+            parts.push_back(StringT(part.data(), part.length()));
+        TEST(parts == NaiveSplit(str, 1, [&separators](const StringT& s, size_t pos) {
+            return separators.empty() ? StringT::npos : s.find_first_of(separators, pos); }));
+    }
+}
+
+static void TestSplit()
+{
+    // Split by character.
+    {
+        TEST(SplitToVector(str_view("a,b,c").split(',')) == (std::vector<string>{ "a", "b", "c" }));
+        TEST(SplitToVector(str_view("a,,b,").split(',')) == (std::vector<string>{ "a", "", "b", "" }));
+        TEST(SplitToVector(str_view(",").split(',')) == (std::vector<string>{ "", "" }));
+        TEST(SplitToVector(str_view("abc").split(',')) == (std::vector<string>{ "abc" }));
+        TEST(SplitToVector(str_view().split(',')) == (std::vector<string>{ "" }));
+        TEST(SplitToVector(str_view("").split(',')) == (std::vector<string>{ "" }));
+        // Parts point into the original string.
+        const char* const sz = "key=value";
+        const str_view_lite value = *++str_view_lite(sz).split('=').begin();
+        TEST(value.data() == sz + 4 && value.length() == 5);
+    }
+
+    // Split by substring.
+    {
+        TEST(SplitToVector(str_view("line1\r\nline2\r\n\r\nline3").split("\r\n")) == (std::vector<string>{ "line1", "line2", "", "line3" }));
+        TEST(SplitToVector(str_view("aaaa").split("aa")) == (std::vector<string>{ "", "", "" }));
+        TEST(SplitToVector(str_view("aaa").split("aa")) == (std::vector<string>{ "", "a" }));
+        TEST(SplitToVector(str_view_lite("a<=>b").split("<=>")) == (std::vector<string>{ "a", "b" }));
+        TEST(SplitToVector(str_view("a").split("aa")) == (std::vector<string>{ "a" }));
+    }
+
+    // Split by any of characters.
+    {
+        TEST(SplitToVector(str_view("a b\tc  d").split_any(" \t")) == (std::vector<string>{ "a", "b", "c", "", "d" }));
+        TEST(SplitToVector(str_view("a b").split_any("")) == (std::vector<string>{ "a b" }));
+        const char_set whitespace(" \t\r\n", 4);
+        TEST(SplitToVector(str_view_lite("x\ny z").split_any(whitespace)) == (std::vector<string>{ "x", "y", "z" }));
+        // Many separators go through the lookup table instead of the SIMD small-set kernel.
+        TEST(SplitToVector(str_view("1+2-3*4/5=6^7&8").split_any("+-*/=^&|!~")) ==
+            (std::vector<string>{ "1", "2", "3", "4", "5", "6", "7", "8" }));
+    }
+
+    // Wide characters.
+    {
+        std::vector<wstring> parts;
+        for(wstr_view_lite part : wstr_view(L"ą;ć;;").split(L';'))
+            parts.push_back(wstring(part.data(), part.length()));
+        TEST(parts == (std::vector<wstring>{ L"ą", L"ć", L"", L"" }));
+        parts.clear();
+        for(wstr_view_lite part : wstr_view(L"xąąy").split_any(L"ą"))
+            parts.push_back(wstring(part.data(), part.length()));
+        TEST(parts == (std::vector<wstring>{ L"x", L"", L"y" }));
+    }
+
+    // Iterator semantics of a forward range.
+    {
+        const auto range = str_view("a,b").split(',');
+        auto it = range.begin();
+        const auto copy = it;
+        TEST(it == copy && it != range.end());
+        TEST(*it++ == "a" && *copy == "a");
+        TEST(*it == "b" && it != copy);
+        TEST(++it == range.end());
+        TEST(range.begin() == copy);
+        TEST(std::distance(range.begin(), range.end()) == 2);
+        TEST(decltype(range)().begin() == decltype(range)().end());
+    }
+
+#ifdef __cpp_lib_ranges
+    {
+        typedef decltype(str_view().split(',')) RangeT;
+        static_assert(std::ranges::forward_range<RangeT>);
+        static_assert(std::ranges::borrowed_range<RangeT>);
+        static_assert(std::ranges::view<RangeT>);
+
+        const str_view csv = "10,,20,abc,30";
+        TEST(std::ranges::count_if(csv.split(','), [](str_view_lite part) { return part.empty(); }) == 1);
+        const auto found = std::ranges::find(csv.split(','), str_view_lite("abc"));
+        TEST((*found).data() == csv.data() + 7);
+        size_t nonEmpty = 0;
+        for(str_view_lite part : csv.split(',') | std::views::filter([](str_view_lite part) { return !part.empty(); }))
+            nonEmpty += part.length();
+        TEST(nonEmpty == 9);
+    }
+#endif
+
+    TestSplitKernel<char>();
+    TestSplitKernel<wchar_t>();
+}
+
+template<typename CharT>
+static void TestBatchKernel()
+{
+    typedef std::basic_string<CharT> StringT;
+    typedef str_view_lite_template<CharT> LiteT;
+
+    uint32_t seed = 777;
+    auto random = [&seed](uint32_t max) -> uint32_t {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % max;
+    };
+    // Short strings over tiny alphabet, including '\0', give many equal keys and prefixes.
+    auto randomString = [&random](size_t maxLength) {
+        StringT str(random((uint32_t)maxLength + 1), (CharT)0);
+        for(CharT& ch : str)
+            ch = (CharT)(random(4) ? 'a' + random(2) : 0);
+        return str;
+    };
+    for(size_t iter = 0; iter < 300; ++iter)
+    {
+        // Counts around multiples of register width test the scalar tail.
+        std::vector<StringT> strings(random(40));
+        for(StringT& str : strings)
+            str = randomString(7);
+        str_view_batch_template<CharT> batch;
+        for(const StringT& str : strings)
+            batch.push_back(LiteT(str));
+        TEST(batch.size() == strings.size());
+
+        for(size_t probeIndex = 0; probeIndex < 10; ++probeIndex)
+        {
+            const StringT probe = randomString(9);
+            size_t first = SIZE_MAX, longest = SIZE_MAX, equal = 0;
+            for(size_t i = 0; i < strings.size(); ++i)
+            {
+                if(probe.compare(0, strings[i].length(), strings[i]) == 0 && strings[i].length() <= probe.length())
+                {
+                    if(first == SIZE_MAX)
+                        first = i;
+                    if(longest == SIZE_MAX || strings[i].length() > strings[longest].length())
+                        longest = i;
+                }
+                if(strings[i] == probe)
+                    ++equal;
+            }
+            TEST(batch.find_first_matching_prefix(LiteT(probe)) == first);
+            TEST(batch.find_longest_matching_prefix(LiteT(probe)) == longest);
+            TEST(batch.count_equal(LiteT(probe)) == equal);
+        }
+
+        // Batch points to characters of strings, so a copy is sorted for reference.
+        batch.sort();
+        std::vector<StringT> expected = strings;
+        std::sort(expected.begin(), expected.end());
+        bool sorted = batch.size() == expected.size();
+        for(size_t i = 0; sorted && i < expected.size(); ++i)
+            sorted = StringT(batch[i].data(), batch[i].length()) == expected[i];
+        TEST(sorted);
+    }
+}
+
+static void TestBatch()
+{
+    {
+        str_view_batch routes;
+        TEST(routes.empty() && routes.find_first_matching_prefix("/") == SIZE_MAX);
+        const char* const prefixes[] = { "/api/v2/users", "/api/v1/", "/api/v1/users/", "/static/", "/api/v1/users" };
+        for(const char* prefix : prefixes)
+            routes.push_back(prefix);
+        TEST(routes.size() == 5 && routes[3] == "/static/");
+        TEST(routes.find_first_matching_prefix("/api/v1/users/42") == 1);
+        TEST(routes.find_longest_matching_prefix("/api/v1/users/42") == 2);
+        TEST(routes.find_longest_matching_prefix("/api/v1/users") == 4);
+        TEST(routes.find_first_matching_prefix("/api/v3") == SIZE_MAX);
+        TEST(routes.find_first_matching_prefix("/stat") == SIZE_MAX);
+        TEST(routes.find_first_matching_prefix(str_view("/static/a.css")) == 3);
+        TEST(routes.count_equal("/api/v1/") == 1 && routes.count_equal("/api/v1") == 0);
+
+        routes.push_back("");
+        TEST(routes.find_first_matching_prefix("/xyz") == 5);
+        routes.clear();
+        TEST(routes.empty() && routes.count_equal("") == 0);
+    }
+
+    // count_equal and sort across many strings, all with the same first characters.
+    {
+        std::vector<string> keys;
+        for(size_t i = 0; i < 100; ++i)
+            keys.push_back("key_" + std::to_string(i % 37));
+        str_view_batch batch;
+        batch.reserve(keys.size());
+        for(const string& key : keys)
+            batch.push_back(key);
+        TEST(batch.count_equal("key_5") == 3);
+        TEST(batch.count_equal("key_36") == 2);
+        TEST(batch.count_equal("key_") == 0);
+        TEST(batch.count_equal("key_50") == 0);
+        batch.sort();
+        bool sorted = true;
+        for(size_t i = 1; i < batch.size(); ++i)
+            sorted = sorted && batch[i - 1].compare(batch[i]) <= 0;
+        TEST(sorted && batch[0] == "key_0" && batch[99] == "key_9");
+    }
+
+    // Bytes above 0x7F are sorted as unsigned, like memcmp.
+    {
+        str_view_batch batch;
+        batch.push_back("\x80");
+        batch.push_back("b");
+        batch.push_back(str_view_lite("a\0", 2));
+        batch.push_back("a");
+        batch.sort();
+        TEST(batch[0] == "a" && batch[1].length() == 2 && batch[2] == "b" && batch[3] == "\x80");
+    }
+
+    {
+        wstr_view_batch batch;
+        batch.push_back(L"zażółć");
+        batch.push_back(L"za");
+        TEST(batch.find_longest_matching_prefix(L"zażółć gęślą") == 0);
+        TEST(batch.find_first_matching_prefix(L"zaz") == 1);
+        TEST(batch.count_equal(L"za") == 1);
+    }
+
+    TestBatchKernel<char>();
+    TestBatchKernel<wchar_t>();
+}
+
+// Runs tasks in reverse order on the calling thread, to check that results don't depend on order.
+class ReverseExecutor : public str_view_executor
+{
+public:
+    size_t m_TaskCount = 0;
+    virtual void run(size_t taskCount, const std::function<void(size_t)>& task)
+    {
+        m_TaskCount += taskCount;
+        for(size_t i = taskCount; i--; )
+            task(i);
+    }
+};
+
+template<typename CharT>
+static void TestParallelSearchKernel(str_view_executor& executor)
+{
+    typedef std::basic_string<CharT> StringT;
+    typedef str_view_template<CharT> ViewT;
+
+    uint32_t seed = 99;
+    auto random = [&seed](uint32_t max) -> uint32_t {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % max;
+    };
+    for(size_t iter = 0; iter < 300; ++iter)
+    {
+        const uint32_t alphabet = 2 + random(6);
+        StringT haystack(random(500), (CharT)'a');
+        for(CharT& ch : haystack)
+            ch = (CharT)('a' + random(alphabet));
+        StringT needle(1 + random(iter % 2 ? 40 : 4), (CharT)'a');
+        for(CharT& ch : needle)
+            ch = (CharT)('a' + random(alphabet));
+        const CharT ch = (CharT)('a' + random(alphabet + 1));
+        const CharT chars[] = { (CharT)('a' + random(alphabet + 2)), (CharT)('a' + random(alphabet + 2)) };
+
+        // Chunks shorter than the needle make occurrences cross many chunk borders.
+        const str_view_parallel_options options(&executor, 1 + random(60));
+        const ViewT view(haystack);
+        TEST(view.find_parallel(ViewT(needle), options) == view.find(ViewT(needle)));
+        TEST(view.find_parallel(ch, options) == view.find(ch));
+        TEST(view.count_parallel(ch, options) == view.count(ch));
+        TEST(view.find_first_of_parallel(ViewT(chars, 2), options) == view.find_first_of(ViewT(chars, 2)));
+
+        std::vector<size_t> serial, parallel;
+        str_view_searcher_template<CharT>(ViewT(needle)).find_all(view, [&serial](size_t pos) { serial.push_back(pos); });
+        TEST(view.find_all_parallel(ViewT(needle), [&parallel](size_t pos) { parallel.push_back(pos); }, options) == serial.size());
+        TEST(parallel == serial);
+    }
+}
+
+static void TestParallelSearch()
+{
+    // count
+    {
+        TEST(str_view().count('a') == 0);
+        TEST(str_view("abracadabra").count('a') == 5);
+        TEST(str_view_lite("abracadabra").count('z') == 0);
+        TEST(wstr_view(L"ąbąbą").count(L'ą') == 3);
+        const string longStr(1000, 'x');
+        TEST(str_view(longStr).count('x') == 1000);
+        TEST(str_view(longStr).substr(1, 998).count('x') == 998);
+    }
+
+    // Edge cases follow serial methods.
+    {
+        const str_view_parallel_options options(nullptr, 4);
+        const str_view v = "0123456789";
+        TEST(v.find_parallel("", options) == 0);
+        TEST(v.find_parallel("0123456789x", options) == SIZE_MAX);
+        TEST(v.find_parallel("0123456789", options) == 0);
+        TEST(v.find_parallel("3456", options) == 3);
+        TEST(v.find_parallel('9', options) == 9);
+        TEST(v.find_first_of_parallel("", options) == SIZE_MAX);
+        TEST(v.find_first_of_parallel(char_set(str_view("97")), options) == 7);
+        size_t count = 0;
+        TEST(v.find_all_parallel("", [&count](size_t) { ++count; }, options) == 11 && count == 11);
+        TEST(str_view().find_parallel('a', options) == SIZE_MAX && str_view().count_parallel('a', options) == 0);
+    }
+
+    // Many threads on a long string, with occurrences only at chunk borders.
+    {
+        string haystack(1 << 20, '.');
+        const size_t chunkLength = 4096;
+        for(size_t border = chunkLength; border < haystack.length(); border += chunkLength * 7)
+            haystack.replace(border - 2, 5, "<tag>");
+        const str_view_lite view(haystack);
+        str_view_thread_executor executor(4);
+        TEST(executor.thread_count() == 4);
+        const str_view_parallel_options options(&executor, chunkLength);
+        TEST(view.find_parallel("<tag>", options) == chunkLength - 2);
+        TEST(view.count_parallel('<', options) == view.count('<'));
+        std::vector<size_t> positions;
+        const size_t count = view.find_all_parallel("<tag>", [&positions](size_t pos) { positions.push_back(pos); }, options);
+        TEST(count == positions.size() && count == view.count('<'));
+        TEST(std::is_sorted(positions.begin(), positions.end()));
+        TEST(view.find_parallel("</tag>", options) == SIZE_MAX);
+        TEST(view.find_first_of_parallel("<>", options) == chunkLength - 2);
+        // Default executor
+        TEST(view.find_parallel('>', str_view_parallel_options(nullptr, chunkLength)) == chunkLength + 2);
+    }
+
+    ReverseExecutor reverseExecutor;
+    TestParallelSearchKernel<char>(reverseExecutor);
+    TestParallelSearchKernel<wchar_t>(reverseExecutor);
+    TEST(reverseExecutor.m_TaskCount > 0);
+    str_view_thread_executor threadExecutor(3);
+    TestParallelSearchKernel<char>(threadExecutor);
+}
+
+template<typename CharT>
+static void TestSortKernel(str_view_executor& executor)
+{
+    typedef std::basic_string<CharT> StringT;
+    typedef str_view_template<CharT> ViewT;
+    typedef str_view_lite_template<CharT> LiteT;
+    const auto less = [](const LiteT& lhs, const LiteT& rhs) { return lhs.template compare<str_view_binary_compare>(rhs) < 0; };
+    const auto equal = [](const LiteT& lhs, const LiteT& rhs) { return lhs.template compare<str_view_binary_compare>(rhs) == 0; };
+    const auto same = [&equal](const std::vector<LiteT>& lhs, const std::vector<LiteT>& rhs) {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(), equal);
+    };
+
+    // Empty and single view.
+    {
+        std::vector<LiteT> views;
+        str_view_sort(views);
+        str_view_unique(views);
+        TEST(views.empty());
+        const StringT a(3, (CharT)'a');
+        views.push_back(LiteT(a));
+        str_view_sort(views);
+        TEST(str_view_unique(views.data(), views.size()) == 1 && views[0] == LiteT(a));
+    }
+
+    /*
+    Random strings with '\0', characters with the highest bit set, long common prefixes
+    and many duplicates, compared with std::sort and std::unique.
+    */
+    uint32_t seed = 0x3C6EF372u;
+    const auto random = [&seed](uint32_t range) {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) % range;
+    };
+    const CharT alphabet[] = { (CharT)0, (CharT)'a', (CharT)'b', (CharT)(sizeof(CharT) == 1 ? 0xFF : 0x10FF), (CharT)0x7F };
+    for(size_t test = 0; test < 300; ++test)
+    {
+        std::vector<StringT> strings(random(test % 3 ? 60 : 700));
+        const size_t prefixLength = test % 4 == 0 ? random(40) : 0;
+        for(StringT& str : strings)
+        {
+            str.assign(prefixLength, (CharT)'x');
+            for(size_t i = random(test % 2 ? 4 : 30); i--; )
+                str += alphabet[random(test % 5 == 0 ? 5 : 3)];
+        }
+        std::vector<LiteT> views(strings.begin(), strings.end());
+        std::vector<LiteT> expected = views;
+        std::sort(expected.begin(), expected.end(), less);
+
+        const str_view_parallel_options options(&executor, 1 + random(test % 2 ? 100 : 10));
+        str_view_sort(views, options);
+        TEST(same(views, expected));
+        expected.erase(std::unique(expected.begin(), expected.end(), equal), expected.end());
+        str_view_unique(views, options);
+        TEST(same(views, expected));
+
+        // str_view_template, with lengths of null-terminated strings calculated by the sort.
+        std::vector<ViewT> fullViews;
+        std::vector<LiteT> liteViews;
+        for(const StringT& str : strings)
+        {
+            if(str.find((CharT)0) == StringT::npos)
+            {
+                fullViews.push_back(ViewT(str.c_str()));
+                liteViews.push_back(LiteT(str));
+            }
+            else
+                fullViews.push_back(ViewT(str.data(), str.length()));
+            if(test % 7 == 0)
+                fullViews.back().c_str(); // Some views own a copy, which must be moved.
+        }
+        for(const StringT& str : strings)
+        {
+            if(str.find((CharT)0) != StringT::npos)
+                liteViews.push_back(LiteT(str));
+        }
+        std::sort(liteViews.begin(), liteViews.end(), less);
+        str_view_sort(fullViews.data(), fullViews.size(), options);
+        bool ok = fullViews.size() == liteViews.size();
+        for(size_t i = 0; ok && i < fullViews.size(); ++i)
+            ok = equal(LiteT(fullViews[i]), liteViews[i]) &&
+                (liteViews[i].empty() || tmemcmp(fullViews[i].c_str(), liteViews[i].data(), liteViews[i].length()) == 0);
+        TEST(ok);
+        const size_t uniqueCount = str_view_unique(fullViews.data(), fullViews.size(), options);
+        liteViews.erase(std::unique(liteViews.begin(), liteViews.end(), equal), liteViews.end());
+        ok = uniqueCount == liteViews.size();
+        for(size_t i = 0; ok && i < uniqueCount; ++i)
+            ok = equal(LiteT(fullViews[i]), liteViews[i]);
+        TEST(ok);
+    }
+}
+
+static void TestSort()
+{
+    ReverseExecutor reverseExecutor;
+    TestSortKernel<char>(reverseExecutor);
+    TestSortKernel<wchar_t>(reverseExecutor);
+    TEST(reverseExecutor.m_TaskCount > 0);
+
+    // Many views on threads, including a bucket of views with equal first 8 characters.
+    {
+        std::vector<string> strings;
+        char buf[32];
+        for(uint32_t i = 0; i < 100000; ++i)
+        {
+            const uint32_t value = i * 2654435761u;
+            snprintf(buf, sizeof(buf), i % 4 ? "%u" : "samekey_%u", value % 50000);
+            strings.push_back(buf);
+        }
+        std::vector<str_view> views(strings.begin(), strings.end());
+        std::vector<string> expected = strings;
+        std::sort(expected.begin(), expected.end());
+        str_view_thread_executor executor(4);
+        const str_view_parallel_options options(&executor, 4096);
+        str_view_sort(views, options);
+        TEST(std::equal(views.begin(), views.end(), expected.begin(), [](const str_view& v, const string& s) { return v == s; }));
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+        str_view_unique(views, options);
+        TEST(views.size() == expected.size() &&
+            std::equal(views.begin(), views.end(), expected.begin(), [](const str_view& v, const string& s) { return v == s; }));
+    }
+}
+
+#if !defined(STR_VIEW_NO_MAPPED_FILE)
+
+static void TestMappedFile()
+{
+    const char* const path = "str_view_test_mapped.tmp";
+    auto writeFile = [path](const string& contents) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(contents.data(), (std::streamsize)contents.length());
+    };
+
+    // Sizes around page boundaries, including exact multiples that need additional zero page.
+    const size_t sizes[] = { 1, 100, 4095, 4096, 4097, 8192, 65536, 65537 };
+    for(size_t size : sizes)
+    {
+        string contents(size, 'x');
+        for(size_t i = 0; i < size; ++i)
+            contents[i] = (char)('a' + i % 26);
+        writeFile(contents);
+
+        mapped_str_view view(path);
+        TEST(view.is_open());
+        TEST(view.length() == size && !view.empty());
+        TEST(view == str_view(contents));
+        TEST(view.find("xyz") == (size >= 26 ? 23 : SIZE_MAX));
+        TEST(strcmp(view.c_str(), contents.c_str()) == 0);
+#if !defined(_WIN32)
+        TEST(view.c_str() == view.data());
+#else
+        if(size % 4096)
+            TEST(view.c_str() == view.data());
+#endif
+        // Views of the mapping can be passed around as usual.
+        const str_view sub = view.substr(size - 1);
+        TEST(sub.length() == 1 && sub[0] == contents.back());
+    }
+
+    // Empty file
+    {
+        writeFile(string());
+        mapped_str_view view(path);
+        TEST(view.is_open() && view.empty() && view.length() == 0);
+        TEST(view.c_str()[0] == '\0');
+    }
+
+    // Missing file
+    {
+        std::remove(path);
+        mapped_str_view view;
+        TEST(!view.is_open() && view.empty());
+        TEST(!view.open(path));
+        TEST(!view.is_open() && view.empty());
+    }
+
+    // Move, reopen and close.
+    {
+        writeFile("Ala ma kota");
+        mapped_str_view view(path);
+        const char* const data = view.data();
+        mapped_str_view moved(std::move(view));
+        TEST(!view.is_open() && view.empty());
+        TEST(moved.is_open() && moved.data() == data && moved == "Ala ma kota");
+        view = std::move(moved);
+        TEST(view.is_open() && view == "Ala ma kota" && !moved.is_open());
+        TEST(view.open(path) && view == "Ala ma kota");
+        view.close();
+        TEST(!view.is_open() && view.empty());
+        std::remove(path);
+    }
+}
+
+#endif // #if !defined(STR_VIEW_NO_MAPPED_FILE)
+
+static void TestCpuFeatures()
+{
+    const str_view_cpu_features& features = str_view_get_cpu_features();
+    // main() doesn't run the tests on a CPU that doesn't support the build.
+    TEST(str_view_cpu_supports_build());
+    TEST(&features == &str_view_get_cpu_features());
+#if STR_VIEW_AVX512
+    TEST(features.avx512bw && str_view("AVX-512") == str_view_simd_name());
+#elif STR_VIEW_AVX2
+    TEST(features.avx2 && str_view("AVX2") == str_view_simd_name());
+#elif STR_VIEW_SSE2
+    TEST(features.sse2 && str_view("SSE2") == str_view_simd_name());
+#elif STR_VIEW_NEON
+    TEST(features.neon && str_view("NEON") == str_view_simd_name());
+#else
+    TEST(str_view("scalar") == str_view_simd_name());
+#endif
+    TEST(!features.avx512bw || features.avx2);
+    TEST(!features.avx2 || features.sse2);
+    TEST(!(features.sse2 && features.neon));
+#if STR_VIEW_DISPATCH
+    TEST(str_view(str_view_simd_dispatch_name()) == (features.avx512bw ? "AVX-512" : features.avx2 ? "AVX2" : str_view_simd_name()));
+#else
+    TEST(str_view(str_view_simd_dispatch_name()) == str_view_simd_name());
+#endif
+}
+
+#if STR_VIEW_DISPATCH
+
+// Kernels of one level that STR_VIEW_DISPATCH selects from.
+template<typename CharT>
+struct DispatchKernels
+{
+    const CharT* (*findChar)(const CharT*, CharT, size_t);
+    size_t (*countChar)(const CharT*, CharT, size_t);
+    size_t (*strlen)(const CharT*);
+    const CharT* (*findSmallSet)(const CharT*, size_t, const str_view_detail::small_set_pred<CharT>&);
+    const CharT* (*rfindChar)(const CharT*, CharT, size_t);
+    const CharT* (*rfindSmallSet)(const CharT*, size_t, const str_view_detail::small_set_pred<CharT>&);
+    const CharT* (*strlenRfindSmallSet)(const CharT*, const str_view_detail::small_set_pred<CharT>&, size_t&);
+    const CharT* (*findShortSubstr)(const CharT*, size_t, const CharT*, size_t);
+    const CharT* (*rfindShortSubstr)(const CharT*, size_t, const CharT*, size_t);
+    int (*compareNocase)(const CharT*, const CharT*, size_t, bool);
+    size_t (*asciiPrefixLength)(const CharT*, size_t);
+    void (*forEachSmallSetChar)(const CharT*, size_t, const str_view_detail::small_set_pred<CharT>&,
+        str_view_detail::small_set_char_callback&);
+    void (*multiFilterSearch)(const CharT*, size_t, size_t, const CharT* const*, const size_t*, size_t, size_t, size_t,
+        str_view_detail::multi_filter_callback&);
+};
+
+// Positions of characters found by forEachSmallSetChar.
+template<typename CharT>
+static std::vector<size_t> DispatchSmallSetChars(const DispatchKernels<CharT>& kernels, const CharT* str, size_t count,
+    const str_view_detail::small_set_pred<CharT>& pred)
+{
+    std::vector<size_t> result;
+    auto func = [&](size_t pos) { result.push_back(pos); };
+    str_view_detail::small_set_char_callback callback = str_view_detail::small_set_char_callback::make(func);
+    kernels.forEachSmallSetChar(str, count, pred, callback);
+    return result;
+}
+
+// First match of "ab" or "b" found by multiFilterSearch, as position * 2 + pattern index, or SIZE_MAX.
+template<typename CharT>
+static size_t DispatchMultiFilter(const DispatchKernels<CharT>& kernels, const CharT* str, size_t count)
+{
+    static const CharT patternAB[] = { (CharT)'a', (CharT)'b' };
+    static const CharT patternB[] = { (CharT)'b' };
+    const CharT* const patterns[] = { patternAB, patternB };
+    const size_t lengths[] = { 2, 1 };
+    size_t result = SIZE_MAX;
+    auto func = [&](size_t pos, size_t patternIndex) { result = pos * 2 + patternIndex; return false; };
+    str_view_detail::multi_filter_callback callback = str_view_detail::multi_filter_callback::make(func);
+    kernels.multiFilterSearch(str, count, 0, patterns, lengths, 2, 1, 2, callback);
+    return result;
+}
+
+template<typename CharT>
+static void TestDispatchKernels(const DispatchKernels<CharT>& kernels)
+{
+    // Characters around the end of every register of every level, at every alignment of 64-byte registers.
+    std::vector<CharT> buf(1200);
+    const std::vector<CharT> upper(buf.size(), (CharT)'A');
+    const CharT needle[] = { (CharT)'a', (CharT)'b' };
+    const str_view_detail::small_set_pred<CharT> set = { (CharT)'x', (CharT)'b', (CharT)'y', false };
+    const str_view_detail::small_set_pred<CharT> notA = { (CharT)'a', (CharT)'a', (CharT)'a', true };
+    size_t foundLength = 0;
+    for(size_t offset = 0; offset < 64 / sizeof(CharT); offset += 3)
+    {
+        CharT* const str = buf.data() + offset;
+        for(size_t length = 0; length + offset + 1 < buf.size(); length += length < 300 ? 1 : 97)
+        {
+            std::fill(buf.begin(), buf.end(), (CharT)'a');
+            str[length] = (CharT)0;
+            TEST(kernels.strlen(str) == length);
+            TEST(kernels.findChar(str, (CharT)'b', length) == nullptr);
+            TEST(kernels.countChar(str, (CharT)'a', length) == length);
+            TEST(kernels.findSmallSet(str, length, set) == nullptr && kernels.findSmallSet(str, length, notA) == nullptr);
+            TEST(kernels.rfindChar(str, (CharT)'b', length) == nullptr);
+            TEST(kernels.rfindSmallSet(str, length, set) == nullptr && kernels.rfindSmallSet(str, length, notA) == nullptr);
+            TEST(kernels.strlenRfindSmallSet(str, set, foundLength) == nullptr && foundLength == length);
+            TEST(kernels.asciiPrefixLength(str, length) == length);
+            TEST(DispatchSmallSetChars(kernels, str, length, set).empty());
+            TEST(DispatchMultiFilter(kernels, str, length) == SIZE_MAX);
+            if(length >= 2)
+                TEST(kernels.findShortSubstr(str, length, needle, 2) == nullptr &&
+                    kernels.rfindShortSubstr(str, length, needle, 2) == nullptr);
+            const bool vectorCompare = length * sizeof(CharT) >= 64;
+            if(vectorCompare)
+                TEST(kernels.compareNocase(str, upper.data(), length, false) == 0);
+            if(length == 0)
+                continue;
+            for(size_t pos : { (size_t)0, length / 2, length - 1 })
+            {
+                str[pos] = (CharT)'b';
+                TEST(kernels.findChar(str, (CharT)'b', length) == str + pos);
+                TEST(kernels.countChar(str, (CharT)'b', length) == 1);
+                TEST(kernels.findSmallSet(str, length, set) == str + pos && kernels.findSmallSet(str, length, notA) == str + pos);
+                TEST(kernels.rfindChar(str, (CharT)'b', length) == str + pos);
+                TEST(kernels.rfindSmallSet(str, length, set) == str + pos && kernels.rfindSmallSet(str, length, notA) == str + pos);
+                TEST(kernels.strlenRfindSmallSet(str, notA, foundLength) == str + pos && foundLength == length);
+                TEST(DispatchSmallSetChars(kernels, str, length, set) == std::vector<size_t>(1, pos));
+                TEST(DispatchMultiFilter(kernels, str, length) == (pos > 0 ? (pos - 1) * 2 : 1));
+                if(length >= 2)
+                {
+                    const CharT* const expected = pos > 0 ? str + pos - 1 : nullptr;
+                    TEST(kernels.findShortSubstr(str, length, needle, 2) == expected &&
+                        kernels.rfindShortSubstr(str, length, needle, 2) == expected);
+                }
+                if(vectorCompare)
+                    TEST(kernels.compareNocase(str, upper.data(), length, false) > 0);
+                str[pos] = (CharT)0x80;
+                TEST(kernels.asciiPrefixLength(str, length) == pos);
+                str[pos] = (CharT)'a';
+            }
+            str[length - 1] = str[0] = (CharT)'b';
+            TEST(kernels.countChar(str, (CharT)'b', length) == (length > 1 ? 2u : 1u));
+        }
+    }
+}
+
+static void TestDispatchUtf8(bool (*validate)(const char*, size_t))
+{
+    // Boundaries of ranges in table 3-7 across 64-byte registers and at the end, like in TestUtf8.
+    const char bytes[] = { 'x', '\x80', '\x8F', '\x90', '\x9F', '\xA0', '\xBF', '\xC1',
+        '\xC2', '\xDF', '\xE0', '\xED', '\xEF', '\xF0', '\xF4', '\xF5' };
+    const size_t offsets[] = { 62, 255, 316 };
+    string str(320, 'x');
+    wstring converted;
+    for(uint32_t code = 0; code < 0x10000; code += 3)
+    {
+        for(size_t offset : offsets)
+        {
+            for(size_t i = 0; i < 4; ++i)
+                str[offset + i] = bytes[(code >> (i * 4)) & 0xF];
+            str_view_utf8_to_wide(str, converted);
+            TEST(validate(str.data(), str.length()) == (converted.find(L'\xFFFD') == wstring::npos));
+            str.replace(offset, 4, 4, 'x');
+        }
+    }
+}
+
+typedef bool (*DispatchBatchScanPrefix)(const uint32_t*, const uint32_t*, const int32_t*, size_t, uint32_t, int32_t,
+    str_view_detail::batch_callback&);
+typedef bool (*DispatchBatchScanEqual)(const uint32_t*, const int32_t*, size_t, uint32_t, int32_t,
+    str_view_detail::batch_callback&);
+
+static void TestDispatchBatch(DispatchBatchScanPrefix scanPrefix, DispatchBatchScanEqual scanEqual)
+{
+    // Entries match at every third index. The scan stops after given number of matches.
+    const size_t count = 301;
+    std::vector<uint32_t> keys(count, 1), keyMasks(count, UINT32_MAX);
+    std::vector<int32_t> lengths(count, 5);
+    for(size_t i = 0; i < count; i += 3)
+    {
+        keys[i] = 7;
+        lengths[i] = 4;
+    }
+    for(size_t limit : { (size_t)1, (size_t)50, SIZE_MAX })
+    {
+        std::vector<size_t> found;
+        auto func = [&](size_t i) { found.push_back(i); return found.size() < limit; };
+        str_view_detail::batch_callback callback = str_view_detail::batch_callback::make(func);
+        const size_t expectedCount = std::min<size_t>(limit, (count + 2) / 3);
+        TEST(scanPrefix(keys.data(), keyMasks.data(), lengths.data(), count, 7, 4, callback) == (limit == SIZE_MAX));
+        TEST(found.size() == expectedCount && found.back() == (expectedCount - 1) * 3);
+        found.clear();
+        TEST(scanEqual(keys.data(), lengths.data(), count, 7, 4, callback) == (limit == SIZE_MAX));
+        TEST(found.size() == expectedCount && found.back() == (expectedCount - 1) * 3);
+        found.clear();
+        // Longer entries can't be a prefix of the string, shorter ones aren't equal to it.
+        TEST(scanPrefix(keys.data(), keyMasks.data(), lengths.data(), count, 7, 3, callback) && found.empty());
+        TEST(scanEqual(keys.data(), lengths.data(), count, 7, 5, callback) && found.empty());
+    }
+}
+
+static void TestDispatchHash(void (*accumulate)(uint64_t (&)[8], const char*, size_t))
+{
+    // Every number of stripes in a block, compared with the scalar version.
+    string str(str_view_detail::HASH_STRIPE * str_view_detail::HASH_STRIPES_PER_BLOCK, 'a');
+    for(size_t i = 0; i < str.length(); ++i)
+        str[i] = (char)(i * 37 + (i >> 3));
+    for(size_t stripes = 1; stripes <= str_view_detail::HASH_STRIPES_PER_BLOCK; ++stripes)
+    {
+        uint64_t acc[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        uint64_t expected[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        accumulate(acc, str.data(), stripes);
+        str_view_detail::hash_accumulate_scalar<false>(expected, str.data(), 0, stripes);
+        TEST(std::equal(acc, acc + 8, expected));
+    }
+}
+
+template<typename CharT>
+static void TestDispatchLevels()
+{
+    using namespace str_view_detail;
+    const str_view_cpu_features& features = str_view_get_cpu_features();
+    const DispatchKernels<CharT> build = {
+        [](const CharT* str, CharT ch, size_t count) { return simd_find_char<simd_best>(str, ch, count); },
+        [](const CharT* str, CharT ch, size_t count) { return simd_count_char<simd_best>(str, ch, count); },
+        [](const CharT* sz) { return simd_strlen_limited<simd_best>(sz, SIZE_MAX); },
+        [](const CharT* str, size_t count, const small_set_pred<CharT>& pred) {
+            return simd_scan_forward<simd_best>(str, count, simd_small_set_mask<simd_best, CharT>(pred), pred);
+        },
+        [](const CharT* str, CharT ch, size_t count) { return simd_rfind_char<simd_best>(str, ch, count); },
+        [](const CharT* str, size_t count, const small_set_pred<CharT>& pred) {
+            return simd_scan_backward<simd_best>(str, count, simd_small_set_mask<simd_best, CharT>(pred), pred);
+        },
+        [](const CharT* sz, const small_set_pred<CharT>& pred, size_t& outLength) {
+            return simd_strlen_rfind_small_set<simd_best>(sz, pred, outLength);
+        },
+        [](const CharT* haystack, size_t haystackLen, const CharT* needle, size_t needleLen) {
+            return simd_find_short_substr<simd_best>(haystack, haystackLen, needle, needleLen);
+        },
+        [](const CharT* haystack, size_t haystackLen, const CharT* needle, size_t needleLen) {
+            return simd_rfind_short_substr<simd_best>(haystack, haystackLen, needle, needleLen);
+        },
+        [](const CharT* lhs, const CharT* rhs, size_t count, bool stopAtNull) {
+            return simd_compare_nocase<simd_best>(lhs, rhs, count, stopAtNull);
+        },
+        [](const CharT* str, size_t length) { return simd_ascii_prefix_length<simd_best>(str, length); },
+        [](const CharT* str, size_t count, const small_set_pred<CharT>& pred, small_set_char_callback& func) {
+            simd_for_each_small_set_char<simd_best>(str, count, pred, func);
+        },
+        [](const CharT* haystack, size_t haystackLen, size_t pos, const CharT* const* patterns, const size_t* lengths,
+            size_t patternCount, size_t minLen, size_t maxLen, multi_filter_callback& func) {
+            multi_filter_search<simd_best>(haystack, haystackLen, pos, patterns, lengths, patternCount, minLen, maxLen, func);
+        } };
+    TestDispatchKernels(build);
+    if(features.avx2)
+    {
+        const DispatchKernels<CharT> avx2 = { find_char_avx2<CharT>, count_char_avx2<CharT>,
+            simd_strlen_avx2<CharT>, find_small_set_avx2<CharT>, rfind_char_avx2<CharT>, rfind_small_set_avx2<CharT>,
+            strlen_rfind_small_set_avx2<CharT>, find_short_substr_avx2<CharT>, rfind_short_substr_avx2<CharT>,
+            compare_nocase_avx2<CharT>, ascii_prefix_length_avx2<CharT>, for_each_small_set_char_avx2<CharT>,
+            multi_filter_search_avx2<CharT> };
+        TestDispatchKernels(avx2);
+    }
+    if(features.avx2 && features.avx512bw)
+    {
+        const DispatchKernels<CharT> avx512 = { find_char_avx512<CharT>, count_char_avx512<CharT>,
+            simd_strlen_avx512<CharT>, find_small_set_avx512<CharT>, rfind_char_avx512<CharT>, rfind_small_set_avx512<CharT>,
+            strlen_rfind_small_set_avx512<CharT>, find_short_substr_avx512<CharT>, rfind_short_substr_avx512<CharT>,
+            compare_nocase_avx512<CharT>, ascii_prefix_length_avx512<CharT>, for_each_small_set_char_avx512<CharT>,
+            multi_filter_search_avx512<CharT> };
+        TestDispatchKernels(avx512);
+    }
+}
+
+#endif // #if STR_VIEW_DISPATCH
+
+static void TestDispatch()
+{
+#if STR_VIEW_DISPATCH
+    TestDispatchLevels<char>();
+    TestDispatchLevels<wchar_t>();
+    const str_view_cpu_features& features = str_view_get_cpu_features();
+    TestDispatchBatch(
+        [](const uint32_t* keys, const uint32_t* keyMasks, const int32_t* lengths, size_t count, uint32_t strKey,
+            int32_t strLength, str_view_detail::batch_callback& func) {
+            return str_view_detail::simd_batch_scan_prefix<str_view_detail::simd_best>(
+                keys, keyMasks, lengths, count, strKey, strLength, func);
+        },
+        [](const uint32_t* hashes, const int32_t* lengths, size_t count, uint32_t strHash, int32_t strLength,
+            str_view_detail::batch_callback& func) {
+            return str_view_detail::simd_batch_scan_equal<str_view_detail::simd_best>(
+                hashes, lengths, count, strHash, strLength, func);
+        });
+    if(features.avx2)
+    {
+        TestDispatchUtf8(str_view_detail::utf8_validate_avx2);
+        TestDispatchBatch(str_view_detail::batch_scan_prefix_avx2, str_view_detail::batch_scan_equal_avx2);
+        TestDispatchHash(str_view_detail::hash_accumulate_avx2);
+    }
+    if(features.avx2 && features.avx512bw)
+    {
+        TestDispatchUtf8(str_view_detail::utf8_validate_avx512);
+        TestDispatchBatch(str_view_detail::batch_scan_prefix_avx512, str_view_detail::batch_scan_equal_avx512);
+        TestDispatchHash(str_view_detail::hash_accumulate_avx512);
+    }
+#endif
+
+    // Public functions above the dispatch threshold give the same results at every level.
+    string str(5000, 'a');
+    str[4321] = 'b';
+    str[4322] = '\xC4';
+    str[4323] = '\x85';
+    const str_view view = str_view(str.c_str());
+    TEST(view.length() == 5000);
+    TEST(view.find('b') == 4321 && view.count('a') == 4997);
+    TEST(view.find_first_of("xb") == 4321 && view.find_first_not_of("a") == 4321);
+    TEST(view.is_valid_utf8() && !str_view(str.data(), 4323).is_valid_utf8());
+}
+
+template<typename CharT>
+static void TestStringLengthKernel(CharT* buf, size_t bufLen)
+{
+    // Every alignment and length, with garbage before the string and after the null.
+    for(size_t i = 0; i < bufLen; ++i)
+        buf[i] = (CharT)('a' + i % 26);
+    for(size_t offset = 0; offset < 64; ++offset)
+    {
+        for(size_t len = 0; offset + len + 1 < bufLen && len < 300; ++len)
+        {
+            const CharT saved = buf[offset + len];
+            buf[offset + len] = (CharT)0;
+            TEST(tstrlen(buf + offset) == len);
+            TEST(str_view_template<CharT>(buf + offset).length() == len);
+#if STR_VIEW_HAS_SIMD
+            TEST(str_view_detail::simd_strlen(buf + offset) == len);
+#endif
+            // Backward search calculating length in the same pass.
+            typedef str_view_template<CharT> ViewT;
+            const ViewT known(buf + offset, len);
+            const CharT set[] = { (CharT)'c', (CharT)'q', (CharT)0 };
+            const CharT notSet[] = { (CharT)'x', (CharT)'y', (CharT)'z', (CharT)0 };
+            const ViewT lazy(buf + offset);
+            TEST(lazy.rfind((CharT)'c') == known.rfind((CharT)'c') && lazy.length() == len);
+            TEST(ViewT(buf + offset).rfind((CharT)'c', len / 2) == known.rfind((CharT)'c', len / 2));
+            TEST(ViewT(buf + offset).find_last_of(ViewT(set)) == known.find_last_of(ViewT(set)));
+            TEST(ViewT(buf + offset).find_last_not_of(ViewT(notSet), len / 3) == known.find_last_not_of(ViewT(notSet), len / 3));
+            buf[offset + len] = saved;
+        }
+    }
+}
+
+static void TestStringLength()
+{
+    {
+        std::vector<char> buf(512);
+        TestStringLengthKernel(buf.data(), buf.size());
+        std::vector<wchar_t> wbuf(512);
+        TestStringLengthKernel(wbuf.data(), wbuf.size());
+    }
+
+    // Strings ending right before inaccessible page must not fault.
+#if !defined(STR_VIEW_NO_MAPPED_FILE)
+    {
+#if defined(_WIN32)
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        const size_t pageSize = systemInfo.dwPageSize;
+        char* const pages = (char*)VirtualAlloc(nullptr, pageSize * 2, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        DWORD oldProtect;
+        TEST(pages && VirtualProtect(pages + pageSize, pageSize, PAGE_NOACCESS, &oldProtect));
+#else
+        const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+        char* const pages = (char*)mmap(nullptr, pageSize * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        TEST(pages != MAP_FAILED && mprotect(pages + pageSize, pageSize, PROT_NONE) == 0);
+#endif
+        memset(pages, 'x', pageSize);
+        pages[pageSize - 1] = '\0';
+        for(size_t len = 0; len < 200; ++len)
+        {
+            TEST(str_view(pages + pageSize - 1 - len).length() == len);
+            TEST(str_view(pages + pageSize - 1 - len).rfind('x') == (len ? len - 1 : SIZE_MAX));
+        }
+        wchar_t* const wideEnd = (wchar_t*)(pages + pageSize);
+        wideEnd[-1] = L'\0';
+        for(size_t len = 0; len < 50; ++len)
+            TEST(wstr_view(wideEnd - 1 - len).length() == len);
+#if defined(_WIN32)
+        VirtualFree(pages, 0, MEM_RELEASE);
+#else
+        munmap(pages, pageSize * 2);
+#endif
+    }
+#endif
+
+    // With either length policy, views of null-terminated strings behave the same.
+    {
+        const char* const sz = "Ala ma kota";
+        const str_view v = sz;
+        TEST(!v.empty() && v.c_str() == sz);
+        const str_view copy(v);
+        TEST(copy.length() == 11 && copy.substr(4).length() == 7 && copy.substr(4).c_str() == sz + 4);
+        TEST(str_view("").empty() && str_view("").length() == 0);
+    }
+}
+
+static bool StatsEqual(const str_view_stats& lhs, const str_view_stats& rhs)
+{
+    return memcmp(&lhs, &rhs, sizeof(str_view_stats)) == 0;
+}
+
+static void TestStats()
+{
+    const str_view_stats zero = {};
+#if STR_VIEW_STATS
+    str_view_reset_thread_stats();
+    TEST(StatsEqual(str_view_get_thread_stats(), zero));
+
+    // Length of null-terminated string is calculated once.
+    {
+        const char* const sz = "Ala ma kota";
+        const str_view v(sz);
+        TEST(v.length() == 11 && v.length() == 11);
+        TEST(str_view_get_thread_stats().lazyLengths == 1);
+        const str_view known(sz, 11);
+        TEST(known.length() == 11);
+        TEST(str_view_get_thread_stats().lazyLengths == 1);
+        // Backward search calculates it on the way.
+        const str_view searched(sz);
+        TEST(searched.rfind('a') == 10 && searched.length() == 11 && searched.ends_with('a'));
+        TEST(str_view_get_thread_stats().lazyLengths == 2);
+    }
+
+    // Copies.
+    {
+        str_view_reset_thread_stats();
+        const str_view notTerminated("Ala ma kota", 3);
+        notTerminated.c_str();
+        notTerminated.c_str();
+        const wstr_view wideNotTerminated(L"Ala ma kota", 6);
+        wideNotTerminated.c_str();
+        const str_view_sso inlineCopy("Ala ma kota", 6);
+        inlineCopy.c_str();
+        str_view_stats stats = str_view_get_thread_stats();
+        TEST(stats.copyAllocations == 2);
+        TEST(stats.copyBytes == 4 + 7 * sizeof(wchar_t));
+        TEST(stats.inlineCopies == 1 && stats.lostCopyRaces == 0);
+
+        const str_view copied(notTerminated);
+        TEST(str_view_get_thread_stats().copyConstructions == stats.copyConstructions + 1);
+        str_view source(notTerminated);
+        stats = str_view_get_thread_stats();
+        const str_view moved(std::move(source));
+        TEST(str_view_get_thread_stats().moveConstructions == stats.moveConstructions + 1);
+        TEST(str_view_get_thread_stats().copyConstructions == stats.copyConstructions);
+    }
+
+    // Sums for all threads, including finished ones.
+    {
+        constexpr size_t THREAD_COUNT = 8;
+        constexpr size_t VIEW_COUNT = 64;
+        const char* const original = "Ala ma kota, a kot ma Ale.";
+        std::vector<str_view> views;
+        for(size_t i = 0; i < VIEW_COUNT; ++i)
+            views.push_back(str_view(original, 1 + i % 20));
+
+        str_view_reset_stats();
+        std::thread threads[THREAD_COUNT];
+        for(size_t i = 0; i < THREAD_COUNT; ++i)
+        {
+            threads[i] = std::thread([&]() {
+                for(const str_view& v : views)
+                    TEST(strncmp(v.c_str(), original, v.length()) == 0);
+                // Every copy allocated by this thread was either published or lost the race.
+                const str_view_stats threadStats = str_view_get_thread_stats();
+                TEST(threadStats.copyAllocations <= VIEW_COUNT && threadStats.lostCopyRaces <= threadStats.copyAllocations);
+            });
+        }
+        for(size_t i = 0; i < THREAD_COUNT; ++i)
+            threads[i].join();
+        const str_view_stats stats = str_view_get_stats();
+        TEST(stats.copyAllocations - stats.lostCopyRaces == VIEW_COUNT);
+        TEST(stats.copyAllocations >= VIEW_COUNT && stats.copyAllocations <= VIEW_COUNT * THREAD_COUNT);
+        TEST(stats.lazyLengths == 0);
+        str_view_reset_stats();
+        TEST(StatsEqual(str_view_get_stats(), zero));
+    }
+#else
+    // Not collected.
+    const str_view notTerminated("Ala ma kota", 3);
+    notTerminated.c_str();
+    TEST(str_view("Ala").length() == 3);
+    TEST(StatsEqual(str_view_get_thread_stats(), zero));
+    TEST(StatsEqual(str_view_get_stats(), zero));
+#endif
+}
+
 static void TestMultithreading()
 {
     const char* original = "ABCDEF";
@@ -401,6 +3492,114 @@ static void TestMultithreading()
     }
 }
 
+/*
+Many threads race on lazy evaluation of the same objects: length of a null-terminated
+view and publication of null-terminated copies, allocated and inline. Then measures
+how long reading length() and c_str() takes when all threads read one shared object,
+compared with every thread reading its own copy. Reads of an evaluated object don't
+write to it, so the times should be similar - there is no contention on its cache line.
+*/
+static void TestMultithreadingStress()
+{
+    constexpr size_t THREAD_COUNT = 16;
+    constexpr size_t ROUND_COUNT = 100;
+    const char* const original = "Ala ma kota, a kot ma Ale, ale Ala nie ma psa.";
+    const size_t originalLen = strlen(original);
+
+    for(size_t round = 0; round < ROUND_COUNT; ++round)
+    {
+        const size_t offset = round % 8;
+        const size_t copyLen = 1 + round % 32;
+        const str_view lazy = str_view(original + offset);
+        const str_view notTerminated = str_view(original, copyLen);
+        const size_t inlineLen = copyLen % 16;
+        const str_view_sso inlineCopy = str_view_sso(original + offset, inlineLen);
+        const str_view lazySub = str_view(lazy, 2);
+
+        std::atomic<bool> start(false);
+        std::thread threads[THREAD_COUNT];
+        const char* ptrs[THREAD_COUNT];
+        const char* inlinePtrs[THREAD_COUNT];
+        for(size_t i = 0; i < THREAD_COUNT; ++i)
+        {
+            threads[i] = std::thread([&, i]() {
+                while(!start.load())
+                    std::this_thread::yield();
+                // Half of the threads start with c_str() to vary the order of races.
+                if(i % 2)
+                    ptrs[i] = notTerminated.c_str();
+                TEST(lazy.length() == originalLen - offset);
+                TEST(!lazy.empty() && lazySub.length() == originalLen - offset - 2);
+                if(i % 2 == 0)
+                    ptrs[i] = notTerminated.c_str();
+                TEST(strncmp(ptrs[i], original, copyLen) == 0 && ptrs[i][copyLen] == '\0');
+                inlinePtrs[i] = inlineCopy.c_str();
+                TEST(strlen(inlinePtrs[i]) == inlineLen && strncmp(inlinePtrs[i], original + offset, inlineLen) == 0);
+            });
+        }
+        start.store(true);
+        for(size_t i = 0; i < THREAD_COUNT; ++i)
+            threads[i].join();
+        for(size_t i = 0; i < THREAD_COUNT; ++i)
+        {
+            // All threads must have got the same copy.
+            TEST(ptrs[i] == notTerminated.c_str());
+            TEST(inlinePtrs[i] == inlineCopy.c_str());
+        }
+    }
+
+    // Benchmark.
+    constexpr size_t READ_COUNT = 200000;
+    const str_view shared = str_view(original, originalLen - 1);
+    shared.c_str();
+    auto measure = [&](bool useShared) {
+        std::atomic<size_t> checksum(0);
+        std::thread threads[THREAD_COUNT];
+        const auto beginTime = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < THREAD_COUNT; ++i)
+        {
+            threads[i] = std::thread([&]() {
+                const str_view own = shared;
+                own.c_str();
+                const str_view& v = useShared ? shared : own;
+                size_t sum = 0;
+                for(size_t j = 0; j < READ_COUNT; ++j)
+                    sum += v.length() + (size_t)v.c_str()[j % originalLen / 2];
+                checksum.fetch_add(sum);
+            });
+        }
+        for(size_t i = 0; i < THREAD_COUNT; ++i)
+            threads[i].join();
+        const double nanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - beginTime).count();
+        TEST(checksum.load() > 0);
+        return nanoseconds / (double)(THREAD_COUNT * READ_COUNT);
+    };
+    const double sharedTime = measure(true);
+    const double ownTime = measure(false);
+    printf("Multithreading: %zu threads, length() + c_str() of shared view: %.2f ns, own copy: %.2f ns\n",
+        THREAD_COUNT, sharedTime, ownTime);
+
+    // Views of null-terminated strings created and measured on every iteration store their length.
+    const auto beginTime = std::chrono::steady_clock::now();
+    std::thread threads[THREAD_COUNT];
+    for(size_t i = 0; i < THREAD_COUNT; ++i)
+    {
+        threads[i] = std::thread([&, i]() {
+            size_t sum = 0;
+            for(size_t j = 0; j < READ_COUNT; ++j)
+                sum += str_view(original + (i + j) % 8).length();
+            TEST(sum > 0);
+        });
+    }
+    for(size_t i = 0; i < THREAD_COUNT; ++i)
+        threads[i].join();
+    const double freshTime = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - beginTime).count() / (double)(THREAD_COUNT * READ_COUNT);
+    printf("Multithreading: %zu threads, new view of null-terminated string + length(): %.2f ns\n",
+        THREAD_COUNT, freshTime);
+}
+
 static void TestUnicode()
 {
     wstr_view fromNull = wstr_view(nullptr);
@@ -463,7 +3662,7 @@ static void TestDocumentationSamples()
 
     {
         char sz[32];
-        sprintf_s(sz, "Number is %i", 7);
+        snprintf(sz, sizeof(sz), "Number is %i", 7);
         Foo1(sz); // Passed "Number is 7"
     }
 
@@ -607,13 +3806,50 @@ static void TestDocumentationSamples()
 
 int main()
 {
+    if(!str_view_cpu_supports_build())
+    {
+        printf("Skipped: this CPU doesn't support %s.\n", str_view_simd_name());
+        return 77; // SKIP_RETURN_CODE of the test in CMakeLists.txt.
+    }
+
     TestBasicConstruction();
     TestAdvancedConstruction();
     TestCopying();
     TestOperators();
     TestZeroCharacter();
     TestOtherMethods();
+    TestFindChar();
+    TestFindSubstring();
+    TestSearcher();
+    TestFindOf();
+    TestLite();
+    TestConversionToString();
+    TestAllocator();
+    TestInlineCopy();
+    TestConstexpr();
+    TestHash();
+    TestStringPool();
+    TestCompareNocase();
+    TestBinaryCompare();
+    TestSplit();
+    TestBatch();
+    TestKeywordMatcher();
+    TestMultiSearcher();
+    TestRope();
+    TestUtf8();
+    TestParseNumber();
+    TestStructuralIndex();
+    TestParallelSearch();
+    TestSort();
+#if !defined(STR_VIEW_NO_MAPPED_FILE)
+    TestMappedFile();
+#endif
+    TestCpuFeatures();
+    TestStringLength();
+    TestDispatch();
+    TestStats();
     TestMultithreading();
+    TestMultithreadingStress();
     TestUnicode();
     TestNatvis();
     TestDocumentationSamples();
@@ -42,724 +42,9126 @@ SOFTWARE.
 #pragma once
 
 #include <string>
+#include <functional> // for hash
 #include <atomic>
+#include <thread> // for yield
 #include <algorithm> // for min, max
 #include <memory> // for memcmp
+#include <utility> // for pair
+#include <iterator> // for forward_iterator_tag
+#include <type_traits> // for make_unsigned
+#include <limits> // for numeric_limits
+#include <vector> // for string_pool_template, str_view_batch_template
+#include <mutex> // for string_pool_template
 
 #include <cassert>
 #include <cstring>
+#include <cwchar>
 #include <cstdint>
+#include <cfloat> // for FLT_EVAL_METHOD
+#include <cstddef>
+#include <cstdlib> // for strtod
+#include <cerrno>
+#include <clocale> // for newlocale, localeconv
 
-inline size_t tstrlen(const char* sz) { return strlen(sz); }
-inline size_t tstrlen(const wchar_t* sz) { return wcslen(sz); }
-inline void tstrcpy(char* dst, size_t dstCapacity, const char* src) { strcpy_s(dst, dstCapacity, src); }
-inline void tstrcpy(wchar_t* dst, size_t dstCapacity, const wchar_t* src) { wcscpy_s(dst, dstCapacity, src); }
-inline int tstrncmp(const char* lhs, const char* rhs, size_t count) { return strncmp(lhs, rhs, count); }
-inline int tstrncmp(const wchar_t* lhs, const wchar_t* rhs, size_t count) { return wcsncmp(lhs, rhs, count); }
-inline int tstrnicmp(const char* lhs, const char* rhs, size_t count) { return _strnicmp(lhs, rhs, count); }
-inline int tstrnicmp(const wchar_t* lhs, const wchar_t* rhs, size_t count) { return _wcsnicmp(lhs, rhs, count); }
+/*
+SIMD kernels are selected at compile time, based on the instruction set enabled
+for the compiler (e.g. /arch:AVX2 in MSVC, -mavx2 in GCC and Clang). AVX-512 needs
+both F and BW (/arch:AVX512, -mavx512f -mavx512bw).
+Define STR_VIEW_NO_SIMD before including this file to use only scalar code.
+str_view_cpu_supports_build() tells at run time whether the CPU supports the selected one.
+Kernels for long strings can also be selected at run time - see STR_VIEW_DISPATCH.
+*/
+#if !defined(STR_VIEW_NO_SIMD)
+    #if defined(__AVX512F__) && defined(__AVX512BW__)
+        #define STR_VIEW_AVX512 1
+    #endif
+    #if defined(__AVX2__)
+        #define STR_VIEW_AVX2 1
+    #endif
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define STR_VIEW_SSE2 1
+    #endif
+    #if defined(__ARM_NEON) || defined(_M_ARM64)
+        #define STR_VIEW_NEON 1
+    #endif
+#endif
+
+#ifndef STR_VIEW_AVX512
+    #define STR_VIEW_AVX512 0
+#endif
+#ifndef STR_VIEW_AVX2
+    #define STR_VIEW_AVX2 0
+#endif
+#ifndef STR_VIEW_SSE2
+    #define STR_VIEW_SSE2 0
+#endif
+#ifndef STR_VIEW_NEON
+    #define STR_VIEW_NEON 0
+#endif
+
+/*
+STR_VIEW_DISPATCH = 1 makes all SIMD kernels select AVX2 or AVX-512 at run time, when the
+CPU supports a higher level than the build: find, rfind and count of a character, strlen,
+find_first_of and find_last_of a few characters, short substrings, case-insensitive
+comparison, hash, UTF-8 validation and conversion, str_view_batch, str_view_multi_searcher
+and the delimited text index. They are out-of-line functions with target attributes, called
+through a pointer initialized on first use, so strings shorter than DISPATCH_MIN_BYTES still
+use inline kernels of the build. No kernel stays fixed at compile time. Hash of strings
+compared case-insensitively has no SIMD kernel at any level.
+By default it's 1 on x86-64 with GCC or MSVC. Clang requires the target attribute on every
+function that passes a register, including the shared kernel templates, so it's 0 there.
+CMake target str_view_tests_nodispatch tests this with any compiler.
+It's always 0 with STR_VIEW_NO_SIMD.
+*/
+#if defined(STR_VIEW_NO_SIMD)
+    #undef STR_VIEW_DISPATCH
+    #define STR_VIEW_DISPATCH 0
+#elif !defined(STR_VIEW_DISPATCH)
+    #if (defined(__x86_64__) || defined(_M_X64)) && !defined(__clang__) && (defined(__GNUC__) || defined(_MSC_VER))
+        #define STR_VIEW_DISPATCH 1
+    #else
+        #define STR_VIEW_DISPATCH 0
+    #endif
+#endif
+
+/*
+STR_VIEW_TARGET_AVX2 and STR_VIEW_TARGET_AVX512 enable the instruction sets for a function
+in GCC when the whole build doesn't. MSVC compiles intrinsics of any level without it.
+STR_VIEW_SIMD_INLINE forces inlining of kernel templates shared by all levels into the
+target functions, even at -O0, because GCC passes registers between functions compiled
+for different levels in different ways.
+*/
+#if defined(__GNUC__) && !defined(__AVX2__)
+    #define STR_VIEW_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define STR_VIEW_TARGET_AVX2
+#endif
+#if defined(__GNUC__) && !defined(__AVX512BW__)
+    #define STR_VIEW_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+#else
+    #define STR_VIEW_TARGET_AVX512
+#endif
+#if defined(__GNUC__)
+    #define STR_VIEW_SIMD_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+    #define STR_VIEW_SIMD_INLINE __forceinline
+#else
+    #define STR_VIEW_SIMD_INLINE inline
+#endif
+/*
+STR_VIEW_SIMD_LAMBDA does the same for lambdas in kernel templates, which GCC compiles
+without the target of the function they are in. Functions inlined this way still warn
+that passing registers changes ABI, so kernels are between STR_VIEW_SIMD_KERNELS_BEGIN
+and STR_VIEW_SIMD_KERNELS_END.
+*/
+#if defined(__GNUC__)
+    #define STR_VIEW_SIMD_LAMBDA __attribute__((always_inline))
+#else
+    #define STR_VIEW_SIMD_LAMBDA
+#endif
+#if STR_VIEW_DISPATCH && defined(__GNUC__)
+    #define STR_VIEW_SIMD_KERNELS_BEGIN _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wpsabi\"")
+    #define STR_VIEW_SIMD_KERNELS_END _Pragma("GCC diagnostic pop")
+#else
+    #define STR_VIEW_SIMD_KERNELS_BEGIN
+    #define STR_VIEW_SIMD_KERNELS_END
+#endif
+
+#if STR_VIEW_AVX2 || STR_VIEW_DISPATCH
+    #include <immintrin.h>
+#elif STR_VIEW_SSE2
+    #include <emmintrin.h>
+#endif
+#if STR_VIEW_NEON
+    #include <arm_neon.h>
+#endif
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+#endif
+
+/*
+STR_VIEW_NO_SANITIZE marks functions that read whole aligned registers past the end
+of a string. Such reads can't fault, because they never cross a page boundary, but
+AddressSanitizer and ThreadSanitizer would report them.
+*/
+#if defined(__GNUC__) || defined(__clang__)
+    #define STR_VIEW_NO_SANITIZE __attribute__((no_sanitize_address, no_sanitize_thread))
+#elif defined(_MSC_VER) && _MSC_VER >= 1925
+    #define STR_VIEW_NO_SANITIZE __declspec(no_sanitize_address)
+#else
+    #define STR_VIEW_NO_SANITIZE
+#endif
+
+/*
+STR_VIEW_SIMD_STRLEN = 1 makes length of null-terminated strings calculated by
+SIMD kernel of this library, 0 by strlen and wcslen of the C library. By default it's 1
+unless the C library is glibc, which selects its own AVX2 kernels at run time.
+
+STR_VIEW_EAGER_LENGTH = 1 makes str_view_template calculate length of a null-terminated
+string already in the constructor, so length is always known. length() is then a plain
+load without an atomic variable or a branch, which is better when views are accessed more
+often than created. By default it's 0: length is calculated on first use, only if needed.
+It must be defined the same way in all translation units, as it changes the layout of the class.
+*/
+#if !defined(STR_VIEW_SIMD_STRLEN)
+    #if defined(__GLIBC__)
+        #define STR_VIEW_SIMD_STRLEN 0
+    #else
+        #define STR_VIEW_SIMD_STRLEN 1
+    #endif
+#endif
+#if !defined(STR_VIEW_EAGER_LENGTH)
+    #define STR_VIEW_EAGER_LENGTH 0
+#endif
+
+/*
+STR_VIEW_STATS = 1 enables counters of lazy evaluation and copies, returned by
+str_view_get_stats() and str_view_get_thread_stats(). By default it's 0 and the
+counters cost nothing - they are not even compiled in.
+*/
+#if !defined(STR_VIEW_STATS)
+    #define STR_VIEW_STATS 0
+#endif
+
+/*
+mapped_str_view uses memory mapping of the operating system: MapViewOfFile on
+Windows, so <windows.h> is included, or mmap elsewhere.
+Define STR_VIEW_NO_MAPPED_FILE before including this file to leave it out.
+*/
+#if !defined(STR_VIEW_NO_MAPPED_FILE)
+    #if defined(_WIN32)
+        #if !defined(NOMINMAX)
+            #define NOMINMAX
+            #include <windows.h>
+            #undef NOMINMAX
+        #else
+            #include <windows.h>
+        #endif
+    #else
+        #include <sys/mman.h>
+        #include <sys/stat.h>
+        #include <fcntl.h>
+        #include <unistd.h>
+    #endif
+#endif
+
+/*
+STR_VIEW_IS_CONSTANT_EVALUATED() is true when evaluated at compile time. It lets
+constexpr functions use simple loops in constant expressions and the CRT or
+SIMD kernels at run time. It requires C++20, Visual Studio 2019 16.5 or newer,
+GCC 9 or newer, or Clang 9 or newer.
+*/
+#if !defined(STR_VIEW_IS_CONSTANT_EVALUATED)
+    #if defined(__cpp_lib_is_constant_evaluated)
+        #define STR_VIEW_IS_CONSTANT_EVALUATED() std::is_constant_evaluated()
+    #elif defined(_MSC_VER) && _MSC_VER >= 1925 && !defined(__clang__)
+        #define STR_VIEW_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+    #elif defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 9
+        #define STR_VIEW_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+    #elif defined(__has_builtin)
+        #if __has_builtin(__builtin_is_constant_evaluated)
+            #define STR_VIEW_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+        #endif
+    #endif
+#endif
+/*
+STR_VIEW_CONSTEXPR marks functions that can be used in constant expressions.
+It is empty if STR_VIEW_IS_CONSTANT_EVALUATED is not available or the compiler
+doesn't support C++14 constexpr. STR_VIEW_HAS_CONSTEXPR tells which is the case.
+*/
+#if defined(STR_VIEW_IS_CONSTANT_EVALUATED) && (defined(_MSC_VER) || __cpp_constexpr >= 201304)
+    #define STR_VIEW_CONSTEXPR constexpr
+    #define STR_VIEW_HAS_CONSTEXPR 1
+#else
+    #define STR_VIEW_CONSTEXPR
+    #define STR_VIEW_HAS_CONSTEXPR 0
+    /*
+    Functions are not constexpr then, so the builtin would always be false anyway
+    and GCC warns about it in every wrapper.
+    */
+    #undef STR_VIEW_IS_CONSTANT_EVALUATED
+#endif
+#if !defined(STR_VIEW_IS_CONSTANT_EVALUATED)
+    #define STR_VIEW_IS_CONSTANT_EVALUATED() false
+#endif
+/*
+STR_VIEW_HAS_STD_STRING_VIEW tells whether std::basic_string_view is available (C++17).
+Then str_view_template and str_view_lite_template convert to and from it implicitly.
+*/
+#if (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)) && defined(__has_include)
+    #if __has_include(<string_view>)
+        #include <string_view>
+        #define STR_VIEW_HAS_STD_STRING_VIEW 1
+    #endif
+#endif
+#if !defined(STR_VIEW_HAS_STD_STRING_VIEW)
+    #define STR_VIEW_HAS_STD_STRING_VIEW 0
+#endif
+/*
+STR_VIEW_HAS_FROM_CHARS_FLOAT tells whether std::from_chars for floating-point numbers is
+available (C++17, GCC 11, MSVC 2019 16.4). parse() then uses it for the rare numbers with
+more than 19 significant digits that its own algorithms can't round. Otherwise strtod_l
+with "C" locale is used on a copy of the number - see STR_VIEW_HAS_STRTOD_L.
+*/
+#if (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)) && defined(__has_include)
+    #if __has_include(<charconv>)
+        #include <charconv>
+        #if !defined(STR_VIEW_HAS_FROM_CHARS_FLOAT) && defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+            #define STR_VIEW_HAS_FROM_CHARS_FLOAT 1
+        #endif
+    #endif
+#endif
+#if !defined(STR_VIEW_HAS_FROM_CHARS_FLOAT)
+    #define STR_VIEW_HAS_FROM_CHARS_FLOAT 0
+#endif
+/*
+STR_VIEW_HAS_STRTOD_L tells whether strtod_l (_strtod_l in MSVC) is available, to parse
+numbers independently of the current C locale. Without it, strtod is called with the
+decimal point of the current locale, which isn't thread-safe if the locale is changed.
+*/
+#if !defined(STR_VIEW_HAS_STRTOD_L)
+    #if defined(_MSC_VER) || defined(__GLIBC__) || defined(__APPLE__) || defined(__FreeBSD__)
+        #define STR_VIEW_HAS_STRTOD_L 1
+    #else
+        #define STR_VIEW_HAS_STRTOD_L 0
+    #endif
+#endif
+#if STR_VIEW_HAS_STRTOD_L && (defined(__APPLE__) || defined(__FreeBSD__))
+    #include <xlocale.h>
+#endif
+
+/*
+Instruction sets supported by the CPU that the program runs on, detected at run time.
+On x86 it's CPUID, also checking that the operating system saves AVX registers.
+SIMD kernels for short strings are selected at compile time by STR_VIEW_AVX512,
+STR_VIEW_AVX2 and the others, because they must be inlined, and GCC and Clang don't inline
+intrinsics into functions compiled for a lower level. Only kernels for long strings are
+dispatched by these features, when STR_VIEW_DISPATCH is 1. Check str_view_cpu_supports_build() at startup,
+or build the program once for each level and pick the build by these features.
+*/
+struct str_view_cpu_features
+{
+    bool sse2;
+    bool avx2;
+    // AVX-512 F and BW, used by kernels on bytes.
+    bool avx512bw;
+    bool neon;
+};
+
+namespace str_view_detail
+{
+
+inline str_view_cpu_features detect_cpu_features()
+{
+    str_view_cpu_features result = {};
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    // EAX, EBX, ECX, EDX of leaves 1 and 7.
+    unsigned leaf1[4] = {}, leaf7[4] = {};
+    uint64_t xcr0 = 0;
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const unsigned maxLeaf = (unsigned)info[0];
+    __cpuid(info, 1);
+    memcpy(leaf1, info, sizeof(leaf1));
+    if(maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        memcpy(leaf7, info, sizeof(leaf7));
+    }
+    if((leaf1[2] >> 27) & 1) // OSXSAVE
+        xcr0 = _xgetbv(0);
+#else
+    const unsigned maxLeaf = __get_cpuid_max(0, nullptr);
+    __cpuid(1, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+    if(maxLeaf >= 7)
+        __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+    if((leaf1[2] >> 27) & 1) // OSXSAVE
+    {
+        unsigned xcr0Low, xcr0High;
+        __asm__ volatile("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+        xcr0 = ((uint64_t)xcr0High << 32) | xcr0Low;
+    }
+#endif
+    // XMM and YMM state, then also opmask and ZMM state.
+    const bool osSavesAvx = (xcr0 & 0x06) == 0x06;
+    const bool osSavesAvx512 = (xcr0 & 0xE6) == 0xE6;
+    result.sse2 = ((leaf1[3] >> 26) & 1) != 0;
+    result.avx2 = osSavesAvx && ((leaf1[2] >> 28) & 1) && ((leaf7[1] >> 5) & 1);
+    result.avx512bw = osSavesAvx512 && ((leaf7[1] >> 16) & 1) && ((leaf7[1] >> 30) & 1);
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    // NEON is a mandatory part of AArch64.
+    result.neon = true;
+#else
+    // Other CPUs can't be queried portably, so it's what the compiler was allowed to use.
+    result.neon = STR_VIEW_NEON != 0;
+#endif
+    return result;
+}
+
+} // namespace str_view_detail
+
+// Returns features of the CPU, detected on the first call.
+inline const str_view_cpu_features& str_view_get_cpu_features()
+{
+    static const str_view_cpu_features features = str_view_detail::detect_cpu_features();
+    return features;
+}
+
+class str_view_allocator;
+
+namespace str_view_detail
+{
+
+// Returns index of the lowest set bit. mask must not be 0.
+inline unsigned bit_scan_forward(uint64_t mask)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (unsigned)index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if(_BitScanForward(&index, (unsigned long)mask))
+        return (unsigned)index;
+    _BitScanForward(&index, (unsigned long)(mask >> 32));
+    return (unsigned)index + 32;
+#else
+    return (unsigned)__builtin_ctzll(mask);
+#endif
+}
+
+// Returns index of the highest set bit. mask must not be 0.
+inline unsigned bit_scan_reverse(uint64_t mask)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanReverse64(&index, mask);
+    return (unsigned)index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if(_BitScanReverse(&index, (unsigned long)(mask >> 32)))
+        return (unsigned)index + 32;
+    _BitScanReverse(&index, (unsigned long)mask);
+    return (unsigned)index;
+#else
+    return 63u - (unsigned)__builtin_clzll(mask);
+#endif
+}
+
+// Returns number of set bits.
+inline unsigned bit_count(uint64_t mask)
+{
+#if defined(__POPCNT__)
+    return (unsigned)__builtin_popcountll(mask);
+#else
+    // Without POPCNT instruction enabled, compilers call a library function instead.
+    mask = mask - ((mask >> 1) & 0x5555555555555555ull);
+    mask = (mask & 0x3333333333333333ull) + ((mask >> 2) & 0x3333333333333333ull);
+    mask = (mask + (mask >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (unsigned)((mask * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+/*
+Each SIMD backend provides the same minimal interface:
+
+- vec - register type.
+- BYTES - register width in bytes.
+- BITS_PER_BYTE - number of bits that mask() produces for each byte of the register.
+- load(p) - unaligned load.
+- load_aligned(p) - load from address aligned to BYTES, also past the end of the object.
+- splat<CharT>(ch) - fills all lanes with ch.
+- cmpeq<CharT>(a, b) - lane-wise equality, all bits of a lane set when equal.
+- bit_or(a, b), bit_and(a, b) - bitwise OR and AND.
+- cmpgt_int32(a, b) - lane-wise a > b of signed 32-bit integers.
+- ascii_tolower<CharT>(v) - converts ASCII uppercase letters in lanes to lowercase.
+- mask(v) - packs the result of cmpeq to an integer, lowest bits for lowest addresses.
+
+Kernels written against this interface work for any character size (1, 2 or 4 bytes),
+so wchar_t is supported both where it's 2 bytes (Windows) and 4 bytes (Linux).
+
+Backends with a byte shuffle (STR_VIEW_HAS_SIMD_SHUFFLE) also provide byte operations
+for UTF-8 validation:
+
+- table16(p) - loads a table of 16 bytes, repeated in every 128-bit lane.
+- lookup16(table, v) - replaces each byte of v, which must be less than 16, with the table entry.
+- shr4(v) - high nibble of each byte.
+- subs_u8(a, b) - lane-wise a - b of unsigned bytes, saturated to 0.
+- bit_xor(a, b) - bitwise XOR.
+- any(v) - whether any bit is set.
+- prev<N>(cur, before) - bytes of cur moved N bytes towards the end, after the last N bytes of before.
+*/
+
+#if STR_VIEW_SSE2
+struct simd_sse2
+{
+    typedef __m128i vec;
+    enum { BYTES = 16, BITS_PER_BYTE = 1 };
+
+    static vec load(const void* p) { return _mm_loadu_si128((const __m128i*)p); }
+    STR_VIEW_NO_SANITIZE static vec load_aligned(const void* p) { return _mm_load_si128((const __m128i*)p); }
+    template<typename CharT> static vec splat(CharT ch)
+    {
+        if(sizeof(CharT) == 1)
+            return _mm_set1_epi8((char)ch);
+        if(sizeof(CharT) == 2)
+            return _mm_set1_epi16((short)ch);
+        return _mm_set1_epi32((int)ch);
+    }
+    template<typename CharT> static vec cmpeq(vec a, vec b)
+    {
+        if(sizeof(CharT) == 1)
+            return _mm_cmpeq_epi8(a, b);
+        if(sizeof(CharT) == 2)
+            return _mm_cmpeq_epi16(a, b);
+        return _mm_cmpeq_epi32(a, b);
+    }
+    static vec bit_or(vec a, vec b) { return _mm_or_si128(a, b); }
+    static vec bit_and(vec a, vec b) { return _mm_and_si128(a, b); }
+    // Compares lanes as signed 32-bit integers.
+    static vec cmpgt_int32(vec a, vec b) { return _mm_cmpgt_epi32(a, b); }
+    static uint64_t mask(vec v) { return (uint32_t)_mm_movemask_epi8(v); }
+    // Converts ASCII uppercase letters to lowercase. Adding 0x80.. - 'A' moves 'A'..'Z' to the bottom of signed range.
+    template<typename CharT> static vec ascii_tolower(vec v)
+    {
+        vec upper;
+        if(sizeof(CharT) == 1)
+            upper = _mm_cmplt_epi8(_mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - 'A'))), _mm_set1_epi8((char)(0x80 + 26)));
+        else if(sizeof(CharT) == 2)
+            upper = _mm_cmplt_epi16(_mm_add_epi16(v, _mm_set1_epi16((short)(0x8000 - 'A'))), _mm_set1_epi16((short)(0x8000 + 26)));
+        else
+            upper = _mm_cmplt_epi32(_mm_add_epi32(v, _mm_set1_epi32((int)(0x80000000u - 'A'))), _mm_set1_epi32((int)(0x80000000u + 26)));
+        return _mm_or_si128(v, _mm_and_si128(upper, splat<CharT>((CharT)0x20)));
+    }
+};
+#endif
+
+#if STR_VIEW_AVX2 || STR_VIEW_DISPATCH
+struct simd_avx2
+{
+    typedef __m256i vec;
+    enum { BYTES = 32, BITS_PER_BYTE = 1 };
+
+    STR_VIEW_TARGET_AVX2 static vec load(const void* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    STR_VIEW_NO_SANITIZE STR_VIEW_TARGET_AVX2 static vec load_aligned(const void* p) { return _mm256_load_si256((const __m256i*)p); }
+    template<typename CharT> STR_VIEW_TARGET_AVX2 static vec splat(CharT ch)
+    {
+        if(sizeof(CharT) == 1)
+            return _mm256_set1_epi8((char)ch);
+        if(sizeof(CharT) == 2)
+            return _mm256_set1_epi16((short)ch);
+        return _mm256_set1_epi32((int)ch);
+    }
+    template<typename CharT> STR_VIEW_TARGET_AVX2 static vec cmpeq(vec a, vec b)
+    {
+        if(sizeof(CharT) == 1)
+            return _mm256_cmpeq_epi8(a, b);
+        if(sizeof(CharT) == 2)
+            return _mm256_cmpeq_epi16(a, b);
+        return _mm256_cmpeq_epi32(a, b);
+    }
+    STR_VIEW_TARGET_AVX2 static vec bit_or(vec a, vec b) { return _mm256_or_si256(a, b); }
+    STR_VIEW_TARGET_AVX2 static vec bit_and(vec a, vec b) { return _mm256_and_si256(a, b); }
+    STR_VIEW_TARGET_AVX2 static vec cmpgt_int32(vec a, vec b) { return _mm256_cmpgt_epi32(a, b); }
+    STR_VIEW_TARGET_AVX2 static uint64_t mask(vec v) { return (uint32_t)_mm256_movemask_epi8(v); }
+    // Same as simd_sse2::ascii_tolower.
+    template<typename CharT> STR_VIEW_TARGET_AVX2 static vec ascii_tolower(vec v)
+    {
+        vec upper;
+        if(sizeof(CharT) == 1)
+            upper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + 26)), _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - 'A'))));
+        else if(sizeof(CharT) == 2)
+            upper = _mm256_cmpgt_epi16(_mm256_set1_epi16((short)(0x8000 + 26)), _mm256_add_epi16(v, _mm256_set1_epi16((short)(0x8000 - 'A'))));
+        else
+            upper = _mm256_cmpgt_epi32(_mm256_set1_epi32((int)(0x80000000u + 26)), _mm256_add_epi32(v, _mm256_set1_epi32((int)(0x80000000u - 'A'))));
+        return _mm256_or_si256(v, _mm256_and_si256(upper, splat<CharT>((CharT)0x20)));
+    }
+    STR_VIEW_TARGET_AVX2 static vec table16(const uint8_t* p)
+    {
+        const __m128i table = _mm_loadu_si128((const __m128i*)p);
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(table), table, 1);
+    }
+    STR_VIEW_TARGET_AVX2 static vec lookup16(vec table, vec v) { return _mm256_shuffle_epi8(table, v); }
+    STR_VIEW_TARGET_AVX2 static vec shr4(vec v) { return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F)); }
+    STR_VIEW_TARGET_AVX2 static vec subs_u8(vec a, vec b) { return _mm256_subs_epu8(a, b); }
+    STR_VIEW_TARGET_AVX2 static vec bit_xor(vec a, vec b) { return _mm256_xor_si256(a, b); }
+    STR_VIEW_TARGET_AVX2 static bool any(vec v) { return _mm256_testz_si256(v, v) == 0; }
+    // alignr shifts within 128-bit lanes, so the lower lane of cur is shifted in from the upper lane of prev.
+    template<int N> STR_VIEW_TARGET_AVX2 static vec prev(vec cur, vec before)
+    {
+        return _mm256_alignr_epi8(cur, _mm256_permute2x128_si256(before, cur, 0x21), 16 - N);
+    }
+};
+#endif
+
+#if STR_VIEW_AVX512 || STR_VIEW_DISPATCH
+// Comparisons give masks, expanded to registers to keep the interface of the other levels.
+struct simd_avx512
+{
+    typedef __m512i vec;
+    enum { BYTES = 64, BITS_PER_BYTE = 1 };
+
+    STR_VIEW_TARGET_AVX512 static vec load(const void* p) { return _mm512_loadu_si512(p); }
+    STR_VIEW_NO_SANITIZE STR_VIEW_TARGET_AVX512 static vec load_aligned(const void* p) { return _mm512_load_si512(p); }
+    template<typename CharT> STR_VIEW_TARGET_AVX512 static vec splat(CharT ch)
+    {
+        if(sizeof(CharT) == 1)
+            return _mm512_set1_epi8((char)ch);
+        if(sizeof(CharT) == 2)
+            return _mm512_set1_epi16((short)ch);
+        return _mm512_set1_epi32((int)ch);
+    }
+    template<typename CharT> STR_VIEW_TARGET_AVX512 static vec cmpeq(vec a, vec b)
+    {
+        if(sizeof(CharT) == 1)
+            return _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(a, b));
+        if(sizeof(CharT) == 2)
+            return _mm512_movm_epi16(_mm512_cmpeq_epi16_mask(a, b));
+        return _mm512_maskz_set1_epi32(_mm512_cmpeq_epi32_mask(a, b), -1);
+    }
+    STR_VIEW_TARGET_AVX512 static vec bit_or(vec a, vec b) { return _mm512_or_si512(a, b); }
+    STR_VIEW_TARGET_AVX512 static vec bit_and(vec a, vec b) { return _mm512_and_si512(a, b); }
+    STR_VIEW_TARGET_AVX512 static vec cmpgt_int32(vec a, vec b) { return _mm512_maskz_set1_epi32(_mm512_cmpgt_epi32_mask(a, b), -1); }
+    STR_VIEW_TARGET_AVX512 static uint64_t mask(vec v) { return (uint64_t)_mm512_movepi8_mask(v); }
+    // Same as simd_neon::ascii_tolower, with unsigned comparisons of AVX-512.
+    template<typename CharT> STR_VIEW_TARGET_AVX512 static vec ascii_tolower(vec v)
+    {
+        if(sizeof(CharT) == 1)
+            return _mm512_or_si512(v, _mm512_maskz_set1_epi8(
+                _mm512_cmplt_epu8_mask(_mm512_sub_epi8(v, _mm512_set1_epi8('A')), _mm512_set1_epi8(26)), 0x20));
+        if(sizeof(CharT) == 2)
+            return _mm512_or_si512(v, _mm512_maskz_set1_epi16(
+                _mm512_cmplt_epu16_mask(_mm512_sub_epi16(v, _mm512_set1_epi16('A')), _mm512_set1_epi16(26)), 0x20));
+        return _mm512_or_si512(v, _mm512_maskz_set1_epi32(
+            _mm512_cmplt_epu32_mask(_mm512_sub_epi32(v, _mm512_set1_epi32('A')), _mm512_set1_epi32(26)), 0x20));
+    }
+    // Zero-masking forms with all bits of the mask set, because GCC warns about the undefined source of the plain ones.
+    STR_VIEW_TARGET_AVX512 static vec table16(const uint8_t* p) { return _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128((const __m128i*)p)); }
+    STR_VIEW_TARGET_AVX512 static vec lookup16(vec table, vec v) { return _mm512_shuffle_epi8(table, v); }
+    STR_VIEW_TARGET_AVX512 static vec shr4(vec v) { return _mm512_and_si512(_mm512_srli_epi16(v, 4), _mm512_set1_epi8(0x0F)); }
+    STR_VIEW_TARGET_AVX512 static vec subs_u8(vec a, vec b) { return _mm512_subs_epu8(a, b); }
+    STR_VIEW_TARGET_AVX512 static vec bit_xor(vec a, vec b) { return _mm512_xor_si512(a, b); }
+    STR_VIEW_TARGET_AVX512 static bool any(vec v) { return _mm512_test_epi64_mask(v, v) != 0; }
+    // Like simd_avx2::prev, with each 128-bit lane of cur first moved up by one lane by valignd.
+    template<int N> STR_VIEW_TARGET_AVX512 static vec prev(vec cur, vec before)
+    {
+        return _mm512_alignr_epi8(cur, _mm512_maskz_alignr_epi32(0xFFFF, cur, before, 12), 16 - N);
+    }
+};
+#endif
+
+#if STR_VIEW_NEON
+struct simd_neon
+{
+    typedef uint8x16_t vec;
+    // NEON has no movemask. Narrowing shift packs each byte to a nibble instead.
+    enum { BYTES = 16, BITS_PER_BYTE = 4 };
+
+    static vec load(const void* p) { return vld1q_u8((const uint8_t*)p); }
+    STR_VIEW_NO_SANITIZE static vec load_aligned(const void* p) { return vld1q_u8((const uint8_t*)p); }
+    template<typename CharT> static vec splat(CharT ch)
+    {
+        if(sizeof(CharT) == 1)
+            return vdupq_n_u8((uint8_t)ch);
+        if(sizeof(CharT) == 2)
+            return vreinterpretq_u8_u16(vdupq_n_u16((uint16_t)ch));
+        return vreinterpretq_u8_u32(vdupq_n_u32((uint32_t)ch));
+    }
+    template<typename CharT> static vec cmpeq(vec a, vec b)
+    {
+        if(sizeof(CharT) == 1)
+            return vceqq_u8(a, b);
+        if(sizeof(CharT) == 2)
+            return vreinterpretq_u8_u16(vceqq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)));
+        return vreinterpretq_u8_u32(vceqq_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b)));
+    }
+    static vec bit_or(vec a, vec b) { return vorrq_u8(a, b); }
+    static vec bit_and(vec a, vec b) { return vandq_u8(a, b); }
+    static vec cmpgt_int32(vec a, vec b) { return vreinterpretq_u8_u32(vcgtq_s32(vreinterpretq_s32_u8(a), vreinterpretq_s32_u8(b))); }
+    // Converts ASCII uppercase letters to lowercase: ch - 'A' < 26 as unsigned means uppercase letter.
+    template<typename CharT> static vec ascii_tolower(vec v)
+    {
+        vec upper;
+        if(sizeof(CharT) == 1)
+            upper = vcltq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8(26));
+        else if(sizeof(CharT) == 2)
+            upper = vreinterpretq_u8_u16(vcltq_u16(vsubq_u16(vreinterpretq_u16_u8(v), vdupq_n_u16('A')), vdupq_n_u16(26)));
+        else
+            upper = vreinterpretq_u8_u32(vcltq_u32(vsubq_u32(vreinterpretq_u32_u8(v), vdupq_n_u32('A')), vdupq_n_u32(26)));
+        return vorrq_u8(v, vandq_u8(upper, splat<CharT>((CharT)0x20)));
+    }
+    static uint64_t mask(vec v)
+    {
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+    }
+#if defined(__aarch64__) || defined(_M_ARM64)
+    // tbl with a full 16-byte table and across-vector maximum are AArch64 only.
+    static vec table16(const uint8_t* p) { return vld1q_u8(p); }
+    static vec lookup16(vec table, vec v) { return vqtbl1q_u8(table, v); }
+    static vec shr4(vec v) { return vshrq_n_u8(v, 4); }
+    static vec subs_u8(vec a, vec b) { return vqsubq_u8(a, b); }
+    static vec bit_xor(vec a, vec b) { return veorq_u8(a, b); }
+    static bool any(vec v) { return vmaxvq_u8(v) != 0; }
+    template<int N> static vec prev(vec cur, vec before) { return vextq_u8(before, cur, 16 - N); }
+#endif
+};
+#endif
+
+#if STR_VIEW_AVX512
+    typedef simd_avx512 simd_best;
+    #define STR_VIEW_HAS_SIMD 1
+#elif STR_VIEW_AVX2
+    typedef simd_avx2 simd_best;
+    #define STR_VIEW_HAS_SIMD 1
+#elif STR_VIEW_SSE2
+    typedef simd_sse2 simd_best;
+    #define STR_VIEW_HAS_SIMD 1
+#elif STR_VIEW_NEON
+    typedef simd_neon simd_best;
+    #define STR_VIEW_HAS_SIMD 1
+#else
+    // Kernels are templates of the SIMD type. Without SIMD they only take their scalar path.
+    typedef void simd_best;
+    #define STR_VIEW_HAS_SIMD 0
+#endif
+#if STR_VIEW_AVX2 || (STR_VIEW_NEON && (defined(__aarch64__) || defined(_M_ARM64)))
+    #define STR_VIEW_HAS_SIMD_SHUFFLE 1
+#else
+    #define STR_VIEW_HAS_SIMD_SHUFFLE 0
+#endif
+
+// Returns pointer to the first character in [str; str + count) for which pred(ch) is true, or null.
+template<typename CharT, typename Pred>
+inline const CharT* scalar_scan_forward(const CharT* str, size_t count, const Pred& pred)
+{
+    for(size_t i = 0; i < count; ++i)
+    {
+        if(pred(str[i]))
+            return str + i;
+    }
+    return nullptr;
+}
+
+// Returns pointer to the last character in [str; str + count) for which pred(ch) is true, or null.
+template<typename CharT, typename Pred>
+inline const CharT* scalar_scan_backward(const CharT* str, size_t count, const Pred& pred)
+{
+    for(size_t i = count; i--; )
+    {
+        if(pred(str[i]))
+            return str + i;
+    }
+    return nullptr;
+}
+
+STR_VIEW_SIMD_KERNELS_BEGIN
+
+#if STR_VIEW_HAS_SIMD
+
+// Mask with bits set for all characters of a register.
+template<typename Simd>
+inline uint64_t simd_full_mask()
+{
+    return Simd::BYTES * Simd::BITS_PER_BYTE == 64 ?
+        ~(uint64_t)0 : (((uint64_t)1 << (Simd::BYTES * Simd::BITS_PER_BYTE)) - 1);
+}
+
+/*
+Generic forward scan.
+blockMask(p) returns mask of matching characters in register loaded from p.
+pred(ch) is the same condition for single character, used when string is shorter than a register.
+*/
+template<typename Simd, typename CharT, typename BlockMask, typename Pred>
+STR_VIEW_SIMD_INLINE const CharT* simd_scan_forward(const CharT* str, size_t count, const BlockMask& blockMask, const Pred& pred)
+{
+    const size_t step = Simd::BYTES / sizeof(CharT);
+    if(count < step)
+        return scalar_scan_forward(str, count, pred);
+    const unsigned bitsPerChar = Simd::BITS_PER_BYTE * sizeof(CharT);
+    size_t i = 0;
+    for(; i + step <= count; i += step)
+    {
+        const uint64_t mask = blockMask(str + i);
+        if(mask)
+            return str + i + bit_scan_forward(mask) / bitsPerChar;
+    }
+    if(i < count)
+    {
+        // Last block overlaps with already searched characters, which didn't match.
+        i = count - step;
+        const uint64_t mask = blockMask(str + i);
+        if(mask)
+            return str + i + bit_scan_forward(mask) / bitsPerChar;
+    }
+    return nullptr;
+}
+
+// Generic backward scan. Parameters like in simd_scan_forward.
+template<typename Simd, typename CharT, typename BlockMask, typename Pred>
+STR_VIEW_SIMD_INLINE const CharT* simd_scan_backward(const CharT* str, size_t count, const BlockMask& blockMask, const Pred& pred)
+{
+    const size_t step = Simd::BYTES / sizeof(CharT);
+    if(count < step)
+        return scalar_scan_backward(str, count, pred);
+    const unsigned bitsPerChar = Simd::BITS_PER_BYTE * sizeof(CharT);
+    size_t i = count;
+    for(; i >= step; i -= step)
+    {
+        const uint64_t mask = blockMask(str + (i - step));
+        if(mask)
+            return str + (i - step) + bit_scan_reverse(mask) / bitsPerChar;
+    }
+    if(i > 0)
+    {
+        // First block overlaps with already searched characters, which didn't match.
+        const uint64_t mask = blockMask(str);
+        if(mask)
+            return str + bit_scan_reverse(mask) / bitsPerChar;
+    }
+    return nullptr;
+}
+
+/*
+Returns length of null-terminated string, or SIZE_MAX when there is no null among at least
+maxLength first characters. Registers are loaded from aligned addresses, so they never cross
+a page boundary and the read can't fault, even though it may include characters before
+the string and after its terminating null.
+*/
+template<typename Simd, typename CharT>
+STR_VIEW_NO_SANITIZE STR_VIEW_SIMD_INLINE size_t simd_strlen_limited(const CharT* sz, size_t maxLength)
+{
+    const size_t step = Simd::BYTES / sizeof(CharT);
+    const unsigned bitsPerChar = Simd::BITS_PER_BYTE * sizeof(CharT);
+    const typename Simd::vec zero = Simd::splat((CharT)0);
+    const size_t misalignment = (size_t)((uintptr_t)sz & (Simd::BYTES - 1));
+    const CharT* p = (const CharT*)((uintptr_t)sz - misalignment);
+    // Characters before the beginning of the string are shifted out.
+    uint64_t mask = Simd::mask(Simd::template cmpeq<CharT>(Simd::load_aligned(p), zero)) >> (misalignment * Simd::BITS_PER_BYTE);
+    if(mask)
+        return bit_scan_forward(mask) / bitsPerChar;
+    // Single registers until p is aligned to 4 registers, which also never cross a page boundary.
+    for(p += step; ((uintptr_t)p & (Simd::BYTES * 4 - 1)) != 0; p += step)
+    {
+        mask = Simd::mask(Simd::template cmpeq<CharT>(Simd::load_aligned(p), zero));
+        if(mask)
+            return (size_t)(p - sz) + bit_scan_forward(mask) / bitsPerChar;
+    }
+    for(; (size_t)(p - sz) < maxLength; p += step * 4)
+    {
+        const typename Simd::vec eq0 = Simd::template cmpeq<CharT>(Simd::load_aligned(p), zero);
+        const typename Simd::vec eq1 = Simd::template cmpeq<CharT>(Simd::load_aligned(p + step), zero);
+        const typename Simd::vec eq2 = Simd::template cmpeq<CharT>(Simd::load_aligned(p + step * 2), zero);
+        const typename Simd::vec eq3 = Simd::template cmpeq<CharT>(Simd::load_aligned(p + step * 3), zero);
+        if(Simd::mask(Simd::bit_or(Simd::bit_or(eq0, eq1), Simd::bit_or(eq2, eq3))) != 0)
+        {
+            const typename Simd::vec eqs[] = { eq0, eq1, eq2, eq3 };
+            for(size_t i = 0; ; ++i)
+            {
+                mask = Simd::mask(eqs[i]);
+                if(mask)
+                    return (size_t)(p + step * i - sz) + bit_scan_forward(mask) / bitsPerChar;
+            }
+        }
+    }
+    return SIZE_MAX;
+}
+
+#endif // #if STR_VIEW_HAS_SIMD
+
+#if STR_VIEW_DISPATCH
+
+// Length from which kernels are dispatched, when an indirect call costs less than a wider register saves.
+enum { DISPATCH_MIN_BYTES = 256 };
+
+/*
+Returns the kernel of the highest level that the CPU supports, or null when it's the level
+of the build, to use the inline kernel. Called once for each kernel, to initialize a static pointer.
+*/
+template<typename Kernel>
+inline Kernel dispatch_kernel(Kernel avx2, Kernel avx512)
+{
+    const str_view_cpu_features& cpu = str_view_get_cpu_features();
+    if(cpu.avx2 && cpu.avx512bw)
+        return STR_VIEW_AVX512 ? nullptr : avx512;
+    return cpu.avx2 && !STR_VIEW_AVX2 ? avx2 : nullptr;
+}
+// Returns build when the CPU has no higher level, for a kernel whose inline copy would be too long.
+template<typename Kernel>
+inline Kernel dispatch_kernel(Kernel avx2, Kernel avx512, Kernel build)
+{
+    const Kernel kernel = dispatch_kernel(avx2, avx512);
+    return kernel ? kernel : build;
+}
+
+/*
+Function of the caller, passed to a dispatched kernel that calls it for every match.
+The kernel is selected through a pointer, so it can't be a template of the function's type.
+*/
+template<typename Signature>
+struct dispatch_callback;
+template<typename Result, typename... Args>
+struct dispatch_callback<Result(Args...)>
+{
+    Result (*call)(void* func, Args... args);
+    void* func;
+
+    template<typename Func>
+    static dispatch_callback make(Func& func)
+    {
+        const dispatch_callback result = { &call_func<Func>, (void*)&func };
+        return result;
+    }
+    template<typename Func>
+    static Result call_func(void* func, Args... args) { return (*(Func*)func)(args...); }
+    Result operator()(Args... args) const { return call(func, args...); }
+};
+
+template<typename CharT>
+STR_VIEW_NO_SANITIZE size_t simd_strlen_build(const CharT* sz)
+{
+    return simd_strlen_limited<simd_best>(sz, SIZE_MAX);
+}
+template<typename CharT>
+STR_VIEW_NO_SANITIZE STR_VIEW_TARGET_AVX2 size_t simd_strlen_avx2(const CharT* sz)
+{
+    return simd_strlen_limited<simd_avx2>(sz, SIZE_MAX);
+}
+template<typename CharT>
+STR_VIEW_NO_SANITIZE STR_VIEW_TARGET_AVX512 size_t simd_strlen_avx512(const CharT* sz)
+{
+    return simd_strlen_limited<simd_avx512>(sz, SIZE_MAX);
+}
+
+#endif // #if STR_VIEW_DISPATCH
+
+#if STR_VIEW_HAS_SIMD
+template<typename CharT>
+STR_VIEW_NO_SANITIZE inline size_t simd_strlen(const CharT* sz)
+{
+#if STR_VIEW_DISPATCH
+    const size_t length = simd_strlen_limited<simd_best>(sz, DISPATCH_MIN_BYTES / sizeof(CharT));
+    if(length != SIZE_MAX)
+        return length;
+    static const auto kernel = dispatch_kernel(&simd_strlen_avx2<CharT>, &simd_strlen_avx512<CharT>, &simd_strlen_build<CharT>);
+    return kernel(sz);
+#else
+    return simd_strlen_limited<simd_best>(sz, SIZE_MAX);
+#endif
+}
+
+// Mask of characters equal to ch in a register loaded from p.
+template<typename Simd, typename CharT>
+struct simd_char_mask
+{
+    typename Simd::vec needle;
+    STR_VIEW_SIMD_INLINE explicit simd_char_mask(CharT ch) : needle(Simd::splat(ch)) { }
+    STR_VIEW_SIMD_INLINE uint64_t operator()(const CharT* p) const { return Simd::mask(Simd::template cmpeq<CharT>(Simd::load(p), needle)); }
+};
+
+template<typename Simd, typename CharT>
+STR_VIEW_SIMD_INLINE const CharT* simd_find_char(const CharT* str, CharT ch, size_t count)
+{
+    return simd_scan_forward<Simd>(str, count, simd_char_mask<Simd, CharT>(ch), [ch](CharT c) { return c == ch; });
+}
+
+template<typename Simd, typename CharT>
+STR_VIEW_SIMD_INLINE const CharT* simd_rfind_char(const CharT* str, CharT ch, size_t count)
+{
+    return simd_scan_backward<Simd>(str, count, simd_char_mask<Simd, CharT>(ch), [ch](CharT c) { return c == ch; });
+}
+
+template<typename Simd, typename CharT>
+STR_VIEW_SIMD_INLINE size_t simd_count_char(const CharT* str, CharT ch, size_t count)
+{
+    size_t result = 0;
+    size_t i = 0;
+    const size_t step = Simd::BYTES / sizeof(CharT);
+    const typename Simd::vec needle = Simd::splat(ch);
+    // Masks of several registers are joined to one 64-bit word, to count its bits at once.
+    enum { MASK_BITS = Simd::BYTES * Simd::BITS_PER_BYTE, MASKS_PER_WORD = 64 / MASK_BITS };
+    for(; i + step * MASKS_PER_WORD <= count; i += step * MASKS_PER_WORD)
+    {
+        uint64_t word = 0;
+        for(unsigned j = 0; j < MASKS_PER_WORD; ++j)
+            word |= Simd::mask(Simd::template cmpeq<CharT>(Simd::load(str + i + j * step), needle)) << (j * MASK_BITS);
+        result += bit_count(word);
+    }
+    for(; i + step <= count; i += step)
+        result += bit_count(Simd::mask(Simd::template cmpeq<CharT>(Simd::load(str + i), needle)));
+    // Every matching character sets the same number of bits.
+    result /= Simd::BITS_PER_BYTE * sizeof(CharT);
+    for(; i < count; ++i)
+        result += str[i] == ch ? 1 : 0;
+    return result;
+}
+#endif // #if STR_VIEW_HAS_SIMD
+
+#if STR_VIEW_DISPATCH
+template<typename CharT>
+STR_VIEW_TARGET_AVX2 const CharT* find_char_avx2(const CharT* str, CharT ch, size_t count)
+{
+    return simd_find_char<simd_avx2>(str, ch, count);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX512 const CharT* find_char_avx512(const CharT* str, CharT ch, size_t count)
+{
+    return simd_find_char<simd_avx512>(str, ch, count);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX2 const CharT* rfind_char_avx2(const CharT* str, CharT ch, size_t count)
+{
+    return simd_rfind_char<simd_avx2>(str, ch, count);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX512 const CharT* rfind_char_avx512(const CharT* str, CharT ch, size_t count)
+{
+    return simd_rfind_char<simd_avx512>(str, ch, count);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX2 size_t count_char_avx2(const CharT* str, CharT ch, size_t count)
+{
+    return simd_count_char<simd_avx2>(str, ch, count);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX512 size_t count_char_avx512(const CharT* str, CharT ch, size_t count)
+{
+    return simd_count_char<simd_avx512>(str, ch, count);
+}
+#endif
+
+template<typename CharT>
+inline const CharT* find_char(const CharT* str, CharT ch, size_t count)
+{
+#if STR_VIEW_DISPATCH
+    if(count * sizeof(CharT) >= DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = dispatch_kernel(&find_char_avx2<CharT>, &find_char_avx512<CharT>);
+        if(kernel)
+            return kernel(str, ch, count);
+    }
+#endif
+#if STR_VIEW_HAS_SIMD
+    return simd_find_char<simd_best>(str, ch, count);
+#else
+    return scalar_scan_forward(str, count, [ch](CharT c) { return c == ch; });
+#endif
+}
+
+// Returns number of characters equal to ch in [str, str + count).
+template<typename CharT>
+inline size_t count_char(const CharT* str, CharT ch, size_t count)
+{
+#if STR_VIEW_DISPATCH
+    if(count * sizeof(CharT) >= DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = dispatch_kernel(&count_char_avx2<CharT>, &count_char_avx512<CharT>);
+        if(kernel)
+            return kernel(str, ch, count);
+    }
+#endif
+#if STR_VIEW_HAS_SIMD
+    return simd_count_char<simd_best>(str, ch, count);
+#else
+    size_t result = 0;
+    for(size_t i = 0; i < count; ++i)
+        result += str[i] == ch ? 1 : 0;
+    return result;
+#endif
+}
+
+template<typename CharT>
+inline const CharT* rfind_char(const CharT* str, CharT ch, size_t count)
+{
+#if STR_VIEW_DISPATCH
+    if(count * sizeof(CharT) >= DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = dispatch_kernel(&rfind_char_avx2<CharT>, &rfind_char_avx512<CharT>);
+        if(kernel)
+            return kernel(str, ch, count);
+    }
+#endif
+#if STR_VIEW_HAS_SIMD
+    return simd_rfind_char<simd_best>(str, ch, count);
+#else
+    return scalar_scan_backward(str, count, [ch](CharT c) { return c == ch; });
+#endif
+}
+
+/*
+Finds first or last character that is (or, when negate is true, is not) equal to any of
+up to SMALL_SET_MAX characters in set. Compares with each of them and ORs the results.
+*/
+enum { SMALL_SET_MAX = 3 };
+
+template<typename CharT>
+struct small_set_pred
+{
+    CharT c0, c1, c2;
+    bool negate;
+    bool operator()(CharT c) const { return (c == c0 || c == c1 || c == c2) != negate; }
+};
+
+template<typename CharT>
+inline small_set_pred<CharT> make_small_set_pred(const CharT* set, size_t setLen, bool negate)
+{
+    assert(setLen >= 1 && setLen <= SMALL_SET_MAX);
+    // Missing characters are filled with duplicates of the first one.
+    small_set_pred<CharT> result = { set[0], set[setLen > 1 ? 1 : 0], set[setLen > 2 ? 2 : 0], negate };
+    return result;
+}
+
+#if STR_VIEW_HAS_SIMD
+template<typename Simd, typename CharT>
+struct simd_small_set_mask
+{
+    typename Simd::vec c0, c1, c2;
+    uint64_t flip;
+    STR_VIEW_SIMD_INLINE explicit simd_small_set_mask(const small_set_pred<CharT>& pred) :
+        c0(Simd::splat(pred.c0)),
+        c1(Simd::splat(pred.c1)),
+        c2(Simd::splat(pred.c2)),
+        flip(pred.negate ? simd_full_mask<Simd>() : 0)
+    {
+    }
+    STR_VIEW_SIMD_INLINE uint64_t operator()(const CharT* p) const
+    {
+        const typename Simd::vec block = Simd::load(p);
+        return Simd::mask(Simd::bit_or(
+            Simd::bit_or(Simd::template cmpeq<CharT>(block, c0), Simd::template cmpeq<CharT>(block, c1)),
+            Simd::template cmpeq<CharT>(block, c2))) ^ flip;
+    }
+};
+#endif
+
+#if STR_VIEW_DISPATCH
+template<typename CharT>
+STR_VIEW_TARGET_AVX2 const CharT* find_small_set_avx2(const CharT* str, size_t count, const small_set_pred<CharT>& pred)
+{
+    return simd_scan_forward<simd_avx2>(str, count, simd_small_set_mask<simd_avx2, CharT>(pred), pred);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX512 const CharT* find_small_set_avx512(const CharT* str, size_t count, const small_set_pred<CharT>& pred)
+{
+    return simd_scan_forward<simd_avx512>(str, count, simd_small_set_mask<simd_avx512, CharT>(pred), pred);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX2 const CharT* rfind_small_set_avx2(const CharT* str, size_t count, const small_set_pred<CharT>& pred)
+{
+    return simd_scan_backward<simd_avx2>(str, count, simd_small_set_mask<simd_avx2, CharT>(pred), pred);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX512 const CharT* rfind_small_set_avx512(const CharT* str, size_t count, const small_set_pred<CharT>& pred)
+{
+    return simd_scan_backward<simd_avx512>(str, count, simd_small_set_mask<simd_avx512, CharT>(pred), pred);
+}
+#endif
+
+template<typename CharT>
+inline const CharT* find_small_set(const CharT* str, size_t count, const CharT* set, size_t setLen, bool negate)
+{
+    const small_set_pred<CharT> pred = make_small_set_pred(set, setLen, negate);
+#if STR_VIEW_DISPATCH
+    if(count * sizeof(CharT) >= DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = dispatch_kernel(&find_small_set_avx2<CharT>, &find_small_set_avx512<CharT>);
+        if(kernel)
+            return kernel(str, count, pred);
+    }
+#endif
+#if STR_VIEW_HAS_SIMD
+    return simd_scan_forward<simd_best>(str, count, simd_small_set_mask<simd_best, CharT>(pred), pred);
+#else
+    return scalar_scan_forward(str, count, pred);
+#endif
+}
+
+template<typename CharT>
+inline const CharT* rfind_small_set(const CharT* str, size_t count, const CharT* set, size_t setLen, bool negate)
+{
+    const small_set_pred<CharT> pred = make_small_set_pred(set, setLen, negate);
+#if STR_VIEW_DISPATCH
+    if(count * sizeof(CharT) >= DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = dispatch_kernel(&rfind_small_set_avx2<CharT>, &rfind_small_set_avx512<CharT>);
+        if(kernel)
+            return kernel(str, count, pred);
+    }
+#endif
+#if STR_VIEW_HAS_SIMD
+    return simd_scan_backward<simd_best>(str, count, simd_small_set_mask<simd_best, CharT>(pred), pred);
+#else
+    return scalar_scan_backward(str, count, pred);
+#endif
+}
+
+/*
+Returns last character of null-terminated string sz that matches pred, or null if there is none,
+and length of the string in outLength, in one pass - instead of calculating the length first
+and then searching backward from the end. Registers are loaded from aligned addresses, like in
+simd_strlen, 4 at a time. Only the last register with a match is remembered, and position
+of the character in it is found at the end.
+*/
+#if STR_VIEW_HAS_SIMD
+template<typename Simd, typename CharT>
+STR_VIEW_NO_SANITIZE STR_VIEW_SIMD_INLINE const CharT* simd_strlen_rfind_small_set(const CharT* sz,
+    const small_set_pred<CharT>& pred, size_t& outLength)
+{
+    const size_t step = Simd::BYTES / sizeof(CharT);
+    const unsigned bitsPerChar = Simd::BITS_PER_BYTE * sizeof(CharT);
+    const typename Simd::vec zero = Simd::splat((CharT)0);
+    const typename Simd::vec c0 = Simd::splat(pred.c0);
+    const typename Simd::vec c1 = Simd::splat(pred.c1);
+    const typename Simd::vec c2 = Simd::splat(pred.c2);
+    const bool singleChar = pred.c0 == pred.c1 && pred.c0 == pred.c2;
+    const uint64_t flip = pred.negate ? simd_full_mask<Simd>() : 0;
+    const CharT* lastBlock = nullptr;
+    uint64_t lastMask = 0;
+    // Returns mask of characters of the block at p equal to any of the set, not negated.
+    const auto matchMask = [&](const CharT* p) STR_VIEW_SIMD_LAMBDA -> uint64_t {
+        const typename Simd::vec block = Simd::load_aligned(p);
+        const typename Simd::vec eq0 = Simd::template cmpeq<CharT>(block, c0);
+        return Simd::mask(singleChar ? eq0 :
+            Simd::bit_or(Simd::bit_or(eq0, Simd::template cmpeq<CharT>(block, c1)), Simd::template cmpeq<CharT>(block, c2)));
+    };
+    // Returns true if block at p has the terminating null. Bits of characters before sz are shifted out.
+    const auto processBlock = [&](const CharT* p, unsigned shift) STR_VIEW_SIMD_LAMBDA -> bool {
+        const uint64_t zeroMask = Simd::mask(Simd::template cmpeq<CharT>(Simd::load_aligned(p), zero)) >> shift;
+        uint64_t blockMatchMask = (matchMask(p) ^ flip) >> shift;
+        const CharT* const blockBegin = p + shift / bitsPerChar;
+        if(zeroMask)
+        {
+            // Only characters before the terminating null.
+            blockMatchMask &= (zeroMask & (~zeroMask + 1)) - 1;
+            outLength = (size_t)(blockBegin - sz) + bit_scan_forward(zeroMask) / bitsPerChar;
+        }
+        if(blockMatchMask)
+        {
+            lastBlock = blockBegin;
+            lastMask = blockMatchMask;
+        }
+        return zeroMask != 0;
+    };
+    const auto result = [&]() STR_VIEW_SIMD_LAMBDA -> const CharT* {
+        return lastBlock ? lastBlock + bit_scan_reverse(lastMask) / bitsPerChar : nullptr;
+    };
+
+    const size_t misalignment = (size_t)((uintptr_t)sz & (Simd::BYTES - 1));
+    const CharT* p = (const CharT*)((uintptr_t)sz - misalignment);
+    if(processBlock(p, (unsigned)(misalignment * Simd::BITS_PER_BYTE)))
+        return result();
+    // Single registers until p is aligned to 4 registers, which also never cross a page boundary.
+    for(p += step; ((uintptr_t)p & (Simd::BYTES * 4 - 1)) != 0; p += step)
+        if(processBlock(p, 0))
+            return result();
+    for(;; p += step * 4)
+    {
+        const typename Simd::vec anyZero = Simd::bit_or(
+            Simd::bit_or(Simd::template cmpeq<CharT>(Simd::load_aligned(p), zero), Simd::template cmpeq<CharT>(Simd::load_aligned(p + step), zero)),
+            Simd::bit_or(Simd::template cmpeq<CharT>(Simd::load_aligned(p + step * 2), zero), Simd::template cmpeq<CharT>(Simd::load_aligned(p + step * 3), zero)));
+        if(flip == 0 && (Simd::mask(anyZero) |
+            matchMask(p) | matchMask(p + step) | matchMask(p + step * 2) | matchMask(p + step * 3)) == 0)
+            continue;
+        for(size_t i = 0; i < 4; ++i)
+            if(processBlock(p + step * i, 0))
+                return result();
+    }
+}
+#endif
+
+#if STR_VIEW_DISPATCH
+template<typename CharT>
+STR_VIEW_NO_SANITIZE STR_VIEW_TARGET_AVX2 const CharT* strlen_rfind_small_set_avx2(const CharT* sz,
+    const small_set_pred<CharT>& pred, size_t& outLength)
+{
+    return simd_strlen_rfind_small_set<simd_avx2>(sz, pred, outLength);
+}
+template<typename CharT>
+STR_VIEW_NO_SANITIZE STR_VIEW_TARGET_AVX512 const CharT* strlen_rfind_small_set_avx512(const CharT* sz,
+    const small_set_pred<CharT>& pred, size_t& outLength)
+{
+    return simd_strlen_rfind_small_set<simd_avx512>(sz, pred, outLength);
+}
+#endif
+
+template<typename CharT>
+inline const CharT* strlen_rfind_small_set(const CharT* sz, const small_set_pred<CharT>& pred, size_t& outLength)
+{
+#if STR_VIEW_DISPATCH
+    /*
+    Length is unknown, so there is no DISPATCH_MIN_BYTES check. Looking for the null first,
+    like simd_strlen does, would make a second pass over the checked characters when the
+    found one is before them, which costs more than the call through the pointer.
+    */
+    static const auto kernel = dispatch_kernel(&strlen_rfind_small_set_avx2<CharT>, &strlen_rfind_small_set_avx512<CharT>);
+    if(kernel)
+        return kernel(sz, pred, outLength);
+#endif
+#if STR_VIEW_HAS_SIMD
+    return simd_strlen_rfind_small_set<simd_best>(sz, pred, outLength);
+#else
+    const CharT* last = nullptr;
+    const CharT* p = sz;
+    for(; *p != (CharT)0; ++p)
+        if(pred(*p))
+            last = p;
+    outLength = (size_t)(p - sz);
+    return last;
+#endif
+}
+
+STR_VIEW_SIMD_KERNELS_END
+
+/*
+Substring search engine.
+
+Needles up to SHORT_NEEDLE_MAX characters use SIMD filter that compares first and last
+character of the needle at many positions at once and verifies only the candidates.
+Longer needles use Two-Way algorithm (Crochemore-Perrin), which is O(n + m) in the
+worst case and needs only constant additional memory.
+Reverse search runs the same algorithms over reversed sequences.
+*/
+enum { SHORT_NEEDLE_MAX = 32 };
+
+// Accessors that allow Two-Way to run over a sequence forward or backward.
+template<typename CharT>
+struct forward_access
+{
+    const CharT* ptr; // First character.
+    CharT operator[](size_t index) const { return ptr[index]; }
+};
+template<typename CharT>
+struct reverse_access
+{
+    const CharT* ptr; // Last character.
+    CharT operator[](size_t index) const { return *(ptr - index); }
+};
+
+// Critical factorization of the needle, computed once per needle.
+struct two_way_params
+{
+    size_t critPos; // Length of the left part of the factorization.
+    size_t period;
+    bool periodic;
+};
+
+template<typename Access>
+inline size_t two_way_max_suffix(Access needle, size_t needleLen, bool invertOrder, size_t& outPeriod)
+{
+    ptrdiff_t maxSuffix = -1, j = 0, k = 1, period = 1;
+    while(j + k < (ptrdiff_t)needleLen)
+    {
+        const auto a = needle[(size_t)(j + k)];
+        const auto b = needle[(size_t)(maxSuffix + k)];
+        if(invertOrder ? (b < a) : (a < b))
+        {
+            // Suffix is smaller, period is entire prefix so far.
+            j += k;
+            k = 1;
+            period = j - maxSuffix;
+        }
+        else if(a == b)
+        {
+            // Advance through repetition of the current period.
+            if(k != period)
+                ++k;
+            else
+            {
+                j += period;
+                k = 1;
+            }
+        }
+        else
+        {
+            // Suffix is larger, start over from current location.
+            maxSuffix = j++;
+            k = period = 1;
+        }
+    }
+    outPeriod = (size_t)period;
+    return (size_t)(maxSuffix + 1);
+}
+
+template<typename Access>
+inline two_way_params two_way_prepare(Access needle, size_t needleLen)
+{
+    size_t period1, period2;
+    const size_t suffix1 = two_way_max_suffix(needle, needleLen, false, period1);
+    const size_t suffix2 = two_way_max_suffix(needle, needleLen, true, period2);
+
+    two_way_params result;
+    result.critPos = suffix1 > suffix2 ? suffix1 : suffix2;
+    result.period = suffix1 > suffix2 ? period1 : period2;
+
+    // Needle is periodic if its left part repeats with the period of the right part.
+    result.periodic = true;
+    for(size_t i = 0; i < result.critPos; ++i)
+    {
+        if(needle[i] != needle[i + result.period])
+        {
+            result.periodic = false;
+            break;
+        }
+    }
+    if(!result.periodic)
+        result.period = std::max(result.critPos, needleLen - result.critPos) + 1;
+    return result;
+}
+
+/*
+Calls func(pos) for positions of occurrences of needle in haystack, in order, until it
+returns false. Returns false if it was stopped this way. After an occurrence, the needle
+is shifted by its period, keeping memory of the characters known to match for periodic
+needles, so finding all overlapping occurrences also takes linear time.
+*/
+template<typename Access, typename Func>
+inline bool two_way_search_all(const two_way_params& params,
+    Access needle, size_t needleLen, Access haystack, size_t haystackLen, Func& func)
+{
+    const size_t critPos = params.critPos;
+    const size_t period = params.period;
+    size_t j = 0;
+    if(params.periodic)
+    {
+        // Number of characters at the beginning known to match from the previous attempt.
+        size_t memory = 0;
+        while(j + needleLen <= haystackLen)
+        {
+            size_t i = std::max(critPos, memory);
+            while(i < needleLen && needle[i] == haystack[i + j])
+                ++i;
+            if(i < needleLen)
+            {
+                j += i - critPos + 1;
+                memory = 0;
+            }
+            else
+            {
+                i = critPos;
+                while(i > memory && needle[i - 1] == haystack[i - 1 + j])
+                    --i;
+                if(i <= memory && !func(j))
+                    return false;
+                j += period;
+                memory = needleLen - period;
+            }
+        }
+    }
+    else
+    {
+        /*
+        Period of a non-periodic needle is at least params.period, so no occurrence
+        starts less than that after another one.
+        */
+        while(j + needleLen <= haystackLen)
+        {
+            size_t i = critPos;
+            while(i < needleLen && needle[i] == haystack[i + j])
+                ++i;
+            if(i < needleLen)
+                j += i - critPos + 1;
+            else
+            {
+                i = critPos;
+                while(i > 0 && needle[i - 1] == haystack[i - 1 + j])
+                    --i;
+                if(i == 0 && !func(j))
+                    return false;
+                j += period;
+            }
+        }
+    }
+    return true;
+}
+
+// Returns position of the first occurrence of needle in haystack, or SIZE_MAX.
+template<typename Access>
+inline size_t two_way_search(const two_way_params& params,
+    Access needle, size_t needleLen, Access haystack, size_t haystackLen)
+{
+    size_t result = SIZE_MAX;
+    auto func = [&result](size_t pos) { result = pos; return false; };
+    two_way_search_all(params, needle, needleLen, haystack, haystackLen, func);
+    return result;
+}
+
+template<typename CharT>
+inline bool chars_equal(const CharT* lhs, const CharT* rhs, size_t count)
+{
+    return memcmp(lhs, rhs, count * sizeof(CharT)) == 0;
+}
+
+template<typename CharT>
+inline const CharT* scalar_find_short_substr(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+    const CharT* const last = haystack + (haystackLen - needleLen);
+    for(const CharT* p = haystack; p <= last; ++p)
+    {
+        p = find_char(p, needle[0], (size_t)(last - p) + 1);
+        if(p == nullptr)
+            return nullptr;
+        if(chars_equal(p + 1, needle + 1, needleLen - 1))
+            return p;
+    }
+    return nullptr;
+}
+
+template<typename CharT>
+inline const CharT* scalar_rfind_short_substr(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+    size_t count = haystackLen - needleLen + 1;
+    while(count)
+    {
+        const CharT* const p = rfind_char(haystack, needle[0], count);
+        if(p == nullptr)
+            return nullptr;
+        if(chars_equal(p + 1, needle + 1, needleLen - 1))
+            return p;
+        count = (size_t)(p - haystack);
+    }
+    return nullptr;
+}
+
+STR_VIEW_SIMD_KERNELS_BEGIN
+
+#if STR_VIEW_HAS_SIMD
+
+// Clears bits of the lowest character found in mask.
+template<typename Simd, typename CharT>
+inline uint64_t clear_char_bits(uint64_t mask, unsigned charIndex)
+{
+    const unsigned bitsPerChar = Simd::BITS_PER_BYTE * sizeof(CharT);
+    const uint64_t charMask = bitsPerChar == 64 ? ~(uint64_t)0 : (((uint64_t)1 << bitsPerChar) - 1);
+    return mask & ~(charMask << (charIndex * bitsPerChar));
+}
+
+// needleLen must be at least 2 and haystackLen at least needleLen.
+template<typename Simd, typename CharT>
+STR_VIEW_SIMD_INLINE const CharT* simd_find_short_substr(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+    const size_t step = Simd::BYTES / sizeof(CharT);
+    const unsigned bitsPerChar = Simd::BITS_PER_BYTE * sizeof(CharT);
+    const typename Simd::vec first = Simd::splat(needle[0]);
+    const typename Simd::vec last = Simd::splat(needle[needleLen - 1]);
+    const size_t candidateCount = haystackLen - needleLen + 1;
+    size_t i = 0;
+    for(; i + step <= candidateCount; i += step)
+    {
+        const CharT* const block = haystack + i;
+        uint64_t mask =
+            Simd::mask(Simd::template cmpeq<CharT>(Simd::load(block), first)) &
+            Simd::mask(Simd::template cmpeq<CharT>(Simd::load(block + (needleLen - 1)), last));
+        while(mask)
+        {
+            const unsigned charIndex = bit_scan_forward(mask) / bitsPerChar;
+            if(chars_equal(block + charIndex + 1, needle + 1, needleLen - 2))
+                return block + charIndex;
+            mask = clear_char_bits<Simd, CharT>(mask, charIndex);
+        }
+    }
+    if(i < candidateCount)
+        return scalar_find_short_substr(haystack + i, haystackLen - i, needle, needleLen);
+    return nullptr;
+}
+
+// needleLen must be at least 2 and haystackLen at least needleLen.
+template<typename Simd, typename CharT>
+STR_VIEW_SIMD_INLINE const CharT* simd_rfind_short_substr(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+    const size_t step = Simd::BYTES / sizeof(CharT);
+    const unsigned bitsPerChar = Simd::BITS_PER_BYTE * sizeof(CharT);
+    const typename Simd::vec first = Simd::splat(needle[0]);
+    const typename Simd::vec last = Simd::splat(needle[needleLen - 1]);
+    size_t i = haystackLen - needleLen + 1; // Number of candidate positions not yet checked.
+    for(; i >= step; i -= step)
+    {
+        const CharT* const block = haystack + (i - step);
+        uint64_t mask =
+            Simd::mask(Simd::template cmpeq<CharT>(Simd::load(block), first)) &
+            Simd::mask(Simd::template cmpeq<CharT>(Simd::load(block + (needleLen - 1)), last));
+        while(mask)
+        {
+            const unsigned charIndex = bit_scan_reverse(mask) / bitsPerChar;
+            if(chars_equal(block + charIndex + 1, needle + 1, needleLen - 2))
+                return block + charIndex;
+            mask = clear_char_bits<Simd, CharT>(mask, charIndex);
+        }
+    }
+    if(i > 0)
+        return scalar_rfind_short_substr(haystack, i + needleLen - 1, needle, needleLen);
+    return nullptr;
+}
+
+#endif // #if STR_VIEW_HAS_SIMD
+
+#if STR_VIEW_DISPATCH
+template<typename CharT>
+STR_VIEW_TARGET_AVX2 const CharT* find_short_substr_avx2(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+    return simd_find_short_substr<simd_avx2>(haystack, haystackLen, needle, needleLen);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX512 const CharT* find_short_substr_avx512(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+    return simd_find_short_substr<simd_avx512>(haystack, haystackLen, needle, needleLen);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX2 const CharT* rfind_short_substr_avx2(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+    return simd_rfind_short_substr<simd_avx2>(haystack, haystackLen, needle, needleLen);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX512 const CharT* rfind_short_substr_avx512(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+    return simd_rfind_short_substr<simd_avx512>(haystack, haystackLen, needle, needleLen);
+}
+#endif
+
+// needleLen must be at least 2 and haystackLen at least needleLen.
+template<typename CharT>
+inline const CharT* find_short_substr(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+#if STR_VIEW_DISPATCH
+    if(haystackLen * sizeof(CharT) >= DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = dispatch_kernel(&find_short_substr_avx2<CharT>, &find_short_substr_avx512<CharT>);
+        if(kernel)
+            return kernel(haystack, haystackLen, needle, needleLen);
+    }
+#endif
+#if STR_VIEW_HAS_SIMD
+    return simd_find_short_substr<simd_best>(haystack, haystackLen, needle, needleLen);
+#else
+    return scalar_find_short_substr(haystack, haystackLen, needle, needleLen);
+#endif
+}
+
+// needleLen must be at least 2 and haystackLen at least needleLen.
+template<typename CharT>
+inline const CharT* rfind_short_substr(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+#if STR_VIEW_DISPATCH
+    if(haystackLen * sizeof(CharT) >= DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = dispatch_kernel(&rfind_short_substr_avx2<CharT>, &rfind_short_substr_avx512<CharT>);
+        if(kernel)
+            return kernel(haystack, haystackLen, needle, needleLen);
+    }
+#endif
+#if STR_VIEW_HAS_SIMD
+    return simd_rfind_short_substr<simd_best>(haystack, haystackLen, needle, needleLen);
+#else
+    return scalar_rfind_short_substr(haystack, haystackLen, needle, needleLen);
+#endif
+}
+
+STR_VIEW_SIMD_KERNELS_END
+
+template<typename CharT>
+inline two_way_params prepare_long_substr(const CharT* needle, size_t needleLen)
+{
+    const forward_access<CharT> needleAccess = { needle };
+    return two_way_prepare(needleAccess, needleLen);
+}
+
+template<typename CharT>
+inline two_way_params prepare_long_rsubstr(const CharT* needle, size_t needleLen)
+{
+    const reverse_access<CharT> needleAccess = { needle + (needleLen - 1) };
+    return two_way_prepare(needleAccess, needleLen);
+}
+
+// params must come from prepare_long_substr() called for the same needle.
+template<typename CharT>
+inline const CharT* find_long_substr(const two_way_params& params,
+    const CharT* haystack, size_t haystackLen, const CharT* needle, size_t needleLen)
+{
+    const forward_access<CharT> needleAccess = { needle };
+    const forward_access<CharT> haystackAccess = { haystack };
+    const size_t index = two_way_search(params, needleAccess, needleLen, haystackAccess, haystackLen);
+    return index != SIZE_MAX ? haystack + index : nullptr;
+}
+
+/*
+Calls func(index) for every occurrence of needle in haystack, in order.
+params must come from prepare_long_substr() called for the same needle.
+*/
+template<typename CharT, typename Func>
+inline void find_all_long_substr(const two_way_params& params,
+    const CharT* haystack, size_t haystackLen, const CharT* needle, size_t needleLen, Func& func)
+{
+    const forward_access<CharT> needleAccess = { needle };
+    const forward_access<CharT> haystackAccess = { haystack };
+    two_way_search_all(params, needleAccess, needleLen, haystackAccess, haystackLen, func);
+}
+
+// params must come from prepare_long_rsubstr() called for the same needle.
+template<typename CharT>
+inline const CharT* rfind_long_substr(const two_way_params& params,
+    const CharT* haystack, size_t haystackLen, const CharT* needle, size_t needleLen)
+{
+    if(haystackLen < needleLen)
+        return nullptr;
+    const reverse_access<CharT> needleAccess = { needle + (needleLen - 1) };
+    const reverse_access<CharT> haystackAccess = { haystack + (haystackLen - 1) };
+    const size_t index = two_way_search(params, needleAccess, needleLen, haystackAccess, haystackLen);
+    return index != SIZE_MAX ? haystack + (haystackLen - index - needleLen) : nullptr;
+}
+
+/*
+Returns pointer to the first occurrence of needle in haystack, or null if not found.
+needleLen must be at least 1.
+*/
+template<typename CharT>
+inline const CharT* find_substr(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+    if(haystackLen < needleLen)
+        return nullptr;
+    if(needleLen == 1)
+        return find_char(haystack, needle[0], haystackLen);
+    if(needleLen <= SHORT_NEEDLE_MAX)
+        return find_short_substr(haystack, haystackLen, needle, needleLen);
+    return find_long_substr(prepare_long_substr(needle, needleLen),
+        haystack, haystackLen, needle, needleLen);
+}
+
+/*
+Returns pointer to the last occurrence of needle in haystack, or null if not found.
+needleLen must be at least 1.
+*/
+template<typename CharT>
+inline const CharT* rfind_substr(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+    if(haystackLen < needleLen)
+        return nullptr;
+    if(needleLen == 1)
+        return rfind_char(haystack, needle[0], haystackLen);
+    if(needleLen <= SHORT_NEEDLE_MAX)
+        return rfind_short_substr(haystack, haystackLen, needle, needleLen);
+    return rfind_long_substr(prepare_long_rsubstr(needle, needleLen),
+        haystack, haystackLen, needle, needleLen);
+}
+
+/*
+Scalar versions of the functions above, usable in constant expressions.
+They are used only during compile-time evaluation.
+*/
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR size_t constexpr_strlen(const CharT* sz)
+{
+    size_t length = 0;
+    while(sz[length] != (CharT)0)
+        ++length;
+    return length;
+}
+
+// Converts ASCII uppercase letter to lowercase. Other characters are left unchanged.
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR CharT constexpr_ascii_tolower(CharT ch)
+{
+    return (ch >= (CharT)'A' && ch <= (CharT)'Z') ? (CharT)(ch + ((CharT)'a' - (CharT)'A')) : ch;
+}
+
+/*
+Works like strncmp/wcsncmp or, if !caseSensitive, like _strnicmp/_wcsnicmp in "C" locale.
+With !stopAtNull, works like memcmp/wmemcmp - doesn't stop at null character.
+*/
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR int constexpr_strncmp(const CharT* lhs, const CharT* rhs, size_t count, bool caseSensitive,
+    bool stopAtNull = true)
+{
+    // strncmp compares characters as unsigned char, wcsncmp as wchar_t.
+    typedef typename std::conditional<sizeof(CharT) == 1, unsigned char, CharT>::type CompareT;
+    for(size_t i = 0; i < count; ++i)
+    {
+        CompareT lhsCh = (CompareT)lhs[i];
+        CompareT rhsCh = (CompareT)rhs[i];
+        if(!caseSensitive)
+        {
+            lhsCh = constexpr_ascii_tolower(lhsCh);
+            rhsCh = constexpr_ascii_tolower(rhsCh);
+        }
+        if(lhsCh != rhsCh)
+            return lhsCh < rhsCh ? -1 : 1;
+        if(stopAtNull && lhsCh == (CompareT)0)
+            return 0;
+    }
+    return 0;
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR const CharT* constexpr_find_char(const CharT* str, CharT ch, size_t count)
+{
+    for(size_t i = 0; i < count; ++i)
+    {
+        if(str[i] == ch)
+            return str + i;
+    }
+    return nullptr;
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR const CharT* constexpr_rfind_char(const CharT* str, CharT ch, size_t count)
+{
+    for(size_t i = count; i--; )
+    {
+        if(str[i] == ch)
+            return str + i;
+    }
+    return nullptr;
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR bool constexpr_chars_equal(const CharT* lhs, const CharT* rhs, size_t count)
+{
+    for(size_t i = 0; i < count; ++i)
+    {
+        if(lhs[i] != rhs[i])
+            return false;
+    }
+    return true;
+}
+
+// needleLen must be at least 1.
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR const CharT* constexpr_find_substr(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+    for(size_t i = 0; i + needleLen <= haystackLen; ++i)
+    {
+        if(constexpr_chars_equal(haystack + i, needle, needleLen))
+            return haystack + i;
+    }
+    return nullptr;
+}
+
+// needleLen must be at least 1.
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR const CharT* constexpr_rfind_substr(const CharT* haystack, size_t haystackLen,
+    const CharT* needle, size_t needleLen)
+{
+    if(haystackLen < needleLen)
+        return nullptr;
+    for(size_t i = haystackLen - needleLen + 1; i--; )
+    {
+        if(constexpr_chars_equal(haystack + i, needle, needleLen))
+            return haystack + i;
+    }
+    return nullptr;
+}
+
+/*
+Hash function for strings, designed after wyhash. Inputs up to 16 bytes are mixed
+with a single 128-bit multiplication. Longer inputs are consumed 16 or 48 bytes at
+a time. Inputs of at least HASH_LONG_MIN bytes first go through 64-byte stripes
+accumulated in 8 independent 64-bit lanes, like in XXH3, using SSE2, AVX2 or NEON
+when available.
+
+Characters are hashed as their little-endian byte representation, so the result is
+the same on every platform, at compile time and at run time. With FoldCase, ASCII
+uppercase letters are converted to lowercase first.
+*/
+
+#if defined(_MSC_VER) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    #define STR_VIEW_LITTLE_ENDIAN 1
+#else
+    #define STR_VIEW_LITTLE_ENDIAN 0
+#endif
+
+enum : uint64_t
+{
+    HASH_P0 = 0xa0761d6478bd642full,
+    HASH_P1 = 0xe7037ed1a0b428dbull,
+    HASH_P2 = 0x8ebc6af09c88c6e3ull,
+    HASH_P3 = 0x589965cc75374cc3ull,
+};
+enum { HASH_LONG_MIN = 256, HASH_STRIPE = 64, HASH_STRIPES_PER_BLOCK = 16 };
+
+// Template only to allow definition of the array in a header.
+template<int Dummy = 0>
+struct hash_secret_template
+{
+    // Stripe s uses values [s; s + 8). Values [16; 24) are used for scrambling.
+    static constexpr uint64_t values[24] = {
+        0x2cb0f69f4abea221ull, 0x9417034723148989ull, 0xdd555950609dfe03ull, 0xdbafb150deb12800ull,
+        0x7e789b2e6c442cb6ull, 0xf41e5636c7e4f8c4ull, 0x0959d150f8fba7e4ull, 0xa97316f13cdb9eeaull,
+        0x74cd8258f9520068ull, 0x55c74a62e116868bull, 0xd2f4c799a2023cbdull, 0xdf98cb79a37b51b9ull,
+        0x396f5885524f3905ull, 0xaf1d56386ca3b276ull, 0xa9ffbe6b5104e85aull, 0x6bd0c51b9fd533b3ull,
+        0x980ce91c50ab4b56ull, 0x28ac395780fe62c5ull, 0x768912e3a6bcedc7ull, 0x50b3e8c9332c7c88ull,
+        0xce3bbfe520bd47daull, 0xcba6c8e8e0bb7c4full, 0xbf194db8434a346dull, 0x7d8f2a7b60416d7full,
+    };
+};
+template<int Dummy>
+constexpr uint64_t hash_secret_template<Dummy>::values[24];
+typedef hash_secret_template<> hash_secret;
+
+// Full 128-bit product of a and b. Returns low half in a and high half in b.
+inline STR_VIEW_CONSTEXPR void hash_mul128(uint64_t& a, uint64_t& b)
+{
+#if defined(__SIZEOF_INT128__)
+    // __extension__ keeps -Wpedantic quiet about the non-standard type.
+    __extension__ typedef unsigned __int128 uint128;
+    const uint128 product = (uint128)a * b;
+    a = (uint64_t)product;
+    b = (uint64_t)(product >> 64);
+#else
+    #if defined(_MSC_VER) && defined(_M_X64)
+    if(!STR_VIEW_IS_CONSTANT_EVALUATED())
+    {
+        a = _umul128(a, b, &b);
+        return;
+    }
+    #elif defined(_MSC_VER) && defined(_M_ARM64)
+    if(!STR_VIEW_IS_CONSTANT_EVALUATED())
+    {
+        const uint64_t hi = __umulh(a, b);
+        a *= b;
+        b = hi;
+        return;
+    }
+    #endif
+    const uint64_t aLo = a & 0xFFFFFFFFull, aHi = a >> 32;
+    const uint64_t bLo = b & 0xFFFFFFFFull, bHi = b >> 32;
+    const uint64_t lolo = aLo * bLo, lohi = aLo * bHi, hilo = aHi * bLo, hihi = aHi * bHi;
+    const uint64_t cross = (lolo >> 32) + (hilo & 0xFFFFFFFFull) + lohi;
+    a = (cross << 32) | (lolo & 0xFFFFFFFFull);
+    b = hihi + (hilo >> 32) + (cross >> 32);
+#endif
+}
+
+inline STR_VIEW_CONSTEXPR uint64_t hash_mix(uint64_t a, uint64_t b)
+{
+    hash_mul128(a, b);
+    return a ^ b;
+}
+
+// Converts ASCII uppercase letters in a word of 8 characters to lowercase.
+inline uint64_t hash_fold_case_swar(uint64_t word)
+{
+    const uint64_t heptets = word & 0x7F7F7F7F7F7F7F7Full;
+    const uint64_t aboveZ = heptets + 0x2525252525252525ull; // 0x7F - 'Z'
+    const uint64_t atLeastA = heptets + 0x3F3F3F3F3F3F3F3Full; // 0x80 - 'A'
+    const uint64_t upper = (atLeastA ^ aboveZ) & ~word & 0x8080808080808080ull;
+    return word | (upper >> 2);
+}
+
+/*
+Returns byteCount <= 8 bytes starting at byteOffset of the little-endian representation
+of str. With FoldCase, ASCII letters are converted to lowercase.
+*/
+template<bool FoldCase, typename CharT>
+inline STR_VIEW_CONSTEXPR uint64_t hash_read_composed(const CharT* str, size_t byteOffset, size_t byteCount)
+{
+    typedef typename std::make_unsigned<CharT>::type UnsignedT;
+    uint64_t result = 0;
+    for(size_t i = 0; i < byteCount; ++i)
+    {
+        const size_t byteIndex = byteOffset + i;
+        UnsignedT unit = (UnsignedT)str[byteIndex / sizeof(CharT)];
+        if(FoldCase)
+            unit = constexpr_ascii_tolower(unit);
+        const uint64_t byte = ((uint64_t)unit >> (8 * (byteIndex % sizeof(CharT)))) & 0xFF;
+        result |= byte << (8 * i);
+    }
+    return result;
+}
+
+// Same as hash_read_composed. byteOffset must be a multiple of sizeof(CharT), byteCount must be 4 or 8.
+template<bool FoldCase, typename CharT>
+inline STR_VIEW_CONSTEXPR uint64_t hash_read(const CharT* str, size_t byteOffset, size_t byteCount)
+{
+#if STR_VIEW_LITTLE_ENDIAN
+    if(!STR_VIEW_IS_CONSTANT_EVALUATED() && (!FoldCase || sizeof(CharT) == 1))
+    {
+        uint64_t result = 0;
+        memcpy(&result, (const char*)str + byteOffset, byteCount);
+        return FoldCase ? hash_fold_case_swar(result) : result;
+    }
+#endif
+    return hash_read_composed<FoldCase>(str, byteOffset, byteCount);
+}
+
+// Accumulates stripeCount stripes starting at byteOffset of str into acc. Stripe s of a block uses secret values [s; s + 8).
+template<bool FoldCase, typename CharT>
+inline STR_VIEW_CONSTEXPR void hash_accumulate_scalar(uint64_t (&acc)[8], const CharT* str, size_t byteOffset,
+    size_t stripeCount)
+{
+    for(size_t s = 0; s < stripeCount; ++s, byteOffset += HASH_STRIPE)
+    {
+        for(size_t i = 0; i < 8; ++i)
+        {
+            const uint64_t data = hash_read<FoldCase>(str, byteOffset + i * 8, 8);
+            const uint64_t key = data ^ hash_secret::values[s + i];
+            acc[i ^ 1] += data;
+            acc[i] += (key & 0xFFFFFFFFull) * (key >> 32);
+        }
+    }
+}
+
+#if STR_VIEW_LITTLE_ENDIAN && STR_VIEW_HAS_SIMD
+
+#if STR_VIEW_AVX2 || STR_VIEW_DISPATCH
+// SIMD versions of hash_accumulate_scalar without FoldCase.
+inline STR_VIEW_TARGET_AVX2 void hash_accumulate_avx2(uint64_t (&acc)[8], const char* str, size_t stripeCount)
+{
+    __m256i accVec[2] = {
+        _mm256_loadu_si256((const __m256i*)acc),
+        _mm256_loadu_si256((const __m256i*)(acc + 4)) };
+    for(size_t s = 0; s < stripeCount; ++s, str += HASH_STRIPE)
+    {
+        for(size_t j = 0; j < 2; ++j)
+        {
+            const __m256i data = _mm256_loadu_si256((const __m256i*)(str + j * 32));
+            const __m256i key = _mm256_xor_si256(data,
+                _mm256_loadu_si256((const __m256i*)(hash_secret::values + s + j * 4)));
+            const __m256i product = _mm256_mul_epu32(key, _mm256_srli_epi64(key, 32));
+            const __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            accVec[j] = _mm256_add_epi64(accVec[j], _mm256_add_epi64(product, swapped));
+        }
+    }
+    _mm256_storeu_si256((__m256i*)acc, accVec[0]);
+    _mm256_storeu_si256((__m256i*)(acc + 4), accVec[1]);
+}
+#endif
+#if STR_VIEW_AVX512 || STR_VIEW_DISPATCH
+/*
+All 8 lanes of the accumulator fit in one register. Zero-masking forms with all bits of
+the mask set, like in simd_avx512, because GCC warns about the undefined source of the plain ones.
+*/
+inline STR_VIEW_TARGET_AVX512 void hash_accumulate_avx512(uint64_t (&acc)[8], const char* str, size_t stripeCount)
+{
+    __m512i accVec = _mm512_loadu_si512(acc);
+    for(size_t s = 0; s < stripeCount; ++s, str += HASH_STRIPE)
+    {
+        const __m512i data = _mm512_loadu_si512(str);
+        const __m512i key = _mm512_xor_si512(data, _mm512_loadu_si512(hash_secret::values + s));
+        const __m512i product = _mm512_maskz_mul_epu32(0xFF, key, _mm512_maskz_srli_epi64(0xFF, key, 32));
+        const __m512i swapped = _mm512_maskz_shuffle_epi32(0xFFFF, data, (_MM_PERM_ENUM)_MM_SHUFFLE(1, 0, 3, 2));
+        accVec = _mm512_add_epi64(accVec, _mm512_add_epi64(product, swapped));
+    }
+    _mm512_storeu_si512(acc, accVec);
+}
+#endif
+
+inline void hash_accumulate_simd(uint64_t (&acc)[8], const char* str, size_t stripeCount)
+{
+#if STR_VIEW_DISPATCH
+    static const auto kernel = dispatch_kernel(&hash_accumulate_avx2, &hash_accumulate_avx512);
+    if(kernel)
+        return kernel(acc, str, stripeCount);
+#endif
+#if STR_VIEW_AVX512
+    hash_accumulate_avx512(acc, str, stripeCount);
+#elif STR_VIEW_AVX2
+    hash_accumulate_avx2(acc, str, stripeCount);
+#elif STR_VIEW_SSE2
+    __m128i accVec[4];
+    for(size_t j = 0; j < 4; ++j)
+        accVec[j] = _mm_loadu_si128((const __m128i*)(acc + j * 2));
+    for(size_t s = 0; s < stripeCount; ++s, str += HASH_STRIPE)
+    {
+        for(size_t j = 0; j < 4; ++j)
+        {
+            const __m128i data = _mm_loadu_si128((const __m128i*)(str + j * 16));
+            const __m128i key = _mm_xor_si128(data,
+                _mm_loadu_si128((const __m128i*)(hash_secret::values + s + j * 2)));
+            const __m128i product = _mm_mul_epu32(key, _mm_srli_epi64(key, 32));
+            const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            accVec[j] = _mm_add_epi64(accVec[j], _mm_add_epi64(product, swapped));
+        }
+    }
+    for(size_t j = 0; j < 4; ++j)
+        _mm_storeu_si128((__m128i*)(acc + j * 2), accVec[j]);
+#elif STR_VIEW_NEON
+    uint64x2_t accVec[4];
+    for(size_t j = 0; j < 4; ++j)
+        accVec[j] = vld1q_u64(acc + j * 2);
+    for(size_t s = 0; s < stripeCount; ++s, str += HASH_STRIPE)
+    {
+        for(size_t j = 0; j < 4; ++j)
+        {
+            const uint64x2_t data = vreinterpretq_u64_u8(vld1q_u8((const uint8_t*)(str + j * 16)));
+            const uint64x2_t key = veorq_u64(data, vld1q_u64(hash_secret::values + s + j * 2));
+            const uint64x2_t product = vmull_u32(vmovn_u64(key), vshrn_n_u64(key, 32));
+            const uint64x2_t swapped = vextq_u64(data, data, 1);
+            accVec[j] = vaddq_u64(accVec[j], vaddq_u64(product, swapped));
+        }
+    }
+    for(size_t j = 0; j < 4; ++j)
+        vst1q_u64(acc + j * 2, accVec[j]);
+#endif
+}
+
+#endif // #if STR_VIEW_LITTLE_ENDIAN && STR_VIEW_HAS_SIMD
+
+/*
+Consumes whole stripes from the beginning of the string, leaving 1..HASH_STRIPE bytes.
+Returns number of bytes consumed and mixes the lanes into seed.
+*/
+template<bool FoldCase, typename CharT>
+inline STR_VIEW_CONSTEXPR size_t hash_long(const CharT* str, size_t byteCount, uint64_t& seed)
+{
+    uint64_t acc[8] = { HASH_P0, HASH_P1, HASH_P2, HASH_P3, ~HASH_P0, ~HASH_P1, ~HASH_P2, ~HASH_P3 };
+    const size_t stripeCount = (byteCount - 1) / HASH_STRIPE;
+    for(size_t stripeIndex = 0; stripeIndex < stripeCount; stripeIndex += HASH_STRIPES_PER_BLOCK)
+    {
+        const size_t blockStripes = std::min<size_t>(HASH_STRIPES_PER_BLOCK, stripeCount - stripeIndex);
+#if STR_VIEW_LITTLE_ENDIAN && STR_VIEW_HAS_SIMD
+        if(!STR_VIEW_IS_CONSTANT_EVALUATED() && !FoldCase)
+            hash_accumulate_simd(acc, (const char*)str + stripeIndex * HASH_STRIPE, blockStripes);
+        else
+#endif
+            hash_accumulate_scalar<FoldCase>(acc, str, stripeIndex * HASH_STRIPE, blockStripes);
+
+        // Scramble.
+        for(size_t i = 0; i < 8; ++i)
+        {
+            acc[i] ^= acc[i] >> 47;
+            acc[i] ^= hash_secret::values[16 + i];
+            acc[i] *= 0x9E3779B1ull;
+        }
+    }
+    for(size_t i = 0; i < 8; i += 2)
+        seed = hash_mix(acc[i] ^ HASH_P1, acc[i + 1] ^ seed);
+    return stripeCount * HASH_STRIPE;
+}
+
+template<bool FoldCase, typename CharT>
+inline STR_VIEW_CONSTEXPR uint64_t hash_string(const CharT* str, size_t count)
+{
+    const size_t byteCount = count * sizeof(CharT);
+    uint64_t seed = hash_mix(HASH_P0, HASH_P1);
+    uint64_t a = 0, b = 0;
+    if(byteCount <= 16)
+    {
+        if(byteCount >= 4)
+        {
+            const size_t middle = (byteCount >> 3) << 2;
+            a = (hash_read<FoldCase>(str, 0, 4) << 32) | hash_read<FoldCase>(str, middle, 4);
+            b = (hash_read<FoldCase>(str, byteCount - 4, 4) << 32) | hash_read<FoldCase>(str, byteCount - 4 - middle, 4);
+        }
+        else if(byteCount > 0)
+        {
+            a = (hash_read_composed<FoldCase>(str, 0, 1) << 16) |
+                (hash_read_composed<FoldCase>(str, byteCount >> 1, 1) << 8) |
+                hash_read_composed<FoldCase>(str, byteCount - 1, 1);
+        }
+    }
+    else
+    {
+        size_t offset = 0;
+        size_t remaining = byteCount;
+        if(byteCount >= HASH_LONG_MIN)
+        {
+            offset = hash_long<FoldCase>(str, byteCount, seed);
+            remaining -= offset;
+        }
+        else if(remaining > 48)
+        {
+            uint64_t seed1 = seed, seed2 = seed;
+            do
+            {
+                seed = hash_mix(hash_read<FoldCase>(str, offset, 8) ^ HASH_P1, hash_read<FoldCase>(str, offset + 8, 8) ^ seed);
+                seed1 = hash_mix(hash_read<FoldCase>(str, offset + 16, 8) ^ HASH_P2, hash_read<FoldCase>(str, offset + 24, 8) ^ seed1);
+                seed2 = hash_mix(hash_read<FoldCase>(str, offset + 32, 8) ^ HASH_P3, hash_read<FoldCase>(str, offset + 40, 8) ^ seed2);
+                offset += 48;
+                remaining -= 48;
+            } while(remaining > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while(remaining > 16)
+        {
+            seed = hash_mix(hash_read<FoldCase>(str, offset, 8) ^ HASH_P1, hash_read<FoldCase>(str, offset + 8, 8) ^ seed);
+            offset += 16;
+            remaining -= 16;
+        }
+        a = hash_read<FoldCase>(str, byteCount - 16, 8);
+        b = hash_read<FoldCase>(str, byteCount - 8, 8);
+    }
+    a ^= HASH_P1;
+    b ^= seed;
+    hash_mul128(a, b);
+    return hash_mix(a ^ HASH_P0 ^ byteCount, b ^ HASH_P1);
+}
+
+/*
+Case-insensitive comparison of count characters, like _strnicmp/_wcsnicmp in "C" locale:
+ASCII letters are compared as lowercase, other characters by value, and, if stopAtNull,
+comparison stops at null character. Doesn't depend on the current locale.
+
+Whole SIMD vectors of characters are checked for a difference or null character, and only
+the vector where one is found is passed to constexpr_strncmp. Strings of char shorter than
+a vector are checked the same way 8 or 4 characters at a time in a 64-bit word.
+*/
+STR_VIEW_SIMD_KERNELS_BEGIN
+
+#if STR_VIEW_HAS_SIMD
+// Part of compare_nocase for count of at least one register of characters.
+template<typename S, typename CharT>
+STR_VIEW_SIMD_INLINE int simd_compare_nocase(const CharT* lhs, const CharT* rhs, size_t count, bool stopAtNull)
+{
+    size_t i = 0;
+    const size_t charsPerVec = S::BYTES / sizeof(CharT);
+    const uint64_t allMask = simd_full_mask<S>();
+    const typename S::vec zero = S::template splat<CharT>((CharT)0);
+    // Returns true if vector at pos contains a difference or null character.
+    auto vectorDiffers = [&](size_t pos) STR_VIEW_SIMD_LAMBDA -> bool
+    {
+        const typename S::vec lhsVec = S::load(lhs + pos);
+        const typename S::vec rhsVec = S::load(rhs + pos);
+        const uint64_t equal = S::mask(S::template cmpeq<CharT>(
+            S::template ascii_tolower<CharT>(lhsVec), S::template ascii_tolower<CharT>(rhsVec)));
+        const uint64_t nullMask = stopAtNull ? S::mask(S::template cmpeq<CharT>(lhsVec, zero)) : 0;
+        return (equal != allMask) | (nullMask != 0);
+    };
+    for(; i + charsPerVec * 2 <= count; i += charsPerVec * 2)
+    {
+        if(vectorDiffers(i) | vectorDiffers(i + charsPerVec))
+            break;
+    }
+    for(; i + charsPerVec <= count; i += charsPerVec)
+    {
+        if(vectorDiffers(i))
+            return constexpr_strncmp(lhs + i, rhs + i, charsPerVec, false, stopAtNull);
+    }
+    // The last vector overlaps characters already checked, which are known to be equal and not null.
+    if(i < count && vectorDiffers(count - charsPerVec))
+        return constexpr_strncmp(lhs + i, rhs + i, count - i, false, stopAtNull);
+    return 0;
+}
+#endif
+
+#if STR_VIEW_DISPATCH
+template<typename CharT>
+STR_VIEW_TARGET_AVX2 int compare_nocase_avx2(const CharT* lhs, const CharT* rhs, size_t count, bool stopAtNull)
+{
+    return simd_compare_nocase<simd_avx2>(lhs, rhs, count, stopAtNull);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX512 int compare_nocase_avx512(const CharT* lhs, const CharT* rhs, size_t count, bool stopAtNull)
+{
+    return simd_compare_nocase<simd_avx512>(lhs, rhs, count, stopAtNull);
+}
+#endif
+
+STR_VIEW_SIMD_KERNELS_END
+
+template<typename CharT>
+inline int compare_nocase(const CharT* lhs, const CharT* rhs, size_t count, bool stopAtNull = true)
+{
+#if STR_VIEW_DISPATCH
+    if(count * sizeof(CharT) >= DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = dispatch_kernel(&compare_nocase_avx2<CharT>, &compare_nocase_avx512<CharT>);
+        if(kernel)
+            return kernel(lhs, rhs, count, stopAtNull);
+    }
+#endif
+#if STR_VIEW_HAS_SIMD
+    if(count >= simd_best::BYTES / sizeof(CharT))
+        return simd_compare_nocase<simd_best>(lhs, rhs, count, stopAtNull);
+#endif
+    size_t i = 0;
+    if(sizeof(CharT) == 1 && count >= 4)
+    {
+        // Words of 8 or 4 characters. The last one overlaps characters already checked.
+        const size_t wordSize = count >= 8 ? 8 : 4;
+        for(;;)
+        {
+            const size_t pos = std::min(i, count - wordSize);
+            uint64_t lhsWord = 0, rhsWord = 0;
+            if(wordSize == 8)
+            {
+                memcpy(&lhsWord, lhs + pos, 8);
+                memcpy(&rhsWord, rhs + pos, 8);
+            }
+            else
+            {
+                uint32_t lhsWord32 = 0, rhsWord32 = 0;
+                memcpy(&lhsWord32, lhs + pos, 4);
+                memcpy(&rhsWord32, rhs + pos, 4);
+                lhsWord = lhsWord32;
+                rhsWord = rhsWord32;
+            }
+            const uint64_t lhsNull = stopAtNull ?
+                (lhsWord - 0x0101010101010101ull) & ~lhsWord & 0x8080808080808080ull : 0;
+            // In a 4-character word, upper 4 bytes are 0 in both words and are ignored.
+            if((lhsNull & (wordSize == 8 ? ~0ull : 0x80808080ull)) != 0 ||
+                hash_fold_case_swar(lhsWord) != hash_fold_case_swar(rhsWord))
+            {
+                return constexpr_strncmp(lhs + i, rhs + i, pos + wordSize - i, false, stopAtNull);
+            }
+            i = pos + wordSize;
+            if(i == count)
+                return 0;
+        }
+    }
+    return constexpr_strncmp(lhs + i, rhs + i, count - i, false, stopAtNull);
+}
+
+// Allocator for null-terminated copies set for the current thread.
+inline str_view_allocator*& thread_allocator()
+{
+    static thread_local str_view_allocator* allocator = nullptr;
+    return allocator;
+}
+
+} // namespace str_view_detail
+
+// Returns name of the instruction set that SIMD kernels were compiled for: "AVX2", "SSE2", "NEON" or "scalar".
+inline const char* str_view_simd_name()
+{
+#if STR_VIEW_AVX512
+    return "AVX-512";
+#elif STR_VIEW_AVX2
+    return "AVX2";
+#elif STR_VIEW_SSE2
+    return "SSE2";
+#elif STR_VIEW_NEON
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+/*
+Returns name of the instruction set of kernels for long strings, selected at run time
+with STR_VIEW_DISPATCH: "AVX-512", "AVX2", or the same as str_view_simd_name().
+*/
+inline const char* str_view_simd_dispatch_name()
+{
+#if STR_VIEW_DISPATCH
+    const str_view_cpu_features& cpu = str_view_get_cpu_features();
+    if(cpu.avx2 && cpu.avx512bw)
+        return "AVX-512";
+    if(cpu.avx2)
+        return "AVX2";
+#endif
+    return str_view_simd_name();
+}
+
+// Tells whether the CPU supports the instruction set that SIMD kernels were compiled for.
+inline bool str_view_cpu_supports_build()
+{
+#if STR_VIEW_AVX512
+    return str_view_get_cpu_features().avx512bw;
+#elif STR_VIEW_AVX2
+    return str_view_get_cpu_features().avx2;
+#elif STR_VIEW_SSE2
+    return str_view_get_cpu_features().sse2;
+#elif STR_VIEW_NEON
+    return str_view_get_cpu_features().neon;
+#else
+    return true;
+#endif
+}
+
+/*
+Wrappers over CRT functions. Those other than tstrcpy can also be used in constant
+expressions - see STR_VIEW_CONSTEXPR.
+*/
+#define STR_VIEW_CONSTEXPR_DISPATCH(constexprCall, runtimeCall) \
+    (STR_VIEW_IS_CONSTANT_EVALUATED() ? (constexprCall) : (runtimeCall))
+#if STR_VIEW_HAS_SIMD && STR_VIEW_SIMD_STRLEN
+inline STR_VIEW_CONSTEXPR size_t tstrlen(const char* sz) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_strlen(sz), str_view_detail::simd_strlen(sz)); }
+inline STR_VIEW_CONSTEXPR size_t tstrlen(const wchar_t* sz) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_strlen(sz), str_view_detail::simd_strlen(sz)); }
+#else
+inline STR_VIEW_CONSTEXPR size_t tstrlen(const char* sz) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_strlen(sz), strlen(sz)); }
+inline STR_VIEW_CONSTEXPR size_t tstrlen(const wchar_t* sz) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_strlen(sz), wcslen(sz)); }
+#endif
+// Copies null-terminated src with its null to dst, which must have room for it, like strcpy_s.
+inline void tstrcpy(char* dst, size_t dstCapacity, const char* src)
+{
+    const size_t len = strlen(src);
+    assert(len < dstCapacity);
+    (void)dstCapacity;
+    memcpy(dst, src, len + 1);
+}
+inline void tstrcpy(wchar_t* dst, size_t dstCapacity, const wchar_t* src)
+{
+    const size_t len = wcslen(src);
+    assert(len < dstCapacity);
+    (void)dstCapacity;
+    wmemcpy(dst, src, len + 1);
+}
+inline STR_VIEW_CONSTEXPR int tstrncmp(const char* lhs, const char* rhs, size_t count) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_strncmp(lhs, rhs, count, true), strncmp(lhs, rhs, count)); }
+inline STR_VIEW_CONSTEXPR int tstrncmp(const wchar_t* lhs, const wchar_t* rhs, size_t count) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_strncmp(lhs, rhs, count, true), wcsncmp(lhs, rhs, count)); }
+// Case-insensitive for ASCII letters only, independent of locale - see str_view_detail::compare_nocase.
+inline STR_VIEW_CONSTEXPR int tstrnicmp(const char* lhs, const char* rhs, size_t count) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_strncmp(lhs, rhs, count, false), str_view_detail::compare_nocase(lhs, rhs, count)); }
+inline STR_VIEW_CONSTEXPR int tstrnicmp(const wchar_t* lhs, const wchar_t* rhs, size_t count) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_strncmp(lhs, rhs, count, false), str_view_detail::compare_nocase(lhs, rhs, count)); }
+// Compare all count characters, including null characters, like memcmp/wmemcmp.
+inline STR_VIEW_CONSTEXPR int tmemcmp(const char* lhs, const char* rhs, size_t count) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_strncmp(lhs, rhs, count, true, false), memcmp(lhs, rhs, count)); }
+inline STR_VIEW_CONSTEXPR int tmemcmp(const wchar_t* lhs, const wchar_t* rhs, size_t count) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_strncmp(lhs, rhs, count, true, false), wmemcmp(lhs, rhs, count)); }
+inline STR_VIEW_CONSTEXPR int tmemicmp(const char* lhs, const char* rhs, size_t count) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_strncmp(lhs, rhs, count, false, false), str_view_detail::compare_nocase(lhs, rhs, count, false)); }
+inline STR_VIEW_CONSTEXPR int tmemicmp(const wchar_t* lhs, const wchar_t* rhs, size_t count) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_strncmp(lhs, rhs, count, false, false), str_view_detail::compare_nocase(lhs, rhs, count, false)); }
+// Return pointer to first/last occurrence of ch in [str; str + count), or null if not found.
+inline STR_VIEW_CONSTEXPR const char* tmemchr(const char* str, char ch, size_t count) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_find_char(str, ch, count), str_view_detail::find_char(str, ch, count)); }
+inline STR_VIEW_CONSTEXPR const wchar_t* tmemchr(const wchar_t* str, wchar_t ch, size_t count) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_find_char(str, ch, count), str_view_detail::find_char(str, ch, count)); }
+inline STR_VIEW_CONSTEXPR const char* tmemrchr(const char* str, char ch, size_t count) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_rfind_char(str, ch, count), str_view_detail::rfind_char(str, ch, count)); }
+inline STR_VIEW_CONSTEXPR const wchar_t* tmemrchr(const wchar_t* str, wchar_t ch, size_t count) { return STR_VIEW_CONSTEXPR_DISPATCH(str_view_detail::constexpr_rfind_char(str, ch, count), str_view_detail::rfind_char(str, ch, count)); }
+
+/*
+Comparison traits. They select how compare(), equals(), starts_with(), ends_with()
+and comparison operators treat null characters inside the string. Pass them as
+template argument, e.g. v1.compare<str_view_binary_compare>(v2).
+
+str_view_cstring_compare is the default. It works like strncmp, so characters
+past '\0' are not compared and views "A\0B" and "A\0C" are equal.
+
+str_view_binary_compare works like memcmp, comparing all characters. Use it for
+views of binary data.
+
+Custom traits need static functions compare() and equal() with the same signatures,
+and hashed_length() to be used with str_view_hash.
+*/
+struct str_view_cstring_compare
+{
+    template<typename CharT>
+    static inline STR_VIEW_CONSTEXPR int compare(const CharT* lhs, const CharT* rhs, size_t count, bool caseSensitive)
+    {
+        return caseSensitive ? tstrncmp(lhs, rhs, count) : tstrnicmp(lhs, rhs, count);
+    }
+    // Number of leading characters hashed by str_view_hash: those before the first '\0'.
+    template<typename CharT>
+    static inline STR_VIEW_CONSTEXPR size_t hashed_length(const CharT* str, size_t count)
+    {
+        const CharT* const end = count ? tmemchr(str, (CharT)0, count) : nullptr;
+        return end ? (size_t)(end - str) : count;
+    }
+    template<typename CharT>
+    static inline STR_VIEW_CONSTEXPR bool equal(const CharT* lhs, const CharT* rhs, size_t count, bool caseSensitive)
+    {
+        // Identical characters are the common case and memcmp is faster than strncmp.
+        if(caseSensitive && tmemcmp(lhs, rhs, count) == 0)
+            return true;
+        return compare(lhs, rhs, count, caseSensitive) == 0;
+    }
+};
+
+struct str_view_binary_compare
+{
+    template<typename CharT>
+    static inline STR_VIEW_CONSTEXPR int compare(const CharT* lhs, const CharT* rhs, size_t count, bool caseSensitive)
+    {
+        return caseSensitive ? tmemcmp(lhs, rhs, count) : tmemicmp(lhs, rhs, count);
+    }
+    template<typename CharT>
+    static inline STR_VIEW_CONSTEXPR size_t hashed_length(const CharT*, size_t count) { return count; }
+    template<typename CharT>
+    static inline STR_VIEW_CONSTEXPR bool equal(const CharT* lhs, const CharT* rhs, size_t count, bool caseSensitive)
+    {
+        return compare(lhs, rhs, count, caseSensitive) == 0;
+    }
+};
+
+/*
+Interface of allocator used for null-terminated copies created by
+str_view_template::c_str().
+
+By default, copies are allocated from the global heap. Install your own allocator
+for the current thread with str_view_allocator_scope, e.g. str_view_monotonic_arena
+reset after each request, to avoid malloc/free pair for every copy.
+
+allocate() must return memory aligned at least to alignof(void*) and to 4 bytes.
+The allocator is remembered with every copy, so the copy is returned to the same
+allocator even if the view is destroyed on a different thread. The allocator must
+remain alive as long as any view holds a copy allocated from it.
+*/
+class str_view_allocator
+{
+public:
+    virtual ~str_view_allocator() { }
+    virtual void* allocate(size_t bytes) = 0;
+    virtual void deallocate(void* ptr, size_t bytes) = 0;
+};
+
+/*
+Returns allocator used by c_str() on the current thread, or null if the
+global heap is used.
+*/
+inline str_view_allocator* str_view_get_thread_allocator()
+{
+    return str_view_detail::thread_allocator();
+}
+
+/*
+Sets allocator used by c_str() on the current thread. Null means the global heap.
+Returns previous allocator.
+*/
+inline str_view_allocator* str_view_set_thread_allocator(str_view_allocator* allocator)
+{
+    str_view_allocator* const prev = str_view_detail::thread_allocator();
+    str_view_detail::thread_allocator() = allocator;
+    return prev;
+}
+
+/*
+Sets allocator used by c_str() on the current thread for the lifetime of this object.
+Restores previous one in destructor.
+*/
+class str_view_allocator_scope
+{
+public:
+    explicit str_view_allocator_scope(str_view_allocator* allocator) :
+        m_Prev(str_view_set_thread_allocator(allocator))
+    {
+    }
+    ~str_view_allocator_scope() { str_view_set_thread_allocator(m_Prev); }
+
+private:
+    str_view_allocator* m_Prev;
+
+    str_view_allocator_scope(const str_view_allocator_scope&) = delete;
+    str_view_allocator_scope& operator=(const str_view_allocator_scope&) = delete;
+};
+
+/*
+Allocator that takes memory from big blocks by just moving a pointer forward.
+deallocate() does nothing. Memory is reclaimed all at once by reset() or destructor.
+
+Not thread-safe - use separate object for each thread.
+All views with copies allocated from it must be destroyed before reset().
+*/
+class str_view_monotonic_arena : public str_view_allocator
+{
+public:
+    explicit str_view_monotonic_arena(size_t blockSize = 4096) :
+        m_BlockSize(blockSize),
+        m_Blocks(nullptr),
+        m_Ptr(nullptr),
+        m_End(nullptr)
+    {
+    }
+    virtual ~str_view_monotonic_arena() { free_blocks(nullptr); }
+
+    virtual void* allocate(size_t bytes) { return allocate(bytes, DEFAULT_ALIGNMENT); }
+    virtual void deallocate(void*, size_t) { }
+
+    // Allocates memory with given alignment, which must be a power of 2 not greater than DEFAULT_ALIGNMENT.
+    void* allocate(size_t bytes, size_t alignment)
+    {
+        assert(alignment > 0 && alignment <= DEFAULT_ALIGNMENT && (alignment & (alignment - 1)) == 0);
+        char* ptr = (char*)(((uintptr_t)m_Ptr + (alignment - 1)) & ~(uintptr_t)(alignment - 1));
+        if(m_Ptr == nullptr || ptr > m_End || (size_t)(m_End - ptr) < bytes)
+        {
+            new_block(bytes);
+            ptr = m_Ptr;
+        }
+        m_Ptr = ptr + bytes;
+        return ptr;
+    }
+
+    // Returns total size of blocks currently allocated from the heap.
+    size_t block_bytes() const
+    {
+        size_t result = 0;
+        for(const block_header* block = m_Blocks; block; block = block->next)
+            result += block->size;
+        return result;
+    }
+
+    /*
+    Makes all memory allocated so far available again.
+    Keeps the most recent block to avoid allocating it again.
+    */
+    void reset()
+    {
+        if(m_Blocks)
+        {
+            free_blocks(m_Blocks);
+            m_Blocks->next = nullptr;
+            m_Ptr = (char*)(m_Blocks + 1);
+        }
+    }
+
+    enum { DEFAULT_ALIGNMENT = sizeof(void*) * 2 };
+
+private:
+    struct block_header
+    {
+        block_header* next;
+        size_t size; // Including this header.
+    };
+
+    size_t m_BlockSize;
+    block_header* m_Blocks; // Most recent first.
+    char* m_Ptr;
+    char* m_End;
+
+    static size_t align_up(size_t bytes)
+    {
+        return (bytes + (DEFAULT_ALIGNMENT - 1)) & ~(size_t)(DEFAULT_ALIGNMENT - 1);
+    }
+    void new_block(size_t minBytes)
+    {
+        const size_t size = std::max(m_BlockSize, minBytes + align_up(sizeof(block_header)));
+        block_header* const block = (block_header*)::operator new(size);
+        block->next = m_Blocks;
+        block->size = size;
+        m_Blocks = block;
+        m_Ptr = (char*)block + align_up(sizeof(block_header));
+        m_End = (char*)block + size;
+    }
+    // Frees all blocks except keep.
+    void free_blocks(block_header* keep)
+    {
+        for(block_header* block = m_Blocks; block; )
+        {
+            block_header* const next = block->next;
+            if(block != keep)
+                ::operator delete(block);
+            block = next;
+        }
+        m_Blocks = keep;
+        if(keep == nullptr)
+            m_Ptr = m_End = nullptr;
+    }
+
+    str_view_monotonic_arena(const str_view_monotonic_arena&) = delete;
+    str_view_monotonic_arena& operator=(const str_view_monotonic_arena&) = delete;
+};
+
+/*
+Interface of thread pool used by parallel search methods like
+str_view_template::find_parallel().
+
+Implement it to run the work on your own thread pool, or with a standard parallel
+algorithm, e.g. std::for_each(std::execution::par, ...) over task indices.
+*/
+class str_view_executor
+{
+public:
+    virtual ~str_view_executor() { }
+    /*
+    Calls task(index) once for every index in [0, taskCount), possibly in parallel
+    on many threads, and returns when all calls have finished. Tasks with lower
+    indices should be started first, because searches for the first occurrence
+    skip tasks past an occurrence already found.
+    */
+    virtual void run(size_t taskCount, const std::function<void(size_t)>& task) = 0;
+};
+
+/*
+Executor that runs tasks on the calling thread and threads created for every run() call.
+It's used when no other executor is given.
+*/
+class str_view_thread_executor : public str_view_executor
+{
+public:
+    // threadCount = 0 means std::thread::hardware_concurrency().
+    explicit str_view_thread_executor(size_t threadCount = 0) :
+        m_ThreadCount(threadCount ? threadCount : std::max<size_t>(1, std::thread::hardware_concurrency()))
+    {
+    }
+
+    size_t thread_count() const { return m_ThreadCount; }
+
+    virtual void run(size_t taskCount, const std::function<void(size_t)>& task)
+    {
+        std::atomic<size_t> nextTask(0);
+        const auto worker = [&]() {
+            for(size_t index; (index = nextTask.fetch_add(1, std::memory_order_relaxed)) < taskCount; )
+                task(index);
+        };
+        std::vector<std::thread> threads;
+        for(size_t i = 1; i < std::min(m_ThreadCount, taskCount); ++i)
+            threads.emplace_back(worker);
+        worker();
+        for(std::thread& thread : threads)
+            thread.join();
+    }
+
+private:
+    size_t m_ThreadCount;
+};
+
+// Parameters of parallel search methods like str_view_template::find_parallel().
+struct str_view_parallel_options
+{
+    enum { DEFAULT_CHUNK_LENGTH = 1024 * 1024 };
+
+    // Null means new str_view_thread_executor with default number of threads.
+    str_view_executor* executor;
+    /*
+    Number of characters searched by one task. Strings not longer than that
+    are searched on the calling thread.
+    */
+    size_t chunkLength;
+
+    str_view_parallel_options(str_view_executor* exec = nullptr, size_t chunkLen = DEFAULT_CHUNK_LENGTH) :
+        executor(exec),
+        chunkLength(chunkLen)
+    {
+    }
+};
+
+/*
+Numbers of operations of string views, collected when STR_VIEW_STATS is 1.
+Otherwise all of them are always zero.
+*/
+struct str_view_stats
+{
+    // Lengths of null-terminated strings calculated on first length() or, with STR_VIEW_EAGER_LENGTH, in constructor.
+    size_t lazyLengths;
+    // Null-terminated copies allocated by c_str().
+    size_t copyAllocations;
+    // Bytes of characters in those copies, including null terminators.
+    size_t copyBytes;
+    // Null-terminated copies written to inline buffer of str_view_sso_template.
+    size_t inlineCopies;
+    // Calls to c_str() that found other thread creating or having created a copy at the same time.
+    size_t lostCopyRaces;
+    // Copy constructions of str_view_template, including substrings created by the constructor.
+    size_t copyConstructions;
+    // Move constructions of str_view_template.
+    size_t moveConstructions;
+};
+
+namespace str_view_detail
+{
+
+enum
+{
+    STATS_LAZY_LENGTHS,
+    STATS_COPY_ALLOCATIONS,
+    STATS_COPY_BYTES,
+    STATS_INLINE_COPIES,
+    STATS_LOST_COPY_RACES,
+    STATS_COPY_CONSTRUCTIONS,
+    STATS_MOVE_CONSTRUCTIONS,
+    STATS_COUNTER_COUNT
+};
+
+inline str_view_stats make_stats(const size_t (&counters)[STATS_COUNTER_COUNT])
+{
+    str_view_stats result;
+    result.lazyLengths = counters[STATS_LAZY_LENGTHS];
+    result.copyAllocations = counters[STATS_COPY_ALLOCATIONS];
+    result.copyBytes = counters[STATS_COPY_BYTES];
+    result.inlineCopies = counters[STATS_INLINE_COPIES];
+    result.lostCopyRaces = counters[STATS_LOST_COPY_RACES];
+    result.copyConstructions = counters[STATS_COPY_CONSTRUCTIONS];
+    result.moveConstructions = counters[STATS_MOVE_CONSTRUCTIONS];
+    return result;
+}
+
+#if STR_VIEW_STATS
+
+/*
+Counters of one thread. Only that thread increments them, with plain relaxed load and
+store, so it doesn't need locked instructions. Other threads read them in str_view_get_stats().
+Trivially destructible, so it can be zero-initialized and used even during destruction
+of other thread_local and static objects.
+*/
+struct thread_stats
+{
+    enum { UNREGISTERED, REGISTERED, RETIRED };
+
+    std::atomic<size_t> counters[STATS_COUNTER_COUNT];
+    // Values of counters at last str_view_reset_thread_stats(). Accessed only by this thread.
+    size_t baseline[STATS_COUNTER_COUNT];
+    thread_stats* prev;
+    thread_stats* next;
+    int state;
+};
+
+// List of counters of all running threads, with sums of counters of threads that have finished.
+struct stats_registry
+{
+    std::mutex mutex;
+    thread_stats* first;
+    size_t retired[STATS_COUNTER_COUNT];
+    // Values of total counters at last str_view_reset_stats().
+    size_t baseline[STATS_COUNTER_COUNT];
+
+    stats_registry() : first(nullptr), retired(), baseline() { }
+
+    // Must be called with the mutex locked.
+    void sum(size_t (&totals)[STATS_COUNTER_COUNT]) const
+    {
+        for(size_t i = 0; i < STATS_COUNTER_COUNT; ++i)
+            totals[i] = retired[i];
+        for(const thread_stats* t = first; t; t = t->next)
+        {
+            for(size_t i = 0; i < STATS_COUNTER_COUNT; ++i)
+                totals[i] += t->counters[i].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+inline stats_registry& get_stats_registry()
+{
+    static stats_registry registry;
+    return registry;
+}
+
+inline thread_stats& get_thread_stats()
+{
+    static thread_local thread_stats stats;
+    return stats;
+}
+
+// Moves counters of the current thread to the registry's sums when the thread exits.
+struct thread_stats_retirer
+{
+    ~thread_stats_retirer()
+    {
+        thread_stats& stats = get_thread_stats();
+        stats_registry& registry = get_stats_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for(size_t i = 0; i < STATS_COUNTER_COUNT; ++i)
+            registry.retired[i] += stats.counters[i].load(std::memory_order_relaxed);
+        (stats.prev ? stats.prev->next : registry.first) = stats.next;
+        if(stats.next)
+            stats.next->prev = stats.prev;
+        // Operations done after this point, e.g. in destructors of other thread_local objects, are not counted.
+        stats.state = thread_stats::RETIRED;
+    }
+};
+
+inline void register_thread_stats(thread_stats& stats)
+{
+    stats_registry& registry = get_stats_registry();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        stats.prev = nullptr;
+        stats.next = registry.first;
+        if(registry.first)
+            registry.first->prev = &stats;
+        registry.first = &stats;
+        stats.state = thread_stats::REGISTERED;
+    }
+    static thread_local thread_stats_retirer retirer;
+    (void)retirer;
+}
+
+inline void stats_add(size_t counter, size_t value)
+{
+    thread_stats& stats = get_thread_stats();
+    if(stats.state != thread_stats::REGISTERED)
+    {
+        if(stats.state == thread_stats::RETIRED)
+            return;
+        register_thread_stats(stats);
+    }
+    std::atomic<size_t>& c = stats.counters[counter];
+    c.store(c.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+#define STR_VIEW_STATS_ADD(counter, value) str_view_detail::stats_add(str_view_detail::counter, (value))
+
+#else
+
+#define STR_VIEW_STATS_ADD(counter, value) ((void)0)
+
+#endif // #if STR_VIEW_STATS
+
+// tstrlen() of a null-terminated string viewed by str_view_template, counted in str_view_stats::lazyLengths.
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR size_t counted_tstrlen(const CharT* sz)
+{
+    return STR_VIEW_CONSTEXPR_DISPATCH(constexpr_strlen(sz), (STR_VIEW_STATS_ADD(STATS_LAZY_LENGTHS, 1), tstrlen(sz)));
+}
+
+} // namespace str_view_detail
+
+/*
+Returns counters summed for all threads, including threads that have finished,
+since the start of the program or last str_view_reset_stats().
+Counters of running threads may be a moment out of date.
+*/
+inline str_view_stats str_view_get_stats()
+{
+    size_t counters[str_view_detail::STATS_COUNTER_COUNT] = {};
+#if STR_VIEW_STATS
+    str_view_detail::stats_registry& registry = str_view_detail::get_stats_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.sum(counters);
+    for(size_t i = 0; i < str_view_detail::STATS_COUNTER_COUNT; ++i)
+        counters[i] -= registry.baseline[i];
+#endif
+    return str_view_detail::make_stats(counters);
+}
+
+// Makes str_view_get_stats() count from zero again. Doesn't affect str_view_get_thread_stats().
+inline void str_view_reset_stats()
+{
+#if STR_VIEW_STATS
+    str_view_detail::stats_registry& registry = str_view_detail::get_stats_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.sum(registry.baseline);
+#endif
+}
+
+// Returns counters of the current thread since its start or last str_view_reset_thread_stats().
+inline str_view_stats str_view_get_thread_stats()
+{
+    size_t counters[str_view_detail::STATS_COUNTER_COUNT] = {};
+#if STR_VIEW_STATS
+    const str_view_detail::thread_stats& stats = str_view_detail::get_thread_stats();
+    for(size_t i = 0; i < str_view_detail::STATS_COUNTER_COUNT; ++i)
+        counters[i] = stats.counters[i].load(std::memory_order_relaxed) - stats.baseline[i];
+#endif
+    return str_view_detail::make_stats(counters);
+}
+
+// Makes str_view_get_thread_stats() count from zero again. Doesn't affect str_view_get_stats().
+inline void str_view_reset_thread_stats()
+{
+#if STR_VIEW_STATS
+    str_view_detail::thread_stats& stats = str_view_detail::get_thread_stats();
+    for(size_t i = 0; i < str_view_detail::STATS_COUNTER_COUNT; ++i)
+        stats.baseline[i] = stats.counters[i].load(std::memory_order_relaxed);
+#endif
+}
+
+namespace str_view_detail
+{
+
+/*
+Null-terminated copies made by c_str() are preceded by this header,
+so they can be returned to the allocator they came from.
+*/
+struct copy_header
+{
+    str_view_allocator* allocator; // Null means global heap.
+    size_t bytes; // Including this header.
+};
+
+/*
+Replacement of std::atomic with the same methods, for a member that is never modified
+while other threads may access it, so it doesn't need to be atomic.
+*/
+template<typename T>
+class nonatomic
+{
+public:
+    STR_VIEW_CONSTEXPR nonatomic(T value) : m_Value(value) { }
+    STR_VIEW_CONSTEXPR operator T() const { return m_Value; }
+    nonatomic<T>& operator=(T value) { m_Value = value; return *this; }
+    T load(std::memory_order = std::memory_order_seq_cst) const { return m_Value; }
+    void store(T value, std::memory_order = std::memory_order_seq_cst) { m_Value = value; }
+    T exchange(T value, std::memory_order = std::memory_order_seq_cst) { const T old = m_Value; m_Value = value; return old; }
+
+private:
+    T m_Value;
+};
+
+template<typename CharT>
+inline CharT* allocate_null_terminated_copy(const CharT* str, size_t length)
+{
+    STR_VIEW_STATS_ADD(STATS_COPY_ALLOCATIONS, 1);
+    STR_VIEW_STATS_ADD(STATS_COPY_BYTES, (length + 1) * sizeof(CharT));
+    str_view_allocator* const allocator = thread_allocator();
+    const size_t bytes = sizeof(copy_header) + (length + 1) * sizeof(CharT);
+    copy_header* const header = (copy_header*)(allocator ?
+        allocator->allocate(bytes) : ::operator new(bytes));
+    header->allocator = allocator;
+    header->bytes = bytes;
+    CharT* const result = (CharT*)(header + 1);
+    assert(((uintptr_t)result & 3) == 0); // Make sure low bits of the address are free for flags.
+    memcpy(result, str, length * sizeof(CharT));
+    result[length] = (CharT)0;
+    return result;
+}
+
+template<typename CharT>
+inline void free_null_terminated_copy(CharT* copy)
+{
+    copy_header* const header = (copy_header*)copy - 1;
+    if(header->allocator)
+        header->allocator->deallocate(header, header->bytes);
+    else
+        ::operator delete(header);
+}
+
+template<typename CharT>
+struct split_by_char;
+template<typename CharT>
+struct split_by_substr;
+template<typename CharT>
+struct split_by_set;
+
+} // namespace str_view_detail
+
+template<typename CharT>
+class char_set_template;
+template<typename CharT>
+class str_view_lite_template;
+template<typename CharT, size_t InlineCapacity>
+class str_view_sso_template;
+template<typename CharT, typename SeparatorT>
+class str_view_split_range_template;
+
+// Parameter is named CharT_ only to let the class declare member type CharT.
+template<typename CharT_>
+class str_view_template
+{
+public:
+    typedef CharT_ CharT;
+    typedef std::basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT>> StringT;
+
+    /*
+    Initializes to empty string.
+    */
+    inline STR_VIEW_CONSTEXPR str_view_template();
+    
+    /*
+    Initializes from a null-terminated string.
+    Null is acceptable. It means empty string.
+    */
+    inline STR_VIEW_CONSTEXPR str_view_template(const CharT* sz);
+    /*
+    Initializes from not null-terminated string.
+    Null is acceptable if length is 0.
+    */
+    inline STR_VIEW_CONSTEXPR str_view_template(const CharT* str, size_t length);
+    /*
+    Initializes from string with given length, with explicit statement that it is null-terminated.
+    Null is acceptable if length is 0.
+    */
+    struct StillNullTerminated { };
+    inline STR_VIEW_CONSTEXPR str_view_template(const CharT* str, size_t length, StillNullTerminated);
+    
+    /*
+    Initializes from an STL string.
+    length can exceed actual str.length(). It then spans to the end of str.
+    */
+    inline str_view_template(const StringT& str, size_t offset = 0, size_t length = SIZE_MAX);
+    /*
+    Initializes from str_view_lite_template.
+    Length is known. String is treated as not null-terminated.
+    */
+    inline STR_VIEW_CONSTEXPR str_view_template(const str_view_lite_template<CharT>& src);
+#if STR_VIEW_HAS_STD_STRING_VIEW
+    typedef std::basic_string_view<CharT> StringViewT;
+    /*
+    Initializes from std::basic_string_view, without copying.
+    Length is known. String is treated as not null-terminated, because it can't be checked
+    without reading past its end. If it's known to be null-terminated, use constructor with
+    StillNullTerminated, so c_str() doesn't make a copy.
+    */
+    inline STR_VIEW_CONSTEXPR str_view_template(const StringViewT& src);
+#endif
+
+    // Copy constructor.
+    inline str_view_template(const str_view_template<CharT>& src, size_t offset = 0, size_t length = SIZE_MAX);
+    // Move constructor.
+    inline str_view_template(str_view_template<CharT>&& src);
+    
+    inline ~str_view_template();
+
+    // Copy assignment operator.
+    inline str_view_template<CharT>& operator=(const str_view_template<CharT>& src);
+    // Move assignment operator.
+    inline str_view_template<CharT>& operator=(str_view_template<CharT>&& src);
+
+    /*
+    Exchanges the view with that of rhs.
+    */
+    inline void swap(str_view_template<CharT>& rhs) noexcept;
+
+    /*
+    Returns the number of characters in the view. 
+    */
+    inline size_t length() const;
+    /*
+    Returns the number of characters in the view. 
+    Usage of this method is not recommended because its name may be misleading -
+    it may suggest size in bytes not in characters.
+    */
+    inline size_t size() const { return length(); }
+    /*
+    Checks if the view has no characters, i.e. whether length() == 0.
+    It may be more efficient than checking length().
+    */
+    inline bool empty() const;
+    /*
+    Returns a pointer to the underlying character array.
+    The pointer is such that the range [data(); data() + length()) is valid and the values in it
+    correspond to the values of the view. 
+    If empty() == true, returned pointer is undefined.
+    */
+    inline const CharT* data() const { return m_Begin; }
+    /*
+    Returns an iterator to the first character of the view.
+    If empty() == true, returned pointer may or may not be null, but always begin() == end().
+    */
+    inline const CharT* begin() const { return m_Begin; }
+    /*
+    Returns an iterator to the character following the last character of the view.
+    This character acts as a placeholder, attempting to access it results in undefined behavior. 
+    */
+    inline const CharT* end() const { return m_Begin + length(); }
+    /*
+    Returns first character in the view.
+    The behavior is undefined if empty() == true.
+    */
+    inline const CharT front() const { return *m_Begin; }
+    /*
+    Returns last character in the view.
+    The behavior is undefined if empty() == true. 
+    */
+    inline const CharT back() const { return m_Begin[length() - 1]; }
+    
+    inline CharT operator[](size_t index) const { return m_Begin[index]; }
+    inline CharT at(size_t index) const { return m_Begin[index]; }
+
+    /*
+    Returns null-terminated string with contents of this object.
+    Possibly an internal copy.
+    */
+    inline const CharT* c_str() const;
+
+    /*
+    Returns lightweight view of the same string, which is trivially copyable.
+    Calculates length if not known yet.
+    */
+    inline str_view_lite_template<CharT> to_lite() const { return str_view_lite_template<CharT>(m_Begin, length()); }
+
+    /*
+    Returns hash of the string. Calculates length if not known yet.
+    With case_sensitive = false, strings equal according to compare(rhs, false) have equal hashes.
+    Returns the same value as str_view_lite_template::hash.
+    */
+    inline size_t hash(bool case_sensitive = true) const { return to_lite().hash(case_sensitive); }
+
+    /*
+    Returns a view of the substring [offset, offset + length).
+    length can exceed actual length(). It then spans to the end of this string.
+    */
+    inline str_view_template<CharT> substr(size_t offset = 0, size_t length = SIZE_MAX) const;
+
+    /*
+    Copies the substring [offset, offset + length) to the character string pointed to by dst.
+    If pointer string ends before length is reached, string is copied to the end.
+    Null character is not added past the end of destination.
+    Returns number of characters copied.
+    */
+    inline size_t copy_to(CharT* dst, size_t offset = 0, size_t length = SIZE_MAX) const;
+
+    /*
+    Replaces content of dst with the substring [offset, offset + length).
+    Capacity of dst is reused, so converting many strings to the same dst doesn't allocate
+    memory once it's large enough.
+    */
+    inline void to_string(StringT& dst, size_t offset = 0, size_t length = SIZE_MAX) const;
+    /*
+    Appends the substring [offset, offset + length) to dst.
+    To append many strings with one allocation, see str_view_append().
+    */
+    inline void append_to(StringT& dst, size_t offset = 0, size_t length = SIZE_MAX) const;
+
+#if STR_VIEW_HAS_STD_STRING_VIEW
+    /*
+    Converts to std::basic_string_view, without copying. Calculates length if not known yet.
+    Together with the constructor, this lets str_view_template be passed to functions taking
+    std::basic_string_view and the other way around.
+    */
+    inline operator StringViewT() const { return StringViewT(m_Begin, length()); }
+#endif
+
+    /*
+    Compares this with rhs lexicographically.
+    Returns negative value, 0, or positive value, depending on the result.
+    
+    Comparison is made using functions like strncmp, so they don't compare characters
+    past '\0' if it's present in the string. Use CompareT = str_view_binary_compare
+    to compare all characters, like memcmp.
+    */
+    template<typename CompareT = str_view_cstring_compare>
+    inline int compare(const str_view_template<CharT>& rhs, bool case_sensitive = true) const;
+    /*
+    Returns true if this is equal to rhs. Same as compare(rhs) == 0, but strings
+    of different length are rejected without looking at their characters.
+    */
+    template<typename CompareT = str_view_cstring_compare>
+    inline bool equals(const str_view_template<CharT>& rhs, bool case_sensitive = true) const;
+
+    inline bool operator==(const str_view_template<CharT>& rhs) const { return equals(rhs); }
+    inline bool operator!=(const str_view_template<CharT>& rhs) const { return !equals(rhs); }
+    inline bool operator< (const str_view_template<CharT>& rhs) const { return compare(rhs) <  0; }
+    inline bool operator> (const str_view_template<CharT>& rhs) const { return compare(rhs) >  0; }
+    inline bool operator<=(const str_view_template<CharT>& rhs) const { return compare(rhs) <= 0; }
+    inline bool operator>=(const str_view_template<CharT>& rhs) const { return compare(rhs) >= 0; }
+
+    /*
+    Checks if the string view begins with the given prefix.
+
+    If the string view is shorter than the prefix, returns false.
+    If prefix is empty, returns true.
+    */
+    inline bool starts_with(CharT prefix, bool case_sensitive = true) const;
+    template<typename CompareT = str_view_cstring_compare>
+    inline bool starts_with(const str_view_template<CharT>& prefix, bool case_sensitive = true) const;
+
+    /*
+    Checks if the string view ends with the given suffix.
+
+    If the string view is shorter than the suffix, returns false.
+    If suffix is empty, returns true.
+    */
+    inline bool ends_with(CharT suffix, bool case_sensitive = true) const;
+    template<typename CompareT = str_view_cstring_compare>
+    inline bool ends_with(const str_view_template<CharT>& suffix, bool case_sensitive = true) const;
+
+    /*
+    Finds the first substring equal to the given character sequence.
+    pos - position at which to start the search.
+    Returns position of the first character of the found substring, or SIZE_MAX if no such substring is found.
+    If substr is empty, returns pos.
+    */
+    inline size_t find(CharT ch, size_t pos = 0) const;
+    inline size_t find(const str_view_template<CharT>& substr, size_t pos = 0) const;
+
+    /*
+    Finds the last substring equal to the given character sequence.
+    pos - position at which to start the search.
+    Returns position of the first character of the found substring, or SIZE_MAX if no such substring is found.
+    If substr is empty, returns pos.
+    If length is not known yet, rfind(ch) calculates it in the same pass with the search.
+    */
+    inline size_t rfind(CharT ch, size_t pos = SIZE_MAX) const;
+    inline size_t rfind(const str_view_template<CharT>& substr, size_t pos = SIZE_MAX) const;
+
+    /*
+    Finds the first character equal to any of the characters in the given character sequence. 
+    pos - position at which to start the search.
+    Returns position of the first occurrence of any character of the substring,
+    or SIZE_MAX if no such character is found.
+    If chars is empty, returns SIZE_MAX.
+    chars can also be prebuilt char_set_template, so its lookup table is not rebuilt on every call.
+    */
+    inline size_t find_first_of(const str_view_template<CharT>& chars, size_t pos = 0) const;
+    inline size_t find_first_of(const char_set_template<CharT>& chars, size_t pos = 0) const;
+    /*
+    Finds the last character equal to one of characters in the given character sequence.
+    The search considers only the interval [0; pos].
+    If the character is not present in the interval, SIZE_MAX will be returned.
+    If chars is empty, returns SIZE_MAX.
+    chars can also be prebuilt char_set_template, so its lookup table is not rebuilt on every call.
+    If length is not known yet and chars has up to 3 characters, it's calculated in the same pass
+    with the search. The same applies to find_last_not_of().
+    */
+    inline size_t find_last_of(const str_view_template<CharT>& chars, size_t pos = SIZE_MAX) const;
+    inline size_t find_last_of(const char_set_template<CharT>& chars, size_t pos = SIZE_MAX) const;
+    /*
+    Finds the first character NOT equal to any of the characters in the given character sequence. 
+    pos - position at which to start the search.
+    Returns position of the first occurrence of any character not of the substring,
+    or SIZE_MAX if no such character is found.
+    If chars is empty, returns SIZE_MAX.
+    chars can also be prebuilt char_set_template, so its lookup table is not rebuilt on every call.
+    */
+    inline size_t find_first_not_of(const str_view_template<CharT>& chars, size_t pos = 0) const;
+    inline size_t find_first_not_of(const char_set_template<CharT>& chars, size_t pos = 0) const;
+    /*
+    Finds the last character NOT equal to one of characters in the given character sequence.
+    The search considers only the interval [0; pos].
+    If the character is not present in the interval, SIZE_MAX will be returned.
+    If chars is empty, returns SIZE_MAX.
+    chars can also be prebuilt char_set_template, so its lookup table is not rebuilt on every call.
+    */
+    inline size_t find_last_not_of(const str_view_template<CharT>& chars, size_t pos = SIZE_MAX) const;
+    inline size_t find_last_not_of(const char_set_template<CharT>& chars, size_t pos = SIZE_MAX) const;
+
+    /*
+    Checks whether the string is well-formed UTF-8: no invalid bytes, truncated or overlong
+    sequences, surrogates or values above U+10FFFF. Available only for strings of char.
+    With AVX2 or AArch64 NEON, all bytes are checked with SIMD table lookups, otherwise
+    runs of ASCII characters. Calculates length if not known yet.
+    To convert UTF-8 to wide strings and back, see str_view_utf8_to_wide().
+    */
+    inline bool is_valid_utf8() const;
+
+    /*
+    Parses the whole string as a decimal number, like std::from_chars, without allocating
+    memory and without requiring null termination. NumberT can be any integer type except
+    bool and character types, float or double. Syntax is optional sign, digits, then for
+    floating-point types optional fraction and exponent, or "inf", "infinity", "nan" in any case.
+    No whitespace, base prefixes or hexadecimal floats are accepted. Returns false and leaves
+    outValue unchanged if the string is not such number or the value is out of range of NumberT.
+    Calculates length if not known yet.
+    */
+    template<typename NumberT>
+    inline bool parse(NumberT& outValue) const { return to_lite().parse(outValue); }
+    /*
+    Parses a number like parse(), but only at the beginning of substring starting at pos,
+    ignoring what follows it. Returns number of characters taken, or 0 if there is no valid number.
+    */
+    template<typename NumberT>
+    inline size_t parse_prefix(NumberT& outValue, size_t pos = 0) const { return to_lite().parse_prefix(outValue, pos); }
+    // Returns the whole string parsed as a number, or defaultValue if it is not a valid number.
+    inline int64_t to_int(int64_t defaultValue = 0) const { return to_lite().to_int(defaultValue); }
+    inline double to_double(double defaultValue = 0.0) const { return to_lite().to_double(defaultValue); }
+
+    /*
+    Returns a range of parts of the string separated by the given character or substring.
+    Parts are str_view_lite_template found lazily, one per iteration, without allocating memory.
+    A string with N separators always has N + 1 parts, some of which may be empty:
+    "a,,b" gives "a", "", "b" and empty string gives one empty part.
+    Separator substring must not be empty. Calculates length if not known yet.
+    The string and the separator substring must remain alive as long as the range is used.
+    */
+    inline str_view_split_range_template<CharT, str_view_detail::split_by_char<CharT>> split(CharT separator) const;
+    inline str_view_split_range_template<CharT, str_view_detail::split_by_substr<CharT>> split(const str_view_template<CharT>& separator) const;
+    /*
+    Like split(), but any of the given characters separates parts, e.g. split_any(" \t").
+    If separators is empty, the whole string is the only part.
+    separators can also be prebuilt char_set_template.
+    */
+    inline str_view_split_range_template<CharT, str_view_detail::split_by_set<CharT>> split_any(const str_view_template<CharT>& separators) const;
+    inline str_view_split_range_template<CharT, str_view_detail::split_by_set<CharT>> split_any(const char_set_template<CharT>& separators) const;
+
+    /*
+    Returns number of characters equal to ch. Calculates length if not known yet.
+    */
+    inline size_t count(CharT ch) const { return to_lite().count(ch); }
+
+    /*
+    Parallel versions of count(), find() and find_first_of(), for very long strings.
+
+    The string is divided into chunks of options.chunkLength characters, searched as
+    separate tasks on options.executor. Occurrences of substr that cross the border
+    between chunks are found too, so results are always the same as with the serial
+    methods. Searches for the first occurrence skip chunks that start after an
+    occurrence already found.
+    */
+    inline size_t count_parallel(CharT ch, const str_view_parallel_options& options = str_view_parallel_options()) const;
+    inline size_t find_parallel(CharT ch, const str_view_parallel_options& options = str_view_parallel_options()) const;
+    inline size_t find_parallel(const str_view_template<CharT>& substr, const str_view_parallel_options& options = str_view_parallel_options()) const;
+    inline size_t find_first_of_parallel(const str_view_template<CharT>& chars, const str_view_parallel_options& options = str_view_parallel_options()) const;
+    inline size_t find_first_of_parallel(const char_set_template<CharT>& chars, const str_view_parallel_options& options = str_view_parallel_options()) const;
+    /*
+    Calls func(size_t pos) for every occurrence of substr, in order, like
+    str_view_searcher_template::find_all(). Occurrences may overlap.
+    Chunks are searched in parallel and their positions are buffered, then func
+    is called on the calling thread. Returns number of occurrences found.
+    */
+    template<typename Func>
+    inline size_t find_all_parallel(const str_view_template<CharT>& substr, Func func, const str_view_parallel_options& options = str_view_parallel_options()) const;
+
+private:
+    /*
+    Memory ordering of the lazily evaluated members:
+
+    - m_Length is only a cache. Every thread that finds it unknown calculates the
+      same value from the same immutable string and stores it, so its loads and
+      stores are relaxed. A thread that sees SIZE_MAX just calculates it again.
+    - m_NullTerminatedPtr publishes a null-terminated copy written by one thread
+      and read by others. The CAS that sets it releases the copy, and c_str()
+      loads it with acquire, so the characters are visible before the pointer.
+      Values 0 and 1 don't refer to any data written by other threads, so checks
+      like "m_NullTerminatedPtr == 1" are relaxed.
+    - Non-const methods (assignment, move, swap, destructor) may not run at the
+      same time as any other method of the same object, so they use relaxed
+      operations too. Synchronization that makes the object visible to other
+      threads, like creating or joining a thread, also makes its members visible.
+
+    On x86 this changes only stores, which no longer need a locked instruction.
+    On ARM relaxed loads and stores need no barriers at all.
+    */
+    /*
+    SIZE_MAX means unknown. It's never unknown with STR_VIEW_EAGER_LENGTH,
+    so it's then not modified by const methods and doesn't need to be atomic.
+    */
+#if STR_VIEW_EAGER_LENGTH
+    str_view_detail::nonatomic<size_t> m_Length;
+#else
+    mutable std::atomic<size_t> m_Length;
+#endif
+    
+    const CharT* m_Begin;
+
+    /*
+    0 means null-terminated copy was not created yet.
+    1 means pointed string is null-terminated by itself.
+    COPY_BUSY means other thread is writing null-terminated copy to inline buffer of str_view_sso_template.
+    Pointer with INLINE_COPY_BIT set means inline buffer of str_view_sso_template with null-terminated copy.
+    It's not owned - it's never freed or moved to other object.
+    Any other value means pointer to array with null-terminated copy, owned by this object.
+    */
+    mutable std::atomic<uintptr_t> m_NullTerminatedPtr;
+
+    enum : uintptr_t { INLINE_COPY_BIT = 2, COPY_BUSY = 3 };
+
+    // Returns value of m_NullTerminatedPtr that can be moved to other object.
+    static inline uintptr_t transferable_copy(uintptr_t v) { return (v & INLINE_COPY_BIT) ? 0 : v; }
+    // Frees null-terminated copy if owned.
+    static inline void free_copy(uintptr_t v)
+    {
+        if(v > COPY_BUSY && (v & INLINE_COPY_BIT) == 0)
+            str_view_detail::free_null_terminated_copy((CharT*)v);
+    }
+    /*
+    If length is unknown, calculates it in the same pass with finding the last character matching
+    pred, so backward search doesn't read the string twice. Then stores the length and returns
+    true, with position of the character or SIZE_MAX in outPos. Returns false if length is known.
+    */
+    inline bool rfind_lazy(const str_view_detail::small_set_pred<CharT>& pred, size_t& outPos) const;
+
+    template<typename, size_t>
+    friend class str_view_sso_template;
+};
+
+typedef str_view_template<char> str_view;
+typedef str_view_template<wchar_t> wstr_view;
+
+/*
+Set of characters prepared for fast membership tests, used by find_first_of(),
+find_last_of(), find_first_not_of(), find_last_not_of().
+
+Build it once and pass it to these methods when the same set of characters is used
+many times, so the lookup table is not rebuilt on every call.
+
+The object refers to the characters it was built from, so they must remain alive and
+unchanged as long as the set is used.
+*/
+template<typename CharT>
+class char_set_template
+{
+public:
+    // Initializes to empty set.
+    inline char_set_template() : m_Bits(), m_WideBits(), m_Chars(nullptr), m_Count(0) { }
+    /*
+    Initializes from characters of given string view.
+    Duplicates are allowed. Empty set is allowed.
+    */
+    inline explicit char_set_template(const str_view_template<CharT>& chars);
+    inline char_set_template(const CharT* chars, size_t count);
+
+    // Returns number of characters the set was built from, including duplicates.
+    inline size_t length() const { return m_Count; }
+    inline bool empty() const { return m_Count == 0; }
+    // Returns pointer to characters the set was built from.
+    inline const CharT* data() const { return m_Chars; }
+
+    // Checks whether ch belongs to the set.
+    inline bool contains(CharT ch) const;
+
+private:
+    typedef typename std::make_unsigned<CharT>::type UCharT;
+
+    /*
+    Bitmap of characters 0..255.
+    Characters above 255 (possible only for wchar_t) set bit for their hash in m_WideBits.
+    Their exact membership is checked by scanning m_Chars, only when that bit is set.
+    */
+    uint64_t m_Bits[4];
+    uint64_t m_WideBits[4];
+    const CharT* m_Chars;
+    size_t m_Count;
+
+    static inline unsigned wide_hash(UCharT ch) { return (unsigned)((ch ^ (ch >> 8)) & 0xFF); }
+    static inline bool test_bit(const uint64_t* bits, unsigned index) { return ((bits[index >> 6] >> (index & 63)) & 1) != 0; }
+};
+
+typedef char_set_template<char> char_set;
+typedef char_set_template<wchar_t> wchar_set;
+
+template<typename CharT>
+inline char_set_template<CharT>::char_set_template(const str_view_template<CharT>& chars) :
+    char_set_template(chars.data(), chars.length())
+{
+}
+
+template<typename CharT>
+inline char_set_template<CharT>::char_set_template(const CharT* chars, size_t count) :
+    m_Bits(),
+    m_WideBits(),
+    m_Chars(chars),
+    m_Count(count)
+{
+    for(size_t i = 0; i < count; ++i)
+    {
+        const UCharT ch = (UCharT)chars[i];
+        if(ch < 256)
+            m_Bits[ch >> 6] |= (uint64_t)1 << (ch & 63);
+        else
+        {
+            const unsigned hash = wide_hash(ch);
+            m_WideBits[hash >> 6] |= (uint64_t)1 << (hash & 63);
+        }
+    }
+}
+
+template<typename CharT>
+inline bool char_set_template<CharT>::contains(CharT ch) const
+{
+    const UCharT uch = (UCharT)ch;
+    if(uch < 256)
+        return test_bit(m_Bits, (unsigned)uch);
+    if(!test_bit(m_WideBits, wide_hash(uch)))
+        return false;
+    return str_view_detail::find_char(m_Chars, ch, m_Count) != nullptr;
+}
+
+namespace str_view_detail
+{
+
+template<typename CharT>
+inline const CharT* find_in_set(const char_set_template<CharT>& set, const CharT* str, size_t count, bool negate)
+{
+    if(set.length() <= SMALL_SET_MAX)
+        return find_small_set(str, count, set.data(), set.length(), negate);
+    return scalar_scan_forward(str, count, [&set, negate](CharT ch) { return set.contains(ch) != negate; });
+}
+
+template<typename CharT>
+inline const CharT* rfind_in_set(const char_set_template<CharT>& set, const CharT* str, size_t count, bool negate)
+{
+    if(set.length() <= SMALL_SET_MAX)
+        return rfind_small_set(str, count, set.data(), set.length(), negate);
+    return scalar_scan_backward(str, count, [&set, negate](CharT ch) { return set.contains(ch) != negate; });
+}
+
+/*
+Separator policies of str_view_split_range_template.
+find() returns pointer to the first separator in [str, str + count), or null if there is none.
+*/
+template<typename CharT>
+struct split_by_char
+{
+    CharT ch;
+
+    inline const CharT* find(const CharT* str, size_t count) const { return tmemchr(str, ch, count); }
+    inline size_t separator_length() const { return 1; }
+};
+
+template<typename CharT>
+struct split_by_substr
+{
+    const CharT* separator;
+    size_t separatorLen;
+
+    inline const CharT* find(const CharT* str, size_t count) const { return find_substr(str, count, separator, separatorLen); }
+    inline size_t separator_length() const { return separatorLen; }
+};
+
+template<typename CharT>
+struct split_by_set
+{
+    char_set_template<CharT> set;
+
+    inline const CharT* find(const CharT* str, size_t count) const { return set.empty() ? nullptr : find_in_set(set, str, count, false); }
+    inline size_t separator_length() const { return 1; }
+};
+
+} // namespace str_view_detail
+
+/*
+Lightweight string view: just pointer and length.
+
+Unlike str_view_template, it's trivially copyable and has size of two pointers,
+so it can be passed by value in registers. Length is always known - it's calculated
+on construction from a null-terminated string. It doesn't remember whether the string
+is null-terminated and it doesn't offer c_str().
+
+It offers the same methods for comparing, searching and extracting substrings
+as str_view_template. Conversion in both directions is cheap: str_view_template
+can be created from it and it can be created from str_view_template (which
+calculates length of the source if unknown).
+*/
+template<typename CharT>
+class str_view_lite_template
+{
+public:
+    typedef std::basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT>> StringT;
+
+    // Initializes to empty string.
+    inline STR_VIEW_CONSTEXPR str_view_lite_template() : m_Begin(nullptr), m_Length(0) { }
+    /*
+    Initializes from a null-terminated string. Calculates its length.
+    Null is acceptable. It means empty string.
+    */
+    inline STR_VIEW_CONSTEXPR str_view_lite_template(const CharT* sz) : m_Begin(sz), m_Length(sz ? tstrlen(sz) : 0) { }
+    /*
+    Initializes from not null-terminated string.
+    Null is acceptable if length is 0.
+    */
+    inline STR_VIEW_CONSTEXPR str_view_lite_template(const CharT* str, size_t length) : m_Begin(length ? str : nullptr), m_Length(length) { }
+    /*
+    Initializes from an STL string.
+    length can exceed actual str.length(). It then spans to the end of str.
+    */
+    inline str_view_lite_template(const StringT& str, size_t offset = 0, size_t length = SIZE_MAX);
+    /*
+    Initializes from str_view_template.
+    Calculates its length if not known yet.
+    */
+    inline str_view_lite_template(const str_view_template<CharT>& src) : m_Begin(src.data()), m_Length(src.length()) { }
+#if STR_VIEW_HAS_STD_STRING_VIEW
+    typedef std::basic_string_view<CharT> StringViewT;
+    // Conversions from and to std::basic_string_view. Both just copy pointer and length.
+    inline STR_VIEW_CONSTEXPR str_view_lite_template(const StringViewT& src) : m_Begin(src.length() ? src.data() : nullptr), m_Length(src.length()) { }
+    inline STR_VIEW_CONSTEXPR operator StringViewT() const { return StringViewT(m_Begin, m_Length); }
+#endif
+
+    inline void swap(str_view_lite_template<CharT>& rhs) noexcept { std::swap(m_Begin, rhs.m_Begin); std::swap(m_Length, rhs.m_Length); }
+
+    inline STR_VIEW_CONSTEXPR size_t length() const { return m_Length; }
+    inline STR_VIEW_CONSTEXPR size_t size() const { return m_Length; }
+    inline STR_VIEW_CONSTEXPR bool empty() const { return m_Length == 0; }
+    inline STR_VIEW_CONSTEXPR const CharT* data() const { return m_Begin; }
+    inline STR_VIEW_CONSTEXPR const CharT* begin() const { return m_Begin; }
+    inline STR_VIEW_CONSTEXPR const CharT* end() const { return m_Begin + m_Length; }
+    inline STR_VIEW_CONSTEXPR const CharT front() const { return *m_Begin; }
+    inline STR_VIEW_CONSTEXPR const CharT back() const { return m_Begin[m_Length - 1]; }
+
+    inline STR_VIEW_CONSTEXPR CharT operator[](size_t index) const { return m_Begin[index]; }
+    inline STR_VIEW_CONSTEXPR CharT at(size_t index) const { return m_Begin[index]; }
+
+    // Methods below work like the same methods of str_view_template.
+
+    inline STR_VIEW_CONSTEXPR str_view_lite_template<CharT> substr(size_t offset = 0, size_t length = SIZE_MAX) const;
+    inline size_t copy_to(CharT* dst, size_t offset = 0, size_t length = SIZE_MAX) const;
+    inline void to_string(StringT& dst, size_t offset = 0, size_t length = SIZE_MAX) const;
+    inline void append_to(StringT& dst, size_t offset = 0, size_t length = SIZE_MAX) const;
+
+    template<typename CompareT = str_view_cstring_compare>
+    inline STR_VIEW_CONSTEXPR int compare(const str_view_lite_template<CharT>& rhs, bool case_sensitive = true) const;
+    template<typename CompareT = str_view_cstring_compare>
+    inline STR_VIEW_CONSTEXPR bool equals(const str_view_lite_template<CharT>& rhs, bool case_sensitive = true) const;
+
+    inline STR_VIEW_CONSTEXPR bool operator==(const str_view_lite_template<CharT>& rhs) const { return equals(rhs); }
+    inline STR_VIEW_CONSTEXPR bool operator!=(const str_view_lite_template<CharT>& rhs) const { return !equals(rhs); }
+    inline STR_VIEW_CONSTEXPR bool operator< (const str_view_lite_template<CharT>& rhs) const { return compare(rhs) <  0; }
+    inline STR_VIEW_CONSTEXPR bool operator> (const str_view_lite_template<CharT>& rhs) const { return compare(rhs) >  0; }
+    inline STR_VIEW_CONSTEXPR bool operator<=(const str_view_lite_template<CharT>& rhs) const { return compare(rhs) <= 0; }
+    inline STR_VIEW_CONSTEXPR bool operator>=(const str_view_lite_template<CharT>& rhs) const { return compare(rhs) >= 0; }
+
+    inline STR_VIEW_CONSTEXPR bool starts_with(CharT prefix, bool case_sensitive = true) const;
+    template<typename CompareT = str_view_cstring_compare>
+    inline STR_VIEW_CONSTEXPR bool starts_with(const str_view_lite_template<CharT>& prefix, bool case_sensitive = true) const;
+    inline STR_VIEW_CONSTEXPR bool ends_with(CharT suffix, bool case_sensitive = true) const;
+    template<typename CompareT = str_view_cstring_compare>
+    inline STR_VIEW_CONSTEXPR bool ends_with(const str_view_lite_template<CharT>& suffix, bool case_sensitive = true) const;
+
+    inline STR_VIEW_CONSTEXPR size_t find(CharT ch, size_t pos = 0) const;
+    inline STR_VIEW_CONSTEXPR size_t find(const str_view_lite_template<CharT>& substr, size_t pos = 0) const;
+    inline STR_VIEW_CONSTEXPR size_t rfind(CharT ch, size_t pos = SIZE_MAX) const;
+    inline STR_VIEW_CONSTEXPR size_t rfind(const str_view_lite_template<CharT>& substr, size_t pos = SIZE_MAX) const;
+
+    /*
+    Returns hash of the string. Strings that are equal have equal hashes.
+    With case_sensitive = false, strings that are equal according to
+    compare(rhs, false) have equal hashes - ASCII letters are treated as lowercase.
+    All characters are hashed, including those after '\0'. Strings that contain '\0'
+    may be equal with str_view_cstring_compare and still have different hashes.
+    std::hash and str_view_hash_nocase hash only characters before '\0' to match
+    the default traits - see str_view_hash.
+    The same value is returned at compile time and at run time, on every platform.
+    */
+    inline STR_VIEW_CONSTEXPR size_t hash(bool case_sensitive = true) const
+    {
+        return (size_t)(case_sensitive ?
+            str_view_detail::hash_string<false>(m_Begin, m_Length) :
+            str_view_detail::hash_string<true>(m_Begin, m_Length));
+    }
+
+    inline size_t find_first_of(const str_view_lite_template<CharT>& chars, size_t pos = 0) const;
+    inline size_t find_first_of(const char_set_template<CharT>& chars, size_t pos = 0) const;
+    inline size_t find_last_of(const str_view_lite_template<CharT>& chars, size_t pos = SIZE_MAX) const;
+    inline size_t find_last_of(const char_set_template<CharT>& chars, size_t pos = SIZE_MAX) const;
+    inline size_t find_first_not_of(const str_view_lite_template<CharT>& chars, size_t pos = 0) const;
+    inline size_t find_first_not_of(const char_set_template<CharT>& chars, size_t pos = 0) const;
+    inline size_t find_last_not_of(const str_view_lite_template<CharT>& chars, size_t pos = SIZE_MAX) const;
+    inline size_t find_last_not_of(const char_set_template<CharT>& chars, size_t pos = SIZE_MAX) const;
+
+    inline bool is_valid_utf8() const;
+
+    template<typename NumberT>
+    inline bool parse(NumberT& outValue) const;
+    template<typename NumberT>
+    inline size_t parse_prefix(NumberT& outValue, size_t pos = 0) const;
+    inline int64_t to_int(int64_t defaultValue = 0) const { parse(defaultValue); return defaultValue; }
+    inline double to_double(double defaultValue = 0.0) const { parse(defaultValue); return defaultValue; }
+
+    inline str_view_split_range_template<CharT, str_view_detail::split_by_char<CharT>> split(CharT separator) const;
+    inline str_view_split_range_template<CharT, str_view_detail::split_by_substr<CharT>> split(const str_view_lite_template<CharT>& separator) const;
+    inline str_view_split_range_template<CharT, str_view_detail::split_by_set<CharT>> split_any(const str_view_lite_template<CharT>& separators) const;
+    inline str_view_split_range_template<CharT, str_view_detail::split_by_set<CharT>> split_any(const char_set_template<CharT>& separators) const;
+
+    inline size_t count(CharT ch) const { return str_view_detail::count_char(m_Begin, ch, m_Length); }
+    inline size_t count_parallel(CharT ch, const str_view_parallel_options& options = str_view_parallel_options()) const;
+    inline size_t find_parallel(CharT ch, const str_view_parallel_options& options = str_view_parallel_options()) const;
+    inline size_t find_parallel(const str_view_lite_template<CharT>& substr, const str_view_parallel_options& options = str_view_parallel_options()) const;
+    inline size_t find_first_of_parallel(const str_view_lite_template<CharT>& chars, const str_view_parallel_options& options = str_view_parallel_options()) const;
+    inline size_t find_first_of_parallel(const char_set_template<CharT>& chars, const str_view_parallel_options& options = str_view_parallel_options()) const;
+    template<typename Func>
+    inline size_t find_all_parallel(const str_view_lite_template<CharT>& substr, Func func, const str_view_parallel_options& options = str_view_parallel_options()) const;
+
+private:
+    const CharT* m_Begin;
+    size_t m_Length;
+};
+
+typedef str_view_lite_template<char> str_view_lite;
+typedef str_view_lite_template<wchar_t> wstr_view_lite;
+
+/*
+Comparison between str_view_template and str_view_lite_template. Without them,
+C++20 finds both operator== of str_view_template and reversed operator== of
+str_view_lite_template equally good.
+*/
+template<typename CharT>
+inline bool operator==(const str_view_template<CharT>& lhs, const str_view_lite_template<CharT>& rhs) { return lhs.to_lite().equals(rhs); }
+template<typename CharT>
+inline bool operator!=(const str_view_template<CharT>& lhs, const str_view_lite_template<CharT>& rhs) { return !lhs.to_lite().equals(rhs); }
+template<typename CharT>
+inline bool operator==(const str_view_lite_template<CharT>& lhs, const str_view_template<CharT>& rhs) { return lhs.equals(rhs.to_lite()); }
+template<typename CharT>
+inline bool operator!=(const str_view_lite_template<CharT>& lhs, const str_view_template<CharT>& rhs) { return !lhs.equals(rhs.to_lite()); }
+
+#if STR_VIEW_HAS_STD_STRING_VIEW
+/*
+Comparison with std::basic_string_view. Without them, operator== of str_view_template
+and of std::basic_string_view are equally good, as both need one conversion.
+*/
+template<typename CharT>
+inline bool operator==(const str_view_template<CharT>& lhs, std::basic_string_view<CharT> rhs) { return lhs.to_lite().equals(rhs); }
+template<typename CharT>
+inline bool operator!=(const str_view_template<CharT>& lhs, std::basic_string_view<CharT> rhs) { return !lhs.to_lite().equals(rhs); }
+template<typename CharT>
+inline bool operator==(std::basic_string_view<CharT> lhs, const str_view_template<CharT>& rhs) { return rhs.to_lite().equals(lhs); }
+template<typename CharT>
+inline bool operator!=(std::basic_string_view<CharT> lhs, const str_view_template<CharT>& rhs) { return !rhs.to_lite().equals(lhs); }
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR bool operator==(const str_view_lite_template<CharT>& lhs, std::basic_string_view<CharT> rhs) { return lhs.equals(rhs); }
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR bool operator!=(const str_view_lite_template<CharT>& lhs, std::basic_string_view<CharT> rhs) { return !lhs.equals(rhs); }
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR bool operator==(std::basic_string_view<CharT> lhs, const str_view_lite_template<CharT>& rhs) { return rhs.equals(lhs); }
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR bool operator!=(std::basic_string_view<CharT> lhs, const str_view_lite_template<CharT>& rhs) { return !rhs.equals(lhs); }
+#endif
+
+/*
+Appends all given strings to dst, reserving memory for them once, e.g.:
+
+    str_view_append(line, key, ": ", value, "\r\n");
+
+Strings can be anything str_view_lite_template can be created from. When dst has to grow,
+its capacity is at least doubled, so calling it repeatedly to build a long output doesn't
+reallocate every time.
+*/
+template<typename CharT, typename... StringsT>
+inline void str_view_append(std::basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT>>& dst, const StringsT&... strings)
+{
+    // The first, empty view is there so the array isn't empty when no strings are given.
+    const str_view_lite_template<CharT> views[] = { str_view_lite_template<CharT>(), str_view_lite_template<CharT>(strings)... };
+    size_t newLength = dst.length();
+    for(const str_view_lite_template<CharT>& view : views)
+        newLength += view.length();
+    if(newLength > dst.capacity())
+        dst.reserve(std::max(newLength, dst.capacity() * 2));
+    for(const str_view_lite_template<CharT>& view : views)
+        dst.append(view.data(), view.length());
+}
+
+template<typename CharT>
+inline str_view_lite_template<CharT>::str_view_lite_template(const StringT& str, size_t offset, size_t length) :
+    m_Begin(nullptr),
+    m_Length(0)
+{
+    assert(offset <= str.length());
+    m_Length = std::min(length, str.length() - offset);
+    if(m_Length)
+        m_Begin = str.data() + offset;
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR str_view_lite_template<CharT> str_view_lite_template<CharT>::substr(size_t offset, size_t length) const
+{
+    assert(offset <= m_Length);
+    return str_view_lite_template<CharT>(m_Begin + offset, std::min(length, m_Length - offset));
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::copy_to(CharT* dst, size_t offset, size_t length) const
+{
+    const size_t thisLen = this->length();
+    assert(offset <= thisLen);
+    length = std::min(length, thisLen - offset);
+    memcpy(dst, m_Begin + offset, length * sizeof(CharT));
+    return length;
+}
+
+template<typename CharT>
+inline void str_view_lite_template<CharT>::to_string(StringT& dst, size_t offset, size_t length) const
+{
+    const size_t thisLen = this->length();
+    assert(offset <= thisLen);
+    length = std::min(length, thisLen - offset);
+    dst.assign(m_Begin + offset, length);
+}
+
+template<typename CharT>
+inline void str_view_lite_template<CharT>::append_to(StringT& dst, size_t offset, size_t length) const
+{
+    const size_t thisLen = this->length();
+    assert(offset <= thisLen);
+    length = std::min(length, thisLen - offset);
+    dst.append(m_Begin + offset, length);
+}
+
+template<typename CharT>
+template<typename CompareT>
+inline STR_VIEW_CONSTEXPR int str_view_lite_template<CharT>::compare(const str_view_lite_template<CharT>& rhs, bool case_sensitive) const
+{
+    const size_t lhsLen = length();
+    const size_t rhsLen = rhs.length();
+    const size_t minLen = std::min(lhsLen, rhsLen);
+
+    if(minLen > 0)
+    {
+        const int result = CompareT::compare(data(), rhs.data(), minLen, case_sensitive);
+        if(result != 0)
+            return result;
+    }
+
+    if(lhsLen < rhsLen)
+        return -1;
+    if(lhsLen > rhsLen)
+        return 1;
+    return 0;
+}
+
+template<typename CharT>
+template<typename CompareT>
+inline STR_VIEW_CONSTEXPR bool str_view_lite_template<CharT>::equals(const str_view_lite_template<CharT>& rhs, bool case_sensitive) const
+{
+    const size_t thisLen = length();
+    if(thisLen != rhs.length())
+        return false;
+    if(thisLen == 0 || m_Begin == rhs.m_Begin)
+        return true;
+    return CompareT::equal(m_Begin, rhs.m_Begin, thisLen, case_sensitive);
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR bool str_view_lite_template<CharT>::starts_with(CharT prefix, bool case_sensitive) const
+{
+    if(!empty())
+    {
+        if(case_sensitive)
+            return *m_Begin == prefix;
+        return tstrnicmp(m_Begin, &prefix, 1) == 0;
+    }
+    return false;
+}
+
+template<typename CharT>
+template<typename CompareT>
+inline STR_VIEW_CONSTEXPR bool str_view_lite_template<CharT>::starts_with(const str_view_lite_template<CharT>& prefix, bool case_sensitive) const
+{
+    const size_t prefixLen = prefix.length();
+    if(length() >= prefixLen)
+        return prefixLen == 0 || CompareT::equal(m_Begin, prefix.m_Begin, prefixLen, case_sensitive);
+    return false;
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR bool str_view_lite_template<CharT>::ends_with(CharT suffix, bool case_sensitive) const
+{
+    const size_t thisLen = length();
+    if(thisLen > 0)
+    {
+        if(case_sensitive)
+            return m_Begin[thisLen - 1] == suffix;
+        return tstrnicmp(m_Begin + (thisLen - 1), &suffix, 1) == 0;
+    }
+    return false;
+}
+
+template<typename CharT>
+template<typename CompareT>
+inline STR_VIEW_CONSTEXPR bool str_view_lite_template<CharT>::ends_with(const str_view_lite_template<CharT>& suffix, bool case_sensitive) const
+{
+    const size_t thisLen = length();
+    const size_t suffixLen = suffix.length();
+    if(thisLen >= suffixLen)
+        return suffixLen == 0 || CompareT::equal(m_Begin + (thisLen - suffixLen), suffix.m_Begin, suffixLen, case_sensitive);
+    return false;
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR size_t str_view_lite_template<CharT>::find(CharT ch, size_t pos) const
+{
+    const size_t thisLen = length();
+    if(pos >= thisLen)
+        return SIZE_MAX;
+    const CharT* const found = tmemchr(m_Begin + pos, ch, thisLen - pos);
+    return found ? (size_t)(found - m_Begin) : SIZE_MAX;
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR size_t str_view_lite_template<CharT>::find(const str_view_lite_template<CharT>& substr, size_t pos) const
+{
+    const size_t subLen = substr.length();
+    if(subLen == 0)
+        return pos;
+    const size_t thisLen = length();
+    if(thisLen < subLen || pos > thisLen - subLen)
+        return SIZE_MAX;
+    const CharT* const found = STR_VIEW_CONSTEXPR_DISPATCH(
+        str_view_detail::constexpr_find_substr(m_Begin + pos, thisLen - pos, substr.m_Begin, subLen),
+        str_view_detail::find_substr(m_Begin + pos, thisLen - pos, substr.m_Begin, subLen));
+    return found ? (size_t)(found - m_Begin) : SIZE_MAX;
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR size_t str_view_lite_template<CharT>::rfind(CharT ch, size_t pos) const
+{
+    const size_t thisLen = length();
+    if(thisLen == 0)
+        return SIZE_MAX;
+    const CharT* const found = tmemrchr(m_Begin, ch, std::min(pos, thisLen - 1) + 1);
+    return found ? (size_t)(found - m_Begin) : SIZE_MAX;
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR size_t str_view_lite_template<CharT>::rfind(const str_view_lite_template<CharT>& substr, size_t pos) const
+{
+    const size_t subLen = substr.length();
+    if(subLen == 0)
+        return pos;
+    const size_t thisLen = length();
+    if(thisLen < subLen)
+        return SIZE_MAX;
+    const size_t searchLen = std::min(pos, thisLen - subLen) + subLen;
+    const CharT* const found = STR_VIEW_CONSTEXPR_DISPATCH(
+        str_view_detail::constexpr_rfind_substr(m_Begin, searchLen, substr.m_Begin, subLen),
+        str_view_detail::rfind_substr(m_Begin, searchLen, substr.m_Begin, subLen));
+    return found ? (size_t)(found - m_Begin) : SIZE_MAX;
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::find_first_of(const str_view_lite_template<CharT>& chars, size_t pos) const
+{
+    const size_t charsLen = chars.length();
+    if(charsLen <= str_view_detail::SMALL_SET_MAX)
+    {
+        const size_t thisLen = length();
+        if(charsLen == 0 || pos >= thisLen)
+            return SIZE_MAX;
+        const CharT* const found = str_view_detail::find_small_set(m_Begin + pos, thisLen - pos, chars.m_Begin, charsLen, false);
+        return found ? (size_t)(found - m_Begin) : SIZE_MAX;
+    }
+    return find_first_of(char_set_template<CharT>(chars.m_Begin, charsLen), pos);
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::find_first_of(const char_set_template<CharT>& chars, size_t pos) const
+{
+    if(chars.empty())
+        return SIZE_MAX;
+    const size_t thisLen = length();
+    if(pos >= thisLen)
+        return SIZE_MAX;
+    const CharT* const found = str_view_detail::find_in_set(chars, m_Begin + pos, thisLen - pos, false);
+    return found ? (size_t)(found - m_Begin) : SIZE_MAX;
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::find_last_of(const str_view_lite_template<CharT>& chars, size_t pos) const
+{
+    const size_t charsLen = chars.length();
+    if(charsLen <= str_view_detail::SMALL_SET_MAX)
+    {
+        const size_t thisLen = length();
+        if(charsLen == 0 || thisLen == 0)
+            return SIZE_MAX;
+        const CharT* const found = str_view_detail::rfind_small_set(m_Begin, std::min(pos, thisLen - 1) + 1, chars.m_Begin, charsLen, false);
+        return found ? (size_t)(found - m_Begin) : SIZE_MAX;
+    }
+    return find_last_of(char_set_template<CharT>(chars.m_Begin, charsLen), pos);
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::find_last_of(const char_set_template<CharT>& chars, size_t pos) const
+{
+    if(chars.empty())
+        return SIZE_MAX;
+    const size_t thisLen = length();
+    if(thisLen == 0)
+        return SIZE_MAX;
+    const CharT* const found = str_view_detail::rfind_in_set(chars, m_Begin, std::min(pos, thisLen - 1) + 1, false);
+    return found ? (size_t)(found - m_Begin) : SIZE_MAX;
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::find_first_not_of(const str_view_lite_template<CharT>& chars, size_t pos) const
+{
+    const size_t charsLen = chars.length();
+    if(charsLen <= str_view_detail::SMALL_SET_MAX)
+    {
+        const size_t thisLen = length();
+        if(charsLen == 0 || pos >= thisLen)
+            return SIZE_MAX;
+        const CharT* const found = str_view_detail::find_small_set(m_Begin + pos, thisLen - pos, chars.m_Begin, charsLen, true);
+        return found ? (size_t)(found - m_Begin) : SIZE_MAX;
+    }
+    return find_first_not_of(char_set_template<CharT>(chars.m_Begin, charsLen), pos);
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::find_first_not_of(const char_set_template<CharT>& chars, size_t pos) const
+{
+    if(chars.empty())
+        return SIZE_MAX;
+    const size_t thisLen = length();
+    if(pos >= thisLen)
+        return SIZE_MAX;
+    const CharT* const found = str_view_detail::find_in_set(chars, m_Begin + pos, thisLen - pos, true);
+    return found ? (size_t)(found - m_Begin) : SIZE_MAX;
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::find_last_not_of(const str_view_lite_template<CharT>& chars, size_t pos) const
+{
+    const size_t charsLen = chars.length();
+    if(charsLen <= str_view_detail::SMALL_SET_MAX)
+    {
+        const size_t thisLen = length();
+        if(charsLen == 0 || thisLen == 0)
+            return SIZE_MAX;
+        const CharT* const found = str_view_detail::rfind_small_set(m_Begin, std::min(pos, thisLen - 1) + 1, chars.m_Begin, charsLen, true);
+        return found ? (size_t)(found - m_Begin) : SIZE_MAX;
+    }
+    return find_last_not_of(char_set_template<CharT>(chars.m_Begin, charsLen), pos);
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::find_last_not_of(const char_set_template<CharT>& chars, size_t pos) const
+{
+    if(chars.empty())
+        return SIZE_MAX;
+    const size_t thisLen = length();
+    if(thisLen == 0)
+        return SIZE_MAX;
+    const CharT* const found = str_view_detail::rfind_in_set(chars, m_Begin, std::min(pos, thisLen - 1) + 1, true);
+    return found ? (size_t)(found - m_Begin) : SIZE_MAX;
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR str_view_template<CharT>::str_view_template() :
+	m_Length(0),
+	m_Begin(nullptr),
+	m_NullTerminatedPtr(0)
+{
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR str_view_template<CharT>::str_view_template(const CharT* sz) :
+	m_Length(sz ? (STR_VIEW_EAGER_LENGTH ? str_view_detail::counted_tstrlen(sz) : SIZE_MAX) : 0),
+	m_Begin(sz),
+	m_NullTerminatedPtr(sz ? 1 : 0)
+{
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR str_view_template<CharT>::str_view_template(const CharT* str, size_t length) :
+	m_Length(length),
+	m_Begin(length ? str : nullptr),
+	m_NullTerminatedPtr(0)
+{
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR str_view_template<CharT>::str_view_template(const CharT* str, size_t length, StillNullTerminated) :
+	m_Length(length),
+	m_Begin(length ? str : nullptr),
+	m_NullTerminatedPtr(length ? 1 : 0)
+{
+    assert(length == 0 || str[length] == (CharT)0); // Make sure it's really null terminated.
+}
+
+template<typename CharT>
+inline str_view_template<CharT>::str_view_template(const StringT& str, size_t offset, size_t length) :
+	m_Length(0),
+	m_Begin(nullptr),
+	m_NullTerminatedPtr(0)
+{
+	assert(offset <= str.length());
+    const size_t len = std::min(length, str.length() - offset);
+    m_Length.store(len, std::memory_order_relaxed);
+    if(len)
+    {
+        if(len == str.length() - offset)
+        {
+            m_Begin = str.c_str() + offset;
+            m_NullTerminatedPtr.store(1, std::memory_order_relaxed);
+        }
+        else
+            m_Begin = str.data() + offset;
+    }
+}
+
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR str_view_template<CharT>::str_view_template(const str_view_lite_template<CharT>& src) :
+	m_Length(src.length()),
+	m_Begin(src.data()),
+	m_NullTerminatedPtr(0)
+{
+}
+
+#if STR_VIEW_HAS_STD_STRING_VIEW
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR str_view_template<CharT>::str_view_template(const StringViewT& src) :
+	m_Length(src.length()),
+	m_Begin(src.length() ? src.data() : nullptr),
+	m_NullTerminatedPtr(0)
+{
+}
+#endif
+
+template<typename CharT>
+inline str_view_template<CharT>::str_view_template(const str_view_template<CharT>& src, size_t offset, size_t length) :
+	m_Length(0),
+	m_Begin(nullptr),
+	m_NullTerminatedPtr(0)
+{
+    STR_VIEW_STATS_ADD(STATS_COPY_CONSTRUCTIONS, 1);
+    // Source length is unknown, constructor doesn't limit the length - it may remain unknown.
+    if(!STR_VIEW_EAGER_LENGTH && src.m_Length.load(std::memory_order_relaxed) == SIZE_MAX && length == SIZE_MAX)
+    {
+        m_Length.store(SIZE_MAX, std::memory_order_relaxed);
+        m_Begin = src.m_Begin + offset;
+        assert(src.m_NullTerminatedPtr.load(std::memory_order_relaxed) == 1);
+        m_NullTerminatedPtr.store(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        const size_t srcLen = src.length();
+	    assert(offset <= srcLen);
+        const size_t len = std::min(length, srcLen - offset);
+        m_Length.store(len, std::memory_order_relaxed);
+        if(len)
+        {
+            m_Begin = src.m_Begin + offset;
+            if(src.m_NullTerminatedPtr.load(std::memory_order_relaxed) == 1 && len == srcLen - offset)
+                m_NullTerminatedPtr.store(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+template<typename CharT>
+inline str_view_template<CharT>::str_view_template(str_view_template<CharT>&& src) :
+	m_Length(src.m_Length.exchange(0, std::memory_order_relaxed)),
+	m_Begin(src.m_Begin),
+	m_NullTerminatedPtr(transferable_copy(src.m_NullTerminatedPtr.exchange(0, std::memory_order_relaxed)))
+{
+    STR_VIEW_STATS_ADD(STATS_MOVE_CONSTRUCTIONS, 1);
+	src.m_Begin = nullptr;
+}
+
+template<typename CharT>
+inline str_view_template<CharT>::~str_view_template()
+{
+    free_copy(m_NullTerminatedPtr.load(std::memory_order_relaxed));
+}
+
+template<typename CharT>
+inline str_view_template<CharT>& str_view_template<CharT>::operator=(const str_view_template<CharT>& src)
+{
+	if(&src != this)
+    {
+        free_copy(m_NullTerminatedPtr.load(std::memory_order_relaxed));
+		m_Begin = src.m_Begin;
+		m_Length.store(src.m_Length.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		m_NullTerminatedPtr.store(src.m_NullTerminatedPtr.load(std::memory_order_relaxed) == 1 ? 1 : 0, std::memory_order_relaxed);
+    }
+	return *this;
+}
+
+template<typename CharT>
+inline str_view_template<CharT>& str_view_template<CharT>::operator=(str_view_template<CharT>&& src)
+{
+	if(&src != this)
+    {
+        free_copy(m_NullTerminatedPtr.load(std::memory_order_relaxed));
+		m_Begin = src.m_Begin;
+		m_Length.store(src.m_Length.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+		m_NullTerminatedPtr.store(transferable_copy(src.m_NullTerminatedPtr.exchange(0, std::memory_order_relaxed)), std::memory_order_relaxed);
+		src.m_Begin = nullptr;
+    }
+	return *this;
+}
+
+template<typename CharT>
+inline void str_view_template<CharT>::swap(str_view_template<CharT>& rhs) noexcept
+{
+    const size_t rhsLength = rhs.m_Length.load(std::memory_order_relaxed);
+    const size_t lhsLength = m_Length.exchange(rhsLength, std::memory_order_relaxed);
+    rhs.m_Length.store(lhsLength, std::memory_order_relaxed);
+
+    std::swap(m_Begin, rhs.m_Begin);
+
+    // Inline copies belong to their objects, so they are dropped rather than swapped.
+    const uintptr_t rhsNullTerminatedPtr = rhs.m_NullTerminatedPtr.load(std::memory_order_relaxed);
+    const uintptr_t lhsNullTerminatedPtr = m_NullTerminatedPtr.exchange(transferable_copy(rhsNullTerminatedPtr), std::memory_order_relaxed);
+    rhs.m_NullTerminatedPtr.store(transferable_copy(lhsNullTerminatedPtr), std::memory_order_relaxed);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::length() const
+{
+#if STR_VIEW_EAGER_LENGTH
+    return m_Length;
+#else
+    size_t len = m_Length.load(std::memory_order_relaxed);
+    if(len == SIZE_MAX)
+    {
+        assert(m_NullTerminatedPtr.load(std::memory_order_relaxed) == 1);
+        len = str_view_detail::counted_tstrlen(m_Begin);
+        // It doesn't matter if other thread does it at the same time.
+        // It will atomically set it to the same value.
+        m_Length.store(len, std::memory_order_relaxed);
+    }
+    return len;
+#endif
+}
+
+template<typename CharT>
+inline bool str_view_template<CharT>::empty() const
+{
+    const size_t len = m_Length.load(std::memory_order_relaxed);
+    if(!STR_VIEW_EAGER_LENGTH && len == SIZE_MAX)
+    {
+        // Length is unknown. String is null-terminated.
+        // We still don't need to know the length. We just peek first character.
+        assert(m_NullTerminatedPtr.load(std::memory_order_relaxed) == 1);
+        return m_Begin == nullptr || *m_Begin == (CharT)0;
+    }
+    return len == 0;
+}
+
+template<typename CharT>
+inline const CharT* str_view_template<CharT>::c_str() const
+{
+    static const CharT nullChar = (CharT)0;
+	if(empty())
+		return &nullChar;
+    // Acquire, so that characters of a copy made by other thread are visible.
+    uintptr_t v = m_NullTerminatedPtr.load(std::memory_order_acquire);
+	if(v == 1)
+    {
+        //assert(m_Begin[length()] == (CharT)0); // Make sure it's really null terminated.
+		return m_Begin;
+    }
+	if(v == 0)
+    {
+        // Not null terminated, so length must be known.
+        const size_t len = m_Length.load(std::memory_order_relaxed);
+        assert(len != SIZE_MAX);
+        CharT* nullTerminatedCopy = str_view_detail::allocate_null_terminated_copy(m_Begin, len);
+
+        // Release publishes the copy. Acquire on failure makes the winner's copy visible.
+        uintptr_t expected = 0;
+        if(m_NullTerminatedPtr.compare_exchange_strong(expected, (uintptr_t)nullTerminatedCopy,
+            std::memory_order_acq_rel, std::memory_order_acquire))
+            return nullTerminatedCopy;
+        // Other thread was quicker to set his copy to m_NullTerminatedPtr. Destroy mine, use that one.
+        STR_VIEW_STATS_ADD(STATS_LOST_COPY_RACES, 1);
+        str_view_detail::free_null_terminated_copy(nullTerminatedCopy);
+        v = expected;
+    }
+    // Other thread is writing inline copy. It takes only a moment.
+    while(v == COPY_BUSY)
+    {
+        std::this_thread::yield();
+        v = m_NullTerminatedPtr.load(std::memory_order_acquire);
+    }
+	return (const CharT*)(v & ~(uintptr_t)INLINE_COPY_BIT);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::copy_to(CharT* dst, size_t offset, size_t length) const
+{
+    return to_lite().copy_to(dst, offset, length);
+}
+
+template<typename CharT>
+inline void str_view_template<CharT>::to_string(StringT& dst, size_t offset, size_t length) const
+{
+    to_lite().to_string(dst, offset, length);
+}
+
+template<typename CharT>
+inline void str_view_template<CharT>::append_to(StringT& dst, size_t offset, size_t length) const
+{
+    to_lite().append_to(dst, offset, length);
+}
+
+template<typename CharT>
+inline str_view_template<CharT> str_view_template<CharT>::substr(size_t offset, size_t length) const
+{
+    // Length can remain unknown.
+    if(!STR_VIEW_EAGER_LENGTH && m_Length.load(std::memory_order_relaxed) == SIZE_MAX && length == SIZE_MAX)
+    {
+        assert(m_NullTerminatedPtr.load(std::memory_order_relaxed) == 1);
+        return str_view_template<CharT>(m_Begin + offset);
+    }
+
+    const size_t thisLen = this->length();
+    assert(offset <= thisLen);
+	length = std::min(length, thisLen - offset);
+	// Result will be null-terminated.
+	if(m_NullTerminatedPtr.load(std::memory_order_relaxed) == 1 && length == thisLen - offset)
+		return str_view_template<CharT>(m_Begin + offset, length, StillNullTerminated());
+	// Result will not be null-terminated.
+	return str_view_template<CharT>(m_Begin + offset, length);
+}
+
+template<typename CharT>
+template<typename CompareT>
+inline int str_view_template<CharT>::compare(const str_view_template<CharT>& rhs, bool case_sensitive) const
+{
+    return to_lite().template compare<CompareT>(rhs.to_lite(), case_sensitive);
+}
+
+template<typename CharT>
+template<typename CompareT>
+inline bool str_view_template<CharT>::equals(const str_view_template<CharT>& rhs, bool case_sensitive) const
+{
+    return to_lite().template equals<CompareT>(rhs.to_lite(), case_sensitive);
+}
+
+template<typename CharT>
+inline bool str_view_template<CharT>::starts_with(CharT prefix, bool case_sensitive) const
+{
+    if(!empty())
+    {
+        if(case_sensitive)
+            return *m_Begin == prefix;
+        return tstrnicmp(m_Begin, &prefix, 1) == 0;
+    }
+    return false;
+}
+
+template<typename CharT>
+template<typename CompareT>
+inline bool str_view_template<CharT>::starts_with(const str_view_template<CharT>& prefix, bool case_sensitive) const
+{
+    return to_lite().template starts_with<CompareT>(prefix.to_lite(), case_sensitive);
+}
+
+template<typename CharT>
+inline bool str_view_template<CharT>::ends_with(CharT suffix, bool case_sensitive) const
+{
+    return to_lite().ends_with(suffix, case_sensitive);
+}
+
+template<typename CharT>
+template<typename CompareT>
+inline bool str_view_template<CharT>::ends_with(const str_view_template<CharT>& suffix, bool case_sensitive) const
+{
+    return to_lite().template ends_with<CompareT>(suffix.to_lite(), case_sensitive);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find(CharT ch, size_t pos) const
+{
+    return to_lite().find(ch, pos);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find(const str_view_template<CharT>& substr, size_t pos) const
+{
+    return to_lite().find(substr.to_lite(), pos);
+}
+
+template<typename CharT>
+inline bool str_view_template<CharT>::rfind_lazy(const str_view_detail::small_set_pred<CharT>& pred, size_t& outPos) const
+{
+#if STR_VIEW_EAGER_LENGTH
+    (void)pred;
+    (void)outPos;
+    return false;
+#else
+    if(m_Length.load(std::memory_order_relaxed) != SIZE_MAX)
+        return false;
+    assert(m_NullTerminatedPtr.load(std::memory_order_relaxed) == 1);
+    STR_VIEW_STATS_ADD(STATS_LAZY_LENGTHS, 1);
+    size_t len;
+    const CharT* const found = str_view_detail::strlen_rfind_small_set(m_Begin, pred, len);
+    m_Length.store(len, std::memory_order_relaxed);
+    outPos = found ? (size_t)(found - m_Begin) : SIZE_MAX;
+    return true;
+#endif
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::rfind(CharT ch, size_t pos) const
+{
+    // Last occurrence in the whole string is also the result if it's not after pos.
+    size_t last;
+    if(rfind_lazy(str_view_detail::make_small_set_pred(&ch, 1, false), last) && (last == SIZE_MAX || last <= pos))
+        return last;
+    return to_lite().rfind(ch, pos);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::rfind(const str_view_template<CharT>& substr, size_t pos) const
+{
+    return to_lite().rfind(substr.to_lite(), pos);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find_first_of(const str_view_template<CharT>& chars, size_t pos) const
+{
+    return to_lite().find_first_of(chars.to_lite(), pos);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find_first_of(const char_set_template<CharT>& chars, size_t pos) const
+{
+    return to_lite().find_first_of(chars, pos);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find_last_of(const str_view_template<CharT>& chars, size_t pos) const
+{
+    const size_t charsLen = chars.length();
+    size_t last;
+    if(charsLen >= 1 && charsLen <= str_view_detail::SMALL_SET_MAX &&
+        rfind_lazy(str_view_detail::make_small_set_pred(chars.data(), charsLen, false), last) &&
+        (last == SIZE_MAX || last <= pos))
+        return last;
+    return to_lite().find_last_of(chars.to_lite(), pos);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find_last_of(const char_set_template<CharT>& chars, size_t pos) const
+{
+    return to_lite().find_last_of(chars, pos);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find_first_not_of(const str_view_template<CharT>& chars, size_t pos) const
+{
+    return to_lite().find_first_not_of(chars.to_lite(), pos);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find_first_not_of(const char_set_template<CharT>& chars, size_t pos) const
+{
+    return to_lite().find_first_not_of(chars, pos);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find_last_not_of(const str_view_template<CharT>& chars, size_t pos) const
+{
+    const size_t charsLen = chars.length();
+    size_t last;
+    if(charsLen >= 1 && charsLen <= str_view_detail::SMALL_SET_MAX &&
+        rfind_lazy(str_view_detail::make_small_set_pred(chars.data(), charsLen, true), last) &&
+        (last == SIZE_MAX || last <= pos))
+        return last;
+    return to_lite().find_last_not_of(chars.to_lite(), pos);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find_last_not_of(const char_set_template<CharT>& chars, size_t pos) const
+{
+    return to_lite().find_last_not_of(chars, pos);
+}
+
+template<typename CharT>
+inline void swap(str_view_template<CharT>& lhs, str_view_template<CharT>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+/*
+User-defined literals. Bring them into scope with:
+
+    using namespace str_view_literals;
+
+"abc"_sv creates str_view_template with known length that is null-terminated,
+so neither length() nor c_str() has to do any work.
+
+"abc"_svl creates str_view_lite_template, which can be used in constant expressions,
+including compare(), find() and hash().
+*/
+namespace str_view_literals
+{
+
+inline str_view operator""_sv(const char* str, size_t length)
+{
+    return str_view(str, length, str_view::StillNullTerminated());
+}
+inline wstr_view operator""_sv(const wchar_t* str, size_t length)
+{
+    return wstr_view(str, length, wstr_view::StillNullTerminated());
+}
+
+inline STR_VIEW_CONSTEXPR str_view_lite operator""_svl(const char* str, size_t length)
+{
+    return str_view_lite(str, length);
+}
+inline STR_VIEW_CONSTEXPR wstr_view_lite operator""_svl(const wchar_t* str, size_t length)
+{
+    return wstr_view_lite(str, length);
+}
+
+} // namespace str_view_literals
+
+namespace str_view_detail
+{
+
+// Hash of the characters compared by CompareT.
+template<typename CompareT, typename CharT>
+inline size_t hash_view(const str_view_lite_template<CharT>& v, bool caseSensitive)
+{
+    return str_view_lite_template<CharT>(v.data(), CompareT::hashed_length(v.data(), v.length())).hash(caseSensitive);
+}
+template<typename CompareT, typename CharT>
+inline size_t hash_view(const str_view_template<CharT>& v, bool caseSensitive)
+{
+    return hash_view<CompareT>(v.to_lite(), caseSensitive);
+}
+
+} // namespace str_view_detail
+
+/*
+Hash function object matching str_view_equal_to<CompareT>: it hashes only the characters
+that CompareT compares. With the default str_view_cstring_compare, those are characters
+before the first '\0', so "A\0B" and "A\0C" have equal hashes, as they are equal.
+std::hash of str_view_template and str_view_lite_template is the same. For views of
+binary data, use:
+
+    std::unordered_map<str_view_lite, int, str_view_hash<str_view_binary_compare>, str_view_equal_to<str_view_binary_compare>>
+
+For strings without '\0' it returns the same value as hash().
+*/
+template<typename CompareT = str_view_cstring_compare>
+struct str_view_hash
+{
+    template<typename ViewT>
+    inline size_t operator()(const ViewT& v) const { return str_view_detail::hash_view<CompareT>(v, true); }
+};
+
+/*
+Function objects for case-insensitive hash containers, e.g.:
+
+    std::unordered_map<str_view, int, str_view_hash_nocase, str_view_equal_nocase>
+
+They accept str_view_template and str_view_lite_template. Like the default traits,
+they ignore characters after '\0'.
+*/
+struct str_view_hash_nocase
+{
+    template<typename ViewT>
+    inline size_t operator()(const ViewT& v) const { return str_view_detail::hash_view<str_view_cstring_compare>(v, false); }
+};
+struct str_view_equal_nocase
+{
+    template<typename ViewT>
+    inline bool operator()(const ViewT& lhs, const ViewT& rhs) const { return lhs.equals(rhs, false); }
+};
+
+/*
+Function objects for ordered and hash containers that use the given comparison traits, e.g.
+for views of binary data:
+
+    std::map<str_view_lite, int, str_view_less<str_view_binary_compare>>
+    std::unordered_map<str_view_lite, int, str_view_hash<str_view_binary_compare>, str_view_equal_to<str_view_binary_compare>>
+*/
+template<typename CompareT = str_view_cstring_compare>
+struct str_view_less
+{
+    template<typename ViewT>
+    inline bool operator()(const ViewT& lhs, const ViewT& rhs) const { return lhs.template compare<CompareT>(rhs) < 0; }
+};
+template<typename CompareT = str_view_cstring_compare>
+struct str_view_equal_to
+{
+    template<typename ViewT>
+    inline bool operator()(const ViewT& lhs, const ViewT& rhs) const { return lhs.template equals<CompareT>(rhs); }
+};
+
+namespace std
+{
+
+template<typename CharT>
+struct hash<str_view_template<CharT>>
+{
+    inline size_t operator()(const str_view_template<CharT>& v) const { return str_view_hash<>()(v); }
+};
+
+template<typename CharT>
+struct hash<str_view_lite_template<CharT>>
+{
+    inline size_t operator()(const str_view_lite_template<CharT>& v) const { return str_view_hash<>()(v); }
+};
+
+} // namespace std
+
+/*
+Range of parts of a string, returned by split() and split_any() of str_view_template
+and str_view_lite_template. Parts are found when the iterator is incremented, using
+the same vectorized search as find() and find_first_of(), so nothing is allocated
+and splitting can stop early.
+
+    for(str_view_lite field : line.split(','))
+        ...
+
+It is a forward range. Iterators don't refer to the range object, so with C++20 it is
+also a borrowed view usable with std::ranges algorithms and std::views adaptors.
+*/
+template<typename CharT, typename SeparatorT>
+class str_view_split_range_template
+{
+public:
+    class iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef str_view_lite_template<CharT> value_type;
+        typedef ptrdiff_t difference_type;
+        typedef void pointer;
+        typedef str_view_lite_template<CharT> reference;
+
+        // Initializes iterator equal to end().
+        inline iterator() : m_Part(nullptr), m_PartEnd(nullptr), m_End(nullptr), m_Separator(), m_AtEnd(true) { }
+
+        inline str_view_lite_template<CharT> operator*() const { return str_view_lite_template<CharT>(m_Part, (size_t)(m_PartEnd - m_Part)); }
+        inline iterator& operator++();
+        inline iterator operator++(int) { iterator result = *this; ++*this; return result; }
+
+        inline bool operator==(const iterator& rhs) const { return m_AtEnd == rhs.m_AtEnd && (m_AtEnd || m_Part == rhs.m_Part); }
+        inline bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+
+    private:
+        const CharT* m_Part;
+        const CharT* m_PartEnd;
+        const CharT* m_End;
+        SeparatorT m_Separator;
+        bool m_AtEnd;
+
+        inline iterator(const CharT* str, size_t length, const SeparatorT& separator);
+        // Sets m_PartEnd to the next separator or the end of the string.
+        inline void find_part_end();
+
+        friend class str_view_split_range_template<CharT, SeparatorT>;
+    };
+    typedef iterator const_iterator;
+
+    // Initializes to a range with no parts.
+    inline str_view_split_range_template() : m_Str(), m_Separator(), m_Empty(true) { }
+    inline str_view_split_range_template(const str_view_lite_template<CharT>& str, const SeparatorT& separator) :
+        m_Str(str), m_Separator(separator), m_Empty(false) { }
+
+    inline iterator begin() const { return m_Empty ? iterator() : iterator(m_Str.data(), m_Str.length(), m_Separator); }
+    inline iterator end() const { return iterator(); }
+
+private:
+    str_view_lite_template<CharT> m_Str;
+    SeparatorT m_Separator;
+    bool m_Empty;
+};
+
+#ifdef __cpp_lib_ranges
+namespace std { namespace ranges {
+template<typename CharT, typename SeparatorT>
+inline constexpr bool enable_borrowed_range<str_view_split_range_template<CharT, SeparatorT>> = true;
+template<typename CharT, typename SeparatorT>
+inline constexpr bool enable_view<str_view_split_range_template<CharT, SeparatorT>> = true;
+} } // namespace std::ranges
+#endif
+
+template<typename CharT, typename SeparatorT>
+inline str_view_split_range_template<CharT, SeparatorT>::iterator::iterator(const CharT* str, size_t length, const SeparatorT& separator) :
+    m_Part(str),
+    m_PartEnd(str),
+    m_End(str + length),
+    m_Separator(separator),
+    m_AtEnd(false)
+{
+    find_part_end();
+}
+
+template<typename CharT, typename SeparatorT>
+inline typename str_view_split_range_template<CharT, SeparatorT>::iterator& str_view_split_range_template<CharT, SeparatorT>::iterator::operator++()
+{
+    assert(!m_AtEnd);
+    if(m_PartEnd == m_End)
+        *this = iterator();
+    else
+    {
+        m_Part = m_PartEnd + m_Separator.separator_length();
+        find_part_end();
+    }
+    return *this;
+}
+
+template<typename CharT, typename SeparatorT>
+inline void str_view_split_range_template<CharT, SeparatorT>::iterator::find_part_end()
+{
+    const size_t remaining = (size_t)(m_End - m_Part);
+    const CharT* const found = remaining ? m_Separator.find(m_Part, remaining) : nullptr;
+    m_PartEnd = found ? found : m_End;
+}
+
+template<typename CharT>
+inline str_view_split_range_template<CharT, str_view_detail::split_by_char<CharT>> str_view_lite_template<CharT>::split(CharT separator) const
+{
+    const str_view_detail::split_by_char<CharT> policy = { separator };
+    return str_view_split_range_template<CharT, str_view_detail::split_by_char<CharT>>(*this, policy);
+}
+
+template<typename CharT>
+inline str_view_split_range_template<CharT, str_view_detail::split_by_substr<CharT>> str_view_lite_template<CharT>::split(const str_view_lite_template<CharT>& separator) const
+{
+    assert(!separator.empty());
+    const str_view_detail::split_by_substr<CharT> policy = { separator.data(), separator.length() };
+    return str_view_split_range_template<CharT, str_view_detail::split_by_substr<CharT>>(*this, policy);
+}
+
+template<typename CharT>
+inline str_view_split_range_template<CharT, str_view_detail::split_by_set<CharT>> str_view_lite_template<CharT>::split_any(const str_view_lite_template<CharT>& separators) const
+{
+    return split_any(char_set_template<CharT>(separators.data(), separators.length()));
+}
+
+template<typename CharT>
+inline str_view_split_range_template<CharT, str_view_detail::split_by_set<CharT>> str_view_lite_template<CharT>::split_any(const char_set_template<CharT>& separators) const
+{
+    const str_view_detail::split_by_set<CharT> policy = { separators };
+    return str_view_split_range_template<CharT, str_view_detail::split_by_set<CharT>>(*this, policy);
+}
+
+template<typename CharT>
+inline str_view_split_range_template<CharT, str_view_detail::split_by_char<CharT>> str_view_template<CharT>::split(CharT separator) const
+{
+    return to_lite().split(separator);
+}
+
+template<typename CharT>
+inline str_view_split_range_template<CharT, str_view_detail::split_by_substr<CharT>> str_view_template<CharT>::split(const str_view_template<CharT>& separator) const
+{
+    return to_lite().split(separator.to_lite());
+}
+
+template<typename CharT>
+inline str_view_split_range_template<CharT, str_view_detail::split_by_set<CharT>> str_view_template<CharT>::split_any(const str_view_template<CharT>& separators) const
+{
+    return to_lite().split_any(separators.to_lite());
+}
+
+template<typename CharT>
+inline str_view_split_range_template<CharT, str_view_detail::split_by_set<CharT>> str_view_template<CharT>::split_any(const char_set_template<CharT>& separators) const
+{
+    return to_lite().split_any(separators);
+}
+
+/*
+Searches for a substring that is known in advance, many times.
+
+Preprocessing of the needle is made once, in the constructor, and reused by every
+search. Use it instead of str_view_template::find() when the same needle is looked up
+in many strings.
+
+The object refers to characters of the needle, so the string pointed by the needle
+must remain alive and unchanged as long as the searcher is used.
+
+It can also be passed to std::search (C++17), like std::boyer_moore_searcher.
+*/
+template<typename CharT>
+class str_view_searcher_template
+{
+public:
+    /*
+    Initializes searcher for the given needle.
+    Empty needle is acceptable. It is found at every position.
+    */
+    inline str_view_searcher_template(const str_view_template<CharT>& needle);
+
+    // Returns the number of characters in the needle.
+    inline size_t length() const { return m_NeedleLength; }
+
+    /*
+    Finds the first occurrence of the needle in haystack.
+    Works like haystack.find(needle, pos).
+    */
+    inline size_t find_in(const str_view_template<CharT>& haystack, size_t pos = 0) const;
+    /*
+    Finds the last occurrence of the needle in haystack.
+    Works like haystack.rfind(needle, pos).
+    */
+    inline size_t rfind_in(const str_view_template<CharT>& haystack, size_t pos = SIZE_MAX) const;
+
+    /*
+    Calls func(size_t pos) for every occurrence of the needle in haystack, in order.
+    Occurrences may overlap - "aa" is found in "aaa" at positions 0 and 1.
+    Returns number of occurrences found.
+    */
+    template<typename Func>
+    inline size_t find_all(const str_view_template<CharT>& haystack, Func func) const;
+
+    /*
+    Interface of searchers used by std::search.
+    IterT must be a contiguous iterator over CharT, like a pointer or iterator of std::basic_string or std::vector.
+    Returns range of the first occurrence, or pair (last, last) if not found.
+    */
+    template<typename IterT>
+    inline std::pair<IterT, IterT> operator()(IterT first, IterT last) const;
+
+private:
+    const CharT* m_Needle;
+    size_t m_NeedleLength;
+    // Used only for needles longer than str_view_detail::SHORT_NEEDLE_MAX.
+    str_view_detail::two_way_params m_ForwardParams;
+    str_view_detail::two_way_params m_BackwardParams;
+
+    // Returns pointer to the first occurrence of non-empty needle, or null.
+    inline const CharT* search(const CharT* haystack, size_t haystackLen) const;
+};
+
+typedef str_view_searcher_template<char> str_view_searcher;
+typedef str_view_searcher_template<wchar_t> wstr_view_searcher;
+
+template<typename CharT>
+inline str_view_searcher_template<CharT>::str_view_searcher_template(const str_view_template<CharT>& needle) :
+    m_Needle(needle.data()),
+    m_NeedleLength(needle.length()),
+    m_ForwardParams(),
+    m_BackwardParams()
+{
+    if(m_NeedleLength > str_view_detail::SHORT_NEEDLE_MAX)
+    {
+        m_ForwardParams = str_view_detail::prepare_long_substr(m_Needle, m_NeedleLength);
+        m_BackwardParams = str_view_detail::prepare_long_rsubstr(m_Needle, m_NeedleLength);
+    }
+}
+
+template<typename CharT>
+inline const CharT* str_view_searcher_template<CharT>::search(const CharT* haystack, size_t haystackLen) const
+{
+    if(haystackLen < m_NeedleLength)
+        return nullptr;
+    if(m_NeedleLength == 1)
+        return tmemchr(haystack, m_Needle[0], haystackLen);
+    if(m_NeedleLength <= str_view_detail::SHORT_NEEDLE_MAX)
+        return str_view_detail::find_short_substr(haystack, haystackLen, m_Needle, m_NeedleLength);
+    return str_view_detail::find_long_substr(m_ForwardParams, haystack, haystackLen, m_Needle, m_NeedleLength);
+}
+
+template<typename CharT>
+inline size_t str_view_searcher_template<CharT>::find_in(const str_view_template<CharT>& haystack, size_t pos) const
+{
+    if(m_NeedleLength == 0)
+        return pos;
+    const size_t haystackLen = haystack.length();
+    if(haystackLen < m_NeedleLength || pos > haystackLen - m_NeedleLength)
+        return SIZE_MAX;
+    const CharT* const found = search(haystack.data() + pos, haystackLen - pos);
+    return found ? (size_t)(found - haystack.data()) : SIZE_MAX;
+}
+
+template<typename CharT>
+inline size_t str_view_searcher_template<CharT>::rfind_in(const str_view_template<CharT>& haystack, size_t pos) const
+{
+    if(m_NeedleLength == 0)
+        return pos;
+    const size_t haystackLen = haystack.length();
+    if(haystackLen < m_NeedleLength)
+        return SIZE_MAX;
+    const size_t searchLen = std::min(pos, haystackLen - m_NeedleLength) + m_NeedleLength;
+    const CharT* found;
+    if(m_NeedleLength == 1)
+        found = tmemrchr(haystack.data(), m_Needle[0], searchLen);
+    else if(m_NeedleLength <= str_view_detail::SHORT_NEEDLE_MAX)
+        found = str_view_detail::rfind_short_substr(haystack.data(), searchLen, m_Needle, m_NeedleLength);
+    else
+        found = str_view_detail::rfind_long_substr(m_BackwardParams, haystack.data(), searchLen, m_Needle, m_NeedleLength);
+    return found ? (size_t)(found - haystack.data()) : SIZE_MAX;
+}
+
+template<typename CharT>
+template<typename Func>
+inline size_t str_view_searcher_template<CharT>::find_all(const str_view_template<CharT>& haystack, Func func) const
+{
+    const size_t haystackLen = haystack.length();
+    size_t count = 0;
+    if(m_NeedleLength == 0)
+    {
+        for(size_t pos = 0; pos <= haystackLen; ++pos, ++count)
+            func(pos);
+        return count;
+    }
+    const CharT* const haystackBegin = haystack.data();
+    if(m_NeedleLength > str_view_detail::SHORT_NEEDLE_MAX)
+    {
+        // Continues after every occurrence, without starting a new search.
+        auto callback = [&](size_t pos) { func(pos); ++count; return true; };
+        str_view_detail::find_all_long_substr(m_ForwardParams, haystackBegin, haystackLen, m_Needle, m_NeedleLength, callback);
+        return count;
+    }
+    const CharT* const haystackEnd = haystackBegin + haystackLen;
+    for(const CharT* p = haystackBegin; ; ++p, ++count)
+    {
+        p = search(p, (size_t)(haystackEnd - p));
+        if(p == nullptr)
+            break;
+        func((size_t)(p - haystackBegin));
+    }
+    return count;
+}
+
+template<typename CharT>
+template<typename IterT>
+inline std::pair<IterT, IterT> str_view_searcher_template<CharT>::operator()(IterT first, IterT last) const
+{
+    if(m_NeedleLength == 0)
+        return std::make_pair(first, first);
+    if(first == last)
+        return std::make_pair(last, last);
+    const CharT* const haystack = &*first;
+    const CharT* const found = search(haystack, (size_t)(last - first));
+    if(found == nullptr)
+        return std::make_pair(last, last);
+    const IterT foundIter = first + (found - haystack);
+    return std::make_pair(foundIter, foundIter + m_NeedleLength);
+}
+
+namespace str_view_detail
+{
+
+/*
+Divides [0, length) into chunks of options.chunkLength and calls
+chunkTask(chunkIndex, begin, end) for each of them, on options.executor.
+If there is only one chunk, it's processed on the calling thread.
+*/
+template<typename ChunkTask>
+inline void run_chunks(size_t length, const str_view_parallel_options& options, const ChunkTask& chunkTask)
+{
+    const size_t chunkLength = std::max<size_t>(options.chunkLength, 1);
+    const size_t chunkCount = length / chunkLength + (length % chunkLength ? 1 : 0);
+    if(chunkCount <= 1)
+    {
+        chunkTask(0, 0, length);
+        return;
+    }
+    const std::function<void(size_t)> task = [&](size_t index) {
+        const size_t begin = index * chunkLength;
+        chunkTask(index, begin, std::min(length - begin, chunkLength) + begin);
+    };
+    if(options.executor)
+        options.executor->run(chunkCount, task);
+    else
+        str_view_thread_executor().run(chunkCount, task);
+}
+
+// Lowers value of result to pos if it's greater.
+inline void atomic_min(std::atomic<size_t>& result, size_t pos)
+{
+    size_t current = result.load(std::memory_order_relaxed);
+    while(pos < current && !result.compare_exchange_weak(current, pos, std::memory_order_relaxed))
+    {
+    }
+}
+
+} // namespace str_view_detail
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::count_parallel(CharT ch, const str_view_parallel_options& options) const
+{
+    std::atomic<size_t> result(0);
+    str_view_detail::run_chunks(m_Length, options, [&](size_t, size_t begin, size_t end) {
+        result.fetch_add(str_view_detail::count_char(m_Begin + begin, ch, end - begin), std::memory_order_relaxed);
+    });
+    return result.load();
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::find_parallel(CharT ch, const str_view_parallel_options& options) const
+{
+    std::atomic<size_t> result(SIZE_MAX);
+    str_view_detail::run_chunks(m_Length, options, [&](size_t, size_t begin, size_t end) {
+        if(begin > result.load(std::memory_order_relaxed))
+            return;
+        const CharT* const found = tmemchr(m_Begin + begin, ch, end - begin);
+        if(found)
+            str_view_detail::atomic_min(result, (size_t)(found - m_Begin));
+    });
+    return result.load();
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::find_parallel(const str_view_lite_template<CharT>& substr, const str_view_parallel_options& options) const
+{
+    const size_t subLen = substr.length();
+    if(subLen == 0)
+        return 0;
+    if(subLen > m_Length)
+        return SIZE_MAX;
+    const str_view_searcher_template<CharT> searcher(substr);
+    std::atomic<size_t> result(SIZE_MAX);
+    // Chunks divide starting positions. Occurrence starting in the chunk may extend subLen - 1 characters past its end.
+    str_view_detail::run_chunks(m_Length - subLen + 1, options, [&](size_t, size_t begin, size_t end) {
+        if(begin > result.load(std::memory_order_relaxed))
+            return;
+        const size_t pos = searcher.find_in(str_view_template<CharT>(m_Begin + begin, end - begin + subLen - 1));
+        if(pos != SIZE_MAX)
+            str_view_detail::atomic_min(result, begin + pos);
+    });
+    return result.load();
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::find_first_of_parallel(const str_view_lite_template<CharT>& chars, const str_view_parallel_options& options) const
+{
+    return find_first_of_parallel(char_set_template<CharT>(chars.data(), chars.length()), options);
+}
+
+template<typename CharT>
+inline size_t str_view_lite_template<CharT>::find_first_of_parallel(const char_set_template<CharT>& chars, const str_view_parallel_options& options) const
+{
+    if(chars.empty())
+        return SIZE_MAX;
+    std::atomic<size_t> result(SIZE_MAX);
+    str_view_detail::run_chunks(m_Length, options, [&](size_t, size_t begin, size_t end) {
+        if(begin > result.load(std::memory_order_relaxed))
+            return;
+        const CharT* const found = str_view_detail::find_in_set(chars, m_Begin + begin, end - begin, false);
+        if(found)
+            str_view_detail::atomic_min(result, (size_t)(found - m_Begin));
+    });
+    return result.load();
+}
+
+template<typename CharT>
+template<typename Func>
+inline size_t str_view_lite_template<CharT>::find_all_parallel(const str_view_lite_template<CharT>& substr, Func func, const str_view_parallel_options& options) const
+{
+    const size_t subLen = substr.length();
+    const str_view_searcher_template<CharT> searcher(substr);
+    if(subLen == 0 || subLen > m_Length || m_Length - subLen < options.chunkLength)
+        return searcher.find_all(str_view_template<CharT>(m_Begin, m_Length), func);
+
+    const size_t startCount = m_Length - subLen + 1;
+    const size_t chunkLength = std::max<size_t>(options.chunkLength, 1);
+    std::vector<std::vector<size_t>> chunkPositions(startCount / chunkLength + (startCount % chunkLength ? 1 : 0));
+    str_view_detail::run_chunks(startCount, options, [&](size_t index, size_t begin, size_t end) {
+        std::vector<size_t>& positions = chunkPositions[index];
+        searcher.find_all(str_view_template<CharT>(m_Begin + begin, end - begin + subLen - 1), [&](size_t pos) {
+            positions.push_back(begin + pos);
+        });
+    });
+
+    size_t count = 0;
+    for(const std::vector<size_t>& positions : chunkPositions)
+    {
+        for(size_t pos : positions)
+            func(pos);
+        count += positions.size();
+    }
+    return count;
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::count_parallel(CharT ch, const str_view_parallel_options& options) const
+{
+    return to_lite().count_parallel(ch, options);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find_parallel(CharT ch, const str_view_parallel_options& options) const
+{
+    return to_lite().find_parallel(ch, options);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find_parallel(const str_view_template<CharT>& substr, const str_view_parallel_options& options) const
+{
+    return to_lite().find_parallel(substr.to_lite(), options);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find_first_of_parallel(const str_view_template<CharT>& chars, const str_view_parallel_options& options) const
+{
+    return to_lite().find_first_of_parallel(chars.to_lite(), options);
+}
+
+template<typename CharT>
+inline size_t str_view_template<CharT>::find_first_of_parallel(const char_set_template<CharT>& chars, const str_view_parallel_options& options) const
+{
+    return to_lite().find_first_of_parallel(chars, options);
+}
+
+template<typename CharT>
+template<typename Func>
+inline size_t str_view_template<CharT>::find_all_parallel(const str_view_template<CharT>& substr, Func func, const str_view_parallel_options& options) const
+{
+    return to_lite().find_all_parallel(substr.to_lite(), func, options);
+}
+
+/*
+String view that keeps short null-terminated copies inside the object.
+
+c_str() of a string that is not null-terminated and has at most InlineCapacity
+characters writes the copy to a buffer inside this object instead of allocating
+it. Longer strings are handled like in str_view_template.
+
+It can be passed as str_view_template, but only c_str() called on this object
+directly, not through reference to str_view_template, uses the inline buffer.
+Copying or moving the object doesn't transfer the inline copy - it's created again
+when needed.
+
+Like str_view_template, c_str() can be called from multiple threads concurrently.
+*/
+template<typename CharT, size_t InlineCapacity = 31>
+class str_view_sso_template : public str_view_template<CharT>
+{
+public:
+    typedef str_view_template<CharT> BaseT;
+
+    // All constructors of str_view_template are available.
+    using BaseT::BaseT;
+
+    inline str_view_sso_template() : BaseT() { }
+    inline str_view_sso_template(const BaseT& src, size_t offset = 0, size_t length = SIZE_MAX) : BaseT(src, offset, length) { }
+    inline str_view_sso_template(const str_view_sso_template<CharT, InlineCapacity>& src) : BaseT(src) { }
+    inline str_view_sso_template(str_view_sso_template<CharT, InlineCapacity>&& src) : BaseT(std::move(src)) { }
+
+    inline str_view_sso_template<CharT, InlineCapacity>& operator=(const str_view_sso_template<CharT, InlineCapacity>& src)
+    {
+        BaseT::operator=(src);
+        return *this;
+    }
+    inline str_view_sso_template<CharT, InlineCapacity>& operator=(str_view_sso_template<CharT, InlineCapacity>&& src)
+    {
+        BaseT::operator=(std::move(src));
+        return *this;
+    }
+
+    /*
+    Returns null-terminated string with contents of this object.
+    Possibly an internal copy, stored inside this object if it's short enough.
+    */
+    inline const CharT* c_str() const;
+
+private:
+    // Aligned so that lowest 2 bits of its address are free for flags in m_NullTerminatedPtr.
+    alignas(4) mutable CharT m_Buffer[InlineCapacity + 1];
+};
+
+typedef str_view_sso_template<char> str_view_sso;
+typedef str_view_sso_template<wchar_t> wstr_view_sso;
+
+template<typename CharT, size_t InlineCapacity>
+inline const CharT* str_view_sso_template<CharT, InlineCapacity>::c_str() const
+{
+    if(!this->empty() && this->m_NullTerminatedPtr.load(std::memory_order_relaxed) == 0)
+    {
+        // Not null terminated, so length must be known.
+        const size_t len = this->m_Length.load(std::memory_order_relaxed);
+        assert(len != SIZE_MAX);
+        if(len <= InlineCapacity)
+        {
+            // Only the thread that switches from 0 to COPY_BUSY writes the buffer.
+            // Others wait in BaseT::c_str() until it's published.
+            // Claiming the buffer publishes nothing, so it's relaxed. The final store releases it.
+            uintptr_t expected = 0;
+            if(this->m_NullTerminatedPtr.compare_exchange_strong(expected, BaseT::COPY_BUSY,
+                std::memory_order_relaxed, std::memory_order_relaxed))
+            {
+                STR_VIEW_STATS_ADD(STATS_INLINE_COPIES, 1);
+                memcpy(m_Buffer, this->m_Begin, len * sizeof(CharT));
+                m_Buffer[len] = (CharT)0;
+                this->m_NullTerminatedPtr.store((uintptr_t)m_Buffer | BaseT::INLINE_COPY_BIT, std::memory_order_release);
+                return m_Buffer;
+            }
+            STR_VIEW_STATS_ADD(STATS_LOST_COPY_RACES, 1);
+        }
+    }
+    return BaseT::c_str();
+}
+
+namespace str_view_detail
+{
+
+// Number of leading characters packed to the key of every string in str_view_batch_template.
+enum { BATCH_KEY_CHARS = 4 };
+
+// Packs low bytes of up to BATCH_KEY_CHARS first characters, first character in the lowest byte.
+template<typename CharT>
+inline uint32_t batch_key(const CharT* str, size_t length)
+{
+    uint32_t key = 0;
+    for(size_t i = 0, count = std::min<size_t>(length, BATCH_KEY_CHARS); i < count; ++i)
+        key |= (uint32_t)(uint8_t)str[i] << (i * 8);
+    return key;
+}
+// Selects bytes of the key that belong to a string of given length.
+inline uint32_t batch_key_mask(size_t length)
+{
+    return length >= BATCH_KEY_CHARS ? UINT32_MAX : ((uint32_t)1 << (length * 8)) - 1;
+}
+// Length saturated to a positive 32-bit integer, so it can be compared in SIMD lanes as signed.
+inline int32_t batch_packed_length(size_t length)
+{
+    return (int32_t)std::min<size_t>(length, INT32_MAX);
+}
+
+/*
+Calls func(index) in ascending order for every index in [0, count) for which pred(index)
+is true, until func returns false. Returns false if it was stopped this way.
+blockMask(index) calculates the same condition for all 32-bit lanes of a register
+starting at index, as returned by Simd::mask().
+*/
+template<typename Simd, typename BlockMask, typename Pred, typename Func>
+STR_VIEW_SIMD_INLINE bool batch_scan(size_t count, const BlockMask& blockMask, const Pred& pred, Func& func)
+{
+    const size_t step = Simd::BYTES / sizeof(uint32_t);
+    const unsigned bitsPerLane = Simd::BITS_PER_BYTE * sizeof(uint32_t);
+    size_t i = 0;
+    for(; i + step <= count; i += step)
+    {
+        for(uint64_t mask = blockMask(i); mask != 0; )
+        {
+            const unsigned lane = bit_scan_forward(mask) / bitsPerLane;
+            if(!func(i + lane))
+                return false;
+            const unsigned doneBits = (lane + 1) * bitsPerLane;
+            mask = doneBits < 64 ? mask & (~(uint64_t)0 << doneBits) : 0;
+        }
+    }
+    for(; i < count; ++i)
+    {
+        if(pred(i) && !func(i))
+            return false;
+    }
+    return true;
+}
+
+// Same as batch_scan, without SIMD.
+template<typename Pred, typename Func>
+inline bool batch_scan_scalar(size_t count, const Pred& pred, Func& func)
+{
+    for(size_t i = 0; i < count; ++i)
+    {
+        if(pred(i) && !func(i))
+            return false;
+    }
+    return true;
+}
+
+STR_VIEW_SIMD_KERNELS_BEGIN
+
+/*
+Calls func(index) for strings of a batch that can be a prefix of a string with given
+key and packed length: key bytes of the string match and it's not longer.
+*/
+template<typename Simd, typename Func>
+STR_VIEW_SIMD_INLINE bool simd_batch_scan_prefix(const uint32_t* keys, const uint32_t* keyMasks, const int32_t* lengths,
+    size_t count, uint32_t strKey, int32_t strLength, Func& func)
+{
+    const auto pred = [=](size_t i) { return (strKey & keyMasks[i]) == keys[i] && lengths[i] <= strLength; };
+#if STR_VIEW_HAS_SIMD
+    const typename Simd::vec strKeyVec = Simd::template splat<uint32_t>(strKey);
+    const typename Simd::vec strLengthVec = Simd::template splat<uint32_t>((uint32_t)strLength);
+    const auto blockMask = [&](size_t i) STR_VIEW_SIMD_LAMBDA -> uint64_t {
+        const uint64_t keyEqual = Simd::mask(Simd::template cmpeq<uint32_t>(
+            Simd::bit_and(strKeyVec, Simd::load(keyMasks + i)), Simd::load(keys + i)));
+        const uint64_t tooLong = Simd::mask(Simd::cmpgt_int32(Simd::load(lengths + i), strLengthVec));
+        return keyEqual & ~tooLong;
+    };
+    return batch_scan<Simd>(count, blockMask, pred, func);
+#else
+    return batch_scan_scalar(count, pred, func);
+#endif
+}
+
+// Calls func(index) for strings of a batch with given hash and packed length.
+template<typename Simd, typename Func>
+STR_VIEW_SIMD_INLINE bool simd_batch_scan_equal(const uint32_t* hashes, const int32_t* lengths,
+    size_t count, uint32_t strHash, int32_t strLength, Func& func)
+{
+    const auto pred = [=](size_t i) { return hashes[i] == strHash && lengths[i] == strLength; };
+#if STR_VIEW_HAS_SIMD
+    const typename Simd::vec strHashVec = Simd::template splat<uint32_t>(strHash);
+    const typename Simd::vec strLengthVec = Simd::template splat<uint32_t>((uint32_t)strLength);
+    const auto blockMask = [&](size_t i) STR_VIEW_SIMD_LAMBDA -> uint64_t {
+        return Simd::mask(Simd::template cmpeq<uint32_t>(Simd::load(hashes + i), strHashVec)) &
+            Simd::mask(Simd::template cmpeq<uint32_t>(Simd::load(lengths + i), strLengthVec));
+    };
+    return batch_scan<Simd>(count, blockMask, pred, func);
+#else
+    return batch_scan_scalar(count, pred, func);
+#endif
+}
+
+#if STR_VIEW_DISPATCH
+typedef dispatch_callback<bool(size_t)> batch_callback;
+
+inline STR_VIEW_TARGET_AVX2 bool batch_scan_prefix_avx2(const uint32_t* keys, const uint32_t* keyMasks, const int32_t* lengths,
+    size_t count, uint32_t strKey, int32_t strLength, batch_callback& func)
+{
+    return simd_batch_scan_prefix<simd_avx2>(keys, keyMasks, lengths, count, strKey, strLength, func);
+}
+inline STR_VIEW_TARGET_AVX512 bool batch_scan_prefix_avx512(const uint32_t* keys, const uint32_t* keyMasks, const int32_t* lengths,
+    size_t count, uint32_t strKey, int32_t strLength, batch_callback& func)
+{
+    return simd_batch_scan_prefix<simd_avx512>(keys, keyMasks, lengths, count, strKey, strLength, func);
+}
+inline STR_VIEW_TARGET_AVX2 bool batch_scan_equal_avx2(const uint32_t* hashes, const int32_t* lengths,
+    size_t count, uint32_t strHash, int32_t strLength, batch_callback& func)
+{
+    return simd_batch_scan_equal<simd_avx2>(hashes, lengths, count, strHash, strLength, func);
+}
+inline STR_VIEW_TARGET_AVX512 bool batch_scan_equal_avx512(const uint32_t* hashes, const int32_t* lengths,
+    size_t count, uint32_t strHash, int32_t strLength, batch_callback& func)
+{
+    return simd_batch_scan_equal<simd_avx512>(hashes, lengths, count, strHash, strLength, func);
+}
+#endif
+
+STR_VIEW_SIMD_KERNELS_END
+
+template<typename Func>
+inline bool batch_scan_prefix(const uint32_t* keys, const uint32_t* keyMasks, const int32_t* lengths,
+    size_t count, uint32_t strKey, int32_t strLength, Func& func)
+{
+#if STR_VIEW_DISPATCH
+    if(count * sizeof(uint32_t) >= DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = dispatch_kernel(&batch_scan_prefix_avx2, &batch_scan_prefix_avx512);
+        if(kernel)
+        {
+            batch_callback callback = batch_callback::make(func);
+            return kernel(keys, keyMasks, lengths, count, strKey, strLength, callback);
+        }
+    }
+#endif
+    return simd_batch_scan_prefix<simd_best>(keys, keyMasks, lengths, count, strKey, strLength, func);
+}
+
+template<typename Func>
+inline bool batch_scan_equal(const uint32_t* hashes, const int32_t* lengths,
+    size_t count, uint32_t strHash, int32_t strLength, Func& func)
+{
+#if STR_VIEW_DISPATCH
+    if(count * sizeof(uint32_t) >= DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = dispatch_kernel(&batch_scan_equal_avx2, &batch_scan_equal_avx512);
+        if(kernel)
+        {
+            batch_callback callback = batch_callback::make(func);
+            return kernel(hashes, lengths, count, strHash, strLength, callback);
+        }
+    }
+#endif
+    return simd_batch_scan_equal<simd_best>(hashes, lengths, count, strHash, strLength, func);
+}
+
+} // namespace str_view_detail
+
+/*
+Collection of many string views stored as structure of arrays, for operations that
+compare one string with all of them, e.g. matching a request path against a table
+of prefixes.
+
+Besides pointers and lengths, first 4 characters, length and hash of every string are
+packed into separate arrays of 32-bit integers. Operations compare them for several
+strings at once using SIMD and look at the characters only for strings that pass this
+test. Length and hash of every string are calculated once, when it's added.
+
+All characters are compared, including '\0', like with str_view_binary_compare.
+
+The batch refers to characters of added strings, so they must remain alive and
+unchanged as long as the batch is used.
+*/
+template<typename CharT>
+class str_view_batch_template
+{
+public:
+    inline str_view_batch_template() { }
+
+    inline size_t size() const { return m_Strings.size(); }
+    inline bool empty() const { return m_Strings.empty(); }
+    // Returns view of the string at given index.
+    inline str_view_lite_template<CharT> operator[](size_t index) const { return str_view_lite_template<CharT>(m_Strings[index], m_Lengths[index]); }
+
+    inline void reserve(size_t count);
+    // Adds the string at the end. Calculates its length if not known yet.
+    inline void push_back(const str_view_lite_template<CharT>& str);
+    inline void clear();
+
+    /*
+    Returns index of the first string in the batch that is a prefix of str,
+    or SIZE_MAX if there is none. Empty string is a prefix of every string.
+    */
+    inline size_t find_first_matching_prefix(const str_view_lite_template<CharT>& str) const;
+    /*
+    Returns index of the longest string in the batch that is a prefix of str,
+    or SIZE_MAX if there is none. Of strings with equal length, the first one is returned.
+    */
+    inline size_t find_longest_matching_prefix(const str_view_lite_template<CharT>& str) const;
+    // Returns number of strings in the batch equal to str.
+    inline size_t count_equal(const str_view_lite_template<CharT>& str) const;
+
+    /*
+    Sorts strings in the batch in lexicographical order of str_view_binary_compare.
+    Order of equal strings is unspecified.
+    */
+    inline void sort();
+
+private:
+    std::vector<const CharT*> m_Strings;
+    std::vector<size_t> m_Lengths;
+    // str_view_detail::batch_key of every string.
+    std::vector<uint32_t> m_Keys;
+    // str_view_detail::batch_key_mask of every string.
+    std::vector<uint32_t> m_KeyMasks;
+    // str_view_detail::batch_packed_length of every string.
+    std::vector<int32_t> m_PackedLengths;
+    // Lower 32 bits of hash() of every string.
+    std::vector<uint32_t> m_Hashes;
+
+    // Calls func(index) for strings that may be a prefix of str, until it returns false.
+    template<typename Func>
+    inline void scan_prefix_candidates(const str_view_lite_template<CharT>& str, Func func) const;
+    inline bool is_prefix(size_t index, const str_view_lite_template<CharT>& str) const
+    {
+        return m_Lengths[index] <= str.length() &&
+            (m_Lengths[index] == 0 || tmemcmp(m_Strings[index], str.data(), m_Lengths[index]) == 0);
+    }
+};
+
+typedef str_view_batch_template<char> str_view_batch;
+typedef str_view_batch_template<wchar_t> wstr_view_batch;
+
+template<typename CharT>
+inline void str_view_batch_template<CharT>::reserve(size_t count)
+{
+    m_Strings.reserve(count);
+    m_Lengths.reserve(count);
+    m_Keys.reserve(count);
+    m_KeyMasks.reserve(count);
+    m_PackedLengths.reserve(count);
+    m_Hashes.reserve(count);
+}
+
+template<typename CharT>
+inline void str_view_batch_template<CharT>::push_back(const str_view_lite_template<CharT>& str)
+{
+    m_Strings.push_back(str.data());
+    m_Lengths.push_back(str.length());
+    m_Keys.push_back(str_view_detail::batch_key(str.data(), str.length()));
+    m_KeyMasks.push_back(str_view_detail::batch_key_mask(str.length()));
+    m_PackedLengths.push_back(str_view_detail::batch_packed_length(str.length()));
+    m_Hashes.push_back((uint32_t)str.hash());
+}
+
+template<typename CharT>
+inline void str_view_batch_template<CharT>::clear()
+{
+    m_Strings.clear();
+    m_Lengths.clear();
+    m_Keys.clear();
+    m_KeyMasks.clear();
+    m_PackedLengths.clear();
+    m_Hashes.clear();
+}
+
+template<typename CharT>
+template<typename Func>
+inline void str_view_batch_template<CharT>::scan_prefix_candidates(const str_view_lite_template<CharT>& str, Func func) const
+{
+    // String can be a prefix only if its key bytes match str and it's not longer than str.
+    const uint32_t strKey = str_view_detail::batch_key(str.data(), str.length());
+    const int32_t strLength = str_view_detail::batch_packed_length(str.length());
+    str_view_detail::batch_scan_prefix(m_Keys.data(), m_KeyMasks.data(), m_PackedLengths.data(),
+        m_Keys.size(), strKey, strLength, func);
+}
+
+template<typename CharT>
+inline size_t str_view_batch_template<CharT>::find_first_matching_prefix(const str_view_lite_template<CharT>& str) const
+{
+    size_t result = SIZE_MAX;
+    scan_prefix_candidates(str, [&](size_t i) {
+        if(!is_prefix(i, str))
+            return true;
+        result = i;
+        return false;
+    });
+    return result;
+}
+
+template<typename CharT>
+inline size_t str_view_batch_template<CharT>::find_longest_matching_prefix(const str_view_lite_template<CharT>& str) const
+{
+    size_t result = SIZE_MAX;
+    scan_prefix_candidates(str, [&](size_t i) {
+        if((result == SIZE_MAX || m_Lengths[i] > m_Lengths[result]) && is_prefix(i, str))
+            result = i;
+        return true;
+    });
+    return result;
+}
+
+template<typename CharT>
+inline size_t str_view_batch_template<CharT>::count_equal(const str_view_lite_template<CharT>& str) const
+{
+    // Equal string must have the same hash and packed length.
+    const uint32_t strHash = (uint32_t)str.hash();
+    const int32_t strLength = str_view_detail::batch_packed_length(str.length());
+    size_t result = 0;
+    auto func = [&](size_t i) {
+        if(m_Lengths[i] == str.length() &&
+            (str.empty() || tmemcmp(m_Strings[i], str.data(), str.length()) == 0))
+            ++result;
+        return true;
+    };
+    str_view_detail::batch_scan_equal(m_Hashes.data(), m_PackedLengths.data(), m_Keys.size(), strHash, strLength, func);
+    return result;
+}
+
+template<typename CharT>
+inline void str_view_batch_template<CharT>::sort()
+{
+    /*
+    For char, key with bytes reversed orders strings like memcmp by first 4 characters,
+    so most comparisons don't touch the characters. For wchar_t, order of wmemcmp
+    is platform-specific, so only characters are compared.
+    */
+    struct Item
+    {
+        uint32_t sortKey;
+        size_t index;
+    };
+    const size_t count = m_Strings.size();
+    std::vector<Item> items(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        const uint32_t key = m_Keys[i];
+        items[i].sortKey = sizeof(CharT) == 1 ?
+            (key >> 24) | ((key >> 8) & 0xFF00) | ((key << 8) & 0xFF0000) | (key << 24) : 0;
+        items[i].index = i;
+    }
+    std::sort(items.begin(), items.end(), [this](const Item& lhs, const Item& rhs) {
+        if(lhs.sortKey != rhs.sortKey)
+            return lhs.sortKey < rhs.sortKey;
+        return (*this)[lhs.index].template compare<str_view_binary_compare>((*this)[rhs.index]) < 0;
+    });
+
+    std::vector<const CharT*> strings(count);
+    std::vector<size_t> lengths(count);
+    std::vector<uint32_t> keys(count), keyMasks(count);
+    std::vector<int32_t> packedLengths(count);
+    std::vector<uint32_t> hashes(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        const size_t src = items[i].index;
+        strings[i] = m_Strings[src];
+        lengths[i] = m_Lengths[src];
+        keys[i] = m_Keys[src];
+        keyMasks[i] = m_KeyMasks[src];
+        packedLengths[i] = m_PackedLengths[src];
+        hashes[i] = m_Hashes[src];
+    }
+    m_Strings.swap(strings);
+    m_Lengths.swap(lengths);
+    m_Keys.swap(keys);
+    m_KeyMasks.swap(keyMasks);
+    m_PackedLengths.swap(packedLengths);
+    m_Hashes.swap(hashes);
+}
+
+namespace str_view_detail
+{
+
+enum : uint32_t { KEYWORD_NONE = UINT32_MAX };
+
+// Character of a keyword as it's stored in the trie and compared.
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR typename std::make_unsigned<CharT>::type keyword_char(CharT ch, bool caseSensitive)
+{
+    return (typename std::make_unsigned<CharT>::type)(caseSensitive ? ch : constexpr_ascii_tolower(ch));
+}
+
+/*
+Orders indices of keys by their characters, shorter keys first, then by index,
+so the first of duplicated keys comes first.
+*/
+template<typename CharT>
+struct keyword_order_less
+{
+    const str_view_lite_template<CharT>* keys;
+    bool caseSensitive;
+
+    STR_VIEW_CONSTEXPR bool operator()(uint32_t lhs, uint32_t rhs) const
+    {
+        const str_view_lite_template<CharT>& lhsKey = keys[lhs];
+        const str_view_lite_template<CharT>& rhsKey = keys[rhs];
+        const size_t minLen = lhsKey.length() < rhsKey.length() ? lhsKey.length() : rhsKey.length();
+        for(size_t i = 0; i < minLen; ++i)
+        {
+            const auto lhsCh = keyword_char(lhsKey.data()[i], caseSensitive);
+            const auto rhsCh = keyword_char(rhsKey.data()[i], caseSensitive);
+            if(lhsCh != rhsCh)
+                return lhsCh < rhsCh;
+        }
+        if(lhsKey.length() != rhsKey.length())
+            return lhsKey.length() < rhsKey.length();
+        return lhs < rhs;
+    }
+};
+
+// Maximum number of nodes of the trie of given keys: one for every character plus the root.
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR size_t keyword_trie_capacity(const str_view_lite_template<CharT>* keys, size_t keyCount)
+{
+    size_t result = 1;
+    for(size_t i = 0; i < keyCount; ++i)
+        result += keys[i].length();
+    return result;
+}
+
+/*
+Builds flattened trie of the keys. Nodes are numbered in breadth-first order. Edges
+to children of every node are stored one after another, sorted by character, with
+characters and target nodes in separate arrays:
+
+- Edges of node n are [nodeFirstEdges[n], nodeFirstEdges[n + 1]).
+- nodeKeys[n] is index of the key that ends at node n, or KEYWORD_NONE.
+
+Output arrays must have keyword_trie_capacity() elements, nodeFirstEdges one more.
+order and ranges are temporary arrays of keyCount and 3 * keyword_trie_capacity() elements.
+Returns number of nodes.
+*/
+template<typename CharT>
+inline STR_VIEW_CONSTEXPR size_t build_keyword_trie(const str_view_lite_template<CharT>* keys, size_t keyCount, bool caseSensitive,
+    uint32_t* order, uint32_t* ranges,
+    CharT* edgeChars, uint32_t* edgeTargets, uint32_t* nodeFirstEdges, uint32_t* nodeKeys)
+{
+    const keyword_order_less<CharT> less = { keys, caseSensitive };
+    for(size_t i = 0; i < keyCount; ++i)
+        order[i] = (uint32_t)i;
+    if(STR_VIEW_IS_CONSTANT_EVALUATED())
+    {
+        for(size_t i = 1; i < keyCount; ++i)
+        {
+            const uint32_t item = order[i];
+            size_t j = i;
+            for(; j > 0 && less(item, order[j - 1]); --j)
+                order[j] = order[j - 1];
+            order[j] = item;
+        }
+    }
+    else
+        std::sort(order, order + keyCount, less);
+
+    // Node n represents keys order[ranges[3n]..ranges[3n+1]) sharing first ranges[3n+2] characters.
+    ranges[0] = 0;
+    ranges[1] = (uint32_t)keyCount;
+    ranges[2] = 0;
+    size_t nodeCount = 1;
+    size_t edgeCount = 0;
+    for(size_t node = 0; node < nodeCount; ++node)
+    {
+        size_t i = ranges[node * 3];
+        const size_t end = ranges[node * 3 + 1];
+        const size_t depth = ranges[node * 3 + 2];
+        nodeFirstEdges[node] = (uint32_t)edgeCount;
+        nodeKeys[node] = KEYWORD_NONE;
+        // Key that ends here is sorted first. Its duplicates are skipped.
+        if(i < end && keys[order[i]].length() == depth)
+        {
+            nodeKeys[node] = order[i];
+            while(i < end && keys[order[i]].length() == depth)
+                ++i;
+        }
+        while(i < end)
+        {
+            const auto ch = keyword_char(keys[order[i]].data()[depth], caseSensitive);
+            size_t groupEnd = i + 1;
+            while(groupEnd < end && keyword_char(keys[order[groupEnd]].data()[depth], caseSensitive) == ch)
+                ++groupEnd;
+            edgeChars[edgeCount] = (CharT)ch;
+            edgeTargets[edgeCount] = (uint32_t)nodeCount;
+            ++edgeCount;
+            ranges[nodeCount * 3] = (uint32_t)i;
+            ranges[nodeCount * 3 + 1] = (uint32_t)groupEnd;
+            ranges[nodeCount * 3 + 2] = (uint32_t)(depth + 1);
+            ++nodeCount;
+            i = groupEnd;
+        }
+    }
+    nodeFirstEdges[nodeCount] = (uint32_t)edgeCount;
+    return nodeCount;
+}
+
+// Read-only access to arrays of a trie made by build_keyword_trie().
+template<typename CharT>
+struct keyword_trie_ref
+{
+    const CharT* edgeChars;
+    const uint32_t* edgeTargets;
+    const uint32_t* nodeFirstEdges;
+    const uint32_t* nodeKeys;
+    bool caseSensitive;
+
+    // Returns child of the node along edge with given character, or KEYWORD_NONE.
+    STR_VIEW_CONSTEXPR uint32_t child(uint32_t node, typename std::make_unsigned<CharT>::type ch) const
+    {
+        typedef typename std::make_unsigned<CharT>::type UCharT;
+        size_t begin = nodeFirstEdges[node];
+        size_t end = nodeFirstEdges[node + 1];
+        // Most nodes have few children. Nodes close to the root may have many.
+        while(end - begin > 8)
+        {
+            const size_t middle = begin + (end - begin) / 2;
+            if((UCharT)edgeChars[middle] < ch)
+                begin = middle + 1;
+            else
+                end = middle + 1;
+            if(end - begin == 1)
+                break;
+        }
+        for(; begin < end; ++begin)
+        {
+            const UCharT edgeCh = (UCharT)edgeChars[begin];
+            if(edgeCh == ch)
+                return edgeTargets[begin];
+            if(edgeCh > ch)
+                break;
+        }
+        return KEYWORD_NONE;
+    }
+
+    STR_VIEW_CONSTEXPR size_t find(const CharT* str, size_t length) const
+    {
+        uint32_t node = 0;
+        for(size_t i = 0; i < length; ++i)
+        {
+            node = child(node, keyword_char(str[i], caseSensitive));
+            if(node == KEYWORD_NONE)
+                return SIZE_MAX;
+        }
+        return nodeKeys[node] == KEYWORD_NONE ? SIZE_MAX : nodeKeys[node];
+    }
+
+    STR_VIEW_CONSTEXPR size_t find_longest_prefix(const CharT* str, size_t length) const
+    {
+        uint32_t node = 0;
+        size_t result = nodeKeys[0] == KEYWORD_NONE ? SIZE_MAX : nodeKeys[0];
+        for(size_t i = 0; i < length; ++i)
+        {
+            node = child(node, keyword_char(str[i], caseSensitive));
+            if(node == KEYWORD_NONE)
+                break;
+            if(nodeKeys[node] != KEYWORD_NONE)
+                result = nodeKeys[node];
+        }
+        return result;
+    }
+};
+
+} // namespace str_view_detail
+
+/*
+Matcher of a fixed set of keywords, for dispatching on strings like commands, HTTP
+methods or tokens of a language, instead of comparing with each of them or looking
+them up in std::map.
+
+Keys are compiled into a trie flattened to a few arrays, so matching takes time
+proportional to the length of the string, not number of keys, and touches little
+memory. The matcher copies all characters it needs - keys don't have to remain alive.
+
+Keys are identified by indices in the array given to the constructor. If a key
+appears many times, the first index is returned. With caseSensitive = false, ASCII
+letters are matched regardless of case, like compare(..., false).
+
+To build the matcher at compile time, see static_keyword_matcher_template.
+*/
+template<typename CharT>
+class keyword_matcher_template
+{
+public:
+    // Creates matcher with no keys.
+    inline keyword_matcher_template() : keyword_matcher_template(nullptr, 0) { }
+    inline keyword_matcher_template(const str_view_lite_template<CharT>* keys, size_t keyCount, bool caseSensitive = true);
+    inline keyword_matcher_template(std::initializer_list<str_view_lite_template<CharT>> keys, bool caseSensitive = true) :
+        keyword_matcher_template(keys.begin(), keys.size(), caseSensitive)
+    {
+    }
+
+    // Returns number of keys, including duplicates.
+    inline size_t size() const { return m_KeyLengths.size(); }
+    inline bool empty() const { return m_KeyLengths.empty(); }
+    inline size_t key_length(size_t index) const { return m_KeyLengths[index]; }
+    inline bool case_sensitive() const { return m_CaseSensitive; }
+
+    // Returns index of the key equal to str, or SIZE_MAX if there is none.
+    inline size_t find(const str_view_lite_template<CharT>& str) const { return trie().find(str.data(), str.length()); }
+    /*
+    Returns index of the longest key that is a prefix of str, or SIZE_MAX if there is none.
+    Length of the matched part is key_length() of the result.
+    */
+    inline size_t find_longest_prefix(const str_view_lite_template<CharT>& str) const { return trie().find_longest_prefix(str.data(), str.length()); }
+
+private:
+    std::vector<CharT> m_EdgeChars;
+    std::vector<uint32_t> m_EdgeTargets;
+    std::vector<uint32_t> m_NodeFirstEdges;
+    std::vector<uint32_t> m_NodeKeys;
+    std::vector<size_t> m_KeyLengths;
+    bool m_CaseSensitive;
+
+    inline str_view_detail::keyword_trie_ref<CharT> trie() const
+    {
+        const str_view_detail::keyword_trie_ref<CharT> result = {
+            m_EdgeChars.data(), m_EdgeTargets.data(), m_NodeFirstEdges.data(), m_NodeKeys.data(), m_CaseSensitive };
+        return result;
+    }
+};
+
+typedef keyword_matcher_template<char> keyword_matcher;
+typedef keyword_matcher_template<wchar_t> wkeyword_matcher;
+
+template<typename CharT>
+inline keyword_matcher_template<CharT>::keyword_matcher_template(const str_view_lite_template<CharT>* keys, size_t keyCount, bool caseSensitive) :
+    m_CaseSensitive(caseSensitive)
+{
+    const size_t capacity = str_view_detail::keyword_trie_capacity(keys, keyCount);
+    std::vector<uint32_t> order(keyCount + 1);
+    std::vector<uint32_t> ranges(capacity * 3);
+    m_EdgeChars.resize(capacity);
+    m_EdgeTargets.resize(capacity);
+    m_NodeFirstEdges.resize(capacity + 1);
+    m_NodeKeys.resize(capacity);
+    const size_t nodeCount = str_view_detail::build_keyword_trie(keys, keyCount, caseSensitive,
+        order.data(), ranges.data(), m_EdgeChars.data(), m_EdgeTargets.data(), m_NodeFirstEdges.data(), m_NodeKeys.data());
+    // Keys with common prefixes need fewer nodes than the capacity.
+    m_EdgeChars.resize(nodeCount - 1);
+    m_EdgeChars.shrink_to_fit();
+    m_EdgeTargets.resize(nodeCount - 1);
+    m_EdgeTargets.shrink_to_fit();
+    m_NodeFirstEdges.resize(nodeCount + 1);
+    m_NodeFirstEdges.shrink_to_fit();
+    m_NodeKeys.resize(nodeCount);
+    m_NodeKeys.shrink_to_fit();
+    m_KeyLengths.resize(keyCount);
+    for(size_t i = 0; i < keyCount; ++i)
+        m_KeyLengths[i] = keys[i].length();
+}
+
+/*
+Same as keyword_matcher_template, with arrays of fixed size, so it can be built
+at compile time from keys that are string literals. Create it by
+make_static_keyword_matcher(), with capacity calculated by keyword_matcher_capacity():
+
+    static constexpr str_view_lite KEYWORDS[] = { "if"_svl, "else"_svl, "while"_svl };
+    static constexpr auto MATCHER =
+        make_static_keyword_matcher<keyword_matcher_capacity(KEYWORDS)>(KEYWORDS);
+    static_assert(MATCHER.find("else"_svl) == 1, "");
+
+NodeCapacity must be at least keyword_matcher_capacity() of the keys.
+*/
+template<typename CharT, size_t KeyCount, size_t NodeCapacity>
+class static_keyword_matcher_template
+{
+public:
+    STR_VIEW_CONSTEXPR static_keyword_matcher_template(const str_view_lite_template<CharT> (&keys)[KeyCount], bool caseSensitive = true) :
+        m_EdgeChars(),
+        m_EdgeTargets(),
+        m_NodeFirstEdges(),
+        m_NodeKeys(),
+        m_KeyLengths(),
+        m_NodeCount(0),
+        m_CaseSensitive(caseSensitive)
+    {
+        assert(str_view_detail::keyword_trie_capacity(keys, KeyCount) <= NodeCapacity);
+        uint32_t order[KeyCount] = {};
+        uint32_t ranges[NodeCapacity * 3] = {};
+        m_NodeCount = str_view_detail::build_keyword_trie(keys, KeyCount, caseSensitive,
+            order, ranges, m_EdgeChars, m_EdgeTargets, m_NodeFirstEdges, m_NodeKeys);
+        for(size_t i = 0; i < KeyCount; ++i)
+            m_KeyLengths[i] = keys[i].length();
+    }
+
+    STR_VIEW_CONSTEXPR size_t size() const { return KeyCount; }
+    STR_VIEW_CONSTEXPR size_t key_length(size_t index) const { return m_KeyLengths[index]; }
+    STR_VIEW_CONSTEXPR bool case_sensitive() const { return m_CaseSensitive; }
+    // Returns number of nodes of the trie actually used, which may be less than NodeCapacity.
+    STR_VIEW_CONSTEXPR size_t node_count() const { return m_NodeCount; }
+
+    STR_VIEW_CONSTEXPR size_t find(const str_view_lite_template<CharT>& str) const { return trie().find(str.data(), str.length()); }
+    STR_VIEW_CONSTEXPR size_t find_longest_prefix(const str_view_lite_template<CharT>& str) const { return trie().find_longest_prefix(str.data(), str.length()); }
+
+private:
+    CharT m_EdgeChars[NodeCapacity];
+    uint32_t m_EdgeTargets[NodeCapacity];
+    uint32_t m_NodeFirstEdges[NodeCapacity + 1];
+    uint32_t m_NodeKeys[NodeCapacity];
+    size_t m_KeyLengths[KeyCount];
+    size_t m_NodeCount;
+    bool m_CaseSensitive;
+
+    STR_VIEW_CONSTEXPR str_view_detail::keyword_trie_ref<CharT> trie() const
+    {
+        return str_view_detail::keyword_trie_ref<CharT>{ m_EdgeChars, m_EdgeTargets, m_NodeFirstEdges, m_NodeKeys, m_CaseSensitive };
+    }
+};
+
+// Returns NodeCapacity needed by static_keyword_matcher_template for given keys.
+template<typename CharT, size_t KeyCount>
+inline STR_VIEW_CONSTEXPR size_t keyword_matcher_capacity(const str_view_lite_template<CharT> (&keys)[KeyCount])
+{
+    return str_view_detail::keyword_trie_capacity(keys, KeyCount);
+}
+
+template<size_t NodeCapacity, typename CharT, size_t KeyCount>
+inline STR_VIEW_CONSTEXPR static_keyword_matcher_template<CharT, KeyCount, NodeCapacity> make_static_keyword_matcher(
+    const str_view_lite_template<CharT> (&keys)[KeyCount], bool caseSensitive = true)
+{
+    return static_keyword_matcher_template<CharT, KeyCount, NodeCapacity>(keys, caseSensitive);
+}
+
+namespace str_view_detail
+{
+
+// Maximum number of patterns searched by multi_filter_search().
+enum { MULTI_FILTER_MAX = 8 };
+
+STR_VIEW_SIMD_KERNELS_BEGIN
+
+#if STR_VIEW_HAS_SIMD
+
+/*
+Filter for small sets of patterns, like simd_find_short_substr() for many needles:
+every block of the haystack is compared with first and last character of each pattern
+and only positions where both match are verified. This is the idea of Teddy, with
+exact characters instead of nibble masks, so it needs no byte shuffles.
+
+Calls func(size_t pos, size_t patternIndex) for matches starting at pos or later, ordered
+by position, then by index of the pattern, until it returns false.
+Patterns are non-empty and lengths are between minLen and maxLen.
+*/
+template<typename Simd, typename CharT, typename Func>
+STR_VIEW_SIMD_INLINE void multi_filter_search(const CharT* haystack, size_t haystackLen, size_t pos,
+    const CharT* const* patterns, const size_t* lengths, size_t patternCount, size_t minLen, size_t maxLen, Func& func)
+{
+    const size_t step = Simd::BYTES / sizeof(CharT);
+    const unsigned bitsPerChar = Simd::BITS_PER_BYTE * sizeof(CharT);
+    typename Simd::vec first[MULTI_FILTER_MAX];
+    typename Simd::vec last[MULTI_FILTER_MAX];
+    for(size_t p = 0; p < patternCount; ++p)
+    {
+        first[p] = Simd::splat(patterns[p][0]);
+        last[p] = Simd::splat(patterns[p][lengths[p] - 1]);
+    }
+    size_t i = pos;
+    for(; i + step + maxLen <= haystackLen + 1; i += step)
+    {
+        const CharT* const block = haystack + i;
+        const typename Simd::vec blockFirst = Simd::load(block);
+        uint64_t masks[MULTI_FILTER_MAX];
+        uint64_t anyMask = 0;
+        for(size_t p = 0; p < patternCount; ++p)
+        {
+            masks[p] =
+                Simd::mask(Simd::template cmpeq<CharT>(blockFirst, first[p])) &
+                Simd::mask(Simd::template cmpeq<CharT>(Simd::load(block + (lengths[p] - 1)), last[p]));
+            anyMask |= masks[p];
+        }
+        while(anyMask)
+        {
+            const unsigned charIndex = bit_scan_forward(anyMask) / bitsPerChar;
+            for(size_t p = 0; p < patternCount; ++p)
+            {
+                if(((masks[p] >> (charIndex * bitsPerChar)) & 1) != 0 &&
+                    (lengths[p] <= 2 || chars_equal(block + charIndex + 1, patterns[p] + 1, lengths[p] - 2)) &&
+                    !func(i + charIndex, p))
+                {
+                    return;
+                }
+            }
+            anyMask = clear_char_bits<Simd, CharT>(anyMask, charIndex);
+        }
+    }
+    for(; i + minLen <= haystackLen; ++i)
+    {
+        for(size_t p = 0; p < patternCount; ++p)
+        {
+            if(haystack[i] == patterns[p][0] && i + lengths[p] <= haystackLen &&
+                chars_equal(haystack + i + 1, patterns[p] + 1, lengths[p] - 1) && !func(i, p))
+                return;
+        }
+    }
+}
+
+#endif // #if STR_VIEW_HAS_SIMD
+
+#if STR_VIEW_DISPATCH
+typedef dispatch_callback<bool(size_t, size_t)> multi_filter_callback;
+
+template<typename CharT>
+STR_VIEW_TARGET_AVX2 void multi_filter_search_avx2(const CharT* haystack, size_t haystackLen, size_t pos,
+    const CharT* const* patterns, const size_t* lengths, size_t patternCount, size_t minLen, size_t maxLen,
+    multi_filter_callback& func)
+{
+    multi_filter_search<simd_avx2>(haystack, haystackLen, pos, patterns, lengths, patternCount, minLen, maxLen, func);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX512 void multi_filter_search_avx512(const CharT* haystack, size_t haystackLen, size_t pos,
+    const CharT* const* patterns, const size_t* lengths, size_t patternCount, size_t minLen, size_t maxLen,
+    multi_filter_callback& func)
+{
+    multi_filter_search<simd_avx512>(haystack, haystackLen, pos, patterns, lengths, patternCount, minLen, maxLen, func);
+}
+#endif
+
+STR_VIEW_SIMD_KERNELS_END
+
+} // namespace str_view_detail
+
+/*
+Searcher of many patterns at once, for finding any of a set of tokens, keywords or
+signatures in a haystack in one pass, instead of calling find() for each of them.
+Use it like str_view_searcher_template, when the same set is searched in many haystacks.
+
+Small sets (up to 8 patterns) are searched with a SIMD filter on first and last
+characters of the patterns. Larger sets are compiled into an Aho-Corasick automaton,
+so search takes time proportional to the length of the haystack and number of matches,
+not number of patterns.
+
+Patterns are identified by indices in the array given to the constructor. They must not
+be empty. The searcher copies all characters it needs - patterns don't have to remain alive.
+*/
+template<typename CharT>
+class str_view_multi_searcher_template
+{
+public:
+    // Creates searcher with no patterns. It finds nothing.
+    inline str_view_multi_searcher_template() : str_view_multi_searcher_template(nullptr, 0) { }
+    inline str_view_multi_searcher_template(const str_view_lite_template<CharT>* patterns, size_t patternCount);
+    inline str_view_multi_searcher_template(std::initializer_list<str_view_lite_template<CharT>> patterns) :
+        str_view_multi_searcher_template(patterns.begin(), patterns.size())
+    {
+    }
+
+    // Returns number of patterns, including duplicates.
+    inline size_t size() const { return m_Lengths.size(); }
+    inline bool empty() const { return m_Lengths.empty(); }
+    inline size_t pattern_length(size_t index) const { return m_Lengths[index]; }
+
+    /*
+    Finds the first occurrence of any pattern in haystack, starting at pos or later.
+    If many patterns start there, the one with the lowest index is taken.
+    Returns its position and index of the pattern in outPatternIndex, or SIZE_MAX if not found.
+    */
+    inline size_t find_in(const str_view_template<CharT>& haystack, size_t pos, size_t& outPatternIndex) const;
+    inline size_t find_in(const str_view_template<CharT>& haystack, size_t pos = 0) const
+    {
+        size_t patternIndex;
+        return find_in(haystack, pos, patternIndex);
+    }
+
+    /*
+    Calls func(size_t pos, size_t patternIndex) for every occurrence of every pattern in
+    haystack, ordered by position, then by index of the pattern.
+    Occurrences may overlap - patterns "ab" and "bc" are both found in "abc".
+    Returns number of occurrences found.
+    */
+    template<typename Func>
+    inline size_t find_all(const str_view_template<CharT>& haystack, Func func) const;
+
+    /*
+    Interface of searchers used by std::search.
+    IterT must be a contiguous iterator over CharT, like a pointer or iterator of std::basic_string or std::vector.
+    Returns range of the first occurrence, like find_in(), or pair (last, last) if not found.
+    */
+    template<typename IterT>
+    inline std::pair<IterT, IterT> operator()(IterT first, IterT last) const;
+
+private:
+    typedef typename std::make_unsigned<CharT>::type UCharT;
+
+    std::vector<CharT> m_Chars;
+    std::vector<size_t> m_Offsets;
+    std::vector<size_t> m_Lengths;
+    size_t m_MinLength;
+    size_t m_MaxLength;
+    bool m_UseFilter;
+
+    // Aho-Corasick automaton, built on the trie of the patterns made by build_keyword_trie().
+    std::vector<CharT> m_EdgeChars;
+    std::vector<uint32_t> m_EdgeTargets;
+    std::vector<uint32_t> m_NodeFirstEdges;
+    // Node for the longest proper suffix of the node that is also in the trie.
+    std::vector<uint32_t> m_FailureLinks;
+    // Nearest node on the chain of failure links where a pattern ends, or KEYWORD_NONE.
+    std::vector<uint32_t> m_OutputLinks;
+    // Patterns that end at node n are m_Outputs[m_NodeFirstOutputs[n]..m_NodeFirstOutputs[n + 1]).
+    std::vector<uint32_t> m_NodeFirstOutputs;
+    std::vector<uint32_t> m_Outputs;
+    // Transitions from the root, where the automaton spends most of the time, for characters up to 0xFF.
+    std::vector<uint32_t> m_RootTargets;
+
+    inline str_view_detail::keyword_trie_ref<CharT> trie() const
+    {
+        const str_view_detail::keyword_trie_ref<CharT> result = {
+            m_EdgeChars.data(), m_EdgeTargets.data(), m_NodeFirstEdges.data(), nullptr, true };
+        return result;
+    }
+    inline uint32_t next_node(uint32_t node, UCharT ch) const;
+    /*
+    Runs the automaton over haystack[pos..end), calling func(size_t pos, size_t patternIndex)
+    for every match, ordered by position of its end. func may decrease end.
+    */
+    template<typename Func>
+    inline void run_automaton(const CharT* haystack, size_t pos, size_t& end, Func& func) const;
+    template<typename Func>
+    inline void run_filter(const CharT* haystack, size_t haystackLen, size_t pos, Func& func) const;
+};
+
+typedef str_view_multi_searcher_template<char> str_view_multi_searcher;
+typedef str_view_multi_searcher_template<wchar_t> wstr_view_multi_searcher;
+
+template<typename CharT>
+inline str_view_multi_searcher_template<CharT>::str_view_multi_searcher_template(
+    const str_view_lite_template<CharT>* patterns, size_t patternCount) :
+    m_MinLength(SIZE_MAX),
+    m_MaxLength(0),
+    m_UseFilter(STR_VIEW_HAS_SIMD && patternCount <= str_view_detail::MULTI_FILTER_MAX)
+{
+    m_Offsets.resize(patternCount);
+    m_Lengths.resize(patternCount);
+    for(size_t i = 0; i < patternCount; ++i)
+    {
+        const size_t length = patterns[i].length();
+        assert(length > 0);
+        m_Offsets[i] = m_Chars.size();
+        m_Lengths[i] = length;
+        m_Chars.insert(m_Chars.end(), patterns[i].data(), patterns[i].data() + length);
+        m_MinLength = std::min(m_MinLength, length);
+        m_MaxLength = std::max(m_MaxLength, length);
+    }
+    if(m_UseFilter)
+        return;
+
+    const size_t capacity = str_view_detail::keyword_trie_capacity(patterns, patternCount);
+    std::vector<uint32_t> order(patternCount + 1);
+    std::vector<uint32_t> ranges(capacity * 3);
+    std::vector<uint32_t> nodeKeys(capacity);
+    m_EdgeChars.resize(capacity);
+    m_EdgeTargets.resize(capacity);
+    m_NodeFirstEdges.resize(capacity + 1);
+    const size_t nodeCount = str_view_detail::build_keyword_trie(patterns, patternCount, true,
+        order.data(), ranges.data(), m_EdgeChars.data(), m_EdgeTargets.data(), m_NodeFirstEdges.data(), nodeKeys.data());
+    m_EdgeChars.resize(nodeCount - 1);
+    m_EdgeChars.shrink_to_fit();
+    m_EdgeTargets.resize(nodeCount - 1);
+    m_EdgeTargets.shrink_to_fit();
+    m_NodeFirstEdges.resize(nodeCount + 1);
+    m_NodeFirstEdges.shrink_to_fit();
+    const str_view_detail::keyword_trie_ref<CharT> trieRef = trie();
+
+    // The trie keeps only the first of duplicated patterns. All of them are reported.
+    std::vector<uint32_t> patternNodes(patternCount);
+    m_NodeFirstOutputs.assign(nodeCount + 1, 0);
+    for(size_t i = 0; i < patternCount; ++i)
+    {
+        uint32_t node = 0;
+        for(size_t j = 0; j < m_Lengths[i]; ++j)
+            node = trieRef.child(node, (UCharT)m_Chars[m_Offsets[i] + j]);
+        patternNodes[i] = node;
+        ++m_NodeFirstOutputs[node + 1];
+    }
+    for(size_t node = 0; node < nodeCount; ++node)
+        m_NodeFirstOutputs[node + 1] += m_NodeFirstOutputs[node];
+    m_Outputs.resize(patternCount);
+    {
+        std::vector<uint32_t> outputCounts(m_NodeFirstOutputs.begin(), m_NodeFirstOutputs.end() - 1);
+        for(size_t i = 0; i < patternCount; ++i)
+            m_Outputs[outputCounts[patternNodes[i]]++] = (uint32_t)i;
+    }
+
+    // Nodes are in breadth-first order, so links of shallower nodes are always ready.
+    m_FailureLinks.assign(nodeCount, 0);
+    m_OutputLinks.assign(nodeCount, str_view_detail::KEYWORD_NONE);
+    for(uint32_t node = 0; node < nodeCount; ++node)
+    {
+        for(uint32_t edge = m_NodeFirstEdges[node]; edge < m_NodeFirstEdges[node + 1]; ++edge)
+        {
+            const uint32_t target = m_EdgeTargets[edge];
+            const UCharT ch = (UCharT)m_EdgeChars[edge];
+            uint32_t failure = 0;
+            if(node != 0)
+            {
+                for(uint32_t link = m_FailureLinks[node]; ; link = m_FailureLinks[link])
+                {
+                    const uint32_t child = trieRef.child(link, ch);
+                    if(child != str_view_detail::KEYWORD_NONE)
+                    {
+                        failure = child;
+                        break;
+                    }
+                    if(link == 0)
+                        break;
+                }
+            }
+            m_FailureLinks[target] = failure;
+            m_OutputLinks[target] = m_NodeFirstOutputs[failure] != m_NodeFirstOutputs[failure + 1] ?
+                failure : m_OutputLinks[failure];
+        }
+    }
+
+    m_RootTargets.resize(256);
+    for(size_t ch = 0; ch < 256; ++ch)
+    {
+        const uint32_t child = trieRef.child(0, (UCharT)ch);
+        m_RootTargets[ch] = child != str_view_detail::KEYWORD_NONE ? child : 0;
+    }
+}
+
+template<typename CharT>
+inline uint32_t str_view_multi_searcher_template<CharT>::next_node(uint32_t node, UCharT ch) const
+{
+    const str_view_detail::keyword_trie_ref<CharT> trieRef = trie();
+    for(;;)
+    {
+        if(node == 0)
+        {
+            if((size_t)ch < m_RootTargets.size())
+                return m_RootTargets[ch];
+            const uint32_t child = trieRef.child(0, ch);
+            return child != str_view_detail::KEYWORD_NONE ? child : 0;
+        }
+        const uint32_t child = trieRef.child(node, ch);
+        if(child != str_view_detail::KEYWORD_NONE)
+            return child;
+        node = m_FailureLinks[node];
+    }
+}
+
+template<typename CharT>
+template<typename Func>
+inline void str_view_multi_searcher_template<CharT>::run_automaton(const CharT* haystack, size_t pos, size_t& end, Func& func) const
+{
+    uint32_t node = 0;
+    for(size_t i = pos; i < end; ++i)
+    {
+        node = next_node(node, (UCharT)haystack[i]);
+        uint32_t output = m_NodeFirstOutputs[node] != m_NodeFirstOutputs[node + 1] ? node : m_OutputLinks[node];
+        for(; output != str_view_detail::KEYWORD_NONE; output = m_OutputLinks[output])
+        {
+            for(uint32_t j = m_NodeFirstOutputs[output]; j < m_NodeFirstOutputs[output + 1]; ++j)
+            {
+                const uint32_t patternIndex = m_Outputs[j];
+                func(i + 1 - m_Lengths[patternIndex], (size_t)patternIndex);
+            }
+        }
+    }
+}
+
+template<typename CharT>
+template<typename Func>
+inline void str_view_multi_searcher_template<CharT>::run_filter(const CharT* haystack, size_t haystackLen, size_t pos, Func& func) const
+{
+#if STR_VIEW_HAS_SIMD
+    const CharT* patterns[str_view_detail::MULTI_FILTER_MAX];
+    for(size_t i = 0; i < m_Lengths.size(); ++i)
+        patterns[i] = m_Chars.data() + m_Offsets[i];
+#if STR_VIEW_DISPATCH
+    if((haystackLen - pos) * sizeof(CharT) >= str_view_detail::DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = str_view_detail::dispatch_kernel(
+            &str_view_detail::multi_filter_search_avx2<CharT>, &str_view_detail::multi_filter_search_avx512<CharT>);
+        if(kernel)
+        {
+            str_view_detail::multi_filter_callback callback = str_view_detail::multi_filter_callback::make(func);
+            kernel(haystack, haystackLen, pos, patterns, m_Lengths.data(), m_Lengths.size(), m_MinLength, m_MaxLength, callback);
+            return;
+        }
+    }
+#endif
+    str_view_detail::multi_filter_search<str_view_detail::simd_best>(haystack, haystackLen, pos,
+        patterns, m_Lengths.data(), m_Lengths.size(), m_MinLength, m_MaxLength, func);
+#else
+    (void)haystack; (void)haystackLen; (void)pos; (void)func;
+#endif
+}
+
+template<typename CharT>
+inline size_t str_view_multi_searcher_template<CharT>::find_in(const str_view_template<CharT>& haystack, size_t pos, size_t& outPatternIndex) const
+{
+    const size_t haystackLen = haystack.length();
+    if(m_Lengths.empty() || pos > haystackLen || haystackLen - pos < m_MinLength)
+        return SIZE_MAX;
+    size_t result = SIZE_MAX;
+    size_t resultPattern = SIZE_MAX;
+    if(m_UseFilter)
+    {
+        auto func = [&](size_t matchPos, size_t patternIndex) -> bool {
+            result = matchPos;
+            resultPattern = patternIndex;
+            return false;
+        };
+        run_filter(haystack.data(), haystackLen, pos, func);
+    }
+    else
+    {
+        // Matches are found in order of their ends. Shorter match that ends first may start later.
+        size_t end = haystackLen;
+        auto func = [&](size_t matchPos, size_t patternIndex) {
+            if(matchPos < result || (matchPos == result && patternIndex < resultPattern))
+            {
+                result = matchPos;
+                resultPattern = patternIndex;
+                // Matches that end further start after result.
+                end = std::min(end, result + m_MaxLength);
+            }
+        };
+        run_automaton(haystack.data(), pos, end, func);
+    }
+    if(result != SIZE_MAX)
+        outPatternIndex = resultPattern;
+    return result;
+}
+
+template<typename CharT>
+template<typename Func>
+inline size_t str_view_multi_searcher_template<CharT>::find_all(const str_view_template<CharT>& haystack, Func func) const
+{
+    const size_t haystackLen = haystack.length();
+    size_t count = 0;
+    if(m_Lengths.empty() || haystackLen < m_MinLength)
+        return 0;
+    if(m_UseFilter)
+    {
+        auto filterFunc = [&](size_t matchPos, size_t patternIndex) -> bool {
+            func(matchPos, patternIndex);
+            ++count;
+            return true;
+        };
+        run_filter(haystack.data(), haystackLen, 0, filterFunc);
+        return count;
+    }
+
+    /*
+    Matches found by the automaton are kept sorted in pending[pendingBegin..] and
+    passed to func when no match found later can start before them.
+    */
+    std::vector<std::pair<size_t, size_t>> pending;
+    size_t pendingBegin = 0;
+    auto flush = [&](size_t posLimit) {
+        for(; pendingBegin < pending.size() && pending[pendingBegin].first < posLimit; ++pendingBegin, ++count)
+            func(pending[pendingBegin].first, pending[pendingBegin].second);
+        if(pendingBegin == pending.size())
+        {
+            pending.clear();
+            pendingBegin = 0;
+        }
+        else if(pendingBegin > pending.size() / 2)
+        {
+            pending.erase(pending.begin(), pending.begin() + pendingBegin);
+            pendingBegin = 0;
+        }
+    };
+    size_t end = haystackLen;
+    auto automatonFunc = [&](size_t matchPos, size_t patternIndex) {
+        const std::pair<size_t, size_t> match(matchPos, patternIndex);
+        pending.insert(std::upper_bound(pending.begin() + pendingBegin, pending.end(), match), match);
+        // Matches found later end here or further, so they start at matchEnd - m_MaxLength or later.
+        const size_t matchEnd = matchPos + m_Lengths[patternIndex];
+        if(matchEnd > m_MaxLength)
+            flush(matchEnd - m_MaxLength);
+    };
+    run_automaton(haystack.data(), 0, end, automatonFunc);
+    flush(SIZE_MAX);
+    return count;
+}
+
+template<typename CharT>
+template<typename IterT>
+inline std::pair<IterT, IterT> str_view_multi_searcher_template<CharT>::operator()(IterT first, IterT last) const
+{
+    if(first == last)
+        return std::make_pair(last, last);
+    const CharT* const haystack = &*first;
+    size_t patternIndex;
+    const size_t found = find_in(str_view_template<CharT>(haystack, (size_t)(last - first)), 0, patternIndex);
+    if(found == SIZE_MAX)
+        return std::make_pair(last, last);
+    const IterT foundIter = first + found;
+    return std::make_pair(foundIter, foundIter + m_Lengths[patternIndex]);
+}
+
+/*
+String made of a sequence of pieces that are not contiguous in memory, like buffers of
+a scatter list received from the network. Searching and comparison work across
+borders of the pieces, without copying them into one string first.
+
+Pieces are str_view_template, so they refer to characters of other strings, which
+must remain alive as long as the rope is used. Empty pieces are skipped.
+Positions are counted from the beginning of the first piece, as if all pieces were
+concatenated. Characters are compared by value, including null characters, like with
+str_view_binary_compare.
+
+To search in a stream of buffers that arrive one by one, without keeping them all,
+see str_view_stream_searcher_template.
+*/
+template<typename CharT>
+class str_view_rope_template
+{
+public:
+    typedef std::basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT>> StringT;
+
+    // Initializes to empty rope.
+    inline str_view_rope_template() : m_Length(0) { }
+    inline str_view_rope_template(const str_view_template<CharT>* pieces, size_t pieceCount);
+    inline str_view_rope_template(std::initializer_list<str_view_template<CharT>> pieces) :
+        str_view_rope_template(pieces.begin(), pieces.size())
+    {
+    }
+
+    // Appends a piece at the end.
+    inline void push_back(const str_view_template<CharT>& piece);
+    inline void clear();
+
+    // Returns total number of characters in all pieces.
+    inline size_t length() const { return m_Length; }
+    inline size_t size() const { return m_Length; }
+    inline bool empty() const { return m_Length == 0; }
+    inline size_t piece_count() const { return m_Pieces.size(); }
+    inline const str_view_template<CharT>& piece(size_t index) const { return m_Pieces[index]; }
+    // Returns position of the first character of the piece.
+    inline size_t piece_offset(size_t index) const { return m_PieceOffsets[index]; }
+    // Returns index of the piece that contains character at pos. pos must be less than length().
+    inline size_t find_piece(size_t pos) const;
+
+    inline CharT operator[](size_t pos) const;
+
+    /*
+    Returns the substring [offset, offset + length) as a rope of parts of the pieces.
+    length can exceed actual length(). It then spans to the end of this string.
+    */
+    inline str_view_rope_template<CharT> substr(size_t offset = 0, size_t length = SIZE_MAX) const;
+    /*
+    Copies the substring [offset, offset + length) to the character string pointed to by dst.
+    Null character is not added past the end of destination.
+    Returns number of characters copied.
+    */
+    inline size_t copy_to(CharT* dst, size_t offset = 0, size_t length = SIZE_MAX) const;
+    inline void to_string(StringT& dst, size_t offset = 0, size_t length = SIZE_MAX) const;
+    inline void append_to(StringT& dst, size_t offset = 0, size_t length = SIZE_MAX) const;
+
+    /*
+    Compares this string with other string, character by character, like str_view_template::compare.
+    Returns negative number, 0 or positive number.
+    */
+    inline int compare(const str_view_template<CharT>& rhs, bool case_sensitive = true) const;
+    inline int compare(const str_view_rope_template<CharT>& rhs, bool case_sensitive = true) const;
+    inline bool starts_with(const str_view_template<CharT>& prefix, bool case_sensitive = true) const;
+    inline bool ends_with(const str_view_template<CharT>& suffix, bool case_sensitive = true) const;
+
+    /*
+    Finds the first occurrence of a character or substring, starting at pos.
+    Substring may span many pieces. Returns its position or SIZE_MAX if not found.
+    If substr is empty, returns pos, like str_view_template::find().
+    */
+    inline size_t find(CharT ch, size_t pos = 0) const;
+    inline size_t find(const str_view_template<CharT>& substr, size_t pos = 0) const;
+    /*
+    Finds the first occurrence of any of the characters in chars, starting at pos.
+    Returns its position or SIZE_MAX if not found or chars is empty.
+    */
+    inline size_t find_first_of(const str_view_template<CharT>& chars, size_t pos = 0) const;
+    inline size_t find_first_of(const char_set_template<CharT>& chars, size_t pos = 0) const;
+
+    /*
+    Calls func(const str_view_rope_template<CharT>& part) for every part of the string
+    separated by the given character or substring, with the same rules as
+    str_view_template::split(): N separators give N + 1 parts. Parts may span many pieces.
+    The part passed to func is valid only during the call.
+    Separator substring must not be empty. Returns number of parts.
+    */
+    template<typename Func>
+    inline size_t split(CharT separator, Func func) const;
+    template<typename Func>
+    inline size_t split(const str_view_template<CharT>& separator, Func func) const;
+
+private:
+    std::vector<str_view_template<CharT>> m_Pieces;
+    std::vector<size_t> m_PieceOffsets;
+    size_t m_Length;
+
+    /*
+    Compares count characters starting at pos with the first count characters of rhs pieces.
+    Both must have that many characters.
+    */
+    inline int compare_range(size_t pos, const str_view_template<CharT>* rhsPieces, size_t count, bool caseSensitive) const;
+    // Fills part with substring [offset, offset + length), reusing its memory.
+    inline void get_substr(str_view_rope_template<CharT>& part, size_t offset, size_t length) const;
+    template<typename FindT, typename Func>
+    inline size_t split_by(const FindT& findSeparator, size_t separatorLen, Func& func) const;
+};
+
+typedef str_view_rope_template<char> str_view_rope;
+typedef str_view_rope_template<wchar_t> wstr_view_rope;
+
+template<typename CharT>
+inline str_view_rope_template<CharT>::str_view_rope_template(const str_view_template<CharT>* pieces, size_t pieceCount) :
+    m_Length(0)
+{
+    m_Pieces.reserve(pieceCount);
+    m_PieceOffsets.reserve(pieceCount);
+    for(size_t i = 0; i < pieceCount; ++i)
+        push_back(pieces[i]);
+}
+
+template<typename CharT>
+inline void str_view_rope_template<CharT>::push_back(const str_view_template<CharT>& piece)
+{
+    const size_t pieceLen = piece.length();
+    if(pieceLen == 0)
+        return;
+    m_Pieces.push_back(piece);
+    m_PieceOffsets.push_back(m_Length);
+    m_Length += pieceLen;
+}
+
+template<typename CharT>
+inline void str_view_rope_template<CharT>::clear()
+{
+    m_Pieces.clear();
+    m_PieceOffsets.clear();
+    m_Length = 0;
+}
+
+template<typename CharT>
+inline size_t str_view_rope_template<CharT>::find_piece(size_t pos) const
+{
+    assert(pos < m_Length);
+    return (size_t)(std::upper_bound(m_PieceOffsets.begin(), m_PieceOffsets.end(), pos) - m_PieceOffsets.begin()) - 1;
+}
+
+template<typename CharT>
+inline CharT str_view_rope_template<CharT>::operator[](size_t pos) const
+{
+    const size_t index = find_piece(pos);
+    return m_Pieces[index].data()[pos - m_PieceOffsets[index]];
+}
+
+template<typename CharT>
+inline void str_view_rope_template<CharT>::get_substr(str_view_rope_template<CharT>& part, size_t offset, size_t length) const
+{
+    assert(offset <= m_Length);
+    length = std::min(length, m_Length - offset);
+    part.clear();
+    if(length == 0)
+        return;
+    for(size_t i = find_piece(offset); length > 0; ++i)
+    {
+        const size_t begin = offset - m_PieceOffsets[i];
+        const size_t count = std::min(length, m_Pieces[i].length() - begin);
+        part.push_back(m_Pieces[i].substr(begin, count));
+        offset += count;
+        length -= count;
+    }
+}
+
+template<typename CharT>
+inline str_view_rope_template<CharT> str_view_rope_template<CharT>::substr(size_t offset, size_t length) const
+{
+    str_view_rope_template<CharT> result;
+    get_substr(result, offset, length);
+    return result;
+}
+
+template<typename CharT>
+inline size_t str_view_rope_template<CharT>::copy_to(CharT* dst, size_t offset, size_t length) const
+{
+    assert(offset <= m_Length);
+    length = std::min(length, m_Length - offset);
+    if(length == 0)
+        return 0;
+    size_t copied = 0;
+    for(size_t i = find_piece(offset); copied < length; ++i)
+        copied += m_Pieces[i].copy_to(dst + copied, offset + copied - m_PieceOffsets[i], length - copied);
+    return length;
+}
+
+template<typename CharT>
+inline void str_view_rope_template<CharT>::to_string(StringT& dst, size_t offset, size_t length) const
+{
+    assert(offset <= m_Length);
+    length = std::min(length, m_Length - offset);
+    dst.resize(length);
+    if(length > 0)
+        copy_to(&dst[0], offset, length);
+}
+
+template<typename CharT>
+inline void str_view_rope_template<CharT>::append_to(StringT& dst, size_t offset, size_t length) const
+{
+    assert(offset <= m_Length);
+    length = std::min(length, m_Length - offset);
+    if(length == 0)
+        return;
+    const size_t oldLength = dst.length();
+    dst.resize(oldLength + length);
+    copy_to(&dst[oldLength], offset, length);
+}
+
+template<typename CharT>
+inline int str_view_rope_template<CharT>::compare_range(size_t pos, const str_view_template<CharT>* rhsPieces, size_t count, bool caseSensitive) const
+{
+    if(count == 0)
+        return 0;
+    size_t lhsIndex = find_piece(pos);
+    size_t lhsPos = pos - m_PieceOffsets[lhsIndex];
+    size_t rhsPos = 0;
+    while(count > 0)
+    {
+        // Empty pieces may come only from rhs given as a single str_view.
+        if(rhsPos == rhsPieces->length())
+        {
+            ++rhsPieces;
+            rhsPos = 0;
+            continue;
+        }
+        const str_view_template<CharT>& lhsPiece = m_Pieces[lhsIndex];
+        const size_t chunkLen = std::min(count, std::min(lhsPiece.length() - lhsPos, rhsPieces->length() - rhsPos));
+        const int result = str_view_binary_compare::compare(lhsPiece.data() + lhsPos, rhsPieces->data() + rhsPos, chunkLen, caseSensitive);
+        if(result != 0)
+            return result;
+        count -= chunkLen;
+        lhsPos += chunkLen;
+        rhsPos += chunkLen;
+        if(lhsPos == lhsPiece.length())
+        {
+            ++lhsIndex;
+            lhsPos = 0;
+        }
+    }
+    return 0;
+}
+
+template<typename CharT>
+inline int str_view_rope_template<CharT>::compare(const str_view_template<CharT>& rhs, bool case_sensitive) const
+{
+    const size_t rhsLen = rhs.length();
+    const int result = compare_range(0, &rhs, std::min(m_Length, rhsLen), case_sensitive);
+    if(result != 0)
+        return result;
+    return m_Length < rhsLen ? -1 : m_Length > rhsLen ? 1 : 0;
+}
+
+template<typename CharT>
+inline int str_view_rope_template<CharT>::compare(const str_view_rope_template<CharT>& rhs, bool case_sensitive) const
+{
+    const int result = compare_range(0, rhs.m_Pieces.data(), std::min(m_Length, rhs.m_Length), case_sensitive);
+    if(result != 0)
+        return result;
+    return m_Length < rhs.m_Length ? -1 : m_Length > rhs.m_Length ? 1 : 0;
+}
+
+template<typename CharT>
+inline bool str_view_rope_template<CharT>::starts_with(const str_view_template<CharT>& prefix, bool case_sensitive) const
+{
+    const size_t prefixLen = prefix.length();
+    return prefixLen <= m_Length && compare_range(0, &prefix, prefixLen, case_sensitive) == 0;
+}
+
+template<typename CharT>
+inline bool str_view_rope_template<CharT>::ends_with(const str_view_template<CharT>& suffix, bool case_sensitive) const
+{
+    const size_t suffixLen = suffix.length();
+    return suffixLen <= m_Length && compare_range(m_Length - suffixLen, &suffix, suffixLen, case_sensitive) == 0;
+}
+
+template<typename CharT>
+inline size_t str_view_rope_template<CharT>::find(CharT ch, size_t pos) const
+{
+    if(pos >= m_Length)
+        return SIZE_MAX;
+    for(size_t i = find_piece(pos); i < m_Pieces.size(); ++i)
+    {
+        const size_t offset = m_PieceOffsets[i];
+        const size_t found = m_Pieces[i].find(ch, pos > offset ? pos - offset : 0);
+        if(found != SIZE_MAX)
+            return offset + found;
+    }
+    return SIZE_MAX;
+}
+
+template<typename CharT>
+inline size_t str_view_rope_template<CharT>::find(const str_view_template<CharT>& substr, size_t pos) const
+{
+    const size_t subLen = substr.length();
+    if(subLen == 0)
+        return pos;
+    if(pos >= m_Length || m_Length - pos < subLen)
+        return SIZE_MAX;
+    // Occurrences crossing borders are searched in a copy of characters around the border.
+    StringT border;
+    for(size_t i = find_piece(pos); i < m_Pieces.size(); ++i)
+    {
+        const size_t offset = m_PieceOffsets[i];
+        const size_t pieceLen = m_Pieces[i].length();
+        const size_t localPos = pos > offset ? pos - offset : 0;
+        if(localPos + subLen <= pieceLen)
+        {
+            const size_t found = m_Pieces[i].find(substr, localPos);
+            if(found != SIZE_MAX)
+                return offset + found;
+        }
+        const size_t pieceEnd = offset + pieceLen;
+        if(pieceEnd == m_Length)
+            break;
+        const size_t borderBegin = offset + std::max(localPos, pieceLen >= subLen ? pieceLen - (subLen - 1) : 0);
+        const size_t borderEnd = std::min(m_Length, pieceEnd + (subLen - 1));
+        if(borderEnd - borderBegin < subLen)
+            continue;
+        to_string(border, borderBegin, borderEnd - borderBegin);
+        const size_t found = str_view_template<CharT>(border).find(substr);
+        if(found != SIZE_MAX && borderBegin + found < pieceEnd)
+            return borderBegin + found;
+    }
+    return SIZE_MAX;
+}
+
+template<typename CharT>
+inline size_t str_view_rope_template<CharT>::find_first_of(const str_view_template<CharT>& chars, size_t pos) const
+{
+    return find_first_of(char_set_template<CharT>(chars), pos);
+}
+
+template<typename CharT>
+inline size_t str_view_rope_template<CharT>::find_first_of(const char_set_template<CharT>& chars, size_t pos) const
+{
+    if(pos >= m_Length)
+        return SIZE_MAX;
+    for(size_t i = find_piece(pos); i < m_Pieces.size(); ++i)
+    {
+        const size_t offset = m_PieceOffsets[i];
+        const size_t found = m_Pieces[i].find_first_of(chars, pos > offset ? pos - offset : 0);
+        if(found != SIZE_MAX)
+            return offset + found;
+    }
+    return SIZE_MAX;
+}
+
+template<typename CharT>
+template<typename FindT, typename Func>
+inline size_t str_view_rope_template<CharT>::split_by(const FindT& findSeparator, size_t separatorLen, Func& func) const
+{
+    str_view_rope_template<CharT> part;
+    size_t count = 1;
+    size_t partBegin = 0;
+    for(;; ++count)
+    {
+        const size_t separatorPos = findSeparator(partBegin);
+        if(separatorPos == SIZE_MAX)
+            break;
+        get_substr(part, partBegin, separatorPos - partBegin);
+        func(part);
+        partBegin = separatorPos + separatorLen;
+    }
+    get_substr(part, partBegin, SIZE_MAX);
+    func(part);
+    return count;
+}
+
+template<typename CharT>
+template<typename Func>
+inline size_t str_view_rope_template<CharT>::split(CharT separator, Func func) const
+{
+    return split_by([this, separator](size_t pos) { return find(separator, pos); }, 1, func);
+}
+
+template<typename CharT>
+template<typename Func>
+inline size_t str_view_rope_template<CharT>::split(const str_view_template<CharT>& separator, Func func) const
+{
+    assert(!separator.empty());
+    return split_by([this, &separator](size_t pos) { return find(separator, pos); }, separator.length(), func);
+}
+
+/*
+Incremental search of a substring in a stream of chunks, like network reads or blocks of
+a file, which are given one by one to feed(). Occurrences that span many chunks are found
+too. Only the last length() - 1 characters of the stream are remembered, so chunks don't
+have to remain alive after feed() returns.
+
+The needle must not be empty. The searcher copies it.
+*/
+template<typename CharT>
+class str_view_stream_searcher_template
+{
+public:
+    inline str_view_stream_searcher_template(const str_view_template<CharT>& needle);
+    inline str_view_stream_searcher_template(const str_view_stream_searcher_template<CharT>& src);
+    str_view_stream_searcher_template<CharT>& operator=(const str_view_stream_searcher_template<CharT>&) = delete;
+
+    // Returns the number of characters in the needle.
+    inline size_t length() const { return m_Needle.size(); }
+    // Returns number of characters fed so far.
+    inline size_t position() const { return m_Position; }
+    // Starts a new stream.
+    inline void reset() { m_Tail.clear(); m_Position = 0; }
+
+    /*
+    Appends next chunk to the stream. Calls func(size_t pos) for every occurrence of the needle
+    that ends in this chunk, in order, with pos counted from the beginning of the stream.
+    Occurrences may overlap, like in str_view_searcher_template::find_all().
+    Returns number of occurrences found.
+    */
+    template<typename Func>
+    inline size_t feed(const str_view_template<CharT>& chunk, Func func);
+
+private:
+    typedef std::basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT>> StringT;
+
+    std::vector<CharT> m_Needle;
+    str_view_searcher_template<CharT> m_Searcher;
+    // Last characters of the stream, fewer than the needle.
+    StringT m_Tail;
+    // Tail followed by beginning of the chunk, to search occurrences across the border.
+    StringT m_Border;
+    size_t m_Position;
+};
+
+typedef str_view_stream_searcher_template<char> str_view_stream_searcher;
+typedef str_view_stream_searcher_template<wchar_t> wstr_view_stream_searcher;
+
+template<typename CharT>
+inline str_view_stream_searcher_template<CharT>::str_view_stream_searcher_template(const str_view_template<CharT>& needle) :
+    m_Needle(needle.begin(), needle.end()),
+    m_Searcher(str_view_template<CharT>(m_Needle.data(), m_Needle.size())),
+    m_Position(0)
+{
+    assert(!m_Needle.empty());
+}
+
+template<typename CharT>
+inline str_view_stream_searcher_template<CharT>::str_view_stream_searcher_template(const str_view_stream_searcher_template<CharT>& src) :
+    m_Needle(src.m_Needle),
+    m_Searcher(str_view_template<CharT>(m_Needle.data(), m_Needle.size())),
+    m_Tail(src.m_Tail),
+    m_Position(src.m_Position)
+{
+}
+
+template<typename CharT>
+template<typename Func>
+inline size_t str_view_stream_searcher_template<CharT>::feed(const str_view_template<CharT>& chunk, Func func)
+{
+    const size_t chunkLen = chunk.length();
+    const size_t keepLen = m_Needle.size() - 1;
+    const size_t tailLen = m_Tail.length();
+    const size_t tailPos = m_Position - tailLen;
+    size_t count = 0;
+    if(tailLen > 0 && chunkLen > 0)
+    {
+        m_Border.assign(m_Tail);
+        m_Border.append(chunk.data(), std::min(chunkLen, keepLen));
+        m_Searcher.find_all(str_view_template<CharT>(m_Border), [&](size_t pos) {
+            if(pos < tailLen)
+            {
+                func(tailPos + pos);
+                ++count;
+            }
+        });
+    }
+    const size_t chunkPos = m_Position;
+    count += m_Searcher.find_all(chunk, [&](size_t pos) { func(chunkPos + pos); });
+
+    if(chunkLen >= keepLen)
+        m_Tail.assign(chunk.data() + (chunkLen - keepLen), keepLen);
+    else
+    {
+        m_Tail.append(chunk.data(), chunkLen);
+        if(m_Tail.length() > keepLen)
+            m_Tail.erase(0, m_Tail.length() - keepLen);
+    }
+    m_Position += chunkLen;
+    return count;
+}
+
+namespace str_view_detail
+{
+
+enum : uint32_t { UTF8_INVALID = UINT32_MAX, UNICODE_REPLACEMENT = 0xFFFD };
+
+STR_VIEW_SIMD_KERNELS_BEGIN
+
+// Returns number of characters at the beginning of str that are ASCII, i.e. less than 0x80.
+template<typename S, typename CharT>
+STR_VIEW_SIMD_INLINE size_t simd_ascii_prefix_length(const CharT* str, size_t length)
+{
+    typedef typename std::make_unsigned<CharT>::type UCharT;
+    size_t i = 0;
+#if STR_VIEW_HAS_SIMD
+    const size_t step = S::BYTES / sizeof(CharT);
+    const unsigned bitsPerChar = S::BITS_PER_BYTE * sizeof(CharT);
+    const uint64_t allMask = S::BYTES * S::BITS_PER_BYTE == 64 ?
+        ~0ull : (1ull << (S::BYTES * S::BITS_PER_BYTE)) - 1;
+    const typename S::vec highBits = S::template splat<CharT>((CharT)~(UCharT)0x7F);
+    const typename S::vec zero = S::template splat<CharT>((CharT)0);
+    for(; i + step <= length; i += step)
+    {
+        const uint64_t asciiMask = S::mask(S::template cmpeq<CharT>(S::bit_and(S::load(str + i), highBits), zero));
+        if(asciiMask != allMask)
+            return i + bit_scan_forward(~asciiMask & allMask) / bitsPerChar;
+    }
+#endif
+    for(; i < length && (UCharT)str[i] < 0x80; ++i) { }
+    return i;
+}
+
+#if STR_VIEW_DISPATCH
+template<typename CharT>
+STR_VIEW_TARGET_AVX2 size_t ascii_prefix_length_avx2(const CharT* str, size_t length)
+{
+    return simd_ascii_prefix_length<simd_avx2>(str, length);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX512 size_t ascii_prefix_length_avx512(const CharT* str, size_t length)
+{
+    return simd_ascii_prefix_length<simd_avx512>(str, length);
+}
+#endif
+
+STR_VIEW_SIMD_KERNELS_END
+
+template<typename CharT>
+inline size_t ascii_prefix_length(const CharT* str, size_t length)
+{
+#if STR_VIEW_DISPATCH
+    if(length * sizeof(CharT) >= DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = dispatch_kernel(&ascii_prefix_length_avx2<CharT>, &ascii_prefix_length_avx512<CharT>);
+        if(kernel)
+            return kernel(str, length);
+    }
+#endif
+    return simd_ascii_prefix_length<simd_best>(str, length);
+}
+
+/*
+Decodes one UTF-8 sequence from str, which must not be empty, and returns number of bytes taken.
+Sequences that are not well-formed according to table 3-7 of the Unicode Standard - overlong,
+encoding surrogates or values above 0x10FFFF, truncated - give outCodePoint = UTF8_INVALID.
+Then the maximal subpart of the sequence is taken, as the standard recommends for replacement.
+*/
+inline size_t utf8_decode(const char* str, size_t length, uint32_t& outCodePoint)
+{
+    const unsigned lead = (unsigned char)str[0];
+    if(lead < 0x80)
+    {
+        outCodePoint = lead;
+        return 1;
+    }
+    size_t count;
+    uint32_t codePoint;
+    unsigned low = 0x80, high = 0xBF;
+    if(lead < 0xC2)
+    {
+        outCodePoint = UTF8_INVALID;
+        return 1;
+    }
+    if(lead < 0xE0)
+    {
+        count = 2;
+        codePoint = lead & 0x1F;
+    }
+    else if(lead < 0xF0)
+    {
+        count = 3;
+        codePoint = lead & 0x0F;
+        if(lead == 0xE0)
+            low = 0xA0;
+        else if(lead == 0xED)
+            high = 0x9F;
+    }
+    else if(lead < 0xF5)
+    {
+        count = 4;
+        codePoint = lead & 0x07;
+        if(lead == 0xF0)
+            low = 0x90;
+        else if(lead == 0xF4)
+            high = 0x8F;
+    }
+    else
+    {
+        outCodePoint = UTF8_INVALID;
+        return 1;
+    }
+    for(size_t i = 1; i < count; ++i)
+    {
+        const unsigned ch = i < length ? (unsigned char)str[i] : 0;
+        if(ch < low || ch > high)
+        {
+            outCodePoint = UTF8_INVALID;
+            return i;
+        }
+        codePoint = (codePoint << 6) | (ch & 0x3F);
+        low = 0x80;
+        high = 0xBF;
+    }
+    outCodePoint = codePoint;
+    return count;
+}
+
+/*
+Decodes one code point from str of wchar_t, which must not be empty, and returns number of
+characters taken. wchar_t is UTF-16 if it has 2 bytes, like on Windows, or UTF-32 otherwise.
+Unpaired surrogates and values above 0x10FFFF give outCodePoint = UTF8_INVALID.
+*/
+inline size_t wide_decode(const wchar_t* str, size_t length, uint32_t& outCodePoint)
+{
+    const uint32_t ch = (uint32_t)str[0];
+    if(sizeof(wchar_t) == 2)
+    {
+        const uint32_t unit = ch & 0xFFFF;
+        if(unit >= 0xD800 && unit <= 0xDBFF && length > 1)
+        {
+            const uint32_t next = (uint32_t)str[1] & 0xFFFF;
+            if(next >= 0xDC00 && next <= 0xDFFF)
+            {
+                outCodePoint = 0x10000 + ((unit - 0xD800) << 10) + (next - 0xDC00);
+                return 2;
+            }
+        }
+        outCodePoint = unit >= 0xD800 && unit <= 0xDFFF ? UTF8_INVALID : unit;
+        return 1;
+    }
+    outCodePoint = ch > 0x10FFFF || (ch >= 0xD800 && ch <= 0xDFFF) ? UTF8_INVALID : ch;
+    return 1;
+}
+
+// Returns number of wchar_t needed for the code point.
+inline size_t wide_code_point_length(uint32_t codePoint)
+{
+    return sizeof(wchar_t) == 2 && codePoint >= 0x10000 ? 2 : 1;
+}
+
+inline size_t wide_encode(uint32_t codePoint, wchar_t* dst)
+{
+    if(sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+    {
+        dst[0] = (wchar_t)(0xD800 + ((codePoint - 0x10000) >> 10));
+        dst[1] = (wchar_t)(0xDC00 + ((codePoint - 0x10000) & 0x3FF));
+        return 2;
+    }
+    dst[0] = (wchar_t)codePoint;
+    return 1;
+}
+
+// Returns number of bytes of UTF-8 sequence for the code point.
+inline size_t utf8_code_point_length(uint32_t codePoint)
+{
+    return codePoint < 0x80 ? 1 : codePoint < 0x800 ? 2 : codePoint < 0x10000 ? 3 : 4;
+}
+
+inline size_t utf8_encode(uint32_t codePoint, char* dst)
+{
+    if(codePoint < 0x80)
+    {
+        dst[0] = (char)codePoint;
+        return 1;
+    }
+    if(codePoint < 0x800)
+    {
+        dst[0] = (char)(0xC0 | (codePoint >> 6));
+        dst[1] = (char)(0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    if(codePoint < 0x10000)
+    {
+        dst[0] = (char)(0xE0 | (codePoint >> 12));
+        dst[1] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        dst[2] = (char)(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    dst[0] = (char)(0xF0 | (codePoint >> 18));
+    dst[1] = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+    dst[2] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+    dst[3] = (char)(0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+STR_VIEW_SIMD_KERNELS_BEGIN
+
+#if STR_VIEW_HAS_SIMD_SHUFFLE || STR_VIEW_DISPATCH
+
+/*
+Validates UTF-8 with table lookups, as described in "Validating UTF-8 In Less Than One
+Instruction Per Byte" by John Keiser and Daniel Lemire. Every pair of adjacent bytes is
+classified by three lookups: high and low nibble of the first byte and high nibble
+of the second. Each gives a bit for every kind of error that the pair may be, so AND
+of them is nonzero only for an invalid pair. The only exception is UTF8_TWO_CONTS,
+which is valid where the byte before the pair starts a 3-byte or 4-byte sequence.
+*/
+enum
+{
+    UTF8_TOO_SHORT = 1 << 0, // Lead byte not followed by a continuation byte.
+    UTF8_TOO_LONG = 1 << 1, // Continuation byte after ASCII.
+    UTF8_OVERLONG_3 = 1 << 2, // E0 80..9F.
+    UTF8_TOO_LARGE = 1 << 3, // F4 90..BF, F5..FF.
+    UTF8_SURROGATE = 1 << 4, // ED A0..BF.
+    UTF8_OVERLONG_2 = 1 << 5, // C0, C1.
+    UTF8_TOO_LARGE_1000 = 1 << 6, // F5..FF 80..8F.
+    UTF8_OVERLONG_4 = 1 << 6, // F0 80..8F.
+    UTF8_TWO_CONTS = 1 << 7, // Continuation byte after continuation byte.
+    UTF8_CARRY = UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS // Errors independent of the low nibble.
+};
+
+template<typename Simd>
+STR_VIEW_SIMD_INLINE bool simd_utf8_validate(const char* str, size_t length)
+{
+    typedef typename Simd::vec vec;
+    static const uint8_t byte1HighTable[16] = {
+        // 0_______: ASCII.
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        // 10______: continuation.
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+        // 1100____, 1101____: lead of 2 bytes.
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+        UTF8_TOO_SHORT,
+        // 1110____: lead of 3 bytes.
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        // 1111____: lead of 4 bytes or invalid.
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4 };
+    static const uint8_t byte1LowTable[16] = {
+        // ____0000, ____0001
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+        UTF8_CARRY | UTF8_OVERLONG_2,
+        // ____0010, ____0011
+        UTF8_CARRY,
+        UTF8_CARRY,
+        // ____0100, ____0101
+        UTF8_CARRY | UTF8_TOO_LARGE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        // ____011_
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        // ____1___, ____1101 also for ED.
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 };
+    static const uint8_t byte2HighTable[16] = {
+        // 0_______: ASCII.
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        // 1000____, 1001____, 101_____: continuation.
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        // 11______: lead.
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT };
+    // Block ending with any byte greater than these starts a sequence that continues in the next one.
+    static const uint8_t incompleteMax[64] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF };
+    const vec byte1High = Simd::table16(byte1HighTable);
+    const vec byte1Low = Simd::table16(byte1LowTable);
+    const vec byte2High = Simd::table16(byte2HighTable);
+    const vec maxValue = Simd::load(incompleteMax + sizeof(incompleteMax) - Simd::BYTES);
+    const vec lowNibble = Simd::template splat<char>(0x0F);
+    const vec highBit = Simd::template splat<char>((char)0x80);
+    // Saturating subtraction leaves high bit set only in bytes 111_____ and 1111____.
+    const vec thirdByteLead = Simd::template splat<char>((char)(0xE0 - 0x80));
+    const vec fourthByteLead = Simd::template splat<char>((char)(0xF0 - 0x80));
+    vec prevInput = Simd::template splat<char>(0);
+    vec prevIncomplete = prevInput;
+    vec error = prevInput;
+    for(size_t i = 0; i < length; i += Simd::BYTES)
+    {
+        vec input;
+        if(i + Simd::BYTES <= length)
+            input = Simd::load(str + i);
+        else
+        {
+            // Last block is padded with null characters, which are ASCII.
+            char last[Simd::BYTES] = {};
+            memcpy(last, str + i, length - i);
+            input = Simd::load(last);
+        }
+        if(!Simd::any(Simd::bit_and(input, highBit)))
+        {
+            // ASCII block is valid if the previous one didn't end in the middle of a sequence.
+            error = Simd::bit_or(error, prevIncomplete);
+            continue;
+        }
+        const vec prev1 = Simd::template prev<1>(input, prevInput);
+        const vec special = Simd::bit_and(Simd::bit_and(
+            Simd::lookup16(byte1High, Simd::shr4(prev1)),
+            Simd::lookup16(byte1Low, Simd::bit_and(prev1, lowNibble))),
+            Simd::lookup16(byte2High, Simd::shr4(input)));
+        const vec thirdOrFourth = Simd::bit_and(highBit, Simd::bit_or(
+            Simd::subs_u8(Simd::template prev<2>(input, prevInput), thirdByteLead),
+            Simd::subs_u8(Simd::template prev<3>(input, prevInput), fourthByteLead)));
+        error = Simd::bit_or(error, Simd::bit_xor(thirdOrFourth, special));
+        prevIncomplete = Simd::subs_u8(input, maxValue);
+        prevInput = input;
+    }
+    return !Simd::any(Simd::bit_or(error, prevIncomplete));
+}
+
+#endif // #if STR_VIEW_HAS_SIMD_SHUFFLE || STR_VIEW_DISPATCH
+
+STR_VIEW_SIMD_KERNELS_END
+
+#if STR_VIEW_DISPATCH
+inline STR_VIEW_TARGET_AVX2 bool utf8_validate_avx2(const char* str, size_t length)
+{
+    return simd_utf8_validate<simd_avx2>(str, length);
+}
+inline STR_VIEW_TARGET_AVX512 bool utf8_validate_avx512(const char* str, size_t length)
+{
+    return simd_utf8_validate<simd_avx512>(str, length);
+}
+#endif
+
+/*
+Transcoding loops. Runs of ASCII characters, found with SIMD, are copied in a simple loop
+that the compiler vectorizes. Other characters are decoded one code point at a time.
+Invalid code points are replaced with U+FFFD.
+Validation of strings of at least one register uses table lookups where the backend has a byte shuffle.
+*/
+inline bool utf8_validate(const char* str, size_t length)
+{
+#if STR_VIEW_DISPATCH
+    // Without a shuffle the build validates with scalar code, which is slower than a call already for one register.
+    if(length >= (STR_VIEW_HAS_SIMD_SHUFFLE ? (size_t)DISPATCH_MIN_BYTES : (size_t)simd_avx512::BYTES))
+    {
+        static const auto kernel = dispatch_kernel(&utf8_validate_avx2, &utf8_validate_avx512);
+        if(kernel)
+            return kernel(str, length);
+    }
+#endif
+#if STR_VIEW_HAS_SIMD_SHUFFLE
+    if(length >= simd_best::BYTES)
+        return simd_utf8_validate<simd_best>(str, length);
+#endif
+    for(size_t i = 0; i < length; )
+    {
+        if((unsigned char)str[i] < 0x80)
+        {
+            i += ascii_prefix_length(str + i, length - i);
+            continue;
+        }
+        uint32_t codePoint;
+        i += utf8_decode(str + i, length - i, codePoint);
+        if(codePoint == UTF8_INVALID)
+            return false;
+    }
+    return true;
+}
+
+inline size_t utf8_to_wide_length(const char* str, size_t length)
+{
+    size_t result = 0;
+    for(size_t i = 0; i < length; )
+    {
+        if((unsigned char)str[i] < 0x80)
+        {
+            const size_t asciiLen = ascii_prefix_length(str + i, length - i);
+            i += asciiLen;
+            result += asciiLen;
+            continue;
+        }
+        uint32_t codePoint;
+        i += utf8_decode(str + i, length - i, codePoint);
+        result += codePoint == UTF8_INVALID ? 1 : wide_code_point_length(codePoint);
+    }
+    return result;
+}
+
+inline size_t utf8_to_wide(const char* str, size_t length, wchar_t* dst)
+{
+    wchar_t* const dstBegin = dst;
+    for(size_t i = 0; i < length; )
+    {
+        if((unsigned char)str[i] < 0x80)
+        {
+            const size_t asciiLen = ascii_prefix_length(str + i, length - i);
+            for(size_t j = 0; j < asciiLen; ++j)
+                dst[j] = (wchar_t)str[i + j];
+            i += asciiLen;
+            dst += asciiLen;
+            continue;
+        }
+        uint32_t codePoint;
+        i += utf8_decode(str + i, length - i, codePoint);
+        dst += wide_encode(codePoint == UTF8_INVALID ? UNICODE_REPLACEMENT : codePoint, dst);
+    }
+    return (size_t)(dst - dstBegin);
+}
+
+inline size_t wide_to_utf8_length(const wchar_t* str, size_t length)
+{
+    size_t result = 0;
+    for(size_t i = 0; i < length; )
+    {
+        if((uint32_t)str[i] < 0x80)
+        {
+            const size_t asciiLen = ascii_prefix_length(str + i, length - i);
+            i += asciiLen;
+            result += asciiLen;
+            continue;
+        }
+        uint32_t codePoint;
+        i += wide_decode(str + i, length - i, codePoint);
+        result += utf8_code_point_length(codePoint == UTF8_INVALID ? UNICODE_REPLACEMENT : codePoint);
+    }
+    return result;
+}
+
+inline size_t wide_to_utf8(const wchar_t* str, size_t length, char* dst)
+{
+    char* const dstBegin = dst;
+    for(size_t i = 0; i < length; )
+    {
+        if((uint32_t)str[i] < 0x80)
+        {
+            const size_t asciiLen = ascii_prefix_length(str + i, length - i);
+            for(size_t j = 0; j < asciiLen; ++j)
+                dst[j] = (char)str[i + j];
+            i += asciiLen;
+            dst += asciiLen;
+            continue;
+        }
+        uint32_t codePoint;
+        i += wide_decode(str + i, length - i, codePoint);
+        dst += utf8_encode(codePoint == UTF8_INVALID ? UNICODE_REPLACEMENT : codePoint, dst);
+    }
+    return (size_t)(dst - dstBegin);
+}
+
+} // namespace str_view_detail
+
+template<typename CharT>
+inline bool str_view_template<CharT>::is_valid_utf8() const
+{
+    return to_lite().is_valid_utf8();
+}
+
+template<typename CharT>
+inline bool str_view_lite_template<CharT>::is_valid_utf8() const
+{
+    static_assert(sizeof(CharT) == 1, "is_valid_utf8() is available only for strings of char.");
+    return str_view_detail::utf8_validate((const char*)m_Begin, m_Length);
+}
+
+/*
+Conversion of UTF-8 to wchar_t strings and back. wchar_t strings are UTF-16 where wchar_t
+has 2 bytes, like on Windows, and UTF-32 otherwise. Invalid sequences are replaced with
+U+FFFD, like MultiByteToWideChar does by default. Use is_valid_utf8() to reject them instead.
+Null characters are converted like any other.
+*/
+
+// Returns number of wchar_t characters that the UTF-8 string converts to.
+inline size_t str_view_utf8_to_wide_length(const str_view_lite& src)
+{
+    return str_view_detail::utf8_to_wide_length(src.data(), src.length());
+}
+
+/*
+Converts UTF-8 string to dst and adds null character. dst must have room for
+str_view_utf8_to_wide_length(src) + 1 characters - src.length() + 1 is always enough.
+Returns number of characters written, not including the null character.
+*/
+inline size_t str_view_utf8_to_wide(const str_view_lite& src, wchar_t* dst)
+{
+    const size_t result = str_view_detail::utf8_to_wide(src.data(), src.length(), dst);
+    dst[result] = L'\0';
+    return result;
+}
+
+/*
+Converts UTF-8 string to a null-terminated string allocated from arena, so c_str() doesn't
+make a copy. The result may be used until the arena is reset.
+*/
+inline wstr_view str_view_utf8_to_wide(const str_view_lite& src, str_view_monotonic_arena& arena)
+{
+    const size_t length = str_view_utf8_to_wide_length(src);
+    wchar_t* const dst = (wchar_t*)arena.allocate((length + 1) * sizeof(wchar_t), alignof(wchar_t));
+    str_view_utf8_to_wide(src, dst);
+    return wstr_view(dst, length, wstr_view::StillNullTerminated());
+}
+
+// Replaces content of dst with converted string. Capacity of dst is reused.
+inline void str_view_utf8_to_wide(const str_view_lite& src, std::wstring& dst)
+{
+    dst.resize(src.length());
+    dst.resize(str_view_detail::utf8_to_wide(src.data(), src.length(), &dst[0]));
+}
+
+// Returns number of bytes that the wchar_t string converts to in UTF-8.
+inline size_t str_view_wide_to_utf8_length(const wstr_view_lite& src)
+{
+    return str_view_detail::wide_to_utf8_length(src.data(), src.length());
+}
+
+// Returns maximum number of bytes that a wchar_t string of given length can convert to in UTF-8.
+inline STR_VIEW_CONSTEXPR size_t str_view_wide_to_utf8_max_length(size_t wideLength)
+{
+    return wideLength * (sizeof(wchar_t) == 2 ? 3 : 4);
+}
+
+/*
+Converts wchar_t string to dst in UTF-8 and adds null character. dst must have room for
+str_view_wide_to_utf8_length(src) + 1 characters, or str_view_wide_to_utf8_max_length(src.length()) + 1.
+Returns number of characters written, not including the null character.
+*/
+inline size_t str_view_wide_to_utf8(const wstr_view_lite& src, char* dst)
+{
+    const size_t result = str_view_detail::wide_to_utf8(src.data(), src.length(), dst);
+    dst[result] = '\0';
+    return result;
+}
+
+inline str_view str_view_wide_to_utf8(const wstr_view_lite& src, str_view_monotonic_arena& arena)
+{
+    const size_t length = str_view_wide_to_utf8_length(src);
+    char* const dst = (char*)arena.allocate(length + 1, 1);
+    str_view_wide_to_utf8(src, dst);
+    return str_view(dst, length, str_view::StillNullTerminated());
+}
+
+inline void str_view_wide_to_utf8(const wstr_view_lite& src, std::string& dst)
+{
+    dst.resize(str_view_wide_to_utf8_max_length(src.length()));
+    dst.resize(str_view_detail::wide_to_utf8(src.data(), src.length(), &dst[0]));
+}
+
+namespace str_view_detail
+{
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+enum { SWAR_DIGITS = 0 };
+#else
+enum { SWAR_DIGITS = 1 };
+#endif
+/*
+Fast path of float parsing is exact only if arithmetic on float and double is done in their
+own precision, not in a wider one like on x87 FPU.
+*/
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+enum { EXACT_FLOAT_ARITHMETIC = 0 };
+#else
+enum { EXACT_FLOAT_ARITHMETIC = 1 };
+#endif
+
+template<typename NumberT>
+struct is_parsable_number
+{
+    enum { value = (std::is_integral<NumberT>::value &&
+        !std::is_same<NumberT, bool>::value && !std::is_same<NumberT, char>::value &&
+        !std::is_same<NumberT, wchar_t>::value && !std::is_same<NumberT, char16_t>::value &&
+        !std::is_same<NumberT, char32_t>::value) ||
+        std::is_same<NumberT, float>::value || std::is_same<NumberT, double>::value };
+};
+
+// Returns value of a decimal digit, or a number greater than 9 if ch is not a digit.
+template<typename CharT>
+inline unsigned digit_value(CharT ch) { return (unsigned)(ch - (CharT)'0'); }
+
+// Tells whether all 8 bytes of chunk are ASCII digits.
+inline bool swar_is_8_digits(uint64_t chunk)
+{
+    return ((chunk & 0xF0F0F0F0F0F0F0F0ull) |
+        (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+/*
+Converts 8 ASCII digits loaded as little-endian 64-bit number, first digit in the lowest byte.
+Adjacent digits are combined into pairs, then pairs into quadruples, with 3 multiplications instead of 8.
+*/
+inline uint32_t swar_parse_8_digits(uint64_t chunk)
+{
+    const uint64_t mask = 0x000000FF000000FFull;
+    const uint64_t mul1 = 100 + (1000000ull << 32);
+    const uint64_t mul2 = 1 + (10000ull << 32);
+    chunk -= 0x3030303030303030ull;
+    chunk = chunk * 10 + (chunk >> 8);
+    return (uint32_t)(((chunk & mask) * mul1 + ((chunk >> 16) & mask) * mul2) >> 32);
+}
+
+/*
+Appends decimal digits from the beginning of str to value, without checking for overflow.
+Returns number of digits taken. Strings of char are taken 8 digits at a time.
+*/
+template<typename CharT>
+inline size_t accumulate_digits(const CharT* str, size_t length, uint64_t& value)
+{
+    size_t i = 0;
+    if(sizeof(CharT) == 1 && SWAR_DIGITS)
+    {
+        for(; i + 8 <= length; i += 8)
+        {
+            uint64_t chunk;
+            memcpy(&chunk, str + i, 8);
+            if(!swar_is_8_digits(chunk))
+                break;
+            value = value * 100000000 + swar_parse_8_digits(chunk);
+        }
+    }
+    for(unsigned digit; i < length && (digit = digit_value(str[i])) <= 9; ++i)
+        value = value * 10 + digit;
+    return i;
+}
+
+/*
+Parses decimal digits from the beginning of str. Returns number of digits taken, 0 if there are none.
+All digits are taken even if their value doesn't fit in uint64_t, which sets outOverflow.
+*/
+template<typename CharT>
+inline size_t parse_uint64(const CharT* str, size_t length, uint64_t& outValue, bool& outOverflow)
+{
+    size_t i = 0;
+    while(i < length && str[i] == (CharT)'0')
+        ++i;
+    // Any 19 digits fit in uint64_t, only the 20th may overflow.
+    uint64_t value = 0;
+    const size_t significantCount = accumulate_digits(str + i, std::min<size_t>(length - i, 19), value);
+    i += significantCount;
+    outOverflow = false;
+    unsigned digit;
+    if(significantCount == 19 && i < length && (digit = digit_value(str[i])) <= 9)
+    {
+        outOverflow = value > (UINT64_MAX - digit) / 10;
+        value = value * 10 + digit;
+        for(++i; i < length && digit_value(str[i]) <= 9; ++i)
+            outOverflow = true;
+    }
+    outValue = value;
+    return i;
+}
+
+// Returns length of the number at the beginning of str, or 0 if there is no valid number or it's out of range.
+template<typename CharT, typename IntT>
+inline size_t parse_number(const CharT* str, size_t length, IntT& outValue, std::false_type /*isFloat*/)
+{
+    typedef typename std::make_unsigned<IntT>::type UIntT;
+    size_t i = 0;
+    bool negative = false;
+    if(length > 0 && (str[0] == (CharT)'-' || str[0] == (CharT)'+'))
+    {
+        negative = str[0] == (CharT)'-';
+        i = 1;
+    }
+    uint64_t magnitude;
+    bool overflow;
+    const size_t digitCount = parse_uint64(str + i, length - i, magnitude, overflow);
+    if(digitCount == 0 || overflow)
+        return 0;
+    // Unsigned types accept only "-0" as a negative number.
+    uint64_t maxMagnitude = (uint64_t)std::numeric_limits<IntT>::max();
+    if(negative)
+        maxMagnitude = std::numeric_limits<IntT>::is_signed ? maxMagnitude + 1 : 0;
+    if(magnitude > maxMagnitude)
+        return 0;
+    outValue = negative ? (IntT)(UIntT)(0 - magnitude) : (IntT)magnitude;
+    return i + digitCount;
+}
 
+// Returns length of ASCII word at the beginning of str compared case-insensitively, or 0 if it's not there.
 template<typename CharT>
-class str_view_template
+inline size_t match_word_ci(const CharT* str, size_t length, const char* word)
+{
+    size_t i = 0;
+    for(; word[i] != '\0'; ++i)
+        if(i == length || (str[i] | 0x20) != (CharT)word[i])
+            return 0;
+    return i;
+}
+
+template<typename FloatT>
+inline FloatT exact_power_of_10(size_t exponent)
+{
+    static const double POWERS[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    return (FloatT)POWERS[exponent];
+}
+
+#if STR_VIEW_HAS_STRTOD_L
+// "C" locale, created on first use and never freed.
+#if defined(_MSC_VER)
+inline _locale_t c_locale()
+{
+    static const _locale_t locale = _create_locale(LC_ALL, "C");
+    return locale;
+}
+inline float strto_float(const char* str, char** end, float) { return _strtof_l(str, end, c_locale()); }
+inline double strto_float(const char* str, char** end, double) { return _strtod_l(str, end, c_locale()); }
+#else
+inline locale_t c_locale()
+{
+    static const locale_t locale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+    return locale;
+}
+inline float strto_float(const char* str, char** end, float) { return strtof_l(str, end, c_locale()); }
+inline double strto_float(const char* str, char** end, double) { return strtod_l(str, end, c_locale()); }
+#endif
+#else
+inline float strto_float(const char* str, char** end, float) { return strtof(str, end); }
+inline double strto_float(const char* str, char** end, double) { return strtod(str, end); }
+#endif
+
+/*
+Parses number validated by parse_number(), without sign. Rounds correctly,
+like std::from_chars. strtod_l needs a null-terminated copy, which is on the
+stack unless the number is very long.
+*/
+template<typename FloatT>
+inline bool parse_float_slow(const char* str, size_t length, FloatT& outValue)
+{
+#if STR_VIEW_HAS_FROM_CHARS_FLOAT
+    const std::from_chars_result result = std::from_chars(str, str + length, outValue);
+    return result.ec == std::errc() && result.ptr == str + length;
+#else
+    std::string number;
+#if STR_VIEW_HAS_STRTOD_L
+    char stackBuf[128];
+    char* buf = stackBuf;
+    if(length >= sizeof(stackBuf))
+    {
+        number.resize(length);
+        buf = &number[0];
+    }
+    memcpy(buf, str, length);
+    buf[length] = '\0';
+    const size_t bufLength = length;
+#else
+    // Decimal point of the current locale, which may be longer than one byte.
+    number.assign(str, length);
+    const char* const decimalPoint = localeconv()->decimal_point;
+    const size_t pointPos = number.find('.');
+    if(pointPos != std::string::npos && strcmp(decimalPoint, ".") != 0)
+        number.replace(pointPos, 1, decimalPoint);
+    char* const buf = &number[0];
+    const size_t bufLength = number.length();
+#endif
+    char* end;
+    errno = 0;
+    const FloatT value = strto_float(buf, &end, FloatT());
+    if(end != buf + bufLength ||
+        (errno == ERANGE && (value == 0 || value > std::numeric_limits<FloatT>::max())))
+        return false;
+    outValue = value;
+    return true;
+#endif
+}
+
+template<typename CharT, typename FloatT>
+inline bool parse_float_slow(const CharT* str, size_t length, FloatT& outValue)
+{
+    // Number is already validated, so all its characters are ASCII.
+    char stackBuf[128];
+    std::string heapBuf;
+    char* buf = stackBuf;
+    if(length > sizeof(stackBuf))
+    {
+        heapBuf.resize(length);
+        buf = &heapBuf[0];
+    }
+    for(size_t i = 0; i < length; ++i)
+        buf[i] = (char)str[i];
+    return parse_float_slow(buf, length, outValue);
+}
+
+/*
+Table of powers of 5 from 5^MIN_EXPONENT to 5^MAX_EXPONENT for eisel_lemire(): 128 most
+significant bits of each, truncated, where negative powers are first rounded up, like in
+fast_float. It's computed with big integer arithmetic when used for the first time, which
+takes about 10 KB of memory but no table in the source.
+*/
+class powers_of_five_128
 {
 public:
-    typedef CharT CharT;
-    typedef std::basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT>> StringT;
+    enum { MIN_EXPONENT = -342, MAX_EXPONENT = 308 };
 
-    /*
-    Initializes to empty string.
-    */
-    inline str_view_template();
-    
-    /*
-    Initializes from a null-terminated string.
-    Null is acceptable. It means empty string.
-    */
-    inline str_view_template(const CharT* sz);
-    /*
-    Initializes from not null-terminated string.
-    Null is acceptable if length is 0.
-    */
-    inline str_view_template(const CharT* str, size_t length);
-    /*
-    Initializes from string with given length, with explicit statement that it is null-terminated.
-    Null is acceptable if length is 0.
-    */
-    struct StillNullTerminated { };
-    inline str_view_template(const CharT* str, size_t length, StillNullTerminated);
-    
-    /*
-    Initializes from an STL string.
-    length can exceed actual str.length(). It then spans to the end of str.
-    */
-    inline str_view_template(const StringT& str, size_t offset = 0, size_t length = SIZE_MAX);
+    static const powers_of_five_128& get()
+    {
+        static const powers_of_five_128 table;
+        return table;
+    }
+    // Returns high and low half for 5^exponent.
+    const uint64_t* operator[](int64_t exponent) const { return m_Values[exponent - MIN_EXPONENT]; }
 
-    // Copy constructor.
-    inline str_view_template(const str_view_template<CharT>& src, size_t offset = 0, size_t length = SIZE_MAX);
-    // Move constructor.
-    inline str_view_template(str_view_template<CharT>&& src);
-    
-    inline ~str_view_template();
+private:
+    uint64_t m_Values[MAX_EXPONENT - MIN_EXPONENT + 1][2];
 
-    // Copy assignment operator.
-    inline str_view_template<CharT>& operator=(const str_view_template<CharT>& src);
-    // Move assignment operator.
-    inline str_view_template<CharT>& operator=(str_view_template<CharT>&& src);
+    typedef std::vector<uint32_t> BigInt; // Least significant word first, no leading zero words.
 
-    /*
-    Exchanges the view with that of rhs.
-    */
-    inline void swap(str_view_template<CharT>& rhs) noexcept;
+    static size_t bit_length(const BigInt& n)
+    {
+        return n.empty() ? 0 : (n.size() - 1) * 32 + bit_scan_reverse(n.back()) + 1;
+    }
+    // 64 bits of n starting at bit pos, which may be negative for bits below the lowest one.
+    static uint64_t bits64(const BigInt& n, ptrdiff_t pos)
+    {
+        uint64_t result = 0;
+        for(ptrdiff_t bit = 63; bit >= 0; --bit)
+        {
+            const ptrdiff_t index = pos + bit;
+            result <<= 1;
+            if(index >= 0 && (size_t)index / 32 < n.size())
+                result |= (n[(size_t)index / 32] >> (index % 32)) & 1;
+        }
+        return result;
+    }
+    void store(int64_t exponent, const BigInt& n)
+    {
+        const ptrdiff_t low = (ptrdiff_t)bit_length(n) - 128;
+        m_Values[exponent - MIN_EXPONENT][0] = bits64(n, low + 64);
+        m_Values[exponent - MIN_EXPONENT][1] = bits64(n, low);
+    }
 
-    /*
-    Returns the number of characters in the view. 
-    */
-    inline size_t length() const;
-    /*
-    Returns the number of characters in the view. 
-    Usage of this method is not recommended because its name may be misleading -
-    it may suggest size in bytes not in characters.
-    */
-    inline size_t size() const { return length(); }
-    /*
-    Checks if the view has no characters, i.e. whether length() == 0.
-    It may be more efficient than checking length().
-    */
-    inline bool empty() const;
-    /*
-    Returns a pointer to the underlying character array.
-    The pointer is such that the range [data(); data() + length()) is valid and the values in it
-    correspond to the values of the view. 
-    If empty() == true, returned pointer is undefined.
-    */
-    inline const CharT* data() const { return m_Begin; }
-    /*
-    Returns an iterator to the first character of the view.
-    If empty() == true, returned pointer may or may not be null, but always begin() == end().
-    */
-    inline const CharT* begin() const { return m_Begin; }
-    /*
-    Returns an iterator to the character following the last character of the view.
-    This character acts as a placeholder, attempting to access it results in undefined behavior. 
-    */
-    inline const CharT* end() const { return m_Begin + length(); }
-    /*
-    Returns first character in the view.
-    The behavior is undefined if empty() == true.
-    */
-    inline const CharT front() const { return *m_Begin; }
-    /*
-    Returns last character in the view.
-    The behavior is undefined if empty() == true. 
-    */
-    inline const CharT back() const { return m_Begin[length() - 1]; }
-    
-    inline CharT operator[](size_t index) const { return m_Begin[index]; }
-    inline CharT at(size_t index) const { return m_Begin[index]; }
+    powers_of_five_128()
+    {
+        // 5^q for q >= 0, and number of bits of each.
+        BigInt power(1, 1);
+        std::vector<size_t> powerBits(1, 1);
+        for(int64_t q = 0; q <= -MIN_EXPONENT; ++q)
+        {
+            if(q <= MAX_EXPONENT)
+                store(q, power);
+            uint64_t carry = 0;
+            for(uint32_t& word : power)
+            {
+                carry += (uint64_t)word * 5;
+                word = (uint32_t)carry;
+                carry >>= 32;
+            }
+            if(carry)
+                power.push_back((uint32_t)carry);
+            powerBits.push_back(bit_length(power));
+        }
 
-    /*
-    Returns null-terminated string with contents of this object.
-    Possibly an internal copy.
-    */
-    inline const CharT* c_str() const;
+        /*
+        For q < 0: floor(2^b / 5^-q) + 1, where b is 127 or 128 bits more than 5^-q has for
+        -q <= 27, twice that many plus 128 for others. floor(2^b / 5^n) is calculated as
+        floor(2^K / 5^n) shifted right, dividing 2^K by 5 once for every n.
+        */
+        const size_t k = 2 * powerBits[-MIN_EXPONENT] + 128 + 32;
+        BigInt reciprocal(k / 32 + 1, 0);
+        reciprocal.back() = (uint32_t)1 << (k % 32);
+        for(int64_t n = 1; n <= -MIN_EXPONENT; ++n)
+        {
+            uint64_t remainder = 0;
+            for(size_t i = reciprocal.size(); i--; )
+            {
+                remainder = (remainder << 32) | reciprocal[i];
+                reciprocal[i] = (uint32_t)(remainder / 5);
+                remainder %= 5;
+            }
+            while(!reciprocal.empty() && reciprocal.back() == 0)
+                reciprocal.pop_back();
+
+            const size_t b = n <= 27 ? powerBits[n] + 127 : 2 * powerBits[n] + 128;
+            const size_t shift = k - b;
+            BigInt value;
+            for(size_t i = shift / 32; i < reciprocal.size(); ++i)
+                value.push_back((uint32_t)(bits64(reciprocal, (ptrdiff_t)(i * 32 + shift % 32))));
+            for(uint32_t& word : value)
+            {
+                if(++word != 0)
+                    break;
+            }
+            while(!value.empty() && value.back() == 0)
+                value.pop_back();
+            store(-n, value);
+        }
+    }
+};
+
+// Parameters of IEEE 754 binary formats for eisel_lemire().
+template<typename FloatT>
+struct float_format;
+template<>
+struct float_format<double>
+{
+    typedef uint64_t bits_type;
+    enum { MANTISSA_BITS = 52, MIN_EXPONENT = -1023, INFINITE_POWER = 0x7FF };
+    enum { MIN_ROUND_TO_EVEN = -4, MAX_ROUND_TO_EVEN = 23, MIN_POWER_OF_10 = -342, MAX_POWER_OF_10 = 308 };
+};
+template<>
+struct float_format<float>
+{
+    typedef uint32_t bits_type;
+    enum { MANTISSA_BITS = 23, MIN_EXPONENT = -127, INFINITE_POWER = 0xFF };
+    enum { MIN_ROUND_TO_EVEN = -17, MAX_ROUND_TO_EVEN = 10, MIN_POWER_OF_10 = -64, MAX_POWER_OF_10 = 38 };
+};
+
+/*
+Returns w * 10^q correctly rounded to the nearest FloatT, using Eisel-Lemire algorithm:
+w is multiplied by 128-bit approximation of 10^q, which is always precise enough
+(Mushtak, Lemire, "Fast Number Parsing Without Fallback"). Returns 0 or infinity if the
+number is out of range. w must not be 0.
+*/
+template<typename FloatT>
+inline FloatT eisel_lemire(uint64_t w, int64_t q)
+{
+    typedef float_format<FloatT> Format;
+    typedef typename Format::bits_type Bits;
+    if(q < Format::MIN_POWER_OF_10)
+        return 0;
+    if(q > Format::MAX_POWER_OF_10)
+        return std::numeric_limits<FloatT>::infinity();
+
+    const int leadingZeros = 63 - (int)bit_scan_reverse(w);
+    w <<= leadingZeros;
+    const uint64_t* const power = powers_of_five_128::get()[q];
+    uint64_t low = w, high = power[0];
+    hash_mul128(low, high);
+    // Low bits below the mantissa and rounding bit all ones may change with the second half.
+    const uint64_t precisionMask = UINT64_MAX >> (Format::MANTISSA_BITS + 3);
+    if((high & precisionMask) == precisionMask)
+    {
+        uint64_t low2 = w, high2 = power[1];
+        hash_mul128(low2, high2);
+        low += high2;
+        if(high2 > low)
+            ++high;
+    }
+
+    const int upperBit = (int)(high >> 63);
+    const int shift = upperBit + 64 - Format::MANTISSA_BITS - 3;
+    uint64_t mantissa = high >> shift;
+    // floor(q * log2(10)) + 63, calculated in fixed point.
+    int32_t power2 = (int32_t)(((152170 + 65536) * (int32_t)q) >> 16) + 63 + upperBit - leadingZeros - Format::MIN_EXPONENT;
+    if(power2 <= 0)
+    {
+        // Subnormal number.
+        if(-power2 + 1 >= 64)
+            return 0;
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < ((uint64_t)1 << Format::MANTISSA_BITS) ? 0 : 1;
+    }
+    else
+    {
+        // Exactly halfway between two numbers: round to even instead of up.
+        if(low <= 1 && q >= Format::MIN_ROUND_TO_EVEN && q <= Format::MAX_ROUND_TO_EVEN &&
+            (mantissa & 3) == 1 && (mantissa << shift) == high)
+            mantissa &= ~(uint64_t)1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        if(mantissa >= ((uint64_t)2 << Format::MANTISSA_BITS))
+        {
+            mantissa = (uint64_t)1 << Format::MANTISSA_BITS;
+            ++power2;
+        }
+        mantissa &= ~((uint64_t)1 << Format::MANTISSA_BITS);
+        if(power2 >= Format::INFINITE_POWER)
+            return std::numeric_limits<FloatT>::infinity();
+    }
+    const Bits bits = (Bits)mantissa | ((Bits)power2 << Format::MANTISSA_BITS);
+    FloatT result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Returns first 19 significant digits of a number validated by parse_number(), without sign.
+template<typename CharT>
+inline uint64_t leading_significant_digits(const CharT* str, size_t length)
+{
+    uint64_t value = 0;
+    size_t count = 0;
+    for(size_t i = 0; i < length && count < 19; ++i)
+    {
+        const unsigned digit = digit_value(str[i]);
+        if(digit > 9)
+        {
+            if(str[i] == (CharT)'.')
+                continue;
+            break;
+        }
+        if(digit != 0 || count != 0)
+        {
+            value = value * 10 + digit;
+            ++count;
+        }
+    }
+    return value;
+}
+
+/*
+Numbers with up to 19 significant digits, whose mantissa and power of 10 are both exactly
+representable in FloatT, are calculated with one multiplication or division, which is then
+correctly rounded (Clinger's fast path). This covers most numbers found in text data, like
+CSV and JSON. Other numbers with up to 19 significant digits are calculated by
+eisel_lemire(). Longer ones are truncated to 19 digits w, and if w and w + 1 give the
+same result, it's correct. Only otherwise they are parsed by parse_float_slow().
+*/
+template<typename CharT, typename FloatT>
+inline size_t parse_number(const CharT* str, size_t length, FloatT& outValue, std::true_type /*isFloat*/)
+{
+    size_t i = 0;
+    bool negative = false;
+    if(length > 0 && (str[0] == (CharT)'-' || str[0] == (CharT)'+'))
+    {
+        negative = str[0] == (CharT)'-';
+        i = 1;
+    }
+
+    size_t wordLength;
+    if((wordLength = match_word_ci(str + i, length - i, "infinity")) != 0 ||
+        (wordLength = match_word_ci(str + i, length - i, "inf")) != 0)
+    {
+        outValue = negative ? -std::numeric_limits<FloatT>::infinity() : std::numeric_limits<FloatT>::infinity();
+        return i + wordLength;
+    }
+    if((wordLength = match_word_ci(str + i, length - i, "nan")) != 0)
+    {
+        outValue = negative ? -std::numeric_limits<FloatT>::quiet_NaN() : std::numeric_limits<FloatT>::quiet_NaN();
+        return i + wordLength;
+    }
+
+    const size_t numberBegin = i;
+    while(i < length && str[i] == (CharT)'0')
+        ++i;
+    uint64_t mantissa = 0;
+    size_t significantCount = accumulate_digits(str + i, length - i, mantissa);
+    i += significantCount;
+    bool anyDigits = i > numberBegin;
+    int64_t exponent = 0;
+    if(i < length && str[i] == (CharT)'.')
+    {
+        const size_t fractionBegin = ++i;
+        if(significantCount == 0)
+        {
+            while(i < length && str[i] == (CharT)'0')
+                ++i;
+        }
+        const size_t fractionCount = accumulate_digits(str + i, length - i, mantissa);
+        significantCount += fractionCount;
+        i += fractionCount;
+        exponent = -(int64_t)(i - fractionBegin);
+        anyDigits = anyDigits || i > fractionBegin;
+    }
+    if(!anyDigits)
+        return 0;
+
+    // Exponent without digits, like in "1e", is not part of the number.
+    if(i < length && (str[i] | 0x20) == (CharT)'e')
+    {
+        size_t j = i + 1;
+        bool negativeExponent = false;
+        if(j < length && (str[j] == (CharT)'-' || str[j] == (CharT)'+'))
+        {
+            negativeExponent = str[j] == (CharT)'-';
+            ++j;
+        }
+        if(j < length && digit_value(str[j]) <= 9)
+        {
+            // Saturated, as anything beyond is infinity or zero anyway.
+            int64_t explicitExponent = 0;
+            for(unsigned digit; j < length && (digit = digit_value(str[j])) <= 9; ++j)
+                if(explicitExponent < 100000)
+                    explicitExponent = explicitExponent * 10 + digit;
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            i = j;
+        }
+    }
+
+    FloatT value;
+    const int64_t maxExactExponent = std::numeric_limits<FloatT>::digits > 24 ? 22 : 10;
+    if(significantCount == 0)
+        value = 0;
+    else if(EXACT_FLOAT_ARITHMETIC && significantCount <= 19 &&
+        mantissa <= (1ull << std::numeric_limits<FloatT>::digits) &&
+        exponent >= -maxExactExponent && exponent <= maxExactExponent)
+    {
+        value = (FloatT)mantissa;
+        if(exponent < 0)
+            value /= exact_power_of_10<FloatT>((size_t)-exponent);
+        else
+            value *= exact_power_of_10<FloatT>((size_t)exponent);
+    }
+    else
+    {
+        uint64_t w = mantissa;
+        int64_t q = exponent;
+        if(significantCount > 19)
+        {
+            w = leading_significant_digits(str + numberBegin, i - numberBegin);
+            q = exponent + (int64_t)(significantCount - 19);
+        }
+        value = eisel_lemire<FloatT>(w, q);
+        if(significantCount > 19 && eisel_lemire<FloatT>(w + 1, q) != value)
+        {
+            if(!parse_float_slow(str + numberBegin, i - numberBegin, value))
+                return 0;
+        }
+        else if(value == 0 || value > std::numeric_limits<FloatT>::max())
+            return 0; // Out of range, like ERANGE from strtod.
+    }
+    outValue = negative ? -value : value;
+    return i;
+}
+
+} // namespace str_view_detail
+
+template<typename CharT>
+template<typename NumberT>
+inline bool str_view_lite_template<CharT>::parse(NumberT& outValue) const
+{
+    static_assert(str_view_detail::is_parsable_number<NumberT>::value,
+        "parse() is available for integer types except bool and character types, float and double.");
+    NumberT value;
+    if(m_Length == 0 || str_view_detail::parse_number(m_Begin, m_Length, value,
+        typename std::is_floating_point<NumberT>::type()) != m_Length)
+        return false;
+    outValue = value;
+    return true;
+}
+
+template<typename CharT>
+template<typename NumberT>
+inline size_t str_view_lite_template<CharT>::parse_prefix(NumberT& outValue, size_t pos) const
+{
+    static_assert(str_view_detail::is_parsable_number<NumberT>::value,
+        "parse_prefix() is available for integer types except bool and character types, float and double.");
+    if(pos >= m_Length)
+        return 0;
+    return str_view_detail::parse_number(m_Begin + pos, m_Length - pos, outValue,
+        typename std::is_floating_point<NumberT>::type());
+}
+
+namespace str_view_detail
+{
+
+STR_VIEW_SIMD_KERNELS_BEGIN
+
+/*
+Calls func(size_t pos) for every character of [str, str + count) that is equal to any of
+characters of pred, in order. Characters are compared a whole register at a time, so the
+time is proportional to the length of the string plus the number of characters found.
+*/
+template<typename Simd, typename CharT, typename Func>
+STR_VIEW_SIMD_INLINE void simd_for_each_small_set_char(const CharT* str, size_t count, const small_set_pred<CharT>& pred, Func& func)
+{
+    size_t i = 0;
+#if STR_VIEW_HAS_SIMD
+    const size_t step = Simd::BYTES / sizeof(CharT);
+    const unsigned bitsPerChar = Simd::BITS_PER_BYTE * sizeof(CharT);
+    const simd_small_set_mask<Simd, CharT> blockMask(pred);
+    for(; i + step <= count; i += step)
+    {
+        for(uint64_t mask = blockMask(str + i); mask != 0; )
+        {
+            const unsigned charIndex = bit_scan_forward(mask) / bitsPerChar;
+            func(i + charIndex);
+            mask = clear_char_bits<Simd, CharT>(mask, charIndex);
+        }
+    }
+#endif
+    for(; i < count; ++i)
+        if(pred(str[i]))
+            func(i);
+}
+
+#if STR_VIEW_DISPATCH
+typedef dispatch_callback<void(size_t)> small_set_char_callback;
+
+template<typename CharT>
+STR_VIEW_TARGET_AVX2 void for_each_small_set_char_avx2(const CharT* str, size_t count, const small_set_pred<CharT>& pred,
+    small_set_char_callback& func)
+{
+    simd_for_each_small_set_char<simd_avx2>(str, count, pred, func);
+}
+template<typename CharT>
+STR_VIEW_TARGET_AVX512 void for_each_small_set_char_avx512(const CharT* str, size_t count, const small_set_pred<CharT>& pred,
+    small_set_char_callback& func)
+{
+    simd_for_each_small_set_char<simd_avx512>(str, count, pred, func);
+}
+#endif
+
+STR_VIEW_SIMD_KERNELS_END
+
+template<typename CharT, typename Func>
+inline void for_each_small_set_char(const CharT* str, size_t count, const small_set_pred<CharT>& pred, Func func)
+{
+#if STR_VIEW_DISPATCH
+    if(count * sizeof(CharT) >= DISPATCH_MIN_BYTES)
+    {
+        static const auto kernel = dispatch_kernel(&for_each_small_set_char_avx2<CharT>, &for_each_small_set_char_avx512<CharT>);
+        if(kernel)
+        {
+            small_set_char_callback callback = small_set_char_callback::make(func);
+            kernel(str, count, pred, callback);
+            return;
+        }
+    }
+#endif
+    simd_for_each_small_set_char<simd_best>(str, count, pred, func);
+}
+
+} // namespace str_view_detail
+
+/*
+Index of fields of delimited text, like CSV or log lines, built in one pass over the text.
+Instead of calling find() for every field, all delimiters, quotes and newlines are found
+at once with SIMD, and positions of those that separate fields are stored in an array.
+Fields and rows are then taken from the index in constant time.
+
+Rows are separated by '\n'. '\r' before it is not part of the last field, so "\r\n" works too.
+Newline at the end of the text doesn't start a new row, and empty text has no rows.
+Quote characters toggle quoting: delimiters and newlines between them are part of a field,
+as in CSV. Pass quote equal to delimiter to disable quoting, e.g. for log lines.
+Fields are not null-terminated and point into the text, which must remain alive as long as
+they are used. The index doesn't keep a copy of it.
+*/
+template<typename CharT>
+class str_view_structural_index_template
+{
+public:
+    // Creates an empty index, with no rows.
+    inline str_view_structural_index_template() : m_Delimiter((CharT)','), m_Quote((CharT)'"') { }
+    inline explicit str_view_structural_index_template(const str_view_lite_template<CharT>& text,
+        CharT delimiter = (CharT)',', CharT quote = (CharT)'"')
+    {
+        build(text, delimiter, quote);
+    }
+
+    // Indexes new text, reusing memory of the previous index.
+    inline void build(const str_view_lite_template<CharT>& text, CharT delimiter = (CharT)',', CharT quote = (CharT)'"');
 
-    /*
-    Returns a view of the substring [offset, offset + length).
-    length can exceed actual length(). It then spans to the end of this string.
-    */
-    inline str_view_template<CharT> substr(size_t offset = 0, size_t length = SIZE_MAX) const;
+    inline const str_view_lite_template<CharT>& text() const { return m_Text; }
+    inline size_t row_count() const { return m_RowFirstFields.size(); }
+    // Returns total number of fields, in all rows.
+    inline size_t field_count() const { return m_FieldEnds.size(); }
+    inline size_t row_field_count(size_t row) const
+    {
+        assert(row < row_count());
+        return (row + 1 < m_RowFirstFields.size() ? m_RowFirstFields[row + 1] : m_FieldEnds.size()) - m_RowFirstFields[row];
+    }
+    // Returns index of the first field of given row, for use with field(size_t).
+    inline size_t row_first_field(size_t row) const { assert(row < row_count()); return m_RowFirstFields[row]; }
 
+    // Returns whole row, without the newline.
+    inline str_view_lite_template<CharT> row(size_t row) const;
     /*
-    Copies the substring [offset, offset + length) to the character string pointed to by dst.
-    If pointer string ends before length is reached, string is copied to the end.
-    Null character is not added past the end of destination.
-    Returns number of characters copied.
+    Returns field with given index among all fields, or in given row. Enclosing quotes are
+    removed, but doubled quote characters inside are kept - use field_to_string() to unescape them.
     */
-    inline size_t copy_to(CharT* dst, size_t offset = 0, size_t length = SIZE_MAX) const;
+    inline str_view_lite_template<CharT> field(size_t index) const;
+    inline str_view_lite_template<CharT> field(size_t row, size_t column) const
+    {
+        assert(column < row_field_count(row));
+        return field(m_RowFirstFields[row] + column);
+    }
+    // Tells whether the field was enclosed in quotes.
+    inline bool is_quoted(size_t index) const;
+    // Replaces content of dst with the field, with doubled quote characters replaced by single ones.
+    template<typename StringT>
+    inline void field_to_string(size_t index, StringT& dst) const;
 
-    inline void to_string(StringT& dst, size_t offset = 0, size_t length = SIZE_MAX) const;
+private:
+    str_view_lite_template<CharT> m_Text;
+    CharT m_Delimiter;
+    CharT m_Quote;
+    // Position of the delimiter or newline after each field, or length of the text.
+    std::vector<size_t> m_FieldEnds;
+    std::vector<size_t> m_RowFirstFields;
 
-    /*
-    Compares this with rhs lexicographically.
-    Returns negative value, 0, or positive value, depending on the result.
-    
-    Comparison is made using functions like strncmp, so they don't compare characters
-    past '\0' if it's present in the string.
-    */
-    inline int compare(const str_view_template<CharT>& rhs, bool case_sensitive = true) const;
+    inline size_t field_begin(size_t index) const { return index > 0 ? m_FieldEnds[index - 1] + 1 : 0; }
+    inline bool ends_row(size_t index) const
+    {
+        return m_FieldEnds[index] == m_Text.length() || m_Text[m_FieldEnds[index]] == (CharT)'\n';
+    }
+    // Returns end of the field, without '\r' before the newline.
+    inline size_t field_end(size_t index) const;
+    inline str_view_lite_template<CharT> raw_field(size_t index) const
+    {
+        const size_t begin = field_begin(index);
+        return m_Text.substr(begin, field_end(index) - begin);
+    }
+};
 
-    inline bool operator==(const str_view_template<CharT>& rhs) const { return compare(rhs) == 0; }
-    inline bool operator!=(const str_view_template<CharT>& rhs) const { return compare(rhs) != 0; }
-    inline bool operator< (const str_view_template<CharT>& rhs) const { return compare(rhs) <  0; }
-    inline bool operator> (const str_view_template<CharT>& rhs) const { return compare(rhs) >  0; }
-    inline bool operator<=(const str_view_template<CharT>& rhs) const { return compare(rhs) <= 0; }
-    inline bool operator>=(const str_view_template<CharT>& rhs) const { return compare(rhs) >= 0; }
+typedef str_view_structural_index_template<char> str_view_structural_index;
+typedef str_view_structural_index_template<wchar_t> wstr_view_structural_index;
 
-    /*
-    Checks if the string view begins with the given prefix.
+template<typename CharT>
+inline void str_view_structural_index_template<CharT>::build(const str_view_lite_template<CharT>& text, CharT delimiter, CharT quote)
+{
+    assert(delimiter != (CharT)'\n' && quote != (CharT)'\n');
+    m_Text = text;
+    m_Delimiter = delimiter;
+    m_Quote = quote;
+    m_FieldEnds.clear();
+    m_RowFirstFields.clear();
+    const size_t length = text.length();
+    if(length == 0)
+        return;
 
-    If the string view is shorter than the prefix, returns false.
-    If prefix is empty, returns true.
-    */
-    inline bool starts_with(CharT prefix, bool case_sensitive = true) const;
-    inline bool starts_with(const str_view_template<CharT>& prefix, bool case_sensitive = true) const;
+    m_RowFirstFields.push_back(0);
+    const CharT structuralChars[] = { delimiter, quote, (CharT)'\n' };
+    const str_view_detail::small_set_pred<CharT> pred =
+        str_view_detail::make_small_set_pred(structuralChars, 3, false);
+    const CharT* const str = text.data();
+    bool quoted = false;
+    str_view_detail::for_each_small_set_char(str, length, pred, [&](size_t pos) {
+        // Delimiter is checked first, so quote equal to it has no effect.
+        if(str[pos] == delimiter)
+        {
+            if(!quoted)
+                m_FieldEnds.push_back(pos);
+        }
+        else if(str[pos] == quote)
+            quoted = !quoted;
+        else if(!quoted)
+        {
+            m_FieldEnds.push_back(pos);
+            if(pos + 1 < length)
+                m_RowFirstFields.push_back(m_FieldEnds.size());
+        }
+    });
+    if(str[length - 1] != (CharT)'\n' || quoted)
+        m_FieldEnds.push_back(length);
+}
 
-    /*
-    Checks if the string view ends with the given suffix.
+template<typename CharT>
+inline size_t str_view_structural_index_template<CharT>::field_end(size_t index) const
+{
+    assert(index < field_count());
+    const size_t end = m_FieldEnds[index];
+    return end > field_begin(index) && m_Text[end - 1] == (CharT)'\r' && ends_row(index) ? end - 1 : end;
+}
 
-    If the string view is shorter than the suffix, returns false.
-    If suffix is empty, returns true.
-    */
-    inline bool ends_with(CharT suffix, bool case_sensitive = true) const;
-    inline bool ends_with(const str_view_template<CharT>& suffix, bool case_sensitive = true) const;
+template<typename CharT>
+inline str_view_lite_template<CharT> str_view_structural_index_template<CharT>::row(size_t row) const
+{
+    const size_t firstField = row_first_field(row);
+    const size_t begin = field_begin(firstField);
+    return m_Text.substr(begin, field_end(firstField + row_field_count(row) - 1) - begin);
+}
 
-    /*
-    Finds the first substring equal to the given character sequence.
-    pos - position at which to start the search.
-    Returns position of the first character of the found substring, or SIZE_MAX if no such substring is found.
-    If substr is empty, returns pos.
-    */
-    inline size_t find(CharT ch, size_t pos = 0) const;
-    inline size_t find(const str_view_template<CharT>& substr, size_t pos = 0) const;
+template<typename CharT>
+inline bool str_view_structural_index_template<CharT>::is_quoted(size_t index) const
+{
+    const str_view_lite_template<CharT> raw = raw_field(index);
+    return m_Quote != m_Delimiter && raw.length() >= 2 && raw[0] == m_Quote && raw[raw.length() - 1] == m_Quote;
+}
 
-    /*
-    Finds the last substring equal to the given character sequence.
-    pos - position at which to start the search.
-    Returns position of the first character of the found substring, or SIZE_MAX if no such substring is found.
-    If substr is empty, returns pos.
-    */
-    inline size_t rfind(CharT ch, size_t pos = SIZE_MAX) const;
-    inline size_t rfind(const str_view_template<CharT>& substr, size_t pos = SIZE_MAX) const;
+template<typename CharT>
+inline str_view_lite_template<CharT> str_view_structural_index_template<CharT>::field(size_t index) const
+{
+    const str_view_lite_template<CharT> raw = raw_field(index);
+    return is_quoted(index) ? raw.substr(1, raw.length() - 2) : raw;
+}
 
-    /*
-    Finds the first character equal to any of the characters in the given character sequence. 
-    pos - position at which to start the search.
-    Returns position of the first occurrence of any character of the substring,
-    or SIZE_MAX if no such character is found.
-    If chars is empty, returns SIZE_MAX.
-    */
-    inline size_t find_first_of(const str_view_template<CharT>& chars, size_t pos = 0) const;
-    /*
-    Finds the last character equal to one of characters in the given character sequence.
-    The search considers only the interval [0; pos].
-    If the character is not present in the interval, SIZE_MAX will be returned.
-    If chars is empty, returns SIZE_MAX.
-    */
-    inline size_t find_last_of(const str_view_template<CharT>& chars, size_t pos = SIZE_MAX) const;
-    /*
-    Finds the first character NOT equal to any of the characters in the given character sequence. 
-    pos - position at which to start the search.
-    Returns position of the first occurrence of any character not of the substring,
-    or SIZE_MAX if no such character is found.
-    If chars is empty, returns SIZE_MAX.
-    */
-    inline size_t find_first_not_of(const str_view_template<CharT>& chars, size_t pos = 0) const;
-    /*
-    Finds the last character NOT equal to one of characters in the given character sequence.
-    The search considers only the interval [0; pos].
-    If the character is not present in the interval, SIZE_MAX will be returned.
-    If chars is empty, returns SIZE_MAX.
-    */
-    inline size_t find_last_not_of(const str_view_template<CharT>& chars, size_t pos = SIZE_MAX) const;
+template<typename CharT>
+template<typename StringT>
+inline void str_view_structural_index_template<CharT>::field_to_string(size_t index, StringT& dst) const
+{
+    const str_view_lite_template<CharT> value = field(index);
+    if(!is_quoted(index))
+    {
+        value.to_string(dst);
+        return;
+    }
+    dst.clear();
+    dst.reserve(value.length());
+    for(size_t i = 0; i < value.length(); ++i)
+    {
+        dst.push_back(value[i]);
+        if(value[i] == m_Quote && i + 1 < value.length() && value[i + 1] == m_Quote)
+            ++i;
+    }
+}
 
-private:
-    /*
-    SIZE_MAX means unknown.
-    */
-    mutable std::atomic<size_t> m_Length;
-    
-    const CharT* m_Begin;
+namespace str_view_detail
+{
 
-    /*
-    1 means pointed string is null-terminated by itself.
-    Any others bits set mean pointer to array with null-terminated copy.
-    */
-    mutable std::atomic<uintptr_t> m_NullTerminatedPtr;
+// Number of leading characters cached in the key of every string sorted by str_view_sort.
+template<typename CharT>
+struct sort_key_chars
+{
+    enum { VALUE = sizeof(uint64_t) / sizeof(CharT) };
 };
 
-typedef str_view_template<char> str_view;
-typedef str_view_template<wchar_t> wstr_view;
+// Ranges shorter than that are sorted by insertion sort.
+enum { SORT_INSERTION_THRESHOLD = 16 };
+// Number of samples taken for every bucket when choosing splitters of the parallel sort.
+enum { SORT_OVERSAMPLING = 16 };
 
+/*
+Maps character to an unsigned number that orders like tmemcmp: memcmp compares bytes
+as unsigned, wmemcmp compares wchar_t values, which are signed on some platforms.
+*/
 template<typename CharT>
-inline str_view_template<CharT>::str_view_template() :
-	m_Length(0),
-	m_Begin(nullptr),
-	m_NullTerminatedPtr(0)
+inline uint64_t sort_char_bits(CharT ch)
 {
+    typedef typename std::make_unsigned<CharT>::type UnsignedCharT;
+    const UnsignedCharT signBit = sizeof(CharT) > 1 && std::is_signed<CharT>::value ?
+        (UnsignedCharT)((UnsignedCharT)1 << (sizeof(CharT) * 8 - 1)) : (UnsignedCharT)0;
+    return (uint64_t)(UnsignedCharT)((UnsignedCharT)ch ^ signBit);
 }
 
+/*
+Returns characters [depth, depth + sort_key_chars::VALUE) of the string as a big-endian number,
+padded with zeros, so comparing keys compares these characters like tmemcmp.
+*/
 template<typename CharT>
-inline str_view_template<CharT>::str_view_template(const CharT* sz) :
-	m_Length(sz ? SIZE_MAX : 0),
-	m_Begin(sz),
-	m_NullTerminatedPtr(sz ? 1 : 0)
+inline uint64_t sort_key(const CharT* str, size_t length, size_t depth)
 {
+    const size_t keyChars = sort_key_chars<CharT>::VALUE;
+    const unsigned charBits = sizeof(CharT) * 8;
+    uint64_t key = 0;
+    if(depth < length && length - depth >= keyChars)
+    {
+        // Fixed number of iterations, so the compiler can turn it into one load and byte swap.
+        for(size_t i = 0; i < keyChars; ++i)
+            key = (key << charBits) | sort_char_bits(str[depth + i]);
+        return key;
+    }
+    for(size_t i = 0; depth + i < length; ++i)
+        key |= sort_char_bits(str[depth + i]) << ((keyChars - 1 - i) * charBits);
+    return key;
 }
 
+// String sorted by str_view_sort, with cached key of its characters at the current depth.
 template<typename CharT>
-inline str_view_template<CharT>::str_view_template(const CharT* str, size_t length) :
-	m_Length(length),
-	m_Begin(length ? str : nullptr),
-	m_NullTerminatedPtr(0)
+struct sort_item
+{
+    uint64_t key;
+    const CharT* str;
+    size_t length;
+    // Index of the view in the array being sorted.
+    size_t index;
+};
+
+/*
+Strings with equal keys are ordered by their rank: number of remaining characters if the
+string ends within the key, which puts shorter ones first, or sort_key_chars::VALUE + 1 if it
+continues past the key. Strings with equal key and rank not greater than
+sort_key_chars::VALUE are equal. Depth never exceeds length of the string.
+*/
+template<typename CharT>
+inline size_t sort_rank(const sort_item<CharT>& item, size_t depth)
 {
+    return std::min<size_t>(item.length - depth, sort_key_chars<CharT>::VALUE + 1);
 }
 
+// Compares key and rank. Returns negative number, zero or positive number like memcmp.
 template<typename CharT>
-inline str_view_template<CharT>::str_view_template(const CharT* str, size_t length, StillNullTerminated) :
-	m_Length(length),
-	m_Begin(nullptr),
-	m_NullTerminatedPtr(0)
+inline int sort_compare_key(const sort_item<CharT>& lhs, uint64_t rhsKey, size_t rhsRank, size_t depth)
 {
-    if(length)
-    {
-        m_Begin = str;
-        m_NullTerminatedPtr = 1;
-    }
-    assert(m_Begin[m_Length] == (CharT)0); // Make sure it's really null terminated.
+    if(lhs.key != rhsKey)
+        return lhs.key < rhsKey ? -1 : 1;
+    const size_t lhsRank = sort_rank(lhs, depth);
+    return lhsRank < rhsRank ? -1 : lhsRank > rhsRank ? 1 : 0;
 }
 
+// Compares whole strings, knowing that their characters before depth are equal.
 template<typename CharT>
-inline str_view_template<CharT>::str_view_template(const StringT& str, size_t offset, size_t length) :
-	m_Length(0),
-	m_Begin(nullptr),
-	m_NullTerminatedPtr(0)
+inline bool sort_item_less(const sort_item<CharT>& lhs, const sort_item<CharT>& rhs, size_t depth)
 {
-	assert(offset <= str.length());
-    m_Length = std::min(length, str.length() - offset);
-    if(m_Length)
+    const size_t rhsRank = sort_rank(rhs, depth);
+    const int keyResult = sort_compare_key(lhs, rhs.key, rhsRank, depth);
+    if(keyResult != 0 || rhsRank <= sort_key_chars<CharT>::VALUE)
+        return keyResult < 0;
+    const size_t tail = depth + sort_key_chars<CharT>::VALUE;
+    const size_t common = std::min(lhs.length, rhs.length) - tail;
+    const int result = common ? tmemcmp(lhs.str + tail, rhs.str + tail, common) : 0;
+    return result != 0 ? result < 0 : lhs.length < rhs.length;
+}
+
+/*
+Sorts items by multikey quicksort: ranges are partitioned into less than, equal to and
+greater than the key of a pivot. The equal range, if its strings continue past the key,
+is sorted further by the following characters, loading their keys once. Ranges are kept
+on a heap-allocated stack, so long common prefixes don't cause deep recursion.
+All items must have keys loaded at given depth.
+*/
+template<typename CharT>
+inline void sort_items(sort_item<CharT>* items, size_t count, size_t depth)
+{
+    struct Range
+    {
+        sort_item<CharT>* first;
+        size_t count;
+        size_t depth;
+    };
+    const size_t keyChars = sort_key_chars<CharT>::VALUE;
+    std::vector<Range> stack;
+    stack.push_back(Range{ items, count, depth });
+    while(!stack.empty())
     {
-        if(m_Length == str.length() - offset)
+        const Range range = stack.back();
+        stack.pop_back();
+        sort_item<CharT>* const first = range.first;
+        const size_t d = range.depth;
+        if(range.count < SORT_INSERTION_THRESHOLD)
         {
-            m_Begin = str.c_str() + offset;
-            m_NullTerminatedPtr = 1;
+            for(size_t i = 1; i < range.count; ++i)
+            {
+                const sort_item<CharT> item = first[i];
+                size_t j = i;
+                for(; j > 0 && sort_item_less(item, first[j - 1], d); --j)
+                    first[j] = first[j - 1];
+                first[j] = item;
+            }
+            continue;
+        }
+
+        // Median of first, middle and last item.
+        const sort_item<CharT>* a = &first[0];
+        const sort_item<CharT>* b = &first[range.count / 2];
+        const sort_item<CharT>* c = &first[range.count - 1];
+        if(sort_compare_key(*b, a->key, sort_rank(*a, d), d) < 0)
+            std::swap(a, b);
+        if(sort_compare_key(*c, b->key, sort_rank(*b, d), d) < 0)
+            b = sort_compare_key(*c, a->key, sort_rank(*a, d), d) < 0 ? a : c;
+        const uint64_t pivotKey = b->key;
+        const size_t pivotRank = sort_rank(*b, d);
+
+        // Three-way partition: [0, lt) less, [lt, gt) equal, [gt, count) greater.
+        size_t lt = 0, i = 0, gt = range.count;
+        while(i < gt)
+        {
+            const int result = sort_compare_key(first[i], pivotKey, pivotRank, d);
+            if(result < 0)
+                std::swap(first[lt++], first[i++]);
+            else if(result > 0)
+                std::swap(first[i], first[--gt]);
+            else
+                ++i;
+        }
+
+        if(range.count - gt > 1)
+            stack.push_back(Range{ first + gt, range.count - gt, d });
+        if(lt > 1)
+            stack.push_back(Range{ first, lt, d });
+        if(gt - lt > 1 && pivotRank > keyChars)
+        {
+            for(size_t k = lt; k < gt; ++k)
+                first[k].key = sort_key(first[k].str, first[k].length, d + keyChars);
+            stack.push_back(Range{ first + lt, gt - lt, d + keyChars });
         }
-        else
-            m_Begin = str.data() + offset;
     }
 }
 
+// Runs task(index) for every index in [0, taskCount) on options.executor.
+inline void run_tasks(size_t taskCount, const str_view_parallel_options& options, const std::function<void(size_t)>& task)
+{
+    if(options.executor)
+        options.executor->run(taskCount, task);
+    else
+        str_view_thread_executor().run(taskCount, task);
+}
+
+/*
+Sorts items of many chunks in parallel. Splitters chosen from a sample of keys divide the
+items into buckets of about options.chunkLength items, which are then sorted as separate
+tasks. Items with equal key and rank always fall into the same bucket.
+*/
 template<typename CharT>
-inline str_view_template<CharT>::str_view_template(const str_view_template<CharT>& src, size_t offset, size_t length) :
-	m_Length(0),
-	m_Begin(nullptr),
-	m_NullTerminatedPtr(0)
+inline void sort_items_parallel(std::vector<sort_item<CharT>>& items, const str_view_parallel_options& options)
 {
-    // Source length is unknown, constructor doesn't limit the length - it may remain unknown.
-    if(src.m_Length == SIZE_MAX && length == SIZE_MAX)
+    const size_t count = items.size();
+    const size_t chunkLength = std::max<size_t>(options.chunkLength, 1);
+    const size_t chunkCount = count / chunkLength + (count % chunkLength ? 1 : 0);
+
+    std::vector<sort_item<CharT>> splitters;
+    const size_t sampleCount = std::min(count, chunkCount * SORT_OVERSAMPLING);
+    for(size_t i = 0; i < sampleCount; ++i)
+        splitters.push_back(items[i * count / sampleCount]);
+    const auto keyLess = [](const sort_item<CharT>& lhs, const sort_item<CharT>& rhs) {
+        return sort_compare_key(lhs, rhs.key, sort_rank(rhs, 0), 0) < 0;
+    };
+    std::sort(splitters.begin(), splitters.end(), keyLess);
+    size_t splitterCount = 0;
+    for(size_t i = SORT_OVERSAMPLING; i < sampleCount; i += SORT_OVERSAMPLING)
     {
-        m_Length = SIZE_MAX;
-        m_Begin = src.m_Begin + offset;
-        assert(src.m_NullTerminatedPtr == 1);
-        m_NullTerminatedPtr = 1;
+        if(splitterCount == 0 || keyLess(splitters[splitterCount - 1], splitters[i]))
+            splitters[splitterCount++] = splitters[i];
     }
-    else
+    splitters.resize(splitterCount);
+    const size_t bucketCount = splitterCount + 1;
+
+    // Bucket of every item, and number of items of every chunk in every bucket.
+    std::vector<uint32_t> itemBuckets(count);
+    std::vector<size_t> chunkBucketCounts(chunkCount * bucketCount);
+    run_chunks(count, options, [&](size_t chunkIndex, size_t begin, size_t end) {
+        size_t* const bucketCounts = &chunkBucketCounts[chunkIndex * bucketCount];
+        for(size_t i = begin; i < end; ++i)
+        {
+            const size_t bucket = std::upper_bound(splitters.begin(), splitters.end(), items[i], keyLess) - splitters.begin();
+            itemBuckets[i] = (uint32_t)bucket;
+            ++bucketCounts[bucket];
+        }
+    });
+
+    // Turn counts into positions where every chunk writes its items of every bucket.
+    std::vector<size_t> bucketBegins(bucketCount + 1);
+    size_t pos = 0;
+    for(size_t bucket = 0; bucket < bucketCount; ++bucket)
     {
-        const size_t srcLen = src.length();
-	    assert(offset <= srcLen);
-        m_Length = std::min(length, srcLen - offset);
-        if(m_Length)
+        bucketBegins[bucket] = pos;
+        for(size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex)
         {
-            m_Begin = src.m_Begin + offset;
-            if(src.m_NullTerminatedPtr == 1 && m_Length == srcLen - offset)
-                m_NullTerminatedPtr = 1;
+            const size_t bucketItems = chunkBucketCounts[chunkIndex * bucketCount + bucket];
+            chunkBucketCounts[chunkIndex * bucketCount + bucket] = pos;
+            pos += bucketItems;
         }
     }
+    bucketBegins[bucketCount] = pos;
+
+    std::vector<sort_item<CharT>> bucketItems(count);
+    run_chunks(count, options, [&](size_t chunkIndex, size_t begin, size_t end) {
+        size_t* const positions = &chunkBucketCounts[chunkIndex * bucketCount];
+        for(size_t i = begin; i < end; ++i)
+            bucketItems[positions[itemBuckets[i]]++] = items[i];
+    });
+
+    run_tasks(bucketCount, options, [&](size_t bucket) {
+        sort_items(bucketItems.data() + bucketBegins[bucket], bucketBegins[bucket + 1] - bucketBegins[bucket], 0);
+    });
+    items.swap(bucketItems);
 }
 
-template<typename CharT>
-inline str_view_template<CharT>::str_view_template(str_view_template<CharT>&& src) :
-	m_Length(src.m_Length.exchange(0)),
-	m_Begin(src.m_Begin),
-	m_NullTerminatedPtr(src.m_NullTerminatedPtr.exchange(0))
+template<typename CharT, typename ViewT>
+inline void sort_views(ViewT* views, size_t count, const str_view_parallel_options& options)
 {
-	src.m_Begin = nullptr;
+    if(count < 2)
+        return;
+    std::vector<sort_item<CharT>> items(count);
+    run_chunks(count, options, [&](size_t, size_t begin, size_t end) {
+        for(size_t i = begin; i < end; ++i)
+        {
+            sort_item<CharT>& item = items[i];
+            item.str = views[i].data();
+            item.length = views[i].length();
+            item.key = sort_key(item.str, item.length, 0);
+            item.index = i;
+        }
+    });
+
+    if(count <= std::max<size_t>(options.chunkLength, 1))
+        sort_items(items.data(), count, 0);
+    else
+        sort_items_parallel(items, options);
+
+    std::vector<ViewT> sorted(count);
+    run_chunks(count, options, [&](size_t, size_t begin, size_t end) {
+        for(size_t i = begin; i < end; ++i)
+            sorted[i] = std::move(views[items[i].index]);
+    });
+    run_chunks(count, options, [&](size_t, size_t begin, size_t end) {
+        for(size_t i = begin; i < end; ++i)
+            views[i] = std::move(sorted[i]);
+    });
 }
 
-template<typename CharT>
-inline str_view_template<CharT>::~str_view_template()
+template<typename ViewT>
+inline bool unique_equal(const ViewT& lhs, const ViewT& rhs)
 {
-    uintptr_t v = m_NullTerminatedPtr;
-	if(v > 1)
-		delete[] (CharT*)v;
+    const size_t length = lhs.length();
+    return rhs.length() == length && (length == 0 || tmemcmp(lhs.data(), rhs.data(), length) == 0);
 }
 
-template<typename CharT>
-inline str_view_template<CharT>& str_view_template<CharT>::operator=(const str_view_template<CharT>& src)
+/*
+Removes consecutive equal views from [begin, end), moving the kept ones to the beginning,
+and returns their number. If keepFirst is false, the first view is equal to the one before
+begin, so it's removed too.
+*/
+template<typename ViewT>
+inline size_t unique_range(ViewT* views, size_t begin, size_t end, bool keepFirst)
 {
-	if(&src != this)
+    size_t out = begin;
+    if(keepFirst)
+        ++out;
+    for(size_t i = begin + 1; i < end; ++i)
     {
-        uintptr_t v = m_NullTerminatedPtr;
-		if(v > 1)
-			delete[] (CharT*)v;
-		m_Begin = src.m_Begin;
-		m_Length = src.m_Length.load();
-		m_NullTerminatedPtr = src.m_NullTerminatedPtr == 1 ? 1 : 0;
+        // Until a view is kept, views[begin] stays in place and is equal to the removed ones.
+        const ViewT& prev = out > begin ? views[out - 1] : views[begin];
+        if(!unique_equal(views[i], prev))
+        {
+            if(out != i)
+                views[out] = std::move(views[i]);
+            ++out;
+        }
     }
-	return *this;
+    return out - begin;
+}
+
+template<typename ViewT>
+inline size_t unique_views(ViewT* views, size_t count, const str_view_parallel_options& options)
+{
+    if(count < 2)
+        return count;
+    const size_t chunkLength = std::max<size_t>(options.chunkLength, 1);
+    const size_t chunkCount = count / chunkLength + (count % chunkLength ? 1 : 0);
+    if(chunkCount <= 1)
+        return unique_range(views, 0, count, true);
+
+    // Views at chunk borders are compared before any of them is moved.
+    std::vector<uint8_t> keepFirst(chunkCount);
+    keepFirst[0] = 1;
+    for(size_t chunkIndex = 1; chunkIndex < chunkCount; ++chunkIndex)
+        keepFirst[chunkIndex] = !unique_equal(views[chunkIndex * chunkLength], views[chunkIndex * chunkLength - 1]);
+
+    std::vector<size_t> keptCounts(chunkCount);
+    run_chunks(count, options, [&](size_t chunkIndex, size_t begin, size_t end) {
+        keptCounts[chunkIndex] = unique_range(views, begin, end, keepFirst[chunkIndex] != 0);
+    });
+
+    size_t out = keptCounts[0];
+    for(size_t chunkIndex = 1; chunkIndex < chunkCount; ++chunkIndex)
+    {
+        const size_t begin = chunkIndex * chunkLength;
+        for(size_t i = 0; i < keptCounts[chunkIndex]; ++i, ++out)
+        {
+            if(out != begin + i)
+                views[out] = std::move(views[begin + i]);
+        }
+    }
+    return out;
+}
+
+} // namespace str_view_detail
+
+/*
+Sorts views in lexicographical order of str_view_binary_compare, like std::sort with
+compare<str_view_binary_compare>(), but faster for large arrays. Order of equal views
+is unspecified.
+
+Every view gets a key of its next 8 bytes of characters (8 chars or 2-4 wchar_t),
+stored together with its pointer and length, so most comparisons compare two integers
+without touching the characters or calling length(). Ranges are sorted by multikey
+quicksort: views with equal keys are sorted by the following characters, loading their
+keys once, which doesn't compare common prefixes again.
+
+Arrays longer than options.chunkLength (here: number of views) are first divided into
+buckets of about that many views by splitters chosen from a sample, in parallel, and
+buckets are sorted as separate tasks on options.executor. Views with the same first
+8 bytes fall into the same bucket, so if most views share a long prefix, most of the
+work is done by one task.
+
+Length of every view of a null-terminated string is calculated once.
+*/
+template<typename CharT>
+inline void str_view_sort(str_view_template<CharT>* views, size_t count, const str_view_parallel_options& options = str_view_parallel_options())
+{
+    str_view_detail::sort_views<CharT>(views, count, options);
+}
+template<typename CharT>
+inline void str_view_sort(str_view_lite_template<CharT>* views, size_t count, const str_view_parallel_options& options = str_view_parallel_options())
+{
+    str_view_detail::sort_views<CharT>(views, count, options);
+}
+template<typename CharT>
+inline void str_view_sort(std::vector<str_view_template<CharT>>& views, const str_view_parallel_options& options = str_view_parallel_options())
+{
+    str_view_detail::sort_views<CharT>(views.data(), views.size(), options);
+}
+template<typename CharT>
+inline void str_view_sort(std::vector<str_view_lite_template<CharT>>& views, const str_view_parallel_options& options = str_view_parallel_options())
+{
+    str_view_detail::sort_views<CharT>(views.data(), views.size(), options);
 }
 
+/*
+Removes consecutive equal views, like std::unique: moves the first view of every group
+of equal ones to the beginning of the array, in order, and returns their number.
+Call it after str_view_sort to remove all duplicates. Views are equal when they have
+the same length and characters, like with str_view_binary_compare, which is checked
+by comparing lengths first.
+
+Arrays longer than options.chunkLength (number of views) are compared in chunks on
+options.executor. Only moving the kept views to their final place is serial.
+*/
 template<typename CharT>
-inline str_view_template<CharT>& str_view_template<CharT>::operator=(str_view_template<CharT>&& src)
+inline size_t str_view_unique(str_view_template<CharT>* views, size_t count, const str_view_parallel_options& options = str_view_parallel_options())
 {
-	if(&src != this)
-    {
-        uintptr_t v = m_NullTerminatedPtr;
-		if(v > 1)
-			delete[] (CharT*)v;
-		m_Begin = src.m_Begin;
-		m_Length = src.m_Length.exchange(0);
-		m_NullTerminatedPtr = src.m_NullTerminatedPtr.exchange(0);
-		src.m_Begin = nullptr;
-    }
-	return *this;
+    return str_view_detail::unique_views(views, count, options);
 }
-
 template<typename CharT>
-inline void str_view_template<CharT>::swap(str_view_template<CharT>& rhs) noexcept
+inline size_t str_view_unique(str_view_lite_template<CharT>* views, size_t count, const str_view_parallel_options& options = str_view_parallel_options())
 {
-    const size_t rhsLength = rhs.m_Length.load();
-    const size_t lhsLength = m_Length.exchange(rhsLength);
-    rhs.m_Length.store(lhsLength);
-
-    std::swap(m_Begin, rhs.m_Begin);
-
-    const uintptr_t rhsNullTerminatedPtr = rhs.m_NullTerminatedPtr.load();
-    const uintptr_t lhsNullTerminatedPtr = m_NullTerminatedPtr.exchange(rhsNullTerminatedPtr);
-    rhs.m_NullTerminatedPtr.store(lhsNullTerminatedPtr);
+    return str_view_detail::unique_views(views, count, options);
 }
-
+// Removes consecutive equal views and erases the rest of the vector.
 template<typename CharT>
-inline size_t str_view_template<CharT>::length() const
+inline void str_view_unique(std::vector<str_view_template<CharT>>& views, const str_view_parallel_options& options = str_view_parallel_options())
 {
-    size_t len = m_Length;
-    if(len == SIZE_MAX)
-    {
-        assert(m_NullTerminatedPtr == 1);
-        len = tstrlen(m_Begin);
-        // It doesn't matter if other thread does it at the same time.
-        // It will atomically set it to the same value.
-        m_Length = len;
-    }
-    return len;
+    views.erase(views.begin() + str_view_detail::unique_views(views.data(), views.size(), options), views.end());
 }
-
 template<typename CharT>
-inline bool str_view_template<CharT>::empty() const
+inline void str_view_unique(std::vector<str_view_lite_template<CharT>>& views, const str_view_parallel_options& options = str_view_parallel_options())
 {
-    size_t len = m_Length;
-    if(len == SIZE_MAX)
-    {
-        // Length is unknown. String is null-terminated.
-        // We still don't need to know the length. We just peek first character.
-        assert(m_NullTerminatedPtr == 1);
-        return m_Begin == nullptr || *m_Begin == (CharT)0;
-    }
-    return len == 0;
+    views.erase(views.begin() + str_view_detail::unique_views(views.data(), views.size(), options), views.end());
 }
 
+/*
+Set of unique strings, for deduplication of strings that repeat many times.
+
+intern() copies each distinct string once to memory owned by the pool and returns
+a view of that copy. The copy is null-terminated and the view knows it, so its
+length() and c_str() are free. It stays valid and unchanged until the pool is
+cleared or destroyed. Interning the same string again returns a view of the same
+copy, so interned strings can also be compared by data() pointer.
+
+Lookup takes any string that converts to str_view_lite_template, including
+str_view_template, const CharT* and StringT, and doesn't allocate memory.
+
+The pool is thread-safe. It is divided into shards, selected by hash of the string,
+each with its own lock, memory blocks and hash table, so threads interning different
+strings rarely wait for each other.
+*/
 template<typename CharT>
-inline const CharT* str_view_template<CharT>::c_str() const
+class string_pool_template
 {
-    static const CharT nullChar = (CharT)0;
-	if(empty())
-		return &nullChar;
-    uintptr_t v = m_NullTerminatedPtr;
-	if(v == 1)
+public:
+    struct Stats
     {
-        //assert(m_Begin[length()] == (CharT)0); // Make sure it's really null terminated.
-		return m_Begin;
-    }
-	if(v == 0)
+        size_t stringCount; // Number of distinct strings.
+        size_t stringBytes; // Bytes taken by strings, including null terminators.
+        size_t blockBytes; // Bytes of memory blocks allocated for strings.
+        size_t tableBytes; // Bytes taken by hash tables.
+    };
+
+    /*
+    shardCount is rounded up to a power of 2, at most 256. Use 1 for a pool used by a single thread.
+    blockBytes is size of memory blocks in which strings are stored. Longer strings get
+    their own blocks.
+    */
+    inline explicit string_pool_template(size_t shardCount = 16, size_t blockBytes = 64 * 1024);
+
+    /*
+    Returns view of the copy of str owned by the pool, making the copy if str is
+    not in the pool yet. Empty str returns empty view without making a copy.
+    */
+    inline str_view_template<CharT> intern(const str_view_lite_template<CharT>& str);
+    /*
+    Returns view of the copy of str owned by the pool, or empty view if str is not in the pool.
+    */
+    inline str_view_template<CharT> find(const str_view_lite_template<CharT>& str) const;
+    inline bool contains(const str_view_lite_template<CharT>& str) const { return str.empty() || find(str).data() != nullptr; }
+
+    // Returns number of distinct strings in the pool.
+    inline size_t size() const { return get_stats().stringCount; }
+    inline Stats get_stats() const;
+
+    /*
+    Removes all strings and frees their memory.
+    All views returned so far become invalid. Must not be called concurrently with other methods.
+    */
+    inline void clear();
+
+private:
+    struct Entry
     {
-        // Not null terminated, so length must be known.
-        assert(m_Length != SIZE_MAX);
-        CharT* nullTerminatedCopy = new CharT[m_Length + 1];
-        assert(((uintptr_t)nullTerminatedCopy & 1) == 0); // Make sure allocated address is even.
-		memcpy(nullTerminatedCopy, begin(), m_Length * sizeof(CharT));
-		nullTerminatedCopy[m_Length] = (CharT)0;
+        const CharT* str; // Null means empty slot.
+        size_t length;
+        size_t hash;
+    };
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        str_view_monotonic_arena arena;
+        std::vector<Entry> table; // Open addressing with linear probing. Size is 0 or power of 2.
+        size_t count = 0;
+        size_t stringBytes = 0;
+        char padding[64]; // So locks of different shards don't share a cache line.
 
-        uintptr_t expected = 0;
-        if(m_NullTerminatedPtr.compare_exchange_strong(expected, (uintptr_t)nullTerminatedCopy))
-            return nullTerminatedCopy;
-        else
-        {
-            // Other thread was quicker to set his copy to m_NullTerminatedPtr. Destroy mine, use that one.
-            delete[] nullTerminatedCopy;
-            return (const CharT*)expected;
-        }
-    }
-	return (const CharT*)v;
-}
+        explicit Shard(size_t blockBytes) : arena(blockBytes) { }
+    };
 
-template<typename CharT>
-inline size_t str_view_template<CharT>::copy_to(CharT* dst, size_t offset, size_t length) const
-{
-    const size_t thisLen = this->length();
-    assert(offset <= thisLen);
-    length = std::min(length, thisLen - offset);
-    memcpy(dst, m_Begin + offset, length * sizeof(CharT));
-    return length;
-}
+    enum { MAX_SHARD_COUNT = 256 };
+    std::vector<std::unique_ptr<Shard>> m_Shards;
+
+    // Selects shard by the highest bits of hash. Hash tables use the lowest bits.
+    inline Shard& shard_for(size_t hash) const { return *m_Shards[(hash >> (sizeof(size_t) * 8 - 8)) & (m_Shards.size() - 1)]; }
+    // Returns index of the slot with str or the empty slot where it should be inserted. Table must not be empty.
+    static inline size_t find_slot(const std::vector<Entry>& table, const str_view_lite_template<CharT>& str, size_t hash);
+    static inline void grow(Shard& shard);
+
+    string_pool_template(const string_pool_template<CharT>&) = delete;
+    string_pool_template<CharT>& operator=(const string_pool_template<CharT>&) = delete;
+};
+
+typedef string_pool_template<char> string_pool;
+typedef string_pool_template<wchar_t> wstring_pool;
 
 template<typename CharT>
-inline void str_view_template<CharT>::to_string(StringT& dst, size_t offset, size_t length) const
+inline string_pool_template<CharT>::string_pool_template(size_t shardCount, size_t blockBytes)
 {
-    const size_t thisLen = this->length();
-    assert(offset <= thisLen);
-    length = std::min(length, thisLen - offset);
-    dst.assign(m_Begin + offset, m_Begin + (offset + length));
+    size_t actualShardCount = 1;
+    while(actualShardCount < shardCount && actualShardCount < MAX_SHARD_COUNT)
+        actualShardCount *= 2;
+    m_Shards.reserve(actualShardCount);
+    for(size_t i = 0; i < actualShardCount; ++i)
+        m_Shards.emplace_back(new Shard(blockBytes));
 }
 
 template<typename CharT>
-inline str_view_template<CharT> str_view_template<CharT>::substr(size_t offset, size_t length) const
+inline str_view_template<CharT> string_pool_template<CharT>::intern(const str_view_lite_template<CharT>& str)
 {
-    // Length can remain unknown.
-    if(m_Length == SIZE_MAX && length == SIZE_MAX)
+    const size_t length = str.length();
+    if(length == 0)
+        return str_view_template<CharT>();
+    const size_t hash = str.hash();
+    Shard& shard = shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // Table grows only when a new string is inserted, not when an interned one is found.
+    size_t slot = shard.table.empty() ? SIZE_MAX : find_slot(shard.table, str, hash);
+    if(slot == SIZE_MAX || shard.table[slot].str == nullptr)
     {
-        assert(m_NullTerminatedPtr == 1);
-        return str_view_template<CharT>(m_Begin + offset);
+        if((shard.count + 1) * 4 > shard.table.size() * 3)
+        {
+            grow(shard);
+            slot = find_slot(shard.table, str, hash);
+        }
+        Entry& entry = shard.table[slot];
+        const size_t bytes = (length + 1) * sizeof(CharT);
+        CharT* const copy = (CharT*)shard.arena.allocate(bytes, alignof(CharT));
+        memcpy(copy, str.data(), length * sizeof(CharT));
+        copy[length] = (CharT)0;
+        entry.str = copy;
+        entry.length = length;
+        entry.hash = hash;
+        ++shard.count;
+        shard.stringBytes += bytes;
     }
-
-    const size_t thisLen = this->length();
-    assert(offset <= thisLen);
-	length = std::min(length, thisLen - offset);
-	// Result will be null-terminated.
-	if(m_NullTerminatedPtr == 1 && length == thisLen - offset)
-		return str_view_template<CharT>(m_Begin + offset, length, StillNullTerminated());
-	// Result will not be null-terminated.
-	return str_view_template<CharT>(m_Begin + offset, length);
+    const Entry& entry = shard.table[slot];
+    return str_view_template<CharT>(entry.str, length, typename str_view_template<CharT>::StillNullTerminated());
 }
 
 template<typename CharT>
-inline int str_view_template<CharT>::compare(const str_view_template<CharT>& rhs, bool case_sensitive) const
+inline str_view_template<CharT> string_pool_template<CharT>::find(const str_view_lite_template<CharT>& str) const
 {
-    const size_t lhsLen = length();
-    const size_t rhsLen = rhs.length();
-    const size_t minLen = std::min(lhsLen, rhsLen);
-
-    if(minLen > 0)
-    {
-        const int result = case_sensitive ?
-            tstrncmp(data(), rhs.data(), minLen) :
-            tstrnicmp(data(), rhs.data(), minLen);
-        if(result != 0)
-            return result;
-    }
+    const size_t length = str.length();
+    if(length == 0)
+        return str_view_template<CharT>();
+    const size_t hash = str.hash();
+    const Shard& shard = shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
 
-    if(lhsLen < rhsLen)
-        return -1;
-    if(lhsLen > rhsLen)
-        return 1;
-    return 0;
+    if(shard.table.empty())
+        return str_view_template<CharT>();
+    const Entry& entry = shard.table[find_slot(shard.table, str, hash)];
+    if(entry.str == nullptr)
+        return str_view_template<CharT>();
+    return str_view_template<CharT>(entry.str, length, typename str_view_template<CharT>::StillNullTerminated());
 }
 
 template<typename CharT>
-inline bool str_view_template<CharT>::starts_with(CharT prefix, bool case_sensitive) const
+inline typename string_pool_template<CharT>::Stats string_pool_template<CharT>::get_stats() const
 {
-    if(!empty())
+    Stats result = {};
+    for(const std::unique_ptr<Shard>& shard : m_Shards)
     {
-        if(case_sensitive)
-            return *m_Begin == prefix;
-        return tstrnicmp(m_Begin, &prefix, 1) == 0;
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        result.stringCount += shard->count;
+        result.stringBytes += shard->stringBytes;
+        result.blockBytes += shard->arena.block_bytes();
+        result.tableBytes += shard->table.capacity() * sizeof(Entry);
     }
-    return false;
+    return result;
 }
 
 template<typename CharT>
-inline bool str_view_template<CharT>::starts_with(const str_view_template<CharT>& prefix, bool case_sensitive) const
+inline void string_pool_template<CharT>::clear()
 {
-    const size_t prefixLen = prefix.length();
-    if(length() >= prefixLen)
+    for(const std::unique_ptr<Shard>& shard : m_Shards)
     {
-        const int cmpResult = case_sensitive ?
-            tstrncmp(m_Begin, prefix.m_Begin, prefixLen) :
-            tstrnicmp(m_Begin, prefix.m_Begin, prefixLen);
-        return cmpResult == 0;
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->arena.reset();
+        std::vector<Entry>().swap(shard->table);
+        shard->count = 0;
+        shard->stringBytes = 0;
     }
-    return false;
 }
 
 template<typename CharT>
-inline bool str_view_template<CharT>::ends_with(CharT suffix, bool case_sensitive) const
+inline size_t string_pool_template<CharT>::find_slot(const std::vector<Entry>& table,
+    const str_view_lite_template<CharT>& str, size_t hash)
 {
-    const size_t thisLen = length();
-    if(thisLen > 0)
+    const size_t mask = table.size() - 1;
+    for(size_t index = hash & mask; ; index = (index + 1) & mask)
     {
-        if(case_sensitive)
-            return m_Begin[thisLen - 1] == suffix;
-        return tstrnicmp(m_Begin + (thisLen - 1), &suffix, 1) == 0;
+        const Entry& entry = table[index];
+        if(entry.str == nullptr)
+            return index;
+        if(entry.hash == hash && entry.length == str.length() &&
+            memcmp(entry.str, str.data(), str.length() * sizeof(CharT)) == 0)
+        {
+            return index;
+        }
     }
-    return false;
 }
 
 template<typename CharT>
-inline bool str_view_template<CharT>::ends_with(const str_view_template<CharT>& suffix, bool case_sensitive) const
+inline void string_pool_template<CharT>::grow(Shard& shard)
 {
-    const size_t thisLen = length();
-    const size_t suffixLen = suffix.length();
-    if(thisLen >= suffixLen)
+    std::vector<Entry> newTable(shard.table.empty() ? 64 : shard.table.size() * 2, Entry());
+    const size_t mask = newTable.size() - 1;
+    for(const Entry& entry : shard.table)
     {
-        const int cmpResult = case_sensitive ?
-            tstrncmp(m_Begin + (thisLen - suffixLen), suffix.m_Begin, suffixLen) :
-            tstrnicmp(m_Begin + (thisLen - suffixLen), suffix.m_Begin, suffixLen);
-        return cmpResult == 0;
+        if(entry.str != nullptr)
+        {
+            size_t index = entry.hash & mask;
+            while(newTable[index].str != nullptr)
+                index = (index + 1) & mask;
+            newTable[index] = entry;
+        }
     }
-    return false;
+    shard.table.swap(newTable);
 }
 
-template<typename CharT>
-inline size_t str_view_template<CharT>::find(CharT ch, size_t pos) const
+#if !defined(STR_VIEW_NO_MAPPED_FILE)
+
+/*
+View of a whole file mapped to memory, read-only.
+
+Opening the file doesn't read it. The operating system loads its pages when they
+are first accessed, so only the parts that are actually used are read, even from
+a very large file.
+
+The view has known length. It's also null-terminated, so c_str() returns the mapping
+itself without making a copy: bytes after the end of the file in its last page are
+zero, and if the file size is a multiple of page size, a page of zeros is mapped
+after it. On Windows no such page is mapped, so c_str() of such file makes a copy,
+like for any view that is not null-terminated.
+
+The object can be passed as str_view_template<char>. It is the owner of the mapping:
+its copies and substrings are valid as long as it's alive and not closed. It can be
+moved, but not copied.
+
+Contents of the view are undefined if the file is modified while mapped. On Linux,
+accessing part of the file that was truncated raises SIGBUS.
+*/
+class mapped_str_view : public str_view_template<char>
 {
-    const size_t thisLen = length();
-    if(thisLen == 0)
-        return SIZE_MAX;
-    for(size_t i = pos; i < thisLen; ++i)
-    {
-        if(m_Begin[i] == ch)
-            return i;
-    }
-    return SIZE_MAX;
+public:
+    // Initializes to empty view, with no file open.
+    mapped_str_view() : m_Mapping(nullptr), m_MappingBytes(0), m_IsOpen(false) { }
+    // Opens and maps given file. Check is_open() for the result.
+    explicit mapped_str_view(const char* path) : m_Mapping(nullptr), m_MappingBytes(0), m_IsOpen(false) { open(path); }
+#if defined(_WIN32)
+    explicit mapped_str_view(const wchar_t* path) : m_Mapping(nullptr), m_MappingBytes(0), m_IsOpen(false) { open(path); }
+#endif
+    inline mapped_str_view(mapped_str_view&& src);
+    inline mapped_str_view& operator=(mapped_str_view&& src);
+    ~mapped_str_view() { close(); }
+
+    /*
+    Closes the file mapped previously, then opens and maps given file.
+    Returns false if it can't be opened or mapped - the view is then empty.
+    Empty file is opened successfully and gives empty view.
+    */
+    inline bool open(const char* path);
+#if defined(_WIN32)
+    inline bool open(const wchar_t* path);
+#endif
+    // Unmaps the file. The view becomes empty.
+    inline void close();
+    // Returns true if a file was opened successfully and not closed yet.
+    bool is_open() const { return m_IsOpen; }
+
+private:
+    void* m_Mapping; // Null if nothing is mapped, also for empty file.
+    size_t m_MappingBytes;
+    bool m_IsOpen;
+
+#if defined(_WIN32)
+    inline bool map(HANDLE file);
+#else
+    inline bool map(int file);
+#endif
+
+    mapped_str_view(const mapped_str_view&) = delete;
+    mapped_str_view& operator=(const mapped_str_view&) = delete;
+};
+
+inline mapped_str_view::mapped_str_view(mapped_str_view&& src) :
+    str_view_template<char>(std::move(src)),
+    m_Mapping(src.m_Mapping),
+    m_MappingBytes(src.m_MappingBytes),
+    m_IsOpen(src.m_IsOpen)
+{
+    src.m_Mapping = nullptr;
+    src.m_MappingBytes = 0;
+    src.m_IsOpen = false;
 }
 
-template<typename CharT>
-inline size_t str_view_template<CharT>::find(const str_view_template<CharT>& substr, size_t pos) const
+inline mapped_str_view& mapped_str_view::operator=(mapped_str_view&& src)
 {
-    const size_t subLen = substr.length();
-    if(subLen == 0)
-        return pos;
-    const size_t thisLen = length();
-    if(thisLen < subLen)
-        return SIZE_MAX;
-    const size_t maxPos = thisLen - subLen;
-    for(size_t i = pos; i <= maxPos; ++i)
+    if(&src != this)
     {
-        if(memcmp(m_Begin + i, substr.m_Begin, subLen * sizeof(CharT)) == 0)
-            return i;
+        close();
+        str_view_template<char>::operator=(std::move(src));
+        m_Mapping = src.m_Mapping;
+        m_MappingBytes = src.m_MappingBytes;
+        m_IsOpen = src.m_IsOpen;
+        src.m_Mapping = nullptr;
+        src.m_MappingBytes = 0;
+        src.m_IsOpen = false;
     }
-    return SIZE_MAX;
+    return *this;
 }
 
-template<typename CharT>
-inline size_t str_view_template<CharT>::rfind(CharT ch, size_t pos) const
+#if defined(_WIN32)
+
+inline bool mapped_str_view::open(const char* path)
 {
-    const size_t thisLen = length();
-    if(thisLen == 0)
-        return SIZE_MAX;
-    for(size_t i = std::min(pos, thisLen - 1) + 1; i--; )
-    {
-        if(m_Begin[i] == ch)
-            return i;
-    }
-    return SIZE_MAX;
+    close();
+    return map(CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
 }
 
-template<typename CharT>
-inline size_t str_view_template<CharT>::rfind(const str_view_template<CharT>& substr, size_t pos) const
+inline bool mapped_str_view::open(const wchar_t* path)
 {
-    const size_t subLen = substr.length();
-    if(subLen == 0)
-        return pos;
-    const size_t thisLen = length();
-    if(thisLen < subLen)
-        return SIZE_MAX;
-    for(size_t i = std::min(pos, thisLen - subLen) + 1; i--; )
-    {
-        if(memcmp(m_Begin + i, substr.m_Begin, subLen * sizeof(CharT)) == 0)
-            return i;
-    }
-    return SIZE_MAX;
+    close();
+    return map(CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
 }
 
-template<typename CharT>
-inline size_t str_view_template<CharT>::find_first_of(const str_view_template<CharT>& chars, size_t pos) const
+inline bool mapped_str_view::map(HANDLE file)
 {
-    const size_t charsLen = chars.length();
-    if(charsLen == 0)
-        return SIZE_MAX;
-    const size_t thisLen = length();
-    for(size_t thisIndex = pos; thisIndex < thisLen; ++thisIndex)
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize) || (uint64_t)fileSize.QuadPart >= SIZE_MAX / 2)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    const size_t size = (size_t)fileSize.QuadPart;
+    if(size > 0)
     {
-        for(size_t charsIndex = 0; charsIndex < charsLen; ++charsIndex)
+        // The view keeps the mapping object and the file open until it's unmapped.
+        const HANDLE mappingObject = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void* const mapping = mappingObject ? MapViewOfFile(mappingObject, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if(mappingObject)
+            CloseHandle(mappingObject);
+        if(mapping == nullptr)
         {
-            if(m_Begin[thisIndex] == chars.m_Begin[charsIndex])
-                return thisIndex;
+            CloseHandle(file);
+            return false;
         }
+        m_Mapping = mapping;
+        m_MappingBytes = size;
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        if(size % systemInfo.dwPageSize)
+            str_view_template<char>::operator=(str_view_template<char>((const char*)mapping, size, StillNullTerminated()));
+        else
+            str_view_template<char>::operator=(str_view_template<char>((const char*)mapping, size));
     }
-    return SIZE_MAX;
+    CloseHandle(file);
+    m_IsOpen = true;
+    return true;
 }
 
-template<typename CharT>
-inline size_t str_view_template<CharT>::find_last_of(const str_view_template<CharT>& chars, size_t pos) const
+inline void mapped_str_view::close()
 {
-    const size_t charsLen = chars.length();
-    if(charsLen == 0)
-        return SIZE_MAX;
-    const size_t thisLen = length();
-    if(thisLen == 0)
-        return SIZE_MAX;
-    for(size_t thisIndex = std::min(pos, thisLen - 1) + 1; thisIndex--; )
-    {
-        for(size_t charsIndex = 0; charsIndex < charsLen; ++charsIndex)
-        {
-            if(m_Begin[thisIndex] == chars.m_Begin[charsIndex])
-                return thisIndex;
-        }
-    }
-    return SIZE_MAX;
+    // Frees null-terminated copy, if any, before the memory it was made from.
+    str_view_template<char>::operator=(str_view_template<char>());
+    if(m_Mapping)
+        UnmapViewOfFile(m_Mapping);
+    m_Mapping = nullptr;
+    m_MappingBytes = 0;
+    m_IsOpen = false;
 }
 
-template<typename CharT>
-inline size_t str_view_template<CharT>::find_first_not_of(const str_view_template<CharT>& chars, size_t pos) const
+#else // #if defined(_WIN32)
+
+inline bool mapped_str_view::open(const char* path)
 {
-    const size_t charsLen = chars.length();
-    if(charsLen == 0)
-        return SIZE_MAX;
-    const size_t thisLen = length();
-    for(size_t thisIndex = pos; thisIndex < thisLen; ++thisIndex)
-    {
-        bool found = false;
-        for(size_t charsIndex = 0; charsIndex < charsLen; ++charsIndex)
-        {
-            if(m_Begin[thisIndex] == chars.m_Begin[charsIndex])
-            {
-                found = true;
-                break;
-            }
-        }
-        if(!found)
-            return thisIndex;
-    }
-    return SIZE_MAX;
+    close();
+    return map(::open(path, O_RDONLY | O_CLOEXEC));
 }
 
-template<typename CharT>
-inline size_t str_view_template<CharT>::find_last_not_of(const str_view_template<CharT>& chars, size_t pos) const
+inline bool mapped_str_view::map(int file)
 {
-    const size_t charsLen = chars.length();
-    if(charsLen == 0)
-        return SIZE_MAX;
-    const size_t thisLen = length();
-    if(thisLen == 0)
-        return SIZE_MAX;
-    for(size_t thisIndex = std::min(pos, thisLen - 1) + 1; thisIndex--; )
+    if(file < 0)
+        return false;
+    struct stat info;
+    if(fstat(file, &info) != 0 || (uint64_t)info.st_size >= SIZE_MAX / 2)
+    {
+        ::close(file);
+        return false;
+    }
+    const size_t size = (size_t)info.st_size;
+    if(size > 0)
     {
-        bool found = false;
-        for(size_t charsIndex = 0; charsIndex < charsLen; ++charsIndex)
+        // If there are no zeros after the end of the file in its last page, anonymous
+        // zero pages are reserved first and the file is mapped over them.
+        const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+        const bool zeroPage = size % pageSize == 0;
+        const size_t mappingBytes = zeroPage ? size + pageSize : size;
+        void* mapping = zeroPage ?
+            mmap(nullptr, mappingBytes, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) :
+            mmap(nullptr, mappingBytes, PROT_READ, MAP_PRIVATE, file, 0);
+        if(mapping != MAP_FAILED && zeroPage &&
+            mmap(mapping, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, file, 0) == MAP_FAILED)
         {
-            if(m_Begin[thisIndex] == chars.m_Begin[charsIndex])
-            {
-                found = true;
-                break;
-            }
+            munmap(mapping, mappingBytes);
+            mapping = MAP_FAILED;
         }
-        if(!found)
-            return thisIndex;
+        if(mapping == MAP_FAILED)
+        {
+            ::close(file);
+            return false;
+        }
+        m_Mapping = mapping;
+        m_MappingBytes = mappingBytes;
+        str_view_template<char>::operator=(str_view_template<char>((const char*)mapping, size, StillNullTerminated()));
     }
-    return SIZE_MAX;
+    // The mapping remains valid after the file is closed.
+    ::close(file);
+    m_IsOpen = true;
+    return true;
 }
 
-template<typename CharT>
-inline void swap(str_view_template<CharT>& lhs, str_view_template<CharT>& rhs)
+inline void mapped_str_view::close()
 {
-    lhs.swap(rhs);
+    str_view_template<char>::operator=(str_view_template<char>());
+    if(m_Mapping)
+        munmap(m_Mapping, m_MappingBytes);
+    m_Mapping = nullptr;
+    m_MappingBytes = 0;
+    m_IsOpen = false;
 }
+
+#endif // #if defined(_WIN32)
+
+#endif // #if !defined(STR_VIEW_NO_MAPPED_FILE)